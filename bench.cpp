@@ -0,0 +1,601 @@
+#include "frostjson.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * frostjson_bench: 吞吐量基准
+ *
+ * 内置生成以下语料, 对每份语料测量 parse / stringify / copy / equal / free / lookup / project / validate /
+ * pstringify, 输出 MB/s 与 ns/op, 并可写出机器可读的 JSON 结果以便跨提交比较.
+ *
+ *   canada   数字密集 (坐标数组, 类似 canada.json)
+ *   twitter  字符串密集 (状态对象数组, 含转义与非 ASCII, 类似 twitter.json)
+ *   nested   深层嵌套的数组/对象
+ *   flat     单个超大扁平对象
+ *   ndjson   逐行独立的小文档
+ *
+ * project 用 frost_parse_projected 只取 /search_metadata (仅 twitter 中存在), 其余部分被跳过;
+ * validate 用 frost_validate 只做校验; pstringify 为 frost_stringify_parallel (线程数取硬件线程数).
+ *
+ * 用法: frostjson_bench [--warmup N] [--reps N] [--scale F] [--corpus name] [--op name] [--out file]
+ */
+
+struct bench_options {
+    int warmup = 2;
+    int reps = 7;
+    double scale = 1.0;
+    const char* corpus = nullptr;
+    const char* op = nullptr;
+    const char* out = nullptr;
+};
+
+struct bench_corpus {
+    const char* name;
+    std::string json;               /* 单个文档, 或 NDJSON 的全部行 */
+    std::vector<std::string> lines; /* 仅 NDJSON: 每行一个文档 */
+};
+
+struct bench_result {
+    std::string corpus;
+    std::string op;
+    size_t bytes;
+    size_t ops;                     /* 每次重复中的操作数 (lookup 为查找次数, 其余为 1) */
+    double min_ns, median_ns;       /* 每次重复的耗时 */
+};
+
+/* 确定性的伪随机数, 保证跨提交语料一致 */
+static unsigned long long bench_seed = 0x9E3779B97F4A7C15ULL;
+
+static auto bench_rand() -> unsigned long long
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 7;
+    bench_seed ^= bench_seed << 17;
+    return bench_seed;
+}
+
+static auto bench_uniform(double lo, double hi) -> double
+{
+    return lo + (hi - lo) * (double)(bench_rand() >> 11) / (double)(1ULL << 53);
+}
+
+static void bench_append_number(std::string& out, double num)
+{
+    char buf[32];
+    out.append(buf, (size_t)sprintf(buf, "%.15g", num));
+}
+
+static void bench_append_word(std::string& out, size_t len)
+{
+    static const char alpha[] = "abcdefghijklmnopqrstuvwxyz";
+    for (size_t i = 0; i < len; i++)
+        out += alpha[bench_rand() % 26];
+}
+
+static auto bench_scaled(size_t count, double scale) -> size_t
+{
+    size_t n = (size_t)((double)count * scale);
+    return n > 0 ? n : 1;
+}
+
+static void bench_gen_canada(std::string& out, double scale)
+{
+    size_t polygons = bench_scaled(48, scale);
+    out = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},"
+          "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+    for (size_t p = 0; p < polygons; p++) {
+        size_t points = 500 + bench_rand() % 2000;
+        if (p > 0)
+            out += ',';
+        out += '[';
+        for (size_t i = 0; i < points; i++) {
+            if (i > 0)
+                out += ',';
+            out += '[';
+            bench_append_number(out, bench_uniform(-141.0, -52.0));
+            out += ',';
+            bench_append_number(out, bench_uniform(41.0, 83.0));
+            out += ']';
+        }
+        out += ']';
+    }
+    out += "]}}]}";
+}
+
+static void bench_append_text(std::string& out, size_t words)
+{
+    static const char* const extras[] = { "\\n", "\\\"", "\\u00e9", "\xe6\x97\xa5\xe6\x9c\xac", "\\/", "#tag", "@user" };
+    out += '"';
+    for (size_t w = 0; w < words; w++) {
+        if (w > 0)
+            out += ' ';
+        if (bench_rand() % 8 == 0)
+            out += extras[bench_rand() % (sizeof(extras) / sizeof(extras[0]))];
+        else
+            bench_append_word(out, 2 + bench_rand() % 9);
+    }
+    out += '"';
+}
+
+static void bench_append_status(std::string& out, size_t id)
+{
+    char buf[64];
+    out += "{\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",\"id\":";
+    out.append(buf, (size_t)sprintf(buf, "%llu", 505874924095815681ULL + (unsigned long long)id));
+    out += ",\"text\":";
+    bench_append_text(out, 8 + bench_rand() % 16);
+    out += ",\"source\":\"<a href=\\\"http://twitter.com/download/iphone\\\" rel=\\\"nofollow\\\">Twitter for iPhone</a>\"";
+    out += ",\"truncated\":false,\"in_reply_to_status_id\":null,\"user\":{\"id\":";
+    out.append(buf, (size_t)sprintf(buf, "%llu", bench_rand() % 4000000000ULL));
+    out += ",\"name\":";
+    bench_append_text(out, 2);
+    out += ",\"screen_name\":\"";
+    bench_append_word(out, 6 + bench_rand() % 8);
+    out += "\",\"description\":";
+    bench_append_text(out, 4 + bench_rand() % 20);
+    out += ",\"followers_count\":";
+    out.append(buf, (size_t)sprintf(buf, "%llu", bench_rand() % 100000));
+    out += ",\"verified\":false,\"lang\":\"ja\"},\"entities\":{\"hashtags\":[],\"urls\":[],\"user_mentions\":[";
+    size_t mentions = bench_rand() % 3;
+    for (size_t i = 0; i < mentions; i++) {
+        if (i > 0)
+            out += ',';
+        out += "{\"screen_name\":\"";
+        bench_append_word(out, 8);
+        out += "\",\"indices\":[0,9]}";
+    }
+    out += "]},\"retweet_count\":";
+    out.append(buf, (size_t)sprintf(buf, "%llu", bench_rand() % 1000));
+    out += ",\"favorited\":false,\"retweeted\":false,\"lang\":\"ja\"}";
+}
+
+static void bench_gen_twitter(std::string& out, double scale)
+{
+    size_t statuses = bench_scaled(2000, scale);
+    out = "{\"statuses\":[";
+    for (size_t i = 0; i < statuses; i++) {
+        if (i > 0)
+            out += ',';
+        bench_append_status(out, i);
+    }
+    out += "],\"search_metadata\":{\"completed_in\":0.087,\"count\":100,\"query\":\"%E4%B8%80\"}}";
+}
+
+static void bench_append_nested(std::string& out, int depth)
+{
+    if (depth == 0) {
+        out += "[1,\"leaf\",true]";
+        return;
+    }
+    if (depth % 2 == 0) {
+        out += "{\"k\":";
+        bench_append_nested(out, depth - 1);
+        out += ",\"n\":";
+        out += std::to_string(depth);
+        out += '}';
+    } else {
+        out += '[';
+        bench_append_nested(out, depth - 1);
+        out += ",null]";
+    }
+}
+
+static void bench_gen_nested(std::string& out, double scale)
+{
+    size_t chains = bench_scaled(2000, scale);
+    out = "[";
+    for (size_t i = 0; i < chains; i++) {
+        if (i > 0)
+            out += ',';
+        bench_append_nested(out, 64 + (int)(i % 64) * 4);
+    }
+    out += ']';
+}
+
+static void bench_gen_flat(std::string& out, double scale)
+{
+    size_t members = bench_scaled(20000, scale);
+    char buf[32];
+    out = "{";
+    for (size_t i = 0; i < members; i++) {
+        if (i > 0)
+            out += ',';
+        out.append(buf, (size_t)sprintf(buf, "\"key_%zu_", i));
+        bench_append_word(out, 4);
+        out += "\":";
+        switch (i % 4) {
+        case 0:
+            bench_append_number(out, bench_uniform(-1e6, 1e6));
+            break;
+        case 1:
+            bench_append_text(out, 2);
+            break;
+        case 2:
+            out += (bench_rand() & 1) != 0 ? "true" : "false";
+            break;
+        default:
+            out += "null";
+        }
+    }
+    out += '}';
+}
+
+static void bench_gen_ndjson(bench_corpus& cor, double scale)
+{
+    size_t lines = bench_scaled(20000, scale);
+    cor.json.clear();
+    cor.lines.reserve(lines);
+    for (size_t i = 0; i < lines; i++) {
+        std::string line = "{\"seq\":";
+        line += std::to_string(i);
+        line += ",\"level\":\"";
+        line += (i % 5 == 0) ? "warn" : "info";
+        line += "\",\"latency_ms\":";
+        bench_append_number(line, bench_uniform(0.0, 250.0));
+        line += ",\"msg\":";
+        bench_append_text(line, 3 + bench_rand() % 6);
+        line += ",\"tags\":[\"a\",\"b\"]}";
+        cor.json += line;
+        cor.json += '\n';
+        cor.lines.push_back(std::move(line));
+    }
+}
+
+/* 一份语料被解析后的形式: NDJSON 为多个文档, 其余为单个 */
+using bench_doc = std::vector<frost_value>;
+
+static void bench_parse_doc(const bench_corpus& cor, bench_doc& doc)
+{
+    if (cor.lines.empty()) {
+        doc.resize(1);
+        frost_init(&doc[0]);
+        if (frost_parse(&doc[0], cor.json.c_str()) != FROST_PARSE_OK) {
+            fprintf(stderr, "bench: failed to parse corpus %s\n", cor.name);
+            exit(1);
+        }
+        return;
+    }
+    doc.resize(cor.lines.size());
+    for (size_t i = 0; i < cor.lines.size(); i++) {
+        frost_init(&doc[i]);
+        if (frost_parse(&doc[i], cor.lines[i].c_str()) != FROST_PARSE_OK) {
+            fprintf(stderr, "bench: failed to parse line %zu of corpus %s\n", i, cor.name);
+            exit(1);
+        }
+    }
+}
+
+static void bench_free_doc(bench_doc& doc)
+{
+    for (auto& val : doc)
+        frost_free(&val);
+}
+
+/* 阻止编译器把结果优化掉 */
+static volatile size_t bench_sink;
+
+static auto bench_lookup_value(frost_value* val) -> size_t
+{
+    size_t i = 0;
+    size_t count = 0;
+    if (val->type == FROST_ARRAY) {
+        for (i = 0; i < val->u.a.size; i++)
+            count += bench_lookup_value(&val->u.a.e[i]);
+    } else if (val->type == FROST_OBJECT) {
+        /* 每个对象最多均匀查找 16 个已存在的键, 外加一次不存在的键 */
+        size_t size = val->u.o.size;
+        size_t step = size > 16 ? size / 16 : 1;
+        for (i = 0; i < size; i += step) {
+            frost_value* found = frost_find_object_value(val, val->u.o.m[i].k, val->u.o.m[i].klen);
+            bench_sink += (size_t)(found != nullptr);
+            count++;
+        }
+        bench_sink += (size_t)(frost_find_object_value(val, "__missing__", 11) != nullptr);
+        count++;
+        for (i = 0; i < size; i++)
+            count += bench_lookup_value(&val->u.o.m[i].v);
+    }
+    return count;
+}
+
+using bench_clock = std::chrono::steady_clock;
+
+static auto bench_elapsed_ns(bench_clock::time_point start) -> double
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count();
+}
+
+/* 执行一次被测操作, 返回其耗时; 准备与清理不计时 */
+static auto bench_run_once(const bench_corpus& cor, const std::string& op, size_t* ops) -> double
+{
+    bench_doc doc;
+    bench_doc other;
+    double ns = 0.0;
+    size_t i = 0;
+    *ops = 1;
+    if (op == "parse") {
+        auto start = bench_clock::now();
+        bench_parse_doc(cor, doc);
+        ns = bench_elapsed_ns(start);
+        bench_free_doc(doc);
+        return ns;
+    }
+    if (op == "validate") {
+        const std::vector<std::string> whole(1, cor.json);
+        const std::vector<std::string>& src = cor.lines.empty() ? whole : cor.lines;
+        auto start = bench_clock::now();
+        for (i = 0; i < src.size(); i++)
+            if (frost_validate(src[i].c_str(), src[i].size(), nullptr) != FROST_PARSE_OK) {
+                fprintf(stderr, "bench: failed to validate corpus %s\n", cor.name);
+                exit(1);
+            }
+        return bench_elapsed_ns(start);
+    }
+    if (op == "project") {
+        static const char* const paths[] = { "/search_metadata" };
+        frost_projection* proj = frost_projection_create(paths, 1);
+        const std::vector<std::string> whole(1, cor.json);
+        const std::vector<std::string>& src = cor.lines.empty() ? whole : cor.lines;
+        doc.resize(src.size());
+        auto start = bench_clock::now();
+        for (i = 0; i < src.size(); i++)
+            if (frost_parse_projected(&doc[i], src[i].c_str(), src[i].size(), proj) != FROST_PARSE_OK) {
+                fprintf(stderr, "bench: failed to project corpus %s\n", cor.name);
+                exit(1);
+            }
+        ns = bench_elapsed_ns(start);
+        bench_free_doc(doc);
+        frost_projection_free(proj);
+        return ns;
+    }
+    if (op == "astream") {
+        /* 把 ndjson 的各行 (其他语料为整个文档) 作为一个顶层数组的元素, 逐个取出后立即释放 */
+        std::string array = "[";
+        frost_value val;
+        if (cor.lines.empty())
+            array += cor.json;
+        for (i = 0; i < cor.lines.size(); i++)
+            array += (i == 0 ? "" : ",") + cor.lines[i];
+        array += "]";
+        size_t count = 0;
+        auto start = bench_clock::now();
+        frost_array_stream* stm = frost_array_stream_open_buffer(array.c_str(), array.size(), nullptr);
+        for (; frost_array_stream_next(stm, &val) != 0; count++)
+            frost_free(&val);
+        if (frost_array_stream_get_error(stm) != FROST_PARSE_OK) {
+            fprintf(stderr, "bench: failed to stream corpus %s\n", cor.name);
+            exit(1);
+        }
+        frost_array_stream_close(stm);
+        ns = bench_elapsed_ns(start);
+        *ops = count;
+        return ns;
+    }
+    bench_parse_doc(cor, doc);
+    if (op == "stringify" || op == "pstringify") {
+        std::vector<char*> outs(doc.size());
+        auto start = bench_clock::now();
+        for (i = 0; i < doc.size(); i++)
+            outs[i] = op == "stringify" ? frost_stringify(&doc[i], nullptr) : frost_stringify_parallel(&doc[i], nullptr, 0);
+        ns = bench_elapsed_ns(start);
+        for (char* out : outs)
+            free(out);
+    } else if (op == "copy" || op == "pcopy") {
+        other.resize(doc.size());
+        for (auto& val : other)
+            frost_init(&val);
+        auto start = bench_clock::now();
+        for (i = 0; i < doc.size(); i++)
+            if (op == "copy")
+                frost_copy(&other[i], &doc[i]);
+            else
+                frost_copy_parallel(&other[i], &doc[i], 0);
+        ns = bench_elapsed_ns(start);
+        bench_free_doc(other);
+    } else if (op == "equal" || op == "pequal") {
+        bench_parse_doc(cor, other);
+        size_t equal = 0;
+        auto start = bench_clock::now();
+        for (i = 0; i < doc.size(); i++)
+            equal += (size_t)(op == "equal" ? frost_is_equal(&doc[i], &other[i]) : frost_is_equal_parallel(&doc[i], &other[i], 0));
+        ns = bench_elapsed_ns(start);
+        if (equal != doc.size()) {
+            fprintf(stderr, "bench: corpus %s is not equal to itself\n", cor.name);
+            exit(1);
+        }
+        bench_free_doc(other);
+    } else if (op == "free") {
+        auto start = bench_clock::now();
+        bench_free_doc(doc);
+        return bench_elapsed_ns(start);
+    } else if (op == "dfree") {
+        /* 只计调用方的耗时, 等待回收线程不计时 */
+        auto start = bench_clock::now();
+        for (auto& val : doc)
+            frost_free_deferred(&val);
+        ns = bench_elapsed_ns(start);
+        frost_reclaim_drain();
+        return ns;
+    } else if (op == "lookup") {
+        size_t count = 0;
+        auto start = bench_clock::now();
+        for (auto& val : doc)
+            count += bench_lookup_value(&val);
+        ns = bench_elapsed_ns(start);
+        *ops = count > 0 ? count : 1;
+    }
+    bench_free_doc(doc);
+    return ns;
+}
+
+static auto bench_measure(const bench_corpus& cor, const char* op, const bench_options& opt) -> bench_result
+{
+    bench_result res;
+    std::vector<double> samples;
+    size_t ops = 1;
+    int i = 0;
+    for (i = 0; i < opt.warmup; i++)
+        bench_run_once(cor, op, &ops);
+    for (i = 0; i < opt.reps; i++)
+        samples.push_back(bench_run_once(cor, op, &ops));
+    std::sort(samples.begin(), samples.end());
+    res.corpus = cor.name;
+    res.op = op;
+    res.bytes = cor.json.size();
+    res.ops = ops;
+    res.min_ns = samples.front();
+    res.median_ns = samples[samples.size() / 2];
+    return res;
+}
+
+static auto bench_mb_per_s(size_t bytes, double ns) -> double
+{
+    return ns > 0.0 ? (double)bytes / (1024.0 * 1024.0) / (ns * 1e-9) : 0.0;
+}
+
+static void bench_set_string(frost_value* obj, const char* key, const std::string& str)
+{
+    frost_set_string(frost_set_object_value(obj, key, strlen(key)), str.c_str(), str.size());
+}
+
+static void bench_set_number(frost_value* obj, const char* key, double num)
+{
+    frost_set_number(frost_set_object_value(obj, key, strlen(key)), num);
+}
+
+/* 用 frostjson 自身生成结果文件 */
+static auto bench_write_results(const char* path, const bench_options& opt, const std::vector<bench_result>& results) -> int
+{
+    frost_value root;
+    frost_value* list = nullptr;
+    char* json = nullptr;
+    size_t length = 0;
+    FILE* fp = nullptr;
+    frost_init(&root);
+    frost_set_object(&root, 0);
+#ifdef NDEBUG
+    bench_set_string(&root, "build", "release");
+#else
+    bench_set_string(&root, "build", "debug");
+#endif
+    bench_set_number(&root, "warmup", opt.warmup);
+    bench_set_number(&root, "reps", opt.reps);
+    bench_set_number(&root, "scale", opt.scale);
+    list = frost_set_object_value(&root, "results", 7);
+    frost_set_array(list, results.size());
+    for (const auto& res : results) {
+        frost_value* item = frost_pushback_array_element(list);
+        frost_set_object(item, 0);
+        bench_set_string(item, "corpus", res.corpus);
+        bench_set_string(item, "op", res.op);
+        bench_set_number(item, "bytes", (double)res.bytes);
+        bench_set_number(item, "ops", (double)res.ops);
+        bench_set_number(item, "min_ns", res.min_ns);
+        bench_set_number(item, "median_ns", res.median_ns);
+        bench_set_number(item, "ns_per_op", res.median_ns / (double)res.ops);
+        bench_set_number(item, "mb_per_s", bench_mb_per_s(res.bytes, res.median_ns));
+    }
+    json = frost_stringify(&root, &length);
+    frost_free(&root);
+    fp = fopen(path, "wb");
+    if (fp == nullptr) {
+        free(json);
+        return 0;
+    }
+    fwrite(json, 1, length, fp);
+    fputc('\n', fp);
+    fclose(fp);
+    free(json);
+    return 1;
+}
+
+static auto bench_parse_args(int argc, char** argv, bench_options& opt) -> int
+{
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* next = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+            return 0;
+        if (next == nullptr) {
+            fprintf(stderr, "bench: missing value for %s\n", arg);
+            return 0;
+        }
+        if (strcmp(arg, "--warmup") == 0)
+            opt.warmup = atoi(next);
+        else if (strcmp(arg, "--reps") == 0)
+            opt.reps = atoi(next);
+        else if (strcmp(arg, "--scale") == 0)
+            opt.scale = atof(next);
+        else if (strcmp(arg, "--corpus") == 0)
+            opt.corpus = next;
+        else if (strcmp(arg, "--op") == 0)
+            opt.op = next;
+        else if (strcmp(arg, "--out") == 0)
+            opt.out = next;
+        else {
+            fprintf(stderr, "bench: unknown option %s\n", arg);
+            return 0;
+        }
+        i++;
+    }
+    if (opt.warmup < 0)
+        opt.warmup = 0;
+    if (opt.reps < 1)
+        opt.reps = 1;
+    return opt.scale > 0.0;
+}
+
+auto main(int argc, char** argv) -> int {
+    static const char* const ops[] = { "parse", "stringify", "copy", "equal", "free", "lookup", "project", "validate", "pstringify", "dfree", "pcopy", "pequal", "astream" };
+    bench_options opt;
+    std::vector<bench_corpus> corpora;
+    std::vector<bench_result> results;
+
+    if (bench_parse_args(argc, argv, opt) == 0) {
+        fprintf(stderr, "usage: %s [--warmup N] [--reps N] [--scale F] [--corpus name] [--op name] [--out file]\n", argv[0]);
+        fprintf(stderr, "  corpora: canada twitter nested flat ndjson\n");
+        fprintf(stderr, "  ops:     parse stringify copy equal free lookup project validate pstringify dfree pcopy pequal astream\n");
+        return 1;
+    }
+#ifndef NDEBUG
+    fprintf(stderr, "bench: warning: built without NDEBUG, numbers include assertions\n");
+#endif
+
+    corpora.resize(5);
+    corpora[0].name = "canada";
+    bench_gen_canada(corpora[0].json, opt.scale);
+    corpora[1].name = "twitter";
+    bench_gen_twitter(corpora[1].json, opt.scale);
+    corpora[2].name = "nested";
+    bench_gen_nested(corpora[2].json, opt.scale);
+    corpora[3].name = "flat";
+    bench_gen_flat(corpora[3].json, opt.scale);
+    corpora[4].name = "ndjson";
+    bench_gen_ndjson(corpora[4], opt.scale);
+
+    printf("%-8s %-10s %12s %12s %14s %12s\n", "corpus", "op", "bytes", "MB/s", "ns/op", "ops");
+    for (const auto& cor : corpora) {
+        if (opt.corpus != nullptr && strcmp(opt.corpus, cor.name) != 0)
+            continue;
+        for (const char* op : ops) {
+            if (opt.op != nullptr && strcmp(opt.op, op) != 0)
+                continue;
+            bench_result res = bench_measure(cor, op, opt);
+            printf("%-8s %-10s %12zu %12.1f %14.1f %12zu\n", res.corpus.c_str(), res.op.c_str(), res.bytes,
+                bench_mb_per_s(res.bytes, res.median_ns), res.median_ns / (double)res.ops, res.ops);
+            fflush(stdout);
+            results.push_back(res);
+        }
+    }
+
+    if (opt.out != nullptr && bench_write_results(opt.out, opt, results) == 0) {
+        fprintf(stderr, "bench: cannot write %s\n", opt.out);
+        return 1;
+    }
+    return 0;
+}
@@ -1,13 +1,40 @@
 #include "frostjson.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cctype>
 #include <cerrno>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
 #include <stdio.h>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FROST_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define FROST_SIMD_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+/* 对齐读取可能越过字符串结尾 (不会跨页), 不应被 ASan 报告 */
+#define FROST_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define FROST_NO_SANITIZE_ADDRESS
+#endif
 
 #ifndef FROST_PARSE_STACK_INIT_SIZE
 #define FROST_PARSE_STACK_INIT_SIZE 256
@@ -15,6 +42,18 @@
 #ifndef FROST_PARSE_STRINGIFY_INIT_SIZE
 #define FROST_PARSE_STRINGIFY_INIT_SIZE 256
 #endif
+#ifndef FROST_STRINGIFY_PARALLEL_MIN
+#define FROST_STRINGIFY_PARALLEL_MIN 4096   /* 容器的元素/成员数达到此值才分块并行输出 */
+#endif
+#ifndef FROST_ARRAY_STREAM_CHUNK
+#define FROST_ARRAY_STREAM_CHUNK 65536     /* 流式读取每次至少读入的字节数 */
+#endif
+#ifndef FROST_SKIP_MAX_DEPTH
+#define FROST_SKIP_MAX_DEPTH 10000  /* 跳过 (frost_validate / frost_skip 等) 的嵌套层数上限 */
+#endif
+#ifndef FROST_SORTED_SEARCH_MIN
+#define FROST_SORTED_SEARCH_MIN 16  /* 有序对象的成员数达到此值才用二分查找, 更少时顺序比较更快 */
+#endif
 
 #define EXPECT(c, ch)             \
     do {                          \
@@ -29,12 +68,52 @@
 
 #define PUTS(c, s, len) memcpy(frost_context_push(c, len), s, len)
 
+/* 冻结的值不能修改 */
+#define FROST_ASSERT_WRITABLE(v) assert(((v)->flags & FROST_FLAG_FROZEN) == 0)
+
+/* 即将修改容器: 共享节点先写时复制出独占的一层, 紧凑块中的一层移回单独的分配 */
+#define FROST_MUTATE(v)                                                     \
+    do {                                                                    \
+        FROST_ASSERT_WRITABLE(v);                                           \
+        if (((v)->flags & (FROST_FLAG_SHARED | FROST_FLAG_ARENA)) != 0)     \
+            frost_unshare(v);                                               \
+    } while (0)
+
+/* 取出元素的可写指针: 只需独占而不改变缓冲区, 紧凑块中的节点留在原处; 冻结的值保持不变,
+ * 以便多个线程同时读取 */
+#define FROST_ACCESS(v)                                                                         \
+    do {                                                                                        \
+        if (((v)->flags & (FROST_FLAG_FROZEN | FROST_FLAG_SHARED)) == FROST_FLAG_SHARED)        \
+            frost_claim(v);                                                                     \
+    } while (0)
+
 using frost_context = struct {
     const char* json;
     char* stack;
     size_t size, top;
+    unsigned flags;     /* 解析选项 FROST_PARSE_* */
+    size_t depth;       /* 当前的容器嵌套层数 */
+    size_t bytes;       /* 已为结果分配的堆内存 */
+    size_t max_bytes, max_depth, max_string, max_elements, max_digits;  /* 资源上限, 不限制时为 SIZE_MAX */
 };
 
+#define FROST_PARSE_LIMIT(opt, field) ((opt) != nullptr && (opt)->field != 0 ? (opt)->field : SIZE_MAX)
+
+/* 解析用的上下文; opt 可以为 nullptr */
+static void frost_context_init(frost_context* cot, const char* json, const frost_parse_options* opt)
+{
+    cot->json = json;
+    cot->stack = nullptr;
+    cot->size = cot->top = 0;
+    cot->flags = opt != nullptr ? opt->flags : 0;
+    cot->depth = cot->bytes = 0;
+    cot->max_bytes = FROST_PARSE_LIMIT(opt, max_bytes);
+    cot->max_depth = FROST_PARSE_LIMIT(opt, max_depth);
+    cot->max_string = FROST_PARSE_LIMIT(opt, max_string);
+    cot->max_elements = FROST_PARSE_LIMIT(opt, max_elements);
+    cot->max_digits = FROST_PARSE_LIMIT(opt, max_digits);
+}
+
 static auto frost_context_push(frost_context* cot, size_t size) -> void*
 {
     void* ret = nullptr;
@@ -58,6 +137,29 @@ static auto frost_context_pop(frost_context* cot, size_t size) -> void*
     return cot->stack + (cot->top -= size);
 }
 
+/*
+ * 内存上限: 解析栈的容量与已为结果分配的字节数之和不超过 max_bytes.
+ * frost_parse_reserve 在压栈前检查, 只有需要扩容时才计算扩容后的容量;
+ * frost_parse_charge 在为结果分配前记账.
+ */
+static inline auto frost_parse_reserve(frost_context* cot, size_t size) -> int
+{
+    size_t cap = cot->size == 0 ? FROST_PARSE_STACK_INIT_SIZE : cot->size;
+    if (cot->top + size < cot->size)
+        return 1;
+    while (cot->top + size >= cap)
+        cap += cap >> 1;
+    return cap <= cot->max_bytes - cot->bytes;
+}
+
+static inline auto frost_parse_charge(frost_context* cot, size_t size) -> int
+{
+    if (size > cot->max_bytes - cot->bytes - cot->size)
+        return 0;
+    cot->bytes += size;
+    return 1;
+}
+
 static void frost_parse_whitespace(frost_context* cot)
 {
     const char* par = cot->json;
@@ -80,35 +182,136 @@ static auto frost_parse_literal(frost_context* cot, frost_value* val, const char
     return FROST_PARSE_OK;
 }
 
-static auto frost_parse_number(frost_context* cot, frost_value* val) -> int
+/*
+ * 整数字面量 (无小数与指数部分) 能放进 int64/uint64 时精确保存, 不经过 strtod.
+ * mag 为整数部分的值; 超过 20 位, 或 20 位但大于 UINT64_MAX 时已经溢出. "-0" 保留为 double 以保留符号
+ */
+static auto frost_parse_integer(frost_value* val, int neg, const char* digits, size_t len, uint64_t mag) -> int
+{
+    if (len > 20 || (len == 20 && memcmp(digits, "18446744073709551615", 20) > 0))
+        return 0;
+    if (neg != 0) {
+        if (mag == 0 || mag > (uint64_t)INT64_MAX + 1)
+            return 0;
+        val->u.i64 = (int64_t)(0 - mag);
+        val->flags |= FROST_FLAG_INT64;
+    } else if (mag <= (uint64_t)INT64_MAX) {
+        val->u.i64 = (int64_t)mag;
+        val->flags |= FROST_FLAG_INT64;
+    } else {
+        val->u.u64 = mag;
+        val->flags |= FROST_FLAG_UINT64;
+    }
+    val->type = FROST_NUMBER;
+    return 1;
+}
+
+/* 保存数字的源文本: 不超过 15 字节时内联, 否则复制到堆上 */
+static void frost_set_number_text(frost_value* val, const char* str, size_t len)
+{
+    if (len <= sizeof(val->u.ri.s)) {
+        memcpy(val->u.ri.s, str, len);
+        val->u.ri.len = (unsigned char)len;
+        val->flags |= FROST_FLAG_RAW_NUMBER;
+    } else {
+        val->u.rh.s = (char*)malloc(len + 1);
+        memcpy(val->u.rh.s, str, len);
+        val->u.rh.s[len] = '\0';
+        val->u.rh.len = len;
+        val->flags |= FROST_FLAG_RAW_NUMBER | FROST_FLAG_RAW_HEAP;
+    }
+    val->type = FROST_NUMBER;
+}
+
+/* 延迟数字不调用 strtod: 按 (整数部分位数 - 1 + 指数) 估计数量级, 达到 308 时才用 strtod 确认是否溢出 */
+static auto frost_number_too_big(const char* json, const char* end) -> int
+{
+    const char* p = json;
+    long mag = -1;
+    long exp = 0;
+    int neg = 0;
+    double num = 0.0;
+    if (*p == '-')
+        p++;
+    while (p < end && isdigit(*p) != 0) {
+        mag++;
+        p++;
+    }
+    while (p < end && *p != 'e' && *p != 'E')
+        p++;
+    if (p < end) {
+        p++;
+        if (*p == '+' || *p == '-')
+            neg = *p++ == '-';
+        while (p < end && exp < 100000)
+            exp = exp * 10 + (*p++ - '0');
+    }
+    if (mag + (neg != 0 ? -exp : exp) < 308)
+        return 0;
+    errno = 0;
+    num = strtod(json, nullptr);
+    return errno == ERANGE && (num == HUGE_VAL || num == -HUGE_VAL);
+}
+
+/* 校验数字的语法, 返回数字之后的位置, 非法时返回 nullptr; 同时求出整数部分的值及是否为整数字面量 */
+static auto frost_scan_number(const char* end, uint64_t* mag, int* integer) -> const char*
 {
-    const char* end = cot->json;
+    *mag = 0;
+    *integer = 1;
     if (*end == '-')
         end++;
     if (*end == '0')
         end++;
     else {
         if (isdigit(*end) == 0)
-            return FROST_PARSE_INVALID_VALUE;
+            return nullptr;
         while (isdigit(*end) != 0)
-            end++;
+            *mag = *mag * 10 + (uint64_t)(*end++ - '0');
     }
     if (*end == '.') {
+        *integer = 0;
         end++;
         if (isdigit(*end) == 0)
-            return FROST_PARSE_INVALID_VALUE;
+            return nullptr;
         while (isdigit(*end) != 0)
             end++;
     }
     if (*end == 'e' || *end == 'E') {
+        *integer = 0;
         end++;
         if (*end == '+' || *end == '-')
             end++;
         if (isdigit(*end) == 0)
-            return FROST_PARSE_INVALID_VALUE;
+            return nullptr;
         while (isdigit(*end) != 0)
             end++;
     }
+    return end;
+}
+
+static auto frost_parse_number(frost_context* cot, frost_value* val) -> int
+{
+    const char* digits = cot->json + (*cot->json == '-');
+    uint64_t mag = 0;
+    int integer = 1;
+    const char* end = frost_scan_number(cot->json, &mag, &integer);
+    if (end == nullptr)
+        return FROST_PARSE_INVALID_VALUE;
+    if ((size_t)(end - cot->json) > cot->max_digits)
+        return FROST_PARSE_NUMBER_TOO_LONG;
+    if ((cot->flags & FROST_PARSE_RAW_NUMBERS) != 0) {
+        if (frost_number_too_big(cot->json, end) != 0)
+            return FROST_PARSE_NUMBER_TOO_BIG;
+        if ((size_t)(end - cot->json) > sizeof(val->u.ri.s) && frost_parse_charge(cot, (size_t)(end - cot->json) + 1) == 0)
+            return FROST_PARSE_MEMORY_EXCEEDED;
+        frost_set_number_text(val, cot->json, (size_t)(end - cot->json));
+        cot->json = end;
+        return FROST_PARSE_OK;
+    }
+    if (integer != 0 && frost_parse_integer(val, *cot->json == '-', digits, (size_t)(end - digits), mag) != 0) {
+        cot->json = end;
+        return FROST_PARSE_OK;
+    }
     errno = 0;
     val->u.n = strtod(cot->json, nullptr);
     if (errno == ERANGE && (val->u.n == HUGE_VAL || val->u.n == -HUGE_VAL)) {
@@ -119,6 +322,33 @@ static auto frost_parse_number(frost_context* cot, frost_value* val) -> int
     return FROST_PARSE_OK;
 }
 
+/* 延迟数字首次读取时按与解析相同的规则转换, 结果写入与文本不重叠的 value 并缓存 */
+static void frost_number_load(const frost_value* val)
+{
+    auto* num = (frost_value*)val;
+    const char* str = nullptr;
+    size_t len = 0;
+    size_t i = 0;
+    uint64_t mag = 0;
+    int neg = 0;
+    char buf[sizeof(val->u.ri.s) + 1];
+    if ((val->flags & (FROST_FLAG_RAW_NUMBER | FROST_FLAG_NUMBER_CACHED)) != FROST_FLAG_RAW_NUMBER)
+        return;
+    str = frost_get_number_text(val, &len);
+    neg = str[0] == '-';
+    for (i = (size_t)neg; i < len && isdigit(str[i]) != 0; i++)
+        mag = mag * 10 + (uint64_t)(str[i] - '0');
+    if (i < len || frost_parse_integer(num, neg, str + neg, len - neg, mag) == 0) {
+        if ((val->flags & FROST_FLAG_RAW_HEAP) == 0) {
+            memcpy(buf, str, len);
+            buf[len] = '\0';
+            str = buf;
+        }
+        num->u.n = strtod(str, nullptr);
+    }
+    num->flags |= FROST_FLAG_NUMBER_CACHED;
+}
+
 /*读取4位16进制数字*/
 static auto frost_parse_hex4(const char* end, unsigned* uns) -> const char*
 {
@@ -159,6 +389,185 @@ static void frost_encode_utf8(frost_context* cot, unsigned uns)
     }
 }
 
+/*
+ * UTF-8 校验
+ *
+ * 标量版本为逐字节状态机; x86 上若 CPU 支持 SSSE3, 则使用查表法 (Keiser & Lemire,
+ * "Validating UTF-8 In Less Than One Instruction Per Byte") 每次检查 16 字节,
+ * 纯 ASCII 的块只做一次 movemask.
+ */
+static auto frost_validate_utf8_scalar(const unsigned char* str, size_t len) -> int
+{
+    size_t i = 0;
+    while (i < len) {
+        unsigned char ch = str[i];
+        size_t n = 0;
+        unsigned min = 0;
+        unsigned uns = 0;
+        if (ch < 0x80) {
+            i++;
+            continue;
+        }
+        if (ch >= 0xC2 && ch <= 0xDF) {
+            n = 1;
+            min = 0x80;
+            uns = ch & 0x1F;
+        } else if (ch >= 0xE0 && ch <= 0xEF) {
+            n = 2;
+            min = 0x800;
+            uns = ch & 0x0F;
+        } else if (ch >= 0xF0 && ch <= 0xF4) {
+            n = 3;
+            min = 0x10000;
+            uns = ch & 0x07;
+        } else
+            return 0;
+        if (len - i <= n)
+            return 0;
+        for (size_t j = 1; j <= n; j++) {
+            if ((str[i + j] & 0xC0) != 0x80)
+                return 0;
+            uns = (uns << 6) | (str[i + j] & 0x3F);
+        }
+        if (uns < min || uns > 0x10FFFF || (uns >= 0xD800 && uns <= 0xDFFF))
+            return 0;
+        i += n + 1;
+    }
+    return 1;
+}
+
+#if FROST_SIMD_X86
+#define FROST_TARGET_SSSE3 __attribute__((target("ssse3")))
+
+/* 取 prev 末尾与 input 开头拼成的、向前错开 n 字节的向量 */
+#define FROST_UTF8_PREV(input, prev, n) _mm_alignr_epi8(input, prev, 16 - (n))
+
+FROST_TARGET_SSSE3
+static inline auto frost_utf8_check_block(__m128i input, __m128i prev) -> __m128i
+{
+    /* 各类错误的位标记, 见论文表 */
+    enum {
+        TOO_SHORT = 1 << 0, TOO_LONG = 1 << 1, OVERLONG_3 = 1 << 2, TOO_LARGE = 1 << 3,
+        SURROGATE = 1 << 4, OVERLONG_2 = 1 << 5, TOO_LARGE_1000 = 1 << 6, OVERLONG_4 = 1 << 6,
+        TWO_CONTS = 1 << 7, CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS
+    };
+    const __m128i byte_1_high_table = _mm_setr_epi8(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m128i byte_1_low_table = _mm_setr_epi8(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, CARRY | OVERLONG_2, CARRY, CARRY,
+        CARRY | TOO_LARGE, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000);
+    const __m128i byte_2_high_table = _mm_setr_epi8(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = FROST_UTF8_PREV(input, prev, 1);
+    __m128i byte_1_high = _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+    /* 第 3、4 字节必须是续字节, 这在 special 中表现为 TWO_CONTS, 两者相消 */
+    __m128i third = _mm_subs_epu8(FROST_UTF8_PREV(input, prev, 2), _mm_set1_epi8((char)(0xE0 - 0x80)));
+    __m128i fourth = _mm_subs_epu8(FROST_UTF8_PREV(input, prev, 3), _mm_set1_epi8((char)(0xF0 - 0x80)));
+    __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+    return _mm_xor_si128(must23, special);
+}
+
+/* 块末尾是否有未完成的多字节序列 */
+FROST_TARGET_SSSE3
+static inline auto frost_utf8_incomplete(__m128i input) -> __m128i
+{
+    const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    return _mm_subs_epu8(input, max);
+}
+
+FROST_TARGET_SSSE3
+static auto frost_validate_utf8_ssse3(const unsigned char* str, size_t len) -> int
+{
+    __m128i error = _mm_setzero_si128();
+    __m128i prev = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    unsigned char tail[16];
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i input = _mm_loadu_si128((const __m128i*)(str + i));
+        if (_mm_movemask_epi8(input) == 0)
+            error = _mm_or_si128(error, incomplete);
+        else {
+            error = _mm_or_si128(error, frost_utf8_check_block(input, prev));
+            incomplete = frost_utf8_incomplete(input);
+        }
+        prev = input;
+    }
+    if (i < len) {
+        /* 以 0 补齐, 截断的序列会被识别为 TOO_SHORT */
+        __m128i input;
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, str + i, len - i);
+        input = _mm_loadu_si128((const __m128i*)tail);
+        error = _mm_or_si128(error, frost_utf8_check_block(input, prev));
+        incomplete = _mm_setzero_si128();
+    }
+    error = _mm_or_si128(error, incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+static auto frost_validate_utf8(const char* str, size_t len) -> int
+{
+    const auto* ustr = (const unsigned char*)str;
+#if FROST_SIMD_X86
+    static const int has_ssse3 = __builtin_cpu_supports("ssse3");
+    if (len >= 16 && has_ssse3)
+        return frost_validate_utf8_ssse3(ustr, len);
+#endif
+    return frost_validate_utf8_scalar(ustr, len);
+}
+
+/* 返回 str 起第一个需要特殊处理的字符 ('"', '\\' 或控制字符, 包括结尾的 '\0') */
+FROST_NO_SANITIZE_ADDRESS
+static auto frost_scan_string_plain(const char* str) -> const char*
+{
+#if FROST_SIMD_X86
+    /* 先逐字节走到 16 字节对齐处, 之后的对齐读取不会跨页 */
+    while (((uintptr_t)str & 15) != 0) {
+        auto ch = (unsigned char)*str;
+        if (ch == '\"' || ch == '\\' || ch < 0x20)
+            return str;
+        str++;
+    }
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (;; str += 16) {
+        __m128i input = _mm_load_si128((const __m128i*)str);
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(input, quote), _mm_cmpeq_epi8(input, backslash));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_max_epu8(input, control), control));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0)
+            return str + __builtin_ctz((unsigned)mask);
+    }
+#else
+    for (;; str++) {
+        auto ch = (unsigned char)*str;
+        if (ch == '\"' || ch == '\\' || ch < 0x20)
+            return str;
+    }
+#endif
+}
+
 #define STRING_ERROR(ret) \
     do {                  \
         cot->top = head;  \
@@ -174,6 +583,18 @@ static auto frost_parse_string_raw(frost_context* cot, char** str, size_t* len)
     EXPECT(cot, '\"');
     end = cot->json;
     for (;;) {
+        /* 普通字符整段拷贝; \\u 转义经 frost_encode_utf8 生成, 必然合法, 只需校验原始字节 */
+        const char* run = end;
+        end = frost_scan_string_plain(end);
+        if (end != run) {
+            if ((cot->flags & FROST_PARSE_VALIDATE_UTF8) != 0 && frost_validate_utf8(run, (size_t)(end - run)) == 0)
+                STRING_ERROR(FROST_PARSE_INVALID_UTF8);
+            if (cot->top - head + (size_t)(end - run) > cot->max_string)
+                STRING_ERROR(FROST_PARSE_STRING_TOO_LONG);
+            if (frost_parse_reserve(cot, (size_t)(end - run)) == 0)
+                STRING_ERROR(FROST_PARSE_MEMORY_EXCEEDED);
+            PUTS(cot, run, (size_t)(end - run));
+        }
         char ch = *end++;
         switch (ch) {
         case '\"':
@@ -182,6 +603,11 @@ static auto frost_parse_string_raw(frost_context* cot, char** str, size_t* len)
             cot->json = end;
             return FROST_PARSE_OK;
         case '\\':
+            /* 一个转义至多产生 4 个字节 */
+            if (cot->top - head >= cot->max_string)
+                STRING_ERROR(FROST_PARSE_STRING_TOO_LONG);
+            if (frost_parse_reserve(cot, 4) == 0)
+                STRING_ERROR(FROST_PARSE_MEMORY_EXCEEDED);
             switch (*end++) {
             case '\"':
                 PUTC(cot, '\"');
@@ -222,6 +648,8 @@ static auto frost_parse_string_raw(frost_context* cot, char** str, size_t* len)
                     uns = (((uns - 0xD800) << 10) | (usi - 0xDC00)) + 0x10000;
                 }
                 frost_encode_utf8(cot, uns);
+                if (cot->top - head > cot->max_string)
+                    STRING_ERROR(FROST_PARSE_STRING_TOO_LONG);
                 break;
             default:
                 cot->top = head;
@@ -232,11 +660,9 @@ static auto frost_parse_string_raw(frost_context* cot, char** str, size_t* len)
             cot->top = head;
             return FROST_PARSE_MISS_QUOTATION_MARK;
         default:
-            if ((unsigned char)ch < 0x20) {
-                cot->top = head;
-                return FROST_PARSE_INVALID_STRING_CHAR;
-            }
-            PUTC(cot, ch);
+            assert((unsigned char)ch < 0x20);
+            cot->top = head;
+            return FROST_PARSE_INVALID_STRING_CHAR;
         }
     }
 }
@@ -247,6 +673,8 @@ static auto frost_parse_string(frost_context* cot, frost_value* val) -> int
     char* str = nullptr;
     size_t len = 0;
     ret = frost_parse_string_raw(cot, &str, &len);
+    if (ret == FROST_PARSE_OK && frost_parse_charge(cot, len + 1) == 0)
+        ret = FROST_PARSE_MEMORY_EXCEEDED;
     if (ret == FROST_PARSE_OK)
         frost_set_string(val, str, len);
     return ret;
@@ -263,7 +691,7 @@ static auto frost_parse_array(frost_context* cot, frost_value* val) -> int
     if (*cot->json == ']') {
         cot->json++;
         val->type = FROST_ARRAY;
-        val->u.a.size = 0;
+        val->u.a.size = val->u.a.capacity = 0;
         val->u.a.e = nullptr;
         return FROST_PARSE_OK;
     }
@@ -273,16 +701,29 @@ static auto frost_parse_array(frost_context* cot, frost_value* val) -> int
         ret = frost_parse_value(cot, &cac);
         if (ret != FROST_PARSE_OK)
             break;
+        if (frost_parse_reserve(cot, sizeof(frost_value)) == 0) {
+            frost_free(&cac);
+            ret = FROST_PARSE_MEMORY_EXCEEDED;
+            break;
+        }
         memcpy(frost_context_push(cot, sizeof(frost_value)), &cac, sizeof(frost_value));
         size++;
         frost_parse_whitespace(cot);
         if (*cot->json == ',') {
+            if (size >= cot->max_elements) {
+                ret = FROST_PARSE_TOO_MANY_ELEMENTS;
+                break;
+            }
             cot->json++;
             frost_parse_whitespace(cot);
         } else if (*cot->json == ']') {
+            if (frost_parse_charge(cot, size * sizeof(frost_value)) == 0) {
+                ret = FROST_PARSE_MEMORY_EXCEEDED;
+                break;
+            }
             cot->json++;
             val->type = FROST_ARRAY;
-            val->u.a.size = size;
+            val->u.a.size = val->u.a.capacity = size;
             size *= sizeof(frost_value);
             val->u.a.e = (frost_value*)malloc(size);
             memcpy(val->u.a.e, frost_context_pop(cot, size), size);
@@ -311,7 +752,7 @@ static auto frost_parse_object(frost_context* cot, frost_value* val) -> int
         cot->json++;
         val->type = FROST_OBJECT;
         val->u.o.m = 0;
-        val->u.o.size = 0;
+        val->u.o.size = val->u.o.capacity = 0;
         return FROST_PARSE_OK;
     }
     mem.k = nullptr;
@@ -326,8 +767,13 @@ static auto frost_parse_object(frost_context* cot, frost_value* val) -> int
         ret = frost_parse_string_raw(cot, &str, &mem.klen);
         if (ret != FROST_PARSE_OK)
             break;
+        if (frost_parse_charge(cot, mem.klen + 1) == 0) {
+            ret = FROST_PARSE_MEMORY_EXCEEDED;
+            break;
+        }
         mem.k = (char*)malloc(mem.klen + 1);
-        memcpy(mem.k, str, mem.klen);
+        if (mem.klen > 0)
+            memcpy(mem.k, str, mem.klen);
         mem.k[mem.klen] = '\0';
         frost_parse_whitespace(cot);
         if (*cot->json != ':') {
@@ -339,18 +785,31 @@ static auto frost_parse_object(frost_context* cot, frost_value* val) -> int
         ret = frost_parse_value(cot, &mem.v);
         if (ret != FROST_PARSE_OK)
             break;
+        if (frost_parse_reserve(cot, sizeof(frost_member)) == 0) {
+            frost_free(&mem.v);
+            ret = FROST_PARSE_MEMORY_EXCEEDED;
+            break;
+        }
         memcpy(frost_context_push(cot, sizeof(frost_member)), &mem, sizeof(frost_member));
         size++;
         mem.k = nullptr;
         frost_parse_whitespace(cot);
         if (*cot->json == ',') {
+            if (size >= cot->max_elements) {
+                ret = FROST_PARSE_TOO_MANY_ELEMENTS;
+                break;
+            }
             cot->json++;
             frost_parse_whitespace(cot);
         } else if (*cot->json == '}') {
             size_t sit = sizeof(frost_member) * size;
+            if (frost_parse_charge(cot, sit) == 0) {
+                ret = FROST_PARSE_MEMORY_EXCEEDED;
+                break;
+            }
             cot->json++;
             val->type = FROST_OBJECT;
-            val->u.o.size = size;
+            val->u.o.size = val->u.o.capacity = size;
             val->u.o.m = (frost_member*)malloc(sit);
             memcpy(val->u.o.m, frost_context_pop(cot, sit), sit);
             return FROST_PARSE_OK;
@@ -371,6 +830,7 @@ static auto frost_parse_object(frost_context* cot, frost_value* val) -> int
 
 static auto frost_parse_value(frost_context* cot, frost_value* val) -> int
 {
+    int ret = 0;
     switch (*cot->json) {
     case 'n':
         return frost_parse_literal(cot, val, "null", FROST_NULL);
@@ -383,225 +843,2299 @@ static auto frost_parse_value(frost_context* cot, frost_value* val) -> int
     case '"':
         return frost_parse_string(cot, val);
     case '[':
-        return frost_parse_array(cot, val);
     case '{':
-        return frost_parse_object(cot, val);
+        if (cot->depth >= cot->max_depth)
+            return FROST_PARSE_DEPTH_EXCEEDED;
+        cot->depth++;
+        ret = *cot->json == '[' ? frost_parse_array(cot, val) : frost_parse_object(cot, val);
+        cot->depth--;
+        return ret;
     case '\0':
         return FROST_PARSE_EXPECT_VALUE;
     }
 }
 
 auto frost_parse(frost_value* val, const char* json) -> int
+{
+    return frost_parse_with_options(val, json, nullptr);
+}
+
+auto frost_parse_with_options(frost_value* val, const char* json, const frost_parse_options* opt) -> int
 {
     frost_context cot;
     int ret = 0;
     assert(val != nullptr);
-    cot.json = json;
-    cot.stack = nullptr;
-    cot.size = cot.top = 0;
+    frost_context_init(&cot, json, opt);
     frost_init(val);
     frost_parse_whitespace(&cot);
     ret = frost_parse_value(&cot, val);
     if (ret == FROST_PARSE_OK) {
         frost_parse_whitespace(&cot);
         if (*cot.json != '\0') {
-            val->type = FROST_NULL;
+            frost_free(val);
             ret = FORST_PARSE_ROOT_NOT_SINGULAR;
         }
     }
+    if (ret == FROST_PARSE_OK && (cot.flags & FROST_PARSE_DEDUP) != 0)
+        frost_dedup(val);
     assert(cot.top == 0);
     free(cot.stack);
     return ret;
 }
 
-static void frost_stringify_string(frost_context* cot, const char* str, size_t len)
+/*
+ * 跳过一个值
+ *
+ * 与 frost_parse_value 接受同样的语法并返回同样的错误码, 但不解码字符串、不转换数字,
+ * 也不分配内存. 数字与解析时一样检查是否溢出 (FROST_PARSE_NUMBER_TOO_BIG). 出错时 cot->json
+ * 指向出错的位置: 非法的转义或字符本身, 非法 UTF-8 所在的一段字符的开头, 非法字面量或数字的开头,
+ * 超出嵌套上限的容器的开头.
+ * 跳过的容器与解析时一样计入 cot->depth 并受 max_depth 限制; 即使没有设置 max_depth 也以
+ * FROST_SKIP_MAX_DEPTH 为上限, 深层嵌套的输入不会耗尽栈.
+ */
+static auto frost_skip_fail(frost_context* cot, const char* pos, int ret) -> int
 {
-    static const char hex_digits[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
-    size_t i = 0;
-    size_t size = 0;
-    char *head = nullptr;
-    char *next = nullptr;
-    assert(str != nullptr);
-    size = len * 6 + 2;
-    next = head = (char*)frost_context_push(cot, size); 
-    *next++ = '"';
-    for (i = 0; i < len; i++) {
-        unsigned char ch = (unsigned char)str[i];
-        switch (ch) {
+    cot->json = pos;
+    return ret;
+}
+
+static auto frost_skip_string(frost_context* cot) -> int
+{
+    unsigned uns = 0;
+    const char* esc = nullptr;
+    const char* end = cot->json + 1;
+    for (;;) {
+        const char* run = end;
+        end = frost_scan_string_plain(end);
+        if ((cot->flags & FROST_PARSE_VALIDATE_UTF8) != 0 && end != run && frost_validate_utf8(run, (size_t)(end - run)) == 0)
+            return frost_skip_fail(cot, run, FROST_PARSE_INVALID_UTF8);
+        esc = end;
+        switch (*end++) {
         case '\"':
-            *next++ = '\\';
-            *next++ = '\"';
-            break;
+            cot->json = end;
+            return FROST_PARSE_OK;
         case '\\':
-            *next++ = '\\';
-            *next++ = '\\';
-            break;
-        case '\b':
-            *next++ = '\\';
-            *next++ = 'b';
-            break;
-        case '\f':
-            *next++ = '\\';
-            *next++ = 'f';
-            break;
-        case '\n':
-            *next++ = '\\';
-            *next++ = 'n';
-            break;
-        case '\r':
-            *next++ = '\\';
-            *next++ = 'r';
-            break;
-        case '\t':
-            *next++ = '\\';
-            *next++ = 't';
+            switch (*end++) {
+            case '\"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                break;
+            case 'u':
+                if ((end = frost_parse_hex4(end, &uns)) == nullptr)
+                    return frost_skip_fail(cot, esc, FROST_PARSE_INVALID_UNICODE_HEX);
+                if (uns >= 0xD800 && uns <= 0xDBFF) {
+                    if (end[0] != '\\' || end[1] != 'u')
+                        return frost_skip_fail(cot, esc, FROST_PARSE_INVALID_UNICODE_SURROGATE);
+                    if ((end = frost_parse_hex4(end + 2, &uns)) == nullptr)
+                        return frost_skip_fail(cot, esc, FROST_PARSE_INVALID_UNICODE_HEX);
+                    if (uns < 0xDC00 || uns > 0xDFFF)
+                        return frost_skip_fail(cot, esc, FROST_PARSE_INVALID_UNICODE_SURROGATE);
+                }
+                break;
+            default:
+                return frost_skip_fail(cot, esc, FROST_PARSE_INVALID_STRING_ESCAPE);
+            }
             break;
+        case '\0':
+            return frost_skip_fail(cot, esc, FROST_PARSE_MISS_QUOTATION_MARK);
         default:
-            if (ch < 0x20) {
-                *next++ = '\\';
-                *next++ = 'u';
-                *next++ = '0';
-                *next++ = '0';
-                *next++ = hex_digits[ch >> 4];
-                *next++ = hex_digits[ch & 15];
-            } else
-                *next++ = str[i];
+            return frost_skip_fail(cot, esc, FROST_PARSE_INVALID_STRING_CHAR);
         }
     }
-    *next++ = '"';
-    cot->top -= size - (next - head);
 }
 
-static void frost_stringify_value(frost_context* cot, const frost_value* val)
+static auto frost_skip_literal(frost_context* cot, const char* literal, frost_type type) -> int
 {
-    size_t i = 0;
-    switch (val->type) {
-    case FROST_NULL:
-        PUTS(cot, "null", 4);
-        break;
-    case FROST_FALSE:
-        PUTS(cot, "false", 5);
-        break;
-    case FROST_TRUE:
-        PUTS(cot, "true", 4);
-        break;
-    case FROST_NUMBER: 
-    {
-        char* ch = (char*)frost_context_push(cot, 32);
-        cot->top -= 32 - sprintf(ch, "%.17g", val->u.n);
+    frost_value lit;
+    const char* start = cot->json;
+    int ret = frost_parse_literal(cot, &lit, literal, type);
+    return ret == FROST_PARSE_OK ? ret : frost_skip_fail(cot, start, ret);
+}
+
+static auto frost_skip_value(frost_context* cot) -> int;
+
+static auto frost_skip_array(frost_context* cot) -> int
+{
+    int ret = 0;
+    cot->json++;
+    frost_parse_whitespace(cot);
+    if (*cot->json == ']') {
+        cot->json++;
+        return FROST_PARSE_OK;
     }
-        break;
-    case FROST_STRING:
-        frost_stringify_string(cot, val->u.s.s, val->u.s.len);
-        break;
-    case FROST_ARRAY:
-        PUTC(cot, '[');
-        for (i = 0; i < val->u.a.size; i++) {
-            if (i > 0)
-                PUTC(cot, ',');
-            frost_stringify_value(cot, &val->u.a.e[i]);
-        }
-        PUTC(cot, ']');
-        break;
-    case FROST_OBJECT:
-        PUTC(cot, '{');
-        for (i = 0; i < val->u.o.size; i++) {
-            if (i > 0)
-                PUTC(cot, ',');
-            frost_stringify_string(cot, val->u.o.m[i].k, val->u.o.m[i].klen);
-            PUTC(cot, ':');
-            frost_stringify_value(cot, &val->u.o.m[i].v);
+    for (;;) {
+        if ((ret = frost_skip_value(cot)) != FROST_PARSE_OK)
+            return ret;
+        frost_parse_whitespace(cot);
+        if (*cot->json == ']') {
+            cot->json++;
+            return FROST_PARSE_OK;
         }
-        PUTC(cot, '}');
-        break;
-    default:
-        assert(0 && "invalid type");
+        if (*cot->json != ',')
+            return FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        cot->json++;
+        frost_parse_whitespace(cot);
     }
 }
 
-auto frost_stringify(const frost_value* val, size_t* length) -> char*
+static auto frost_skip_object(frost_context* cot) -> int
 {
-    frost_context cot;
-    assert(val != nullptr);
-    cot.stack = (char*)malloc(cot.size = FROST_PARSE_STRINGIFY_INIT_SIZE);
-    cot.top = 0;
-    frost_stringify_value(&cot, val);
-    if (length != nullptr)
-        *length = cot.top;
-    PUTC(&cot, '\0');
+    int ret = 0;
+    cot->json++;
+    frost_parse_whitespace(cot);
+    if (*cot->json == '}') {
+        cot->json++;
+        return FROST_PARSE_OK;
+    }
+    for (;;) {
+        if (*cot->json != '"')
+            return FROST_PARSE_MISS_KEY;
+        if ((ret = frost_skip_string(cot)) != FROST_PARSE_OK)
+            return ret;
+        frost_parse_whitespace(cot);
+        if (*cot->json != ':')
+            return FROST_PARSE_MISS_COLON;
+        cot->json++;
+        frost_parse_whitespace(cot);
+        if ((ret = frost_skip_value(cot)) != FROST_PARSE_OK)
+            return ret;
+        frost_parse_whitespace(cot);
+        if (*cot->json == '}') {
+            cot->json++;
+            return FROST_PARSE_OK;
+        }
+        if (*cot->json != ',')
+            return FROST_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        cot->json++;
+        frost_parse_whitespace(cot);
+    }
+}
+
+static auto frost_skip_value(frost_context* cot) -> int
+{
+    uint64_t mag = 0;
+    int integer = 0;
+    int ret = 0;
+    const char* end = nullptr;
+    switch (*cot->json) {
+    case 'n':
+        return frost_skip_literal(cot, "null", FROST_NULL);
+    case 't':
+        return frost_skip_literal(cot, "true", FROST_TRUE);
+    case 'f':
+        return frost_skip_literal(cot, "false", FROST_FALSE);
+    case '"':
+        return frost_skip_string(cot);
+    case '[':
+    case '{':
+        if (cot->depth >= cot->max_depth || cot->depth >= FROST_SKIP_MAX_DEPTH)
+            return FROST_PARSE_DEPTH_EXCEEDED;
+        cot->depth++;
+        ret = *cot->json == '[' ? frost_skip_array(cot) : frost_skip_object(cot);
+        cot->depth--;
+        return ret;
+    case '\0':
+        return FROST_PARSE_EXPECT_VALUE;
+    default:
+        if ((end = frost_scan_number(cot->json, &mag, &integer)) == nullptr)
+            return FROST_PARSE_INVALID_VALUE;
+        if (frost_number_too_big(cot->json, end) != 0)
+            return FROST_PARSE_NUMBER_TOO_BIG;
+        cot->json = end;
+        return FROST_PARSE_OK;
+    }
+}
+
+auto frost_skip(const char* json, const char** end, const frost_parse_options* opt) -> int
+{
+    frost_context cot;
+    int ret = 0;
+    assert(json != nullptr && end != nullptr);
+    frost_context_init(&cot, json, opt);
+    frost_parse_whitespace(&cot);
+    ret = frost_skip_value(&cot);
+    *end = cot.json;
+    return ret;
+}
+
+auto frost_validate(const char* json, size_t len, size_t* err_offset) -> int
+{
+    frost_context cot;
+    int ret = 0;
+    assert(json != nullptr && json[len] == '\0');
+    frost_context_init(&cot, json, nullptr);
+    cot.flags = FROST_PARSE_VALIDATE_UTF8;
+    frost_parse_whitespace(&cot);
+    ret = frost_skip_value(&cot);
+    if (ret == FROST_PARSE_OK) {
+        frost_parse_whitespace(&cot);
+        if (cot.json != json + len)
+            ret = FORST_PARSE_ROOT_NOT_SINGULAR;
+    }
+    if (err_offset != nullptr)
+        *err_offset = ret == FROST_PARSE_OK ? 0 : (size_t)(cot.json - json);
+    return ret;
+}
+
+/*
+ * 解析时投影
+ *
+ * 各路径按标记组成一棵前缀树. 解析时沿树向下: 命中叶节点的值完整解析, 命中中间节点的
+ * 容器只构造其中选中的成员/元素, 其余部分用 frost_skip_value 跳过. 同一个标记既可以是
+ * 对象的键, 也可以是数组下标.
+ */
+using frost_projection_node = struct frost_projection_node;
+
+struct frost_projection_node {
+    char* key;                      /* 解码后的标记 */
+    size_t klen;
+    size_t index;                   /* 标记作为数组下标的值, 不是合法下标时为 FROST_KEY_NOT_EXIST */
+    int whole;                      /* 有路径在此结束: 保留整棵子树 */
+    frost_projection_node* child;
+    size_t size, capacity;
+    size_t max_index;               /* 子节点中最大的数组下标 + 1 */
+};
+
+struct frost_projection {
+    frost_projection_node root;
+};
+
+static void frost_projection_node_free(frost_projection_node* node)
+{
+    size_t i;
+    for (i = 0; i < node->size; i++)
+        frost_projection_node_free(&node->child[i]);
+    free(node->child);
+    free(node->key);
+}
+
+static auto frost_projection_child(frost_projection_node* node, const char* key, size_t klen) -> frost_projection_node*
+{
+    size_t i;
+    frost_projection_node* child = nullptr;
+    for (i = 0; i < node->size; i++)
+        if (node->child[i].klen == klen && memcmp(node->child[i].key, key, klen) == 0)
+            return &node->child[i];
+    if (node->size == node->capacity) {
+        node->capacity = node->capacity == 0 ? 4 : node->capacity * 2;
+        node->child = (frost_projection_node*)realloc(node->child, node->capacity * sizeof(frost_projection_node));
+    }
+    child = &node->child[node->size++];
+    memset(child, 0, sizeof(frost_projection_node));
+    child->key = (char*)malloc(klen + 1);
+    memcpy(child->key, key, klen);
+    child->key[klen] = '\0';
+    child->klen = klen;
+    /* 数组下标: 不以 0 开头的十进制数 (或 "0") */
+    child->index = klen > 0 && klen < 19 && (key[0] != '0' || klen == 1) ? 0 : FROST_KEY_NOT_EXIST;
+    for (i = 0; i < klen && child->index != FROST_KEY_NOT_EXIST; i++)
+        child->index = isdigit((unsigned char)key[i]) != 0 ? child->index * 10 + (size_t)(key[i] - '0') : FROST_KEY_NOT_EXIST;
+    if (child->index != FROST_KEY_NOT_EXIST && child->index + 1 > node->max_index)
+        node->max_index = child->index + 1;
+    return child;
+}
+
+/* 把一个 JSON Pointer 加入前缀树, 指针非法时返回 0 */
+static auto frost_projection_add(frost_projection_node* node, const char* path, char* buf) -> int
+{
+    size_t klen = 0;
+    if (*path != '\0' && *path != '/')
+        return 0;
+    while (*path == '/') {
+        for (klen = 0, path++; *path != '\0' && *path != '/'; path++) {
+            if (*path == '~') {
+                if (path[1] != '0' && path[1] != '1')
+                    return 0;
+                buf[klen++] = *++path == '0' ? '~' : '/';
+            } else
+                buf[klen++] = *path;
+        }
+        node = frost_projection_child(node, buf, klen);
+    }
+    node->whole = 1;
+    return 1;
+}
+
+auto frost_projection_create(const char* const* paths, size_t count) -> frost_projection*
+{
+    size_t i;
+    char* buf = nullptr;
+    auto* proj = (frost_projection*)calloc(1, sizeof(frost_projection));
+    assert(paths != nullptr || count == 0);
+    for (i = 0; i < count; i++) {
+        buf = (char*)realloc(buf, strlen(paths[i]) + 1);
+        if (frost_projection_add(&proj->root, paths[i], buf) == 0) {
+            frost_projection_free(proj);
+            proj = nullptr;
+            break;
+        }
+    }
+    free(buf);
+    return proj;
+}
+
+void frost_projection_free(frost_projection* proj)
+{
+    if (proj == nullptr)
+        return;
+    frost_projection_node_free(&proj->root);
+    free(proj);
+}
+
+static auto frost_parse_projected_value(frost_context* cot, frost_value* val, const frost_projection_node* node, int* kept) -> int;
+
+static auto frost_parse_projected_array(frost_context* cot, frost_value* val, const frost_projection_node* node) -> int
+{
+    size_t i, j;
+    int ret = 0;
+    int kept = 0;
+    frost_value* elem = nullptr;
+    cot->json++;
+    frost_set_array(val, 0);
+    frost_parse_whitespace(cot);
+    if (*cot->json == ']') {
+        cot->json++;
+        return FROST_PARSE_OK;
+    }
+    for (i = 0;; i++) {
+        for (j = 0; i < node->max_index && j < node->size && node->child[j].index != i; j++)
+            ;
+        if (i < node->max_index && j < node->size) {
+            /* 下标不变: 前面未选中的元素以 null 占位 */
+            while (frost_get_array_size(val) < i)
+                frost_pushback_array_element(val);
+            elem = frost_pushback_array_element(val);
+            ret = frost_parse_projected_value(cot, elem, &node->child[j], &kept);
+        } else
+            ret = frost_skip_value(cot);
+        if (ret != FROST_PARSE_OK)
+            return ret;
+        frost_parse_whitespace(cot);
+        if (*cot->json == ']') {
+            cot->json++;
+            return FROST_PARSE_OK;
+        }
+        if (*cot->json != ',')
+            return FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        cot->json++;
+        frost_parse_whitespace(cot);
+    }
+}
+
+static auto frost_parse_projected_object(frost_context* cot, frost_value* val, const frost_projection_node* node) -> int
+{
+    size_t i, klen;
+    int ret = 0;
+    int kept = 0;
+    char* key = nullptr;
+    frost_value mem;
+    cot->json++;
+    frost_set_object(val, 0);
+    frost_parse_whitespace(cot);
+    if (*cot->json == '}') {
+        cot->json++;
+        return FROST_PARSE_OK;
+    }
+    for (;;) {
+        const frost_projection_node* child = nullptr;
+        if (*cot->json != '"')
+            return FROST_PARSE_MISS_KEY;
+        if ((ret = frost_parse_string_raw(cot, &key, &klen)) != FROST_PARSE_OK)
+            return ret;
+        for (i = 0; i < node->size && child == nullptr; i++)
+            if (node->child[i].klen == klen && (klen == 0 || memcmp(node->child[i].key, key, klen) == 0))
+                child = &node->child[i];
+        frost_parse_whitespace(cot);
+        if (*cot->json != ':')
+            return FROST_PARSE_MISS_COLON;
+        cot->json++;
+        frost_parse_whitespace(cot);
+        if (child == nullptr)
+            ret = frost_skip_value(cot);
+        else {
+            /* key 指向解析栈, 解析值之前已与子节点比较过, 之后改用子节点中的副本 */
+            frost_init(&mem);
+            ret = frost_parse_projected_value(cot, &mem, child, &kept);
+            if (ret == FROST_PARSE_OK && kept != 0) {
+                /* 重复的键照常保留, 与 frost_parse 一致 */
+                frost_member* m = nullptr;
+                frost_reserve_object(val, frost_get_object_size(val) + 1);
+                m = &val->u.o.m[val->u.o.size++];
+                m->klen = child->klen;
+                m->k = (char*)malloc(child->klen + 1);
+                memcpy(m->k, child->key, child->klen + 1);
+                memcpy(&m->v, &mem, sizeof(frost_value));
+            } else
+                frost_free(&mem);
+        }
+        if (ret != FROST_PARSE_OK)
+            return ret;
+        frost_parse_whitespace(cot);
+        if (*cot->json == '}') {
+            cot->json++;
+            frost_shrink_object(val);
+            return FROST_PARSE_OK;
+        }
+        if (*cot->json != ',')
+            return FROST_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        cot->json++;
+        frost_parse_whitespace(cot);
+    }
+}
+
+/* *kept 为 0 表示值的类型与路径不符 (路径要向下进入的位置是标量), 调用者不保留它 */
+static auto frost_parse_projected_value(frost_context* cot, frost_value* val, const frost_projection_node* node, int* kept) -> int
+{
+    int ret = 0;
+    *kept = 1;
+    if (node->whole != 0)
+        return frost_parse_value(cot, val);
+    if (*cot->json == '{' || *cot->json == '[') {
+        if (cot->depth >= cot->max_depth)
+            return FROST_PARSE_DEPTH_EXCEEDED;
+        cot->depth++;
+        if (*cot->json == '{')
+            ret = frost_parse_projected_object(cot, val, node);
+        else
+            ret = frost_parse_projected_array(cot, val, node);
+        cot->depth--;
+        return ret;
+    }
+    *kept = 0;
+    return frost_skip_value(cot);
+}
+
+auto frost_parse_projected(frost_value* val, const char* json, size_t len, const frost_projection* proj) -> int
+{
+    return frost_parse_projected_with_options(val, json, len, proj, nullptr);
+}
+
+auto frost_parse_projected_with_options(frost_value* val, const char* json, size_t len, const frost_projection* proj,
+    const frost_parse_options* opt) -> int
+{
+    frost_context cot;
+    int ret = 0;
+    int kept = 0;
+    assert(val != nullptr && json != nullptr && proj != nullptr && json[len] == '\0');
+    frost_context_init(&cot, json, opt);
+    frost_init(val);
+    frost_parse_whitespace(&cot);
+    ret = frost_parse_projected_value(&cot, val, &proj->root, &kept);
+    if (ret == FROST_PARSE_OK) {
+        frost_parse_whitespace(&cot);
+        if (cot.json != json + len)
+            ret = FORST_PARSE_ROOT_NOT_SINGULAR;
+    }
+    if (ret != FROST_PARSE_OK || kept == 0)
+        frost_free(val);
+    assert(cot.top == 0);
+    free(cot.stack);
+    return ret;
+}
+
+/*
+ * 拉取式读取器
+ *
+ * 与 frost_parse 共用词法函数, 但每次只前进一个记号, 由调用者决定如何存放结果.
+ * 嵌套的容器以 '[' / '{' 记在 cot.stack 上; 字符串解码在其上方进行, 弹出后内容
+ * 在下一次压栈 (即下一次 frost_reader_next) 之前保持有效.
+ */
+enum {
+    FROST_READER_VALUE,         /* 期望一个值 */
+    FROST_READER_FIRST_VALUE,   /* 刚读过 '[', 期望值或 ']' */
+    FROST_READER_KEY,           /* 刚读过 ',', 期望键 */
+    FROST_READER_FIRST_KEY,     /* 刚读过 '{', 期望键或 '}' */
+    FROST_READER_AFTER_VALUE,   /* 期望 ',' 或容器结束, 根层则期望文本结束 */
+    FROST_READER_DONE
+};
+
+struct frost_reader {
+    frost_context cot;
+    size_t depth;
+    int state;
+    int error;
+    const char* str;
+    size_t len;
+    frost_value num;    /* NUMBER 记号的值 */
+};
+
+auto frost_reader_open(const char* json, const frost_parse_options* opt) -> frost_reader*
+{
+    auto* rdr = (frost_reader*)malloc(sizeof(frost_reader));
+    assert(json != nullptr);
+    frost_context_init(&rdr->cot, json, opt);
+    /* 读取器逐个交出数值, 延迟数字没有意义 */
+    rdr->cot.flags &= ~FROST_PARSE_RAW_NUMBERS;
+    rdr->depth = 0;
+    rdr->state = FROST_READER_VALUE;
+    rdr->error = FROST_PARSE_OK;
+    rdr->str = nullptr;
+    rdr->len = 0;
+    frost_init(&rdr->num);
+    frost_set_number(&rdr->num, 0.0);
+    return rdr;
+}
+
+void frost_reader_close(frost_reader* rdr)
+{
+    if (rdr == nullptr)
+        return;
+    free(rdr->cot.stack);
+    free(rdr);
+}
+
+static auto frost_reader_fail(frost_reader* rdr, int error) -> frost_token
+{
+    rdr->error = error;
+    rdr->state = FROST_READER_DONE;
+    return FROST_TOKEN_ERROR;
+}
+
+static auto frost_reader_close_container(frost_reader* rdr, char open) -> frost_token
+{
+    frost_context* cot = &rdr->cot;
+    assert(rdr->depth > 0 && cot->stack[cot->top - 1] == open);
+    cot->json++;
+    cot->top--;
+    rdr->depth--;
+    rdr->state = FROST_READER_AFTER_VALUE;
+    return open == '[' ? FROST_TOKEN_END_ARRAY : FROST_TOKEN_END_OBJECT;
+}
+
+auto frost_reader_next(frost_reader* rdr) -> frost_token
+{
+    frost_context* cot = &rdr->cot;
+    frost_value val;
+    char* str = nullptr;
+    int ret = 0;
+    assert(rdr != nullptr);
+    frost_parse_whitespace(cot);
+    switch (rdr->state) {
+    case FROST_READER_DONE:
+        return rdr->error == FROST_PARSE_OK ? FROST_TOKEN_END : FROST_TOKEN_ERROR;
+    case FROST_READER_AFTER_VALUE:
+        if (rdr->depth == 0) {
+            if (*cot->json != '\0')
+                return frost_reader_fail(rdr, FORST_PARSE_ROOT_NOT_SINGULAR);
+            rdr->state = FROST_READER_DONE;
+            return FROST_TOKEN_END;
+        }
+        if (cot->stack[cot->top - 1] == '[') {
+            if (*cot->json == ']')
+                return frost_reader_close_container(rdr, '[');
+            if (*cot->json != ',')
+                return frost_reader_fail(rdr, FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+            rdr->state = FROST_READER_VALUE;
+        } else {
+            if (*cot->json == '}')
+                return frost_reader_close_container(rdr, '{');
+            if (*cot->json != ',')
+                return frost_reader_fail(rdr, FROST_PARSE_MISS_COMMA_OR_CURLY_BRACKET);
+            rdr->state = FROST_READER_KEY;
+        }
+        cot->json++;
+        frost_parse_whitespace(cot);
+        return frost_reader_next(rdr);
+    case FROST_READER_FIRST_VALUE:
+        if (*cot->json == ']')
+            return frost_reader_close_container(rdr, '[');
+        break;
+    case FROST_READER_FIRST_KEY:
+        if (*cot->json == '}')
+            return frost_reader_close_container(rdr, '{');
+        /* fall through */
+    case FROST_READER_KEY:
+        if (*cot->json != '"')
+            return frost_reader_fail(rdr, FROST_PARSE_MISS_KEY);
+        if ((ret = frost_parse_string_raw(cot, &str, &rdr->len)) != FROST_PARSE_OK)
+            return frost_reader_fail(rdr, ret);
+        rdr->str = str;
+        frost_parse_whitespace(cot);
+        if (*cot->json != ':')
+            return frost_reader_fail(rdr, FROST_PARSE_MISS_COLON);
+        cot->json++;
+        rdr->state = FROST_READER_VALUE;
+        return FROST_TOKEN_KEY;
+    default:
+        break;
+    }
+    rdr->state = FROST_READER_AFTER_VALUE;
+    switch (*cot->json) {
+    case '[':
+    case '{':
+        if (rdr->depth >= cot->max_depth)
+            return frost_reader_fail(rdr, FROST_PARSE_DEPTH_EXCEEDED);
+        PUTC(cot, *cot->json);
+        rdr->state = *cot->json == '[' ? FROST_READER_FIRST_VALUE : FROST_READER_FIRST_KEY;
+        rdr->depth++;
+        return *cot->json++ == '[' ? FROST_TOKEN_BEGIN_ARRAY : FROST_TOKEN_BEGIN_OBJECT;
+    case '"':
+        if ((ret = frost_parse_string_raw(cot, &str, &rdr->len)) != FROST_PARSE_OK)
+            return frost_reader_fail(rdr, ret);
+        rdr->str = str;
+        return FROST_TOKEN_STRING;
+    case '\0':
+        return frost_reader_fail(rdr, FROST_PARSE_EXPECT_VALUE);
+    default:
+        frost_init(&val);
+        if ((ret = frost_parse_value(cot, &val)) != FROST_PARSE_OK)
+            return frost_reader_fail(rdr, ret);
+        if (val.type == FROST_NUMBER) {
+            memcpy(&rdr->num, &val, sizeof(frost_value));
+            return FROST_TOKEN_NUMBER;
+        }
+        return val.type == FROST_NULL ? FROST_TOKEN_NULL : val.type == FROST_TRUE ? FROST_TOKEN_TRUE : FROST_TOKEN_FALSE;
+    }
+}
+
+auto frost_reader_skip(frost_reader* rdr, frost_token token) -> int
+{
+    frost_context* cot = &rdr->cot;
+    size_t depth = 0;
+    int ret = 0;
+    assert(rdr != nullptr);
+    /* 刚读到容器的开始记号时, 退回到括号处整体跳过, 不再逐个产生记号 */
+    if ((token == FROST_TOKEN_BEGIN_ARRAY || token == FROST_TOKEN_BEGIN_OBJECT)
+        && (rdr->state == FROST_READER_FIRST_VALUE || rdr->state == FROST_READER_FIRST_KEY)
+        && cot->json[-1] == cot->stack[cot->top - 1]) {
+        cot->json--;
+        cot->top--;
+        rdr->depth--;
+        cot->depth = rdr->depth;
+        ret = frost_skip_value(cot);
+        cot->depth = 0;
+        if (ret != FROST_PARSE_OK)
+            frost_reader_fail(rdr, ret);
+        else
+            rdr->state = FROST_READER_AFTER_VALUE;
+        return ret;
+    }
+    for (;;) {
+        switch (token) {
+        case FROST_TOKEN_BEGIN_ARRAY:
+        case FROST_TOKEN_BEGIN_OBJECT:
+            depth++;
+            break;
+        case FROST_TOKEN_END_ARRAY:
+        case FROST_TOKEN_END_OBJECT:
+            depth--;
+            break;
+        case FROST_TOKEN_ERROR:
+            return rdr->error;
+        default:
+            break;
+        }
+        if (depth == 0)
+            return FROST_PARSE_OK;
+        token = frost_reader_next(rdr);
+    }
+}
+
+auto frost_reader_get_number(const frost_reader* rdr) -> double
+{
+    assert(rdr != nullptr);
+    return frost_get_number(&rdr->num);
+}
+
+auto frost_reader_get_number_value(const frost_reader* rdr) -> const frost_value*
+{
+    assert(rdr != nullptr);
+    return &rdr->num;
+}
+
+auto frost_reader_get_string(const frost_reader* rdr) -> const char*
+{
+    assert(rdr != nullptr);
+    return rdr->str;
+}
+
+auto frost_reader_get_string_length(const frost_reader* rdr) -> size_t
+{
+    assert(rdr != nullptr);
+    return rdr->len;
+}
+
+auto frost_reader_get_error(const frost_reader* rdr) -> int
+{
+    assert(rdr != nullptr);
+    return rdr->error;
+}
+
+/*
+ * 顶层数组的流式读取
+ *
+ * 缓冲区只保存尚未交出的数据: 每次补充数据前丢弃已解析的部分, 因此占用的内存与最大的
+ * 单个元素成正比. 元素先直接在缓冲的数据上解析, 失败时再用 frost_skip_value 判断出错处
+ * 是否就是数据的结尾, 是则读入更多数据后重新解析; 每次补充至少使待解析的数据翻倍,
+ * 重新解析的总开销是线性的. 恰好在数据结尾处结束的数字可能还有后续的数字, 同样要重新解析.
+ * 资源上限对每个元素分别生效, max_elements 同时限制顶层数组的元素数.
+ */
+enum {
+    FROST_ARRAY_STREAM_BEGIN,       /* 期望 '[' */
+    FROST_ARRAY_STREAM_FIRST,       /* 刚读过 '[', 期望元素或 ']' */
+    FROST_ARRAY_STREAM_ELEMENT,     /* 刚读过 ',', 期望元素 */
+    FROST_ARRAY_STREAM_NEXT,        /* 期望 ',' 或 ']' */
+    FROST_ARRAY_STREAM_TRAILING,    /* 读过 ']', 其后只能有空白 */
+    FROST_ARRAY_STREAM_DONE
+};
+
+struct frost_array_stream {
+    frost_context cot;              /* 解析栈在元素之间复用 */
+    frost_read_callback read;       /* nullptr 表示全部数据已在 buf 中 (不写入) */
+    void* user;
+    char* buf;                      /* buf[len] 总是 '\0' */
+    size_t pos, len, capacity;      /* pos 之前的数据已经解析 */
+    size_t count;                   /* 已交出的元素数 */
+    int state;
+    int error;
+    int eof;
+};
+
+static auto frost_array_stream_read_fd(void* user, char* data, size_t size) -> ptrdiff_t
+{
+    ptrdiff_t n = 0;
+    do {
+#if defined(_WIN32)
+        n = _read((int)(intptr_t)user, data, size > INT32_MAX ? INT32_MAX : (unsigned)size);
+#else
+        n = read((int)(intptr_t)user, data, size);
+#endif
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+auto frost_array_stream_open(frost_read_callback read, void* user, const frost_parse_options* opt) -> frost_array_stream*
+{
+    auto* stm = (frost_array_stream*)malloc(sizeof(frost_array_stream));
+    assert(read != nullptr);
+    frost_context_init(&stm->cot, nullptr, opt);
+    stm->read = read;
+    stm->user = user;
+    stm->capacity = FROST_ARRAY_STREAM_CHUNK + 1;
+    stm->buf = (char*)malloc(stm->capacity);
+    stm->buf[0] = '\0';
+    stm->pos = stm->len = stm->count = 0;
+    stm->state = FROST_ARRAY_STREAM_BEGIN;
+    stm->error = FROST_PARSE_OK;
+    stm->eof = 0;
+    return stm;
+}
+
+auto frost_array_stream_open_buffer(const char* json, size_t len, const frost_parse_options* opt) -> frost_array_stream*
+{
+    auto* stm = (frost_array_stream*)malloc(sizeof(frost_array_stream));
+    assert(json != nullptr && json[len] == '\0');
+    frost_context_init(&stm->cot, json, opt);
+    stm->read = nullptr;
+    stm->user = nullptr;
+    stm->buf = (char*)json;
+    stm->pos = stm->count = 0;
+    stm->len = stm->capacity = len;
+    stm->state = FROST_ARRAY_STREAM_BEGIN;
+    stm->error = FROST_PARSE_OK;
+    stm->eof = 1;
+    return stm;
+}
+
+auto frost_array_stream_open_fd(int fd, const frost_parse_options* opt) -> frost_array_stream*
+{
+    return frost_array_stream_open(frost_array_stream_read_fd, (void*)(intptr_t)fd, opt);
+}
+
+void frost_array_stream_close(frost_array_stream* stm)
+{
+    if (stm == nullptr)
+        return;
+    if (stm->read != nullptr)
+        free(stm->buf);
+    free(stm->cot.stack);
+    free(stm);
+}
+
+/* 丢弃已解析的数据并读入更多; 没有读到数据 (结束或出错) 时返回 0 */
+static auto frost_array_stream_fill(frost_array_stream* stm) -> int
+{
+    size_t pending = stm->len - stm->pos, want = 0, got = 0;
+    ptrdiff_t n = 0;
+    if (stm->eof != 0)
+        return 0;
+    memmove(stm->buf, stm->buf + stm->pos, pending);
+    stm->pos = 0;
+    stm->len = pending;
+    want = pending > FROST_ARRAY_STREAM_CHUNK ? pending : FROST_ARRAY_STREAM_CHUNK;
+    if (stm->len + want + 1 > stm->capacity) {
+        stm->capacity = stm->len + want + 1;
+        stm->buf = (char*)realloc(stm->buf, stm->capacity);
+    }
+    while (got < want) {
+        n = stm->read(stm->user, stm->buf + stm->len, stm->capacity - 1 - stm->len);
+        if (n <= 0) {
+            if (n < 0)
+                stm->error = FROST_PARSE_READ_FAILED;
+            stm->eof = 1;
+            break;
+        }
+        stm->len += (size_t)n;
+        got += (size_t)n;
+    }
+    stm->buf[stm->len] = '\0';
+    return got > 0;
+}
+
+static auto frost_array_stream_fail(frost_array_stream* stm, int error) -> int
+{
+    if (stm->error == FROST_PARSE_OK)
+        stm->error = error;
+    stm->state = FROST_ARRAY_STREAM_DONE;
+    return 0;
+}
+
+/* [p, end) 结尾处未闭合的字符串的开头引号, 没有则返回 nullptr */
+static auto frost_array_stream_open_string(const char* p, const char* end) -> const char*
+{
+    const char* open = nullptr;
+    for (; p != end; p++) {
+        if (open == nullptr) {
+            if (*p == '"')
+                open = p;
+        } else if (*p == '\\') {
+            if (++p == end)
+                break;
+        } else if (*p == '"')
+            open = nullptr;
+    }
+    return open;
+}
+
+/* 解析 buf + pos 处的元素; 需要更多数据时返回 -1 */
+static auto frost_array_stream_element(frost_array_stream* stm, frost_value* out) -> int
+{
+    frost_context* cot = &stm->cot;
+    const char* end = stm->buf + stm->len;
+    const char* p = nullptr;
+    const char* open = nullptr;
+    int ret = 0;
+    if (stm->count >= cot->max_elements)
+        return FROST_PARSE_TOO_MANY_ELEMENTS;
+    cot->json = stm->buf + stm->pos;
+    cot->depth = 1;
+    cot->bytes = 0;
+    ret = frost_parse_value(cot, out);
+    assert(cot->top == 0);
+    if (ret == FROST_PARSE_OK) {
+        if (cot->json == end && stm->eof == 0 && out->type == FROST_NUMBER) {
+            frost_free(out);
+            return -1;
+        }
+        return ret;
+    }
+    if (stm->eof != 0 || ret >= FROST_PARSE_MEMORY_EXCEEDED)
+        return ret;
+    /* 语法错误可能只是因为数据还没读完: 出错处位于延续到数据结尾的未闭合字符串中 (不论错误码,
+     * 被截断的 UTF-8 序列或转义之前可能还有空格等字符), 或出错的字面量、数字一直延续到数据结尾 */
+    cot->json = stm->buf + stm->pos;
+    cot->depth = 1;
+    frost_skip_value(cot);
+    p = cot->json;
+    open = frost_array_stream_open_string(stm->buf + stm->pos, end);
+    if (open != nullptr && p >= open)
+        return -1;
+    while (p != end && (isalnum((unsigned char)*p) || *p == '+' || *p == '-' || *p == '.' || *p == '\\' || (unsigned char)*p >= 0x80))
+        p++;
+    return p == end ? -1 : ret;
+}
+
+auto frost_array_stream_next(frost_array_stream* stm, frost_value* out) -> int
+{
+    const char* p = nullptr;
+    int ret = 0;
+    assert(stm != nullptr && out != nullptr);
+    frost_init(out);
+    while (stm->state != FROST_ARRAY_STREAM_DONE) {
+        p = stm->buf + stm->pos;
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+            p++;
+        stm->pos = (size_t)(p - stm->buf);
+        if (p == stm->buf + stm->len) {
+            if (frost_array_stream_fill(stm) != 0)
+                continue;
+            if (stm->error != FROST_PARSE_OK)
+                return frost_array_stream_fail(stm, stm->error);
+            switch (stm->state) {
+            case FROST_ARRAY_STREAM_TRAILING:
+                stm->state = FROST_ARRAY_STREAM_DONE;
+                return 0;
+            case FROST_ARRAY_STREAM_BEGIN:
+            case FROST_ARRAY_STREAM_ELEMENT:
+                return frost_array_stream_fail(stm, FROST_PARSE_EXPECT_VALUE);
+            default:
+                return frost_array_stream_fail(stm, FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+            }
+        }
+        switch (stm->state) {
+        case FROST_ARRAY_STREAM_BEGIN:
+            if (*p != '[')
+                return frost_array_stream_fail(stm, FROST_PARSE_TYPE_MISMATCH);
+            stm->pos++;
+            stm->state = FROST_ARRAY_STREAM_FIRST;
+            continue;
+        case FROST_ARRAY_STREAM_FIRST:
+        case FROST_ARRAY_STREAM_NEXT:
+            if (*p == ']') {
+                stm->pos++;
+                stm->state = FROST_ARRAY_STREAM_TRAILING;
+                continue;
+            }
+            if (stm->state == FROST_ARRAY_STREAM_FIRST)
+                break;
+            if (*p != ',')
+                return frost_array_stream_fail(stm, FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+            stm->pos++;
+            stm->state = FROST_ARRAY_STREAM_ELEMENT;
+            continue;
+        case FROST_ARRAY_STREAM_TRAILING:
+            return frost_array_stream_fail(stm, FORST_PARSE_ROOT_NOT_SINGULAR);
+        default:
+            break;
+        }
+        ret = frost_array_stream_element(stm, out);
+        if (ret < 0) {
+            frost_array_stream_fill(stm);
+            continue;
+        }
+        if (ret != FROST_PARSE_OK)
+            return frost_array_stream_fail(stm, ret);
+        stm->pos = (size_t)(stm->cot.json - stm->buf);
+        stm->count++;
+        stm->state = FROST_ARRAY_STREAM_NEXT;
+        if ((stm->cot.flags & FROST_PARSE_DEDUP) != 0)
+            frost_dedup(out);
+        return 1;
+    }
+    return 0;
+}
+
+auto frost_array_stream_get_error(const frost_array_stream* stm) -> int
+{
+    assert(stm != nullptr);
+    return stm->error;
+}
+
+static void frost_stringify_string(frost_context* cot, const char* str, size_t len)
+{
+    static const char hex_digits[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+    size_t i = 0;
+    size_t size = 0;
+    char *head = nullptr;
+    char *next = nullptr;
+    assert(str != nullptr);
+    size = len * 6 + 2;
+    next = head = (char*)frost_context_push(cot, size); 
+    *next++ = '"';
+    for (i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)str[i];
+        switch (ch) {
+        case '\"':
+            *next++ = '\\';
+            *next++ = '\"';
+            break;
+        case '\\':
+            *next++ = '\\';
+            *next++ = '\\';
+            break;
+        case '\b':
+            *next++ = '\\';
+            *next++ = 'b';
+            break;
+        case '\f':
+            *next++ = '\\';
+            *next++ = 'f';
+            break;
+        case '\n':
+            *next++ = '\\';
+            *next++ = 'n';
+            break;
+        case '\r':
+            *next++ = '\\';
+            *next++ = 'r';
+            break;
+        case '\t':
+            *next++ = '\\';
+            *next++ = 't';
+            break;
+        default:
+            if (ch < 0x20) {
+                *next++ = '\\';
+                *next++ = 'u';
+                *next++ = '0';
+                *next++ = '0';
+                *next++ = hex_digits[ch >> 4];
+                *next++ = hex_digits[ch & 15];
+            } else
+                *next++ = str[i];
+        }
+    }
+    *next++ = '"';
+    cot->top -= size - (next - head);
+}
+
+static const char frost_digit_pairs[] =
+    "00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839"
+    "40414243444546474849" "50515253545556575859" "60616263646566676869" "70717273747576777879"
+    "80818283848586878889" "90919293949596979899";
+
+/* 从低位起每次除以 100 写出两位数字, 返回写出的长度 */
+static auto frost_u64toa(uint64_t num, char* buf) -> size_t
+{
+    char tmp[20];
+    char* p = tmp + sizeof(tmp);
+    size_t len = 0;
+    while (num >= 100) {
+        unsigned r = (unsigned)(num % 100);
+        num /= 100;
+        p -= 2;
+        memcpy(p, frost_digit_pairs + r * 2, 2);
+    }
+    if (num >= 10) {
+        p -= 2;
+        memcpy(p, frost_digit_pairs + num * 2, 2);
+    } else
+        *--p = (char)('0' + num);
+    len = (size_t)(tmp + sizeof(tmp) - p);
+    memcpy(buf, p, len);
+    return len;
+}
+
+static auto frost_i64toa(int64_t num, char* buf) -> size_t
+{
+    if (num >= 0)
+        return frost_u64toa((uint64_t)num, buf);
+    *buf = '-';
+    return 1 + frost_u64toa(0 - (uint64_t)num, buf + 1);
+}
+
+static void frost_stringify_value(frost_context* cot, const frost_value* val)
+{
+    size_t i = 0;
+    switch (val->type) {
+    case FROST_NULL:
+        PUTS(cot, "null", 4);
+        break;
+    case FROST_FALSE:
+        PUTS(cot, "false", 5);
+        break;
+    case FROST_TRUE:
+        PUTS(cot, "true", 4);
+        break;
+    case FROST_NUMBER: 
+    {
+        const char* str = nullptr;
+        size_t len = 0;
+        char* ch = nullptr;
+        if ((str = frost_get_number_text(val, &len)) != nullptr) {
+            PUTS(cot, str, len);
+            break;
+        }
+        ch = (char*)frost_context_push(cot, 32);
+        if ((val->flags & FROST_FLAG_INT64) != 0)
+            cot->top -= 32 - frost_i64toa(val->u.i64, ch);
+        else if ((val->flags & FROST_FLAG_UINT64) != 0)
+            cot->top -= 32 - frost_u64toa(val->u.u64, ch);
+        else
+            cot->top -= 32 - sprintf(ch, "%.17g", val->u.n);
+    }
+        break;
+    case FROST_STRING:
+        frost_stringify_string(cot, val->u.s.s, val->u.s.len);
+        break;
+    case FROST_ARRAY:
+        PUTC(cot, '[');
+        for (i = 0; i < val->u.a.size; i++) {
+            if (i > 0)
+                PUTC(cot, ',');
+            frost_stringify_value(cot, &val->u.a.e[i]);
+        }
+        PUTC(cot, ']');
+        break;
+    case FROST_OBJECT:
+        PUTC(cot, '{');
+        for (i = 0; i < val->u.o.size; i++) {
+            if (i > 0)
+                PUTC(cot, ',');
+            frost_stringify_string(cot, val->u.o.m[i].k, val->u.o.m[i].klen);
+            PUTC(cot, ':');
+            frost_stringify_value(cot, &val->u.o.m[i].v);
+        }
+        PUTC(cot, '}');
+        break;
+    default:
+        assert(0 && "invalid type");
+    }
+}
+
+auto frost_stringify(const frost_value* val, size_t* length) -> char*
+{
+    frost_context cot;
+    assert(val != nullptr);
+    cot.stack = (char*)malloc(cot.size = FROST_PARSE_STRINGIFY_INIT_SIZE);
+    cot.top = 0;
+    frost_stringify_value(&cot, val);
+    if (length != nullptr)
+        *length = cot.top;
+    PUTC(&cot, '\0');
+    return cot.stack;
+}
+
+/*
+ * 流式写出
+ *
+ * 事件直接写入与 frost_stringify 相同的输出缓冲区 (frost_context), 字符串与数字经同样的
+ * frost_stringify_string / frost_stringify_value 输出. 每层嵌套只记一个字节的状态:
+ * 是否对象、是否已有元素、是否刚写过键, 据此决定分隔符, 并在调试构建中检查事件顺序.
+ * 根层可以连续写多个值, 以换行分隔 (NDJSON). 有 write 回调时, 缓冲的内容在一个事件
+ * 写完后达到 FROST_WRITER_FLUSH_SIZE 即交给回调, 缓冲区大小与文档大小无关.
+ */
+#ifndef FROST_WRITER_FLUSH_SIZE
+#define FROST_WRITER_FLUSH_SIZE 65536
+#endif
+
+#define FROST_WRITER_OBJECT    0x1  /* 这一层是对象 */
+#define FROST_WRITER_NONEMPTY  0x2  /* 已写过元素或成员, 下一个之前需要分隔符 */
+#define FROST_WRITER_AFTER_KEY 0x4  /* 刚写过键, 期望值 */
+
+struct frost_writer {
+    frost_context cot;
+    frost_write_callback write;
+    void* user;
+    char* levels;           /* levels[0] 为根层 */
+    size_t depth, capacity;
+    int failed;             /* write 曾经返回 0 */
+};
+
+auto frost_writer_open(frost_write_callback write, void* user) -> frost_writer*
+{
+    auto* wtr = (frost_writer*)malloc(sizeof(frost_writer));
+    wtr->cot.stack = (char*)malloc(wtr->cot.size = FROST_PARSE_STRINGIFY_INIT_SIZE);
+    wtr->cot.top = 0;
+    wtr->write = write;
+    wtr->user = user;
+    wtr->capacity = 16;
+    wtr->levels = (char*)malloc(wtr->capacity);
+    wtr->levels[0] = 0;
+    wtr->depth = 0;
+    wtr->failed = 0;
+    return wtr;
+}
+
+void frost_writer_close(frost_writer* wtr)
+{
+    if (wtr == nullptr)
+        return;
+    frost_writer_flush(wtr);
+    free(wtr->cot.stack);
+    free(wtr->levels);
+    free(wtr);
+}
+
+/* 写出一个值之前: 对象中消耗掉刚写过的键, 数组与根层写分隔符 */
+static void frost_writer_prefix(frost_writer* wtr)
+{
+    char* level = &wtr->levels[wtr->depth];
+    if ((*level & FROST_WRITER_OBJECT) != 0) {
+        assert((*level & FROST_WRITER_AFTER_KEY) != 0 && "object member needs a key");
+        *level &= ~FROST_WRITER_AFTER_KEY;
+        return;
+    }
+    if ((*level & FROST_WRITER_NONEMPTY) != 0)
+        PUTC(&wtr->cot, wtr->depth == 0 ? '\n' : ',');
+    *level |= FROST_WRITER_NONEMPTY;
+}
+
+/* 一个事件写完之后 */
+static void frost_writer_done(frost_writer* wtr)
+{
+    if (wtr->write != nullptr && wtr->cot.top >= FROST_WRITER_FLUSH_SIZE)
+        frost_writer_flush(wtr);
+}
+
+static void frost_writer_begin(frost_writer* wtr, char open)
+{
+    assert(wtr != nullptr);
+    frost_writer_prefix(wtr);
+    PUTC(&wtr->cot, open);
+    if (++wtr->depth == wtr->capacity) {
+        wtr->capacity += wtr->capacity >> 1;
+        wtr->levels = (char*)realloc(wtr->levels, wtr->capacity);
+    }
+    wtr->levels[wtr->depth] = open == '{' ? FROST_WRITER_OBJECT : 0;
+}
+
+void frost_writer_begin_object(frost_writer* wtr)
+{
+    frost_writer_begin(wtr, '{');
+}
+
+void frost_writer_begin_array(frost_writer* wtr)
+{
+    frost_writer_begin(wtr, '[');
+}
+
+void frost_writer_end(frost_writer* wtr)
+{
+    assert(wtr != nullptr && wtr->depth > 0 && "end without begin");
+    assert((wtr->levels[wtr->depth] & FROST_WRITER_AFTER_KEY) == 0 && "key without value");
+    PUTC(&wtr->cot, (wtr->levels[wtr->depth--] & FROST_WRITER_OBJECT) != 0 ? '}' : ']');
+    frost_writer_done(wtr);
+}
+
+void frost_writer_key(frost_writer* wtr, const char* key, size_t len)
+{
+    char* level = nullptr;
+    assert(wtr != nullptr && key != nullptr);
+    level = &wtr->levels[wtr->depth];
+    assert((*level & FROST_WRITER_OBJECT) != 0 && "key outside an object");
+    assert((*level & FROST_WRITER_AFTER_KEY) == 0 && "two keys in a row");
+    if ((*level & FROST_WRITER_NONEMPTY) != 0)
+        PUTC(&wtr->cot, ',');
+    *level |= FROST_WRITER_NONEMPTY | FROST_WRITER_AFTER_KEY;
+    frost_stringify_string(&wtr->cot, key, len);
+    PUTC(&wtr->cot, ':');
+}
+
+void frost_writer_string(frost_writer* wtr, const char* str, size_t len)
+{
+    assert(wtr != nullptr && str != nullptr);
+    frost_writer_prefix(wtr);
+    frost_stringify_string(&wtr->cot, str, len);
+    frost_writer_done(wtr);
+}
+
+void frost_writer_value(frost_writer* wtr, const frost_value* val)
+{
+    assert(wtr != nullptr && val != nullptr);
+    frost_writer_prefix(wtr);
+    frost_stringify_value(&wtr->cot, val);
+    frost_writer_done(wtr);
+}
+
+void frost_writer_number(frost_writer* wtr, double n)
+{
+    frost_value num;
+    num.type = FROST_NUMBER;
+    num.flags = 0;
+    num.u.n = n;
+    frost_writer_value(wtr, &num);
+}
+
+void frost_writer_int64(frost_writer* wtr, int64_t n)
+{
+    frost_value num;
+    num.type = FROST_NUMBER;
+    num.flags = FROST_FLAG_INT64;
+    num.u.i64 = n;
+    frost_writer_value(wtr, &num);
+}
+
+void frost_writer_uint64(frost_writer* wtr, uint64_t n)
+{
+    frost_value num;
+    num.type = FROST_NUMBER;
+    num.flags = FROST_FLAG_UINT64;
+    num.u.u64 = n;
+    frost_writer_value(wtr, &num);
+}
+
+void frost_writer_bool(frost_writer* wtr, int b)
+{
+    assert(wtr != nullptr);
+    frost_writer_prefix(wtr);
+    if (b != 0)
+        PUTS(&wtr->cot, "true", 4);
+    else
+        PUTS(&wtr->cot, "false", 5);
+    frost_writer_done(wtr);
+}
+
+void frost_writer_null(frost_writer* wtr)
+{
+    assert(wtr != nullptr);
+    frost_writer_prefix(wtr);
+    PUTS(&wtr->cot, "null", 4);
+    frost_writer_done(wtr);
+}
+
+auto frost_writer_flush(frost_writer* wtr) -> int
+{
+    assert(wtr != nullptr);
+    if (wtr->write == nullptr)
+        return 1;
+    if (wtr->cot.top > 0 && wtr->failed == 0 && wtr->write(wtr->user, wtr->cot.stack, wtr->cot.top) == 0)
+        wtr->failed = 1;
+    wtr->cot.top = 0;
+    return wtr->failed == 0;
+}
+
+auto frost_writer_get_output(frost_writer* wtr, size_t* length) -> const char*
+{
+    assert(wtr != nullptr && wtr->write == nullptr);
+    /* frost_context_push 保证 top < size, 结尾的 '\0' 不计入长度 */
+    wtr->cot.stack[wtr->cot.top] = '\0';
+    if (length != nullptr)
+        *length = wtr->cot.top;
+    return wtr->cot.stack;
+}
+
+void frost_writer_reset(frost_writer* wtr)
+{
+    assert(wtr != nullptr);
+    wtr->cot.top = 0;
+    wtr->levels[0] = 0;
+    wtr->depth = 0;
+    wtr->failed = 0;
+}
+
+/*
+ * 工作窃取调度器
+ *
+ * 供并行输出、复制、比较与哈希等批量操作使用的小型 fork-join 调度器. 每个线程有自己的
+ * 任务队列: 派生的任务压入自己队列的尾部, 取任务时先从自己的尾部取 (后进先出, 局部性好),
+ * 自己的队列为空再从其他线程队列的头部窃取 (先派生的任务往往更大). 等待一组任务的线程
+ * 不会阻塞, 而是继续执行任务, 因此任务内部可以再派生并等待子任务. 线程在
+ * frost_scheduler_run 中启动, 根任务返回后结束.
+ */
+#define FROST_TASK_GRAIN 4096   /* 一个任务至少处理的节点数 (按两层估算) */
+
+using frost_scheduler = struct frost_scheduler;
+using frost_worker = struct {
+    frost_scheduler* sched;
+    size_t index;
+};
+
+/* 处理 ctx 描述的容器的子值 [begin, end); 根任务的区间为 [0, 0) */
+using frost_task_fn = void (*)(frost_worker* w, void* ctx, size_t begin, size_t end);
+
+using frost_task_group = struct {
+    std::atomic<size_t> pending;
+};
+
+using frost_task = struct {
+    frost_task_fn fn;
+    void* ctx;
+    size_t begin, end;
+    frost_task_group* group;
+};
+
+struct frost_task_queue {
+    std::mutex lock;
+    std::deque<frost_task> tasks;
+};
+
+struct frost_scheduler {
+    std::vector<frost_task_queue> queues;
+    std::atomic<int> done{0};
+    std::atomic<int> cancel{0};     /* 操作已有结论 (如发现不相等), 尚未执行的任务可以直接返回 */
+
+    explicit frost_scheduler(size_t threads) : queues(threads) {}
+};
+
+static void frost_task_spawn(frost_worker* w, frost_task_group* group, frost_task_fn fn, void* ctx, size_t begin, size_t end)
+{
+    frost_task_queue* q = &w->sched->queues[w->index];
+    group->pending.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(q->lock);
+    q->tasks.push_back(frost_task{ fn, ctx, begin, end, group });
+}
+
+/* 执行一个任务; 返回 0 表示所有队列都为空 */
+static auto frost_task_run_one(frost_worker* w) -> int
+{
+    size_t i, n = w->sched->queues.size();
+    frost_task task;
+    for (i = 0; i < n; i++) {
+        frost_task_queue* q = &w->sched->queues[(w->index + i) % n];
+        std::unique_lock<std::mutex> guard(q->lock);
+        if (q->tasks.empty())
+            continue;
+        if (i == 0) {
+            task = q->tasks.back();
+            q->tasks.pop_back();
+        } else {
+            task = q->tasks.front();
+            q->tasks.pop_front();
+        }
+        guard.unlock();
+        task.fn(w, task.ctx, task.begin, task.end);
+        task.group->pending.fetch_sub(1, std::memory_order_release);
+        return 1;
+    }
+    return 0;
+}
+
+static void frost_task_wait(frost_worker* w, frost_task_group* group)
+{
+    while (group->pending.load(std::memory_order_acquire) != 0)
+        if (frost_task_run_one(w) == 0)
+            std::this_thread::yield();
+}
+
+static auto frost_child(const frost_value* val, size_t i) -> const frost_value*
+{
+    return val->type == FROST_ARRAY ? &val->u.a.e[i] : &val->u.o.m[i].v;
+}
+
+static auto frost_children(const frost_value* val) -> size_t
+{
+    return val->type == FROST_ARRAY ? val->u.a.size : val->type == FROST_OBJECT ? val->u.o.size : 0;
+}
+
+/*
+ * 按估算的子树规模把容器 val 的子值切成区间: 每累计约 FROST_TASK_GRAIN 个节点派生一个任务,
+ * 最后一段由当前线程执行, 然后等待全部区间完成. 规模只看两层 (子值及其子值数),
+ * 更深的大容器在处理到它时再切分.
+ */
+
+static void frost_task_for(frost_worker* w, const frost_value* val, frost_task_fn fn, void* ctx)
+{
+    frost_task_group group;
+    size_t i, begin = 0, weight = 0;
+    size_t size = frost_children(val);
+    group.pending.store(0, std::memory_order_relaxed);
+    for (i = 0; i + 1 < size; i++) {
+        weight += 1 + frost_children(frost_child(val, i));
+        if (weight >= FROST_TASK_GRAIN) {
+            frost_task_spawn(w, &group, fn, ctx, begin, i + 1);
+            begin = i + 1;
+            weight = 0;
+        }
+    }
+    fn(w, ctx, begin, size);
+    frost_task_wait(w, &group);
+}
+
+/* threads 为 0 时取硬件线程数; 查询本身不便宜, 只做一次 */
+static auto frost_task_threads(unsigned threads) -> unsigned
+{
+    static const unsigned hardware = std::thread::hardware_concurrency();
+    return threads != 0 ? threads : hardware;
+}
+
+/* 两层估算的规模是否不足一个任务; 这样的值不值得启动线程 */
+static auto frost_task_small(const frost_value* val) -> int
+{
+    size_t i, weight = 0, size = frost_children(val);
+    for (i = 0; i < size && weight < FROST_TASK_GRAIN; i++)
+        weight += 1 + frost_children(frost_child(val, i));
+    return weight < FROST_TASK_GRAIN;
+}
+
+/* 由 threads 个线程 (含调用者) 执行根任务 fn(ctx) 及其派生的全部任务 */
+static void frost_scheduler_run(unsigned threads, frost_task_fn fn, void* ctx)
+{
+    frost_scheduler sched(threads);
+    std::vector<std::thread> pool;
+    frost_worker root = { &sched, 0 };
+    for (size_t i = 1; i < threads; i++)
+        pool.emplace_back([&sched, i]() {
+            frost_worker w = { &sched, i };
+            while (sched.done.load(std::memory_order_acquire) == 0)
+                if (frost_task_run_one(&w) == 0)
+                    std::this_thread::yield();
+        });
+    fn(&root, ctx, 0, 0);
+    sched.done.store(1, std::memory_order_release);
+    for (auto& t : pool)
+        t.join();
+}
+
+/*
+ * 并行输出
+ *
+ * 先把树切成按输出顺序排列的片段: 元素/成员数达到 FROST_STRINGIFY_PARALLEL_MIN 的容器
+ * 按下标切成若干连续区间, 较小的容器展开为括号、分隔符与键以及各个子值. 区间与整值
+ * 片段作为任务交给工作窃取调度器, 各自输出到独立的缓冲区, 最后按顺序拼接. 每个片段先做一遍
+ * 尺寸估算 (字符串与键精确计算转义后的长度, 数字取上界), 按结果一次分配缓冲区,
+ * 输出过程中不再 realloc. 各片段调用与 frost_stringify 相同的输出函数, 结果逐字节相同.
+ */
+#define FROST_STRINGIFY_NUMBER_SLACK 32    /* 输出数字时临时占用的空间, 见 frost_stringify_value */
+#define FROST_STRINGIFY_PLAN_FANOUT 64     /* 成员更多的小容器不再展开, 整体作为一个片段 */
+#define FROST_STRINGIFY_PLAN_MAX 4096      /* 片段总数的上限 */
+
+enum {
+    FROST_PIECE_VALUE,      /* 整个值 */
+    FROST_PIECE_RANGE,      /* 容器的子值 [begin, end), 含分隔符与键 */
+    FROST_PIECE_OPEN,       /* 容器的左括号 */
+    FROST_PIECE_CLOSE,      /* 容器的右括号 */
+    FROST_PIECE_PREFIX      /* 第 begin 个子值之前的分隔符与键 */
+};
+
+using frost_stringify_piece = struct {
+    int kind;
+    const frost_value* val;
+    size_t begin, end;
+    char* out;              /* VALUE / RANGE 的输出 */
+    size_t len;
+};
+
+using frost_stringify_plan = struct {
+    frost_stringify_piece* p;
+    size_t size, capacity;
+    size_t chunks;          /* 大容器切成的区间数 */
+};
+
+/* 转义后的精确长度 (含引号); *slack 取 frost_stringify_string 临时多占用的空间的最大值 */
+static auto frost_stringify_string_size(const char* str, size_t len, size_t* slack) -> size_t
+{
+    size_t i, n = len + 2;
+    for (i = 0; i < len; i++) {
+        auto ch = (unsigned char)str[i];
+        if (ch == '\"' || ch == '\\' || ch == '\b' || ch == '\f' || ch == '\n' || ch == '\r' || ch == '\t')
+            n += 1;
+        else if (ch < 0x20)
+            n += 5;
+    }
+    if (len * 6 + 2 - n > *slack)
+        *slack = len * 6 + 2 - n;
+    return n;
+}
+
+static auto frost_stringify_size(const frost_value* val, size_t* slack) -> size_t;
+
+/* 容器第 i 个子值之前的分隔符与键 */
+static auto frost_stringify_prefix_size(const frost_value* val, size_t i, size_t* slack) -> size_t
+{
+    size_t n = i > 0 ? 1 : 0;
+    if (val->type == FROST_OBJECT)
+        n += frost_stringify_string_size(val->u.o.m[i].k, val->u.o.m[i].klen, slack) + 1;
+    return n;
+}
+
+static void frost_stringify_prefix(frost_context* cot, const frost_value* val, size_t i)
+{
+    if (i > 0)
+        PUTC(cot, ',');
+    if (val->type == FROST_OBJECT) {
+        frost_stringify_string(cot, val->u.o.m[i].k, val->u.o.m[i].klen);
+        PUTC(cot, ':');
+    }
+}
+
+/* 输出长度的上界 */
+static auto frost_stringify_size(const frost_value* val, size_t* slack) -> size_t
+{
+    size_t i, n;
+    const char* str = nullptr;
+    switch (val->type) {
+    case FROST_NULL:
+    case FROST_TRUE:
+        return 4;
+    case FROST_FALSE:
+        return 5;
+    case FROST_NUMBER:
+        if ((str = frost_get_number_text(val, &n)) != nullptr)
+            return n;
+        return 24;      /* "%.17g" 最长如 -1.2345678901234567e-308; 整数不超过 20 位 */
+    case FROST_STRING:
+        return frost_stringify_string_size(val->u.s.s, val->u.s.len, slack);
+    default:
+        n = 2;
+        for (i = 0; i < frost_children(val); i++)
+            n += frost_stringify_prefix_size(val, i, slack) + frost_stringify_size(frost_child(val, i), slack);
+        return n;
+    }
+}
+
+static void frost_stringify_plan_add(frost_stringify_plan* plan, int kind, const frost_value* val, size_t begin, size_t end)
+{
+    frost_stringify_piece* piece = nullptr;
+    if (plan->size == plan->capacity) {
+        plan->capacity = plan->capacity == 0 ? 64 : plan->capacity * 2;
+        plan->p = (frost_stringify_piece*)realloc(plan->p, plan->capacity * sizeof(frost_stringify_piece));
+    }
+    piece = &plan->p[plan->size++];
+    piece->kind = kind;
+    piece->val = val;
+    piece->begin = begin;
+    piece->end = end;
+    piece->out = nullptr;
+    piece->len = 0;
+}
+
+static void frost_stringify_plan_value(frost_stringify_plan* plan, const frost_value* val)
+{
+    size_t i, step, size = frost_children(val);
+    if (size >= FROST_STRINGIFY_PARALLEL_MIN) {
+        step = (size + plan->chunks - 1) / plan->chunks;
+        frost_stringify_plan_add(plan, FROST_PIECE_OPEN, val, 0, 0);
+        for (i = 0; i < size; i += step)
+            frost_stringify_plan_add(plan, FROST_PIECE_RANGE, val, i, i + step < size ? i + step : size);
+        frost_stringify_plan_add(plan, FROST_PIECE_CLOSE, val, 0, 0);
+    } else if (size > 0 && size <= FROST_STRINGIFY_PLAN_FANOUT && plan->size + 2 * size + 2 <= FROST_STRINGIFY_PLAN_MAX) {
+        /* 大容器可能藏在较小的外层容器中, 展开外层 */
+        frost_stringify_plan_add(plan, FROST_PIECE_OPEN, val, 0, 0);
+        for (i = 0; i < size; i++) {
+            frost_stringify_plan_add(plan, FROST_PIECE_PREFIX, val, i, i + 1);
+            frost_stringify_plan_value(plan, frost_child(val, i));
+        }
+        frost_stringify_plan_add(plan, FROST_PIECE_CLOSE, val, 0, 0);
+    } else
+        frost_stringify_plan_add(plan, FROST_PIECE_VALUE, val, 0, 0);
+}
+
+static void frost_stringify_piece_run(frost_stringify_piece* piece)
+{
+    frost_context cot;
+    size_t i, bound = 0;
+    size_t slack = FROST_STRINGIFY_NUMBER_SLACK;
+    if (piece->kind == FROST_PIECE_VALUE)
+        bound = frost_stringify_size(piece->val, &slack);
+    else
+        for (i = piece->begin; i < piece->end; i++)
+            bound += frost_stringify_prefix_size(piece->val, i, &slack) + frost_stringify_size(frost_child(piece->val, i), &slack);
+    /* frost_context_push 在 top + size >= size 时扩容, 多留一个字节 */
+    cot.size = bound + slack + 1;
+    cot.stack = (char*)malloc(cot.size);
+    cot.top = 0;
+    if (piece->kind == FROST_PIECE_VALUE)
+        frost_stringify_value(&cot, piece->val);
+    else
+        for (i = piece->begin; i < piece->end; i++) {
+            frost_stringify_prefix(&cot, piece->val, i);
+            frost_stringify_value(&cot, frost_child(piece->val, i));
+        }
+    assert(cot.size == bound + slack + 1 && cot.top <= bound);
+    piece->out = cot.stack;
+    piece->len = cot.top;
+}
+
+static void frost_stringify_piece_task(frost_worker* w, void* ctx, size_t begin, size_t end)
+{
+    auto* plan = (frost_stringify_plan*)ctx;
+    (void)w;
+    for (size_t k = begin; k < end; k++)
+        frost_stringify_piece_run(&plan->p[k]);
+}
+
+/* 每个整值与区间片段一个任务 */
+static void frost_stringify_plan_task(frost_worker* w, void* ctx, size_t begin, size_t end)
+{
+    auto* plan = (frost_stringify_plan*)ctx;
+    frost_task_group group;
+    (void)begin;
+    (void)end;
+    group.pending.store(0, std::memory_order_relaxed);
+    for (size_t k = 0; k < plan->size; k++)
+        if (plan->p[k].kind == FROST_PIECE_VALUE || plan->p[k].kind == FROST_PIECE_RANGE)
+            frost_task_spawn(w, &group, frost_stringify_piece_task, plan, k, k + 1);
+    frost_task_wait(w, &group);
+}
+
+auto frost_stringify_parallel(const frost_value* val, size_t* length, unsigned threads) -> char*
+{
+    frost_stringify_plan plan;
+    frost_context cot;
+    size_t i, heavy = 0;
+    size_t total = 0;
+    size_t slack = FROST_STRINGIFY_NUMBER_SLACK;
+    assert(val != nullptr);
+    threads = frost_task_threads(threads);
+    if (threads <= 1 || frost_task_small(val))
+        return frost_stringify(val, length);
+    memset(&plan, 0, sizeof(plan));
+    plan.chunks = 4 * (size_t)threads;
+    frost_stringify_plan_value(&plan, val);
+    for (i = 0; i < plan.size; i++)
+        heavy += plan.p[i].kind == FROST_PIECE_VALUE || plan.p[i].kind == FROST_PIECE_RANGE;
+    if (heavy < 2) {
+        free(plan.p);
+        return frost_stringify(val, length);
+    }
+
+    frost_scheduler_run(threads < heavy ? threads : (unsigned)heavy, frost_stringify_plan_task, &plan);
+
+    for (i = 0; i < plan.size; i++) {
+        const frost_stringify_piece* piece = &plan.p[i];
+        if (piece->kind == FROST_PIECE_PREFIX)
+            total += frost_stringify_prefix_size(piece->val, piece->begin, &slack);
+        else
+            total += piece->out != nullptr ? piece->len : 1;
+    }
+    cot.size = total + slack + 1;
+    cot.stack = (char*)malloc(cot.size);
+    cot.top = 0;
+    for (i = 0; i < plan.size; i++) {
+        frost_stringify_piece* piece = &plan.p[i];
+        switch (piece->kind) {
+        case FROST_PIECE_OPEN:
+            PUTC(&cot, piece->val->type == FROST_ARRAY ? '[' : '{');
+            break;
+        case FROST_PIECE_CLOSE:
+            PUTC(&cot, piece->val->type == FROST_ARRAY ? ']' : '}');
+            break;
+        case FROST_PIECE_PREFIX:
+            frost_stringify_prefix(&cot, piece->val, piece->begin);
+            break;
+        default:
+            if (piece->len > 0)
+                PUTS(&cot, piece->out, piece->len);
+            free(piece->out);
+        }
+    }
+    free(plan.p);
+    assert(cot.top == total);
+    if (length != nullptr)
+        *length = cot.top;
+    PUTC(&cot, '\0');
     return cot.stack;
 }
 
+/*
+ * 共享节点
+ *
+ * 值 (frost_value) 本身仍按值存放在父容器中; FROST_FLAG_SHARED 表示它的字符串/元素/成员
+ * 缓冲区位于一个带引用计数头的共享块中, 被多个值引用, 内容不可变. 共享块中的子值也都是
+ * 共享的, 因此写时复制只需复制一层 (对象还要复制键) 并增加子值的引用计数.
+ * 共享块通常单独分配; frost_compact 产生的块连同对象的键一起位于一个紧凑块中, 由
+ * FROST_FLAG_ARENA 标记. 紧凑块中的块同样带引用计数头, 但不一定共享: 独占时可以原地修改元素.
+ */
+using frost_arena = struct {
+    std::atomic<size_t> live;   /* 尚未释放的共享块数, 为 0 时释放整个紧凑块 */
+    size_t reserved;            /* 使其后的共享块保持 16 字节对齐 */
+};
+
+struct frost_shared_block {
+    std::atomic<size_t> ref;
+    frost_arena* arena;         /* 所在的紧凑块, 单独分配时为 nullptr; 同时使内容保持 16 字节对齐 */
+};
+
+#define FROST_SHARED_BLOCK(p) ((frost_shared_block*)((char*)(p) - sizeof(frost_shared_block)))
+
+static auto frost_payload(const frost_value* val) -> void*
+{
+    switch (val->type) {
+    case FROST_STRING: return val->u.s.s;
+    case FROST_ARRAY:  return val->u.a.e;
+    case FROST_OBJECT: return val->u.o.m;
+    default:           return nullptr;
+    }
+}
+
+auto frost_shared_block_size(size_t size) -> size_t
+{
+    return sizeof(frost_shared_block) + size;
+}
+
+static auto frost_shared_alloc(size_t size) -> void*
+{
+    auto* block = (frost_shared_block*)malloc(frost_shared_block_size(size));
+    new (&block->ref) std::atomic<size_t>(1);
+    block->arena = nullptr;
+    return block + 1;
+}
+
+static void frost_shared_retain(const frost_value* val)
+{
+    if ((val->flags & FROST_FLAG_SHARED) != 0)
+        FROST_SHARED_BLOCK(frost_payload(val))->ref.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* 写时复制出的一层与共享块各持有一份子值: 共享的子值增加引用计数, 堆上的数字文本复制一份 */
+static void frost_shared_retain_child(frost_value* val)
+{
+    if (val->type == FROST_NUMBER && (val->flags & FROST_FLAG_RAW_HEAP) != 0) {
+        char* s = (char*)malloc(val->u.rh.len + 1);
+        memcpy(s, val->u.rh.s, val->u.rh.len + 1);
+        val->u.rh.s = s;
+    } else
+        frost_shared_retain(val);
+}
+
+/* 放弃一个引用; 返回 1 表示已无其他引用, 调用者需要释放子值与缓冲区 */
+static auto frost_shared_release(const frost_value* val) -> int
+{
+    if ((val->flags & FROST_FLAG_SHARED) == 0)
+        return 1;
+    return FROST_SHARED_BLOCK(frost_payload(val))->ref.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+/* 紧凑块中的对象, 其键也在紧凑块中, 不能单独释放 */
+static auto frost_arena_of(const frost_value* val) -> frost_arena*
+{
+    return (val->flags & FROST_FLAG_ARENA) != 0 ? FROST_SHARED_BLOCK(frost_payload(val))->arena : nullptr;
+}
+
+static void frost_shared_block_free(frost_shared_block* block)
+{
+    if (block->arena == nullptr)
+        free(block);
+    else if (block->arena->live.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        free(block->arena);
+}
+
+static void frost_free_payload(const frost_value* val)
+{
+    void* p = frost_payload(val);
+    if ((val->flags & (FROST_FLAG_SHARED | FROST_FLAG_ARENA)) != 0)
+        frost_shared_block_free(FROST_SHARED_BLOCK(p));
+    else
+        free(p);
+}
+
 void frost_copy(frost_value* dst, const frost_value* src) {
     assert(src != nullptr && dst != nullptr && src != dst);
     size_t i;
+    FROST_ASSERT_WRITABLE(dst);
+    if ((src->flags & FROST_FLAG_SHARED) != 0) {
+        /* 共享节点不可变, 副本只增加引用计数 */
+        frost_shared_retain(src);
+        frost_free(dst);
+        memcpy(dst, src, sizeof(frost_value));
+        dst->flags &= ~(FROST_FLAG_FROZEN);
+        return;
+    }
     switch (src->type) {
+        case FROST_NUMBER:
+            frost_free(dst);
+            memcpy(dst, src, sizeof(frost_value));
+            dst->flags &= ~FROST_FLAG_FROZEN;
+            if ((src->flags & FROST_FLAG_RAW_HEAP) != 0) {
+                dst->u.rh.s = (char*)malloc(src->u.rh.len + 1);
+                memcpy(dst->u.rh.s, src->u.rh.s, src->u.rh.len + 1);
+            }
+            return;
         case FROST_STRING:
             frost_set_string(dst, src->u.s.s, src->u.s.len);
             break;
         case FROST_ARRAY:
             frost_set_array(dst, src->u.a.size);
             for(i = 0; i < src->u.a.size; i++){
+                frost_init(&dst->u.a.e[i]);
                 frost_copy(&dst->u.a.e[i], &src->u.a.e[i]);
             }
             dst->u.a.size = src->u.a.size;
             break;
         case FROST_OBJECT:
+            /* 逐个复制成员而不经 frost_set_object_value, 重复的键也原样保留 */
             frost_set_object(dst, src->u.o.size);
             for(i = 0; i < src->u.o.size; i++){
-                frost_value * val = frost_set_object_value(dst, src->u.o.m[i].k, src->u.o.m[i].klen);
-                frost_copy(val, &src->u.o.m[i].v);
+                frost_member* mem = &dst->u.o.m[i];
+                mem->klen = src->u.o.m[i].klen;
+                mem->k = (char*)malloc(mem->klen + 1);
+                memcpy(mem->k, src->u.o.m[i].k, mem->klen + 1);
+                frost_init(&mem->v);
+                frost_copy(&mem->v, &src->u.o.m[i].v);
             }
             dst->u.o.size = src->u.o.size;
+            dst->flags |= src->flags & FROST_FLAG_SORTED;
             break;
         default:
             frost_free(dst);
-            memcpy(dst, src, sizeof(frost_value));
-            break;
+            dst->type = src->type;
+            return;
+    }
+}
+
+void frost_move(frost_value* dst, frost_value* src) {
+    assert(dst != nullptr && src != nullptr && src != dst);
+    frost_free(dst);
+    memcpy(dst, src, sizeof(frost_value));
+    frost_init(src);
+}
+
+void frost_swap(frost_value* lhs, frost_value* rhs) {
+    assert(lhs != nullptr && rhs != nullptr);
+    if (lhs != rhs) {
+        frost_value temp;
+        memcpy(&temp, lhs, sizeof(frost_value));
+        memcpy(lhs,   rhs, sizeof(frost_value));
+        memcpy(rhs, &temp, sizeof(frost_value));
+    }
+}
+
+void frost_free(frost_value* val)
+{
+    size_t i;
+    assert(val != nullptr);
+    switch (val->type) {
+    case FROST_NUMBER:
+        if ((val->flags & FROST_FLAG_RAW_HEAP) != 0)
+            free(val->u.rh.s);
+        break;
+    case FROST_STRING:
+        if (frost_shared_release(val))
+            frost_free_payload(val);
+        break;
+    case FROST_ARRAY:
+        if (frost_shared_release(val)) {
+            for (i = 0; i < val->u.a.size; i++)
+                frost_free(&val->u.a.e[i]);
+            frost_free_payload(val);
+        }
+        break;
+    case FROST_OBJECT:
+        if (frost_shared_release(val)) {
+            int keys = frost_arena_of(val) == nullptr;
+            for (i = 0; i < val->u.o.size; i++) {
+                if (keys)
+                    free(val->u.o.m[i].k);
+                frost_free(&val->u.o.m[i].v);
+            }
+            frost_free_payload(val);
+        }
+        break;
+    default:
+        break;
+    }
+    val->type = FROST_NULL;
+    val->flags = 0;
+}
+
+void frost_share(frost_value* val)
+{
+    size_t i, size;
+    void* p = nullptr;
+    assert(val != nullptr);
+    if ((val->flags & FROST_FLAG_SHARED) != 0)
+        return;
+    FROST_ASSERT_WRITABLE(val);
+    /* 紧凑块中的块已带引用计数头, 原地转为共享 */
+    if ((val->flags & FROST_FLAG_ARENA) != 0) {
+        if (val->type == FROST_ARRAY)
+            for (i = 0; i < val->u.a.size; i++)
+                frost_share(&val->u.a.e[i]);
+        else if (val->type == FROST_OBJECT)
+            for (i = 0; i < val->u.o.size; i++)
+                frost_share(&val->u.o.m[i].v);
+        val->flags |= FROST_FLAG_SHARED;
+        return;
+    }
+    switch (val->type) {
+    case FROST_STRING:
+        size = val->u.s.len + 1;
+        p = frost_shared_alloc(size);
+        memcpy(p, val->u.s.s, size);
+        free(val->u.s.s);
+        val->u.s.s = (char*)p;
+        break;
+    case FROST_ARRAY:
+        if (val->u.a.size == 0)
+            return;
+        for (i = 0; i < val->u.a.size; i++)
+            frost_share(&val->u.a.e[i]);
+        size = val->u.a.size * sizeof(frost_value);
+        p = frost_shared_alloc(size);
+        memcpy(p, val->u.a.e, size);
+        free(val->u.a.e);
+        val->u.a.e = (frost_value*)p;
+        val->u.a.capacity = val->u.a.size;
+        break;
+    case FROST_OBJECT:
+        if (val->u.o.size == 0)
+            return;
+        for (i = 0; i < val->u.o.size; i++)
+            frost_share(&val->u.o.m[i].v);
+        size = val->u.o.size * sizeof(frost_member);
+        p = frost_shared_alloc(size);
+        memcpy(p, val->u.o.m, size);
+        free(val->u.o.m);
+        val->u.o.m = (frost_member*)p;
+        val->u.o.capacity = val->u.o.size;
+        break;
+    default:
+        return;
+    }
+    val->flags |= FROST_FLAG_SHARED;
+}
+
+void frost_unshare(frost_value* val)
+{
+    size_t i, size;
+    void* p = nullptr;
+    frost_value old;
+    int sole = 0;
+    assert(val != nullptr);
+    if ((val->flags & (FROST_FLAG_SHARED | FROST_FLAG_ARENA)) == 0)
+        return;
+    FROST_ASSERT_WRITABLE(val);
+    /* 唯一的引用直接接管子值与键 (紧凑块中的键除外), 否则为副本增加子值的引用计数并复制键;
+     * 共享块可能已被冻结的文档引用, 复制出的子值去掉只读标记 */
+    sole = (val->flags & FROST_FLAG_SHARED) == 0
+        || FROST_SHARED_BLOCK(frost_payload(val))->ref.load(std::memory_order_acquire) == 1;
+    switch (val->type) {
+    case FROST_STRING:
+        size = val->u.s.len + 1;
+        p = malloc(size);
+        memcpy(p, val->u.s.s, size);
+        break;
+    case FROST_ARRAY:
+        size = val->u.a.size * sizeof(frost_value);
+        p = malloc(size);
+        memcpy(p, val->u.a.e, size);
+        for (i = 0; i < val->u.a.size; i++) {
+            frost_value* e = &((frost_value*)p)[i];
+            e->flags &= ~(FROST_FLAG_FROZEN);
+            if (sole == 0)
+                frost_shared_retain_child(e);
+        }
+        break;
+    case FROST_OBJECT:
+        size = val->u.o.size * sizeof(frost_member);
+        p = malloc(size);
+        memcpy(p, val->u.o.m, size);
+        for (i = 0; i < val->u.o.size; i++) {
+            frost_member* m = &((frost_member*)p)[i];
+            m->v.flags &= ~(FROST_FLAG_FROZEN);
+            if (sole != 0 && frost_arena_of(val) == nullptr)
+                continue;
+            char* k = (char*)malloc(m->klen + 1);
+            memcpy(k, m->k, m->klen + 1);
+            m->k = k;
+            if (sole == 0)
+                frost_shared_retain_child(&m->v);
+        }
+        break;
+    default:
+        assert(0);
+    }
+    memcpy(&old, val, sizeof(frost_value));
+    if (sole != 0)
+        frost_shared_block_free(FROST_SHARED_BLOCK(frost_payload(&old)));
+    else
+        frost_free(&old);
+    switch (val->type) {
+    case FROST_STRING: val->u.s.s = (char*)p; break;
+    case FROST_ARRAY:  val->u.a.e = (frost_value*)p; break;
+    default:           val->u.o.m = (frost_member*)p; break;
     }
+    val->flags &= ~(FROST_FLAG_SHARED | FROST_FLAG_ARENA);
 }
 
-void frost_move(frost_value* dst, frost_value* src) {
-    assert(dst != nullptr && src != nullptr && src != dst);
-    frost_free(dst);
-    memcpy(dst, src, sizeof(frost_value));
-    frost_init(src);
+/*
+ * 取得节点的独占所有权, 供返回子值可写指针的 frost_mutable_* 与 frost_set_object_value 使用:
+ * 紧凑块中只剩这一个引用的共享节点原地转为独占, 不离开紧凑块; 其余情况同 frost_unshare (仍被共享的一层复制出来, 子值留在原处)
+ */
+static void frost_claim(frost_value* val)
+{
+    size_t i;
+    assert((val->flags & FROST_FLAG_SHARED) != 0);
+    if ((val->flags & FROST_FLAG_ARENA) == 0
+        || FROST_SHARED_BLOCK(frost_payload(val))->ref.load(std::memory_order_acquire) != 1) {
+        frost_unshare(val);
+        return;
+    }
+    FROST_ASSERT_WRITABLE(val);
+    if (val->type == FROST_ARRAY)
+        for (i = 0; i < val->u.a.size; i++)
+            val->u.a.e[i].flags &= ~(FROST_FLAG_FROZEN);
+    else if (val->type == FROST_OBJECT)
+        for (i = 0; i < val->u.o.size; i++)
+            val->u.o.m[i].v.flags &= ~(FROST_FLAG_FROZEN);
+    val->flags &= ~FROST_FLAG_SHARED;
 }
 
-void frost_swap(frost_value* lhs, frost_value* rhs) {
-    assert(lhs != nullptr && rhs != nullptr);
-    if (lhs != rhs) {
-        frost_value temp;
-        memcpy(&temp, lhs, sizeof(frost_value));
-        memcpy(lhs,   rhs, sizeof(frost_value));
-        memcpy(rhs, &temp, sizeof(frost_value));
+/*
+ * 紧凑化
+ *
+ * 把独占部分的字符串、数组与对象 (连同其键) 按深度优先的先序重新放进一块连续内存,
+ * 容量收缩到恰好等于大小, 遍历时依次访问的节点在内存中也相邻. 重排后的节点带
+ * FROST_FLAG_ARENA 但仍是独占的: 查找与元素的原地修改不会把它们移出紧凑块, 只有改变大小
+ * 或释放键的修改才把那一层复制回单独的分配; 紧凑块在其中最后一个块释放时整体释放.
+ * 已经共享的子树可能被其他值引用, 保持原样 (应先去重再紧凑化); 已在紧凑块中的节点也留在原处,
+ * 再次紧凑化只搬入其下后来修改过的部分; 延迟数字的堆上文本不移动.
+ *
+ * 节省的字节数按每次分配 16 字节的簿记开销并向上对齐到 16 字节估算, 与紧凑块中
+ * 共享块的占用 (引用计数头加对齐) 相同, 因此只计入收缩的容量与合并的分配次数.
+ */
+static inline auto frost_compact_slot(size_t size) -> size_t
+{
+    return (frost_shared_block_size(size) + 15) & ~(size_t)15;
+}
+
+static inline auto frost_compact_alloc(size_t size) -> size_t
+{
+    return size != 0 ? frost_compact_slot(size) : 0;
+}
+
+/* 累计独占部分原先占用的字节数与重排后的字节数, 返回需要的共享块数 */
+static auto frost_compact_measure(const frost_value* val, size_t* old_bytes, size_t* new_bytes) -> size_t
+{
+    size_t i, n, count = 0;
+    if ((val->flags & FROST_FLAG_SHARED) != 0)
+        return 0;
+    if ((val->flags & FROST_FLAG_ARENA) != 0) {
+        for (i = 0; val->type == FROST_ARRAY && i < val->u.a.size; i++)
+            count += frost_compact_measure(&val->u.a.e[i], old_bytes, new_bytes);
+        for (i = 0; val->type == FROST_OBJECT && i < val->u.o.size; i++)
+            count += frost_compact_measure(&val->u.o.m[i].v, old_bytes, new_bytes);
+        return count;
+    }
+    switch (val->type) {
+    case FROST_STRING:
+        *old_bytes += frost_compact_alloc(val->u.s.len + 1);
+        *new_bytes += frost_compact_slot(val->u.s.len + 1);
+        return 1;
+    case FROST_ARRAY:
+        *old_bytes += frost_compact_alloc(val->u.a.capacity * sizeof(frost_value));
+        if (val->u.a.size == 0)
+            return 0;
+        *new_bytes += frost_compact_slot(val->u.a.size * sizeof(frost_value));
+        for (i = 0; i < val->u.a.size; i++)
+            count += frost_compact_measure(&val->u.a.e[i], old_bytes, new_bytes);
+        return count + 1;
+    case FROST_OBJECT:
+        *old_bytes += frost_compact_alloc(val->u.o.capacity * sizeof(frost_member));
+        if (val->u.o.size == 0)
+            return 0;
+        n = val->u.o.size * sizeof(frost_member);
+        for (i = 0; i < val->u.o.size; i++) {
+            n += val->u.o.m[i].klen + 1;
+            *old_bytes += frost_compact_alloc(val->u.o.m[i].klen + 1);
+            count += frost_compact_measure(&val->u.o.m[i].v, old_bytes, new_bytes);
+        }
+        *new_bytes += frost_compact_slot(n);
+        return count + 1;
+    default:
+        return 0;
     }
 }
 
-void frost_free(frost_value* val)
+/* 从 *cursor 切出一个共享块 */
+static auto frost_compact_carve(frost_arena* arena, char** cursor, size_t size) -> void*
 {
-    size_t i;
-    assert(val != nullptr);
+    auto* block = (frost_shared_block*)*cursor;
+    new (&block->ref) std::atomic<size_t>(1);
+    block->arena = arena;
+    *cursor += frost_compact_slot(size);
+    return block + 1;
+}
+
+static void frost_compact_children(frost_value* val, frost_arena* arena, char** cursor);
+
+static void frost_compact_move(frost_value* val, frost_arena* arena, char** cursor)
+{
+    size_t i, size;
+    void* p = nullptr;
+    if ((val->flags & FROST_FLAG_SHARED) != 0)
+        return;
+    if ((val->flags & FROST_FLAG_ARENA) != 0) {
+        frost_compact_children(val, arena, cursor);
+        return;
+    }
     switch (val->type) {
     case FROST_STRING:
+        size = val->u.s.len + 1;
+        p = frost_compact_carve(arena, cursor, size);
+        memcpy(p, val->u.s.s, size);
         free(val->u.s.s);
+        val->u.s.s = (char*)p;
         break;
     case FROST_ARRAY:
-        for (i = 0; i < val->u.a.size; i++)
-            frost_free(&val->u.a.e[i]);
+        if (val->u.a.size == 0) {
+            free(val->u.a.e);
+            val->u.a.e = nullptr;
+            val->u.a.capacity = 0;
+            return;
+        }
+        size = val->u.a.size * sizeof(frost_value);
+        p = frost_compact_carve(arena, cursor, size);
+        memcpy(p, val->u.a.e, size);
         free(val->u.a.e);
+        val->u.a.e = (frost_value*)p;
+        val->u.a.capacity = val->u.a.size;
+        frost_compact_children(val, arena, cursor);
         break;
     case FROST_OBJECT:
-        for (i = 0; i < val->u.o.size; i++) {
-            free(val->u.o.m[i].k);
-            frost_free(&val->u.o.m[i].v);
+        if (val->u.o.size == 0) {
+            free(val->u.o.m);
+            val->u.o.m = nullptr;
+            val->u.o.capacity = 0;
+            return;
         }
+        size = val->u.o.size * sizeof(frost_member);
+        for (i = 0; i < val->u.o.size; i++)
+            size += val->u.o.m[i].klen + 1;
+        p = frost_compact_carve(arena, cursor, size);
+        size = val->u.o.size * sizeof(frost_member);
+        memcpy(p, val->u.o.m, size);
         free(val->u.o.m);
+        val->u.o.m = (frost_member*)p;
+        val->u.o.capacity = val->u.o.size;
+        /* 键紧跟在成员之后 */
+        for (i = 0; i < val->u.o.size; i++) {
+            frost_member* m = &val->u.o.m[i];
+            char* k = (char*)p + size;
+            memcpy(k, m->k, m->klen + 1);
+            free(m->k);
+            m->k = k;
+            size += m->klen + 1;
+        }
+        frost_compact_children(val, arena, cursor);
+        break;
+    default:
+        return;
+    }
+    val->flags |= FROST_FLAG_ARENA;
+}
+
+static void frost_compact_children(frost_value* val, frost_arena* arena, char** cursor)
+{
+    size_t i;
+    if (val->type == FROST_ARRAY)
+        for (i = 0; i < val->u.a.size; i++)
+            frost_compact_move(&val->u.a.e[i], arena, cursor);
+    else if (val->type == FROST_OBJECT)
+        for (i = 0; i < val->u.o.size; i++)
+            frost_compact_move(&val->u.o.m[i].v, arena, cursor);
+}
+
+auto frost_compact(frost_value* val) -> size_t
+{
+    size_t old_bytes = 0, new_bytes = sizeof(frost_arena), count = 0;
+    frost_arena* arena = nullptr;
+    char* cursor = nullptr;
+    assert(val != nullptr);
+    FROST_ASSERT_WRITABLE(val);
+    count = frost_compact_measure(val, &old_bytes, &new_bytes);
+    if (count == 0) {
+        /* 只剩空容器需要收缩 */
+        frost_compact_move(val, nullptr, &cursor);
+        return old_bytes;
+    }
+    arena = (frost_arena*)malloc(new_bytes);
+    new (&arena->live) std::atomic<size_t>(count);
+    cursor = (char*)(arena + 1);
+    frost_compact_move(val, arena, &cursor);
+    assert(cursor == (char*)arena + new_bytes);
+    return old_bytes > new_bytes ? old_bytes - new_bytes : 0;
+}
+
+/*
+ * 冻结
+ *
+ * 延迟数字的转换结果在这里一次算好, 再给每个节点 (包括共享块中的子值) 加上
+ * FROST_FLAG_FROZEN. 此后数字读取只读缓存, frost_mutable_array_element /
+ * frost_mutable_object_value 也不再写时复制, 整棵树在释放前不会再被写入, 多个线程可以
+ * 不加同步地同时读取.
+ */
+void frost_freeze(frost_value* val)
+{
+    size_t i;
+    assert(val != nullptr);
+    if ((val->flags & FROST_FLAG_FROZEN) != 0)
+        return;
+    switch (val->type) {
+    case FROST_NUMBER:
+        frost_number_load(val);
+        break;
+    case FROST_ARRAY:
+        for (i = 0; i < val->u.a.size; i++)
+            frost_freeze(&val->u.a.e[i]);
+        break;
+    case FROST_OBJECT:
+        for (i = 0; i < val->u.o.size; i++)
+            frost_freeze(&val->u.o.m[i].v);
         break;
     default:
         break;
     }
-    val->type = FROST_NULL;
+    val->flags |= FROST_FLAG_FROZEN;
 }
 
 auto frost_get_type(const frost_value* val) -> frost_type
@@ -610,18 +3144,147 @@ auto frost_get_type(const frost_value* val) -> frost_type
     return val->type;
 }
 
+/*
+ * 结构哈希
+ *
+ * 与 frost_is_equal 的相等关系一致: 数组按顺序组合元素哈希, 对象把各成员 (键, 值) 的哈希
+ * 相加, 与成员顺序无关; -0.0 与 0.0 哈希相同. 可写的树随时可能经由先前取得的元素指针
+ * 被修改, 节点中也没有存放哈希的位置, 因此每次都重新计算, 不写入任何缓存.
+ */
+static inline auto frost_hash_mix(uint64_t h) -> uint64_t
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline auto frost_hash_rotl(uint64_t h, unsigned r) -> uint64_t
+{
+    return (h << r) | (h >> (64 - r));
+}
+
+static auto frost_hash_bytes(const char* str, size_t len, uint64_t seed) -> uint64_t
+{
+    uint64_t h = seed ^ (len * 0x9e3779b97f4a7c15ull);
+    uint64_t k = 0;
+    for (; len >= 8; str += 8, len -= 8) {
+        memcpy(&k, str, 8);
+        h = frost_hash_rotl(h ^ (k * 0x87c37b91114253d5ull), 31) * 0x4cf5ad432745937full;
+    }
+    k = 0;
+    if (len > 0)
+        memcpy(&k, str, len);
+    return frost_hash_mix(h ^ (k * 0x87c37b91114253d5ull));
+}
+
+/* 数组按顺序合入元素哈希, 对象把各成员的哈希相加 */
+#define FROST_HASH_ARRAY_SEED 0x2127599bf4325c37ull
+
+static inline auto frost_hash_element(uint64_t h, uint64_t eh) -> uint64_t
+{
+    return frost_hash_rotl(h ^ eh, 27) * 0x9e3779b97f4a7c15ull;
+}
+
+static inline auto frost_hash_member(const frost_member* mem, uint64_t vh) -> uint64_t
+{
+    return frost_hash_mix(frost_hash_bytes(mem->k, mem->klen, 0x7a3c5e9b1d2f4a68ull) ^ frost_hash_rotl(vh, 29));
+}
+
+static inline auto frost_hash_finish(const frost_value* val, uint64_t h) -> uint64_t
+{
+    if (val->type == FROST_ARRAY)
+        return frost_hash_mix(h ^ val->u.a.size);
+    return frost_hash_mix(h ^ 0x6c8e9cf570932bd5ull ^ val->u.o.size);
+}
+
+/* 整数转为 double; 返回 0 表示不能精确表示 (此时它不等于任何 double) */
+static auto frost_integer_to_double(const frost_value* val, double* num) -> int
+{
+    if ((val->flags & FROST_FLAG_INT64) != 0) {
+        *num = (double)val->u.i64;
+        return *num < 9223372036854775808.0 && (int64_t)*num == val->u.i64;
+    }
+    *num = (double)val->u.u64;
+    return *num < 18446744073709551616.0 && (uint64_t)*num == val->u.u64;
+}
+
+/* 按数值比较: 整数之间精确比较, 整数与 double 相等当且仅当 double 恰好是这个整数 */
+static auto frost_number_equal(const frost_value* lhs, const frost_value* rhs) -> int
+{
+    unsigned lkind = 0;
+    unsigned rkind = 0;
+    double num = 0.0;
+    frost_number_load(lhs);
+    frost_number_load(rhs);
+    lkind = lhs->flags & FROST_FLAG_INTEGER;
+    rkind = rhs->flags & FROST_FLAG_INTEGER;
+    if (lkind == 0 && rkind == 0)
+        return lhs->u.n == rhs->u.n;
+    if (lkind != 0 && rkind != 0)
+        return lkind == rkind && lhs->u.u64 == rhs->u.u64;
+    if (lkind == 0) {
+        const frost_value* tmp = lhs;
+        lhs = rhs;
+        rhs = tmp;
+    }
+    return frost_integer_to_double(lhs, &num) != 0 && num == rhs->u.n;
+}
+
+auto frost_hash(const frost_value* val) -> uint64_t
+{
+    uint64_t h = 0;
+    double num = 0.0;
+    assert(val != nullptr);
+    switch (val->type) {
+    case FROST_NUMBER:
+        frost_number_load(val);
+        /* 整数若能精确转为 double 则按 double 哈希, 与数值相等的 double 一致 */
+        if ((val->flags & FROST_FLAG_INTEGER) != 0 && frost_integer_to_double(val, &num) == 0)
+            return frost_hash_mix(val->u.u64 ^ 0x6a09e667f3bcc909ull);
+        if ((val->flags & FROST_FLAG_INTEGER) == 0)
+            num = val->u.n;
+        num = num == 0.0 ? 0.0 : num;
+        memcpy(&h, &num, sizeof(h));
+        return frost_hash_mix(h ^ 0x3b1b4c1d5e6f7a89ull);
+    case FROST_STRING:
+        return frost_hash_bytes(val->u.s.s, val->u.s.len, 0x5bd1e9955bd1e995ull);
+    case FROST_ARRAY:
+        h = FROST_HASH_ARRAY_SEED;
+        for (size_t i = 0; i < val->u.a.size; i++)
+            h = frost_hash_element(h, frost_hash(&val->u.a.e[i]));
+        return frost_hash_finish(val, h);
+    case FROST_OBJECT:
+        for (size_t i = 0; i < val->u.o.size; i++)
+            h += frost_hash_member(&val->u.o.m[i], frost_hash(&val->u.o.m[i].v));
+        return frost_hash_finish(val, h);
+    default:
+        return frost_hash_mix(0x1f83d9abfb41bd6bull + val->type);
+    }
+}
+
+/*
+ * 两侧引用同一共享块时直接相等. 对象优先按相同下标匹配键, 键顺序一致时为 O(N).
+ */
 auto frost_is_equal(const frost_value* lhs, const frost_value* rhs) -> int {
     size_t i = 0;
     size_t index = 0;
     assert(lhs != nullptr && rhs != nullptr);
+    if (lhs == rhs)
+        return 1;
     if (lhs->type != rhs->type)
         return 0;
+    /* 引用同一共享块 */
+    if ((lhs->flags & rhs->flags & FROST_FLAG_SHARED) != 0 && frost_payload(lhs) == frost_payload(rhs))
+        return 1;
     switch (lhs->type) {
         case FROST_STRING:
             return lhs->u.s.len == rhs->u.s.len && 
                 memcmp(lhs->u.s.s, rhs->u.s.s, lhs->u.s.len) == 0;
         case FROST_NUMBER:
-            return lhs->u.n == rhs->u.n;
+            return frost_number_equal(lhs, rhs);
         case FROST_ARRAY:
             if (lhs->u.a.size != rhs->u.a.size)
                 return 0;
@@ -632,11 +3295,25 @@ auto frost_is_equal(const frost_value* lhs, const frost_value* rhs) -> int {
         case FROST_OBJECT:
             if(lhs->u.o.size != rhs->u.o.size)
                 return 0;
+            /* 两侧都已排序: 键集合相同则逐个对齐, 线性归并即可 */
+            if ((lhs->flags & rhs->flags & FROST_FLAG_SORTED) != 0) {
+                for (i = 0; i < lhs->u.o.size; i++) {
+                    const frost_member* l = &lhs->u.o.m[i];
+                    const frost_member* r = &rhs->u.o.m[i];
+                    if (l->klen != r->klen || memcmp(l->k, r->k, l->klen) != 0 || frost_is_equal(&l->v, &r->v) == 0)
+                        return 0;
+                }
+                return 1;
+            }
             for(i = 0; i < lhs->u.o.size; i++){
-                index = frost_find_object_index(rhs, lhs->u.o.m[i].k, lhs->u.o.m[i].klen);
+                const frost_member* mem = &lhs->u.o.m[i];
+                if (rhs->u.o.m[i].klen == mem->klen && memcmp(rhs->u.o.m[i].k, mem->k, mem->klen) == 0)
+                    index = i;
+                else
+                    index = frost_find_object_index(rhs, mem->k, mem->klen);
                 if(index == FROST_KEY_NOT_EXIST)
                     return 0;
-                if (frost_is_equal(&lhs->u.o.m[i].v, &rhs->u.o.m[index].v) == 0)
+                if (frost_is_equal(&mem->v, &rhs->u.o.m[index].v) == 0)
                     return 0;
             }
             return 1;
@@ -645,6 +3322,215 @@ auto frost_is_equal(const frost_value* lhs, const frost_value* rhs) -> int {
     }
 }
 
+/*
+ * 并行复制、比较与哈希
+ *
+ * 由工作窃取调度器按子树规模切分容器的子值. 参与的值只读: 延迟解析的数字在局部副本上
+ * 转换而不写回缓存, 共享块可能在树中多处出现并被多个线程同时访问. 比较一旦发现不相等就
+ * 设置 cancel, 其余任务随即返回.
+ */
+using frost_pair_task = struct {
+    frost_value* dst;           /* 复制的目标; 比较时为 nullptr */
+    const frost_value* lhs;
+    const frost_value* rhs;
+    uint64_t* hashes;           /* 哈希时各子值的结果 */
+    uint64_t result;            /* 根任务的结论: 是否相等或哈希值 */
+};
+
+static void frost_copy_value_task(frost_worker* w, frost_value* dst, const frost_value* src);
+
+static void frost_copy_range(frost_worker* w, void* ctx, size_t begin, size_t end)
+{
+    auto* task = (frost_pair_task*)ctx;
+    const frost_value* src = task->lhs;
+    for (size_t i = begin; i < end; i++) {
+        if (src->type == FROST_ARRAY) {
+            frost_init(&task->dst->u.a.e[i]);
+            frost_copy_value_task(w, &task->dst->u.a.e[i], &src->u.a.e[i]);
+        } else {
+            frost_member* mem = &task->dst->u.o.m[i];
+            mem->klen = src->u.o.m[i].klen;
+            mem->k = (char*)malloc(mem->klen + 1);
+            memcpy(mem->k, src->u.o.m[i].k, mem->klen + 1);
+            frost_init(&mem->v);
+            frost_copy_value_task(w, &mem->v, &src->u.o.m[i].v);
+        }
+    }
+}
+
+/* dst 为 null; 与 frost_copy 的结果相同 */
+static void frost_copy_value_task(frost_worker* w, frost_value* dst, const frost_value* src)
+{
+    frost_pair_task task = { dst, src, nullptr, nullptr, 0 };
+    if ((src->flags & FROST_FLAG_SHARED) != 0 || frost_children(src) == 0) {
+        frost_copy(dst, src);
+        return;
+    }
+    if (src->type == FROST_ARRAY) {
+        frost_set_array(dst, src->u.a.size);
+        dst->u.a.size = src->u.a.size;
+    } else {
+        frost_set_object(dst, src->u.o.size);
+        dst->u.o.size = src->u.o.size;
+        dst->flags |= src->flags & FROST_FLAG_SORTED;
+    }
+    frost_task_for(w, src, frost_copy_range, &task);
+}
+
+static void frost_copy_root(frost_worker* w, void* ctx, size_t begin, size_t end)
+{
+    auto* task = (frost_pair_task*)ctx;
+    (void)begin;
+    (void)end;
+    frost_copy_value_task(w, task->dst, task->lhs);
+}
+
+void frost_copy_parallel(frost_value* dst, const frost_value* src, unsigned threads)
+{
+    frost_pair_task task = { dst, src, nullptr, nullptr, 0 };
+    assert(src != nullptr && dst != nullptr && src != dst);
+    FROST_ASSERT_WRITABLE(dst);
+    threads = frost_task_threads(threads);
+    if (threads <= 1 || (src->flags & FROST_FLAG_SHARED) != 0 || frost_task_small(src)) {
+        frost_copy(dst, src);
+        return;
+    }
+    frost_free(dst);
+    frost_scheduler_run(threads, frost_copy_root, &task);
+}
+
+static auto frost_equal_value_task(frost_worker* w, const frost_value* lhs, const frost_value* rhs) -> int;
+
+static void frost_equal_range(frost_worker* w, void* ctx, size_t begin, size_t end)
+{
+    auto* task = (frost_pair_task*)ctx;
+    const frost_value* lhs = task->lhs;
+    const frost_value* rhs = task->rhs;
+    size_t i, index = 0;
+    for (i = begin; i < end && w->sched->cancel.load(std::memory_order_relaxed) == 0; i++) {
+        int equal = 0;
+        if (lhs->type == FROST_ARRAY)
+            equal = frost_equal_value_task(w, &lhs->u.a.e[i], &rhs->u.a.e[i]);
+        else {
+            const frost_member* mem = &lhs->u.o.m[i];
+            if (rhs->u.o.m[i].klen == mem->klen && memcmp(rhs->u.o.m[i].k, mem->k, mem->klen) == 0)
+                index = i;
+            else if ((lhs->flags & rhs->flags & FROST_FLAG_SORTED) != 0)
+                index = FROST_KEY_NOT_EXIST;    /* 两侧都已排序时键必须逐个对齐 */
+            else
+                index = frost_find_object_index(rhs, mem->k, mem->klen);
+            equal = index != FROST_KEY_NOT_EXIST && frost_equal_value_task(w, &mem->v, &rhs->u.o.m[index].v);
+        }
+        if (equal == 0)
+            w->sched->cancel.store(1, std::memory_order_relaxed);
+    }
+}
+
+/* 与 frost_is_equal 相同, 但不写入任何缓存; 返回 0 时调用者设置 cancel */
+static auto frost_equal_value_task(frost_worker* w, const frost_value* lhs, const frost_value* rhs) -> int
+{
+    frost_pair_task task = { nullptr, lhs, rhs, nullptr, 0 };
+    frost_value l, r;
+    if (lhs == rhs)
+        return 1;
+    if (lhs->type != rhs->type)
+        return 0;
+    if ((lhs->flags & rhs->flags & FROST_FLAG_SHARED) != 0 && frost_payload(lhs) == frost_payload(rhs))
+        return 1;
+    switch (lhs->type) {
+    case FROST_STRING:
+        return lhs->u.s.len == rhs->u.s.len && memcmp(lhs->u.s.s, rhs->u.s.s, lhs->u.s.len) == 0;
+    case FROST_NUMBER:
+        memcpy(&l, lhs, sizeof(frost_value));
+        memcpy(&r, rhs, sizeof(frost_value));
+        return frost_number_equal(&l, &r);
+    case FROST_ARRAY:
+    case FROST_OBJECT:
+        if (frost_children(lhs) != frost_children(rhs))
+            return 0;
+        frost_task_for(w, lhs, frost_equal_range, &task);
+        return w->sched->cancel.load(std::memory_order_relaxed) == 0;
+    default:
+        return 1;
+    }
+}
+
+static void frost_equal_root(frost_worker* w, void* ctx, size_t begin, size_t end)
+{
+    auto* task = (frost_pair_task*)ctx;
+    (void)begin;
+    (void)end;
+    task->result = frost_equal_value_task(w, task->lhs, task->rhs) != 0 && w->sched->cancel.load(std::memory_order_relaxed) == 0;
+}
+
+auto frost_is_equal_parallel(const frost_value* lhs, const frost_value* rhs, unsigned threads) -> int
+{
+    frost_pair_task task = { nullptr, lhs, rhs, nullptr, 0 };
+    assert(lhs != nullptr && rhs != nullptr);
+    threads = frost_task_threads(threads);
+    if (threads <= 1 || lhs == rhs || lhs->type != rhs->type || frost_task_small(lhs))
+        return frost_is_equal(lhs, rhs);
+    frost_scheduler_run(threads, frost_equal_root, &task);
+    return (int)task.result;
+}
+
+static auto frost_hash_value_task(frost_worker* w, const frost_value* val) -> uint64_t;
+
+static void frost_hash_range(frost_worker* w, void* ctx, size_t begin, size_t end)
+{
+    auto* task = (frost_pair_task*)ctx;
+    const frost_value* val = task->lhs;
+    for (size_t i = begin; i < end; i++) {
+        if (val->type == FROST_ARRAY)
+            task->hashes[i] = frost_hash_value_task(w, &val->u.a.e[i]);
+        else
+            task->hashes[i] = frost_hash_member(&val->u.o.m[i], frost_hash_value_task(w, &val->u.o.m[i].v));
+    }
+}
+
+/* 与 frost_hash 相同, 不写入任何缓存 */
+static auto frost_hash_value_task(frost_worker* w, const frost_value* val) -> uint64_t
+{
+    frost_pair_task task = { nullptr, val, nullptr, nullptr, 0 };
+    frost_value tmp;
+    size_t i, size = frost_children(val);
+    uint64_t h = 0;
+    if (val->type != FROST_ARRAY && val->type != FROST_OBJECT) {
+        memcpy(&tmp, val, sizeof(frost_value));
+        return frost_hash(&tmp);
+    }
+    task.hashes = (uint64_t*)malloc((size > 0 ? size : 1) * sizeof(uint64_t));
+    frost_task_for(w, val, frost_hash_range, &task);
+    if (val->type == FROST_ARRAY) {
+        h = FROST_HASH_ARRAY_SEED;
+        for (i = 0; i < size; i++)
+            h = frost_hash_element(h, task.hashes[i]);
+    } else
+        for (i = 0; i < size; i++)
+            h += task.hashes[i];
+    free(task.hashes);
+    return frost_hash_finish(val, h);
+}
+
+static void frost_hash_root(frost_worker* w, void* ctx, size_t begin, size_t end)
+{
+    auto* task = (frost_pair_task*)ctx;
+    (void)begin;
+    (void)end;
+    task->result = frost_hash_value_task(w, task->lhs);
+}
+
+auto frost_hash_parallel(const frost_value* val, unsigned threads) -> uint64_t
+{
+    frost_pair_task task = { nullptr, val, nullptr, nullptr, 0 };
+    assert(val != nullptr);
+    threads = frost_task_threads(threads);
+    if (threads <= 1 || frost_task_small(val))
+        return frost_hash(val);
+    frost_scheduler_run(threads, frost_hash_root, &task);
+    return task.result;
+}
+
 auto frost_get_boolean(const frost_value* val) -> int
 {
     assert(val != nullptr && (val->type == FROST_TRUE || val->type == FROST_FALSE));
@@ -653,6 +3539,7 @@ auto frost_get_boolean(const frost_value* val) -> int
 
 void frost_set_boolean(frost_value* val, int bol)
 {
+    FROST_ASSERT_WRITABLE(val);
     frost_free(val);
     val->type = (bol != 0) ? FROST_TRUE : FROST_FALSE;
 }
@@ -660,16 +3547,98 @@ void frost_set_boolean(frost_value* val, int bol)
 auto frost_get_number(const frost_value* val) -> double
 {
     assert(val != nullptr && val->type == FROST_NUMBER);
+    frost_number_load(val);
+    if ((val->flags & FROST_FLAG_INT64) != 0)
+        return (double)val->u.i64;
+    if ((val->flags & FROST_FLAG_UINT64) != 0)
+        return (double)val->u.u64;
     return val->u.n;
 }
 
 void frost_set_number(frost_value* val, double num)
 {
+    FROST_ASSERT_WRITABLE(val);
     frost_free(val);
     val->u.n = num;
     val->type = FROST_NUMBER;
 }
 
+auto frost_get_int64(const frost_value* val) -> int64_t
+{
+    assert(val != nullptr && val->type == FROST_NUMBER);
+    frost_number_load(val);
+    if ((val->flags & FROST_FLAG_INT64) != 0)
+        return val->u.i64;
+    if ((val->flags & FROST_FLAG_UINT64) != 0)
+        return INT64_MAX;
+    if (val->u.n != val->u.n)
+        return 0;
+    if (val->u.n >= 9223372036854775808.0)
+        return INT64_MAX;
+    if (val->u.n < -9223372036854775808.0)
+        return INT64_MIN;
+    return (int64_t)val->u.n;
+}
+
+void frost_set_int64(frost_value* val, int64_t num)
+{
+    FROST_ASSERT_WRITABLE(val);
+    frost_free(val);
+    val->u.i64 = num;
+    val->flags = FROST_FLAG_INT64;
+    val->type = FROST_NUMBER;
+}
+
+auto frost_get_uint64(const frost_value* val) -> uint64_t
+{
+    assert(val != nullptr && val->type == FROST_NUMBER);
+    frost_number_load(val);
+    if ((val->flags & FROST_FLAG_INT64) != 0)
+        return val->u.i64 < 0 ? 0 : (uint64_t)val->u.i64;
+    if ((val->flags & FROST_FLAG_UINT64) != 0)
+        return val->u.u64;
+    if (val->u.n != val->u.n)
+        return 0;
+    if (val->u.n >= 18446744073709551616.0)
+        return UINT64_MAX;
+    if (val->u.n <= 0.0)
+        return 0;
+    return (uint64_t)val->u.n;
+}
+
+void frost_set_uint64(frost_value* val, uint64_t num)
+{
+    if (num <= (uint64_t)INT64_MAX) {
+        frost_set_int64(val, (int64_t)num);
+        return;
+    }
+    FROST_ASSERT_WRITABLE(val);
+    frost_free(val);
+    val->u.u64 = num;
+    val->flags = FROST_FLAG_UINT64;
+    val->type = FROST_NUMBER;
+}
+
+auto frost_get_number_kind(const frost_value* val) -> unsigned
+{
+    assert(val != nullptr && val->type == FROST_NUMBER);
+    frost_number_load(val);
+    return val->flags & FROST_FLAG_INTEGER;
+}
+
+auto frost_get_number_text(const frost_value* val, size_t* len) -> const char*
+{
+    assert(val != nullptr && val->type == FROST_NUMBER && len != nullptr);
+    if ((val->flags & FROST_FLAG_RAW_NUMBER) == 0)
+        return nullptr;
+    if ((val->flags & FROST_FLAG_RAW_HEAP) != 0) {
+        *len = val->u.rh.len;
+        return val->u.rh.s;
+    }
+    *len = val->u.ri.len;
+    return val->u.ri.s;
+}
+
 auto frost_get_string(const frost_value* val) -> const char*
 {
     assert(val != nullptr && val->type == FROST_STRING);
@@ -685,9 +3654,11 @@ auto frost_get_string_length(const frost_value* val) -> size_t
 void frost_set_string(frost_value* val, const char* str, size_t len)
 {
     assert(val != nullptr && (str != nullptr || len == 0));
+    FROST_ASSERT_WRITABLE(val);
     frost_free(val);
     val->u.s.s = (char*)malloc(len + 1);
-    memcpy(val->u.s.s, str, len);
+    if (len > 0)
+        memcpy(val->u.s.s, str, len);
     val->u.s.s[len] = '\0';
     val->u.s.len = len;
     val->type = FROST_STRING;
@@ -695,6 +3666,7 @@ void frost_set_string(frost_value* val, const char* str, size_t len)
 
 void frost_set_array(frost_value* val, size_t capacity) {
     assert(val != nullptr);
+    FROST_ASSERT_WRITABLE(val);
     frost_free(val);
     val->type = FROST_ARRAY;
     val->u.a.size = 0;
@@ -716,7 +3688,9 @@ auto frost_get_array_capacity(const frost_value* val) -> size_t {
 
 void frost_reserve_array(frost_value* val, size_t capacity) {
     assert(val != nullptr && val->type == FROST_ARRAY);
+    FROST_ASSERT_WRITABLE(val);
     if (val->u.a.capacity < capacity) {
+        frost_unshare(val);
         val->u.a.capacity = capacity;
         val->u.a.e = (frost_value*)realloc(val->u.a.e, capacity * sizeof(frost_value));
     }
@@ -724,7 +3698,9 @@ void frost_reserve_array(frost_value* val, size_t capacity) {
 
 void frost_shrink_array(frost_value* val) {
     assert(val != nullptr && val->type == FROST_ARRAY);
+    FROST_ASSERT_WRITABLE(val);
     if (val->u.a.capacity > val->u.a.size) {
+        frost_unshare(val);
         val->u.a.capacity = val->u.a.size;
         val->u.a.e = (frost_value*)realloc(val->u.a.e, val->u.a.capacity * sizeof(frost_value));
     }
@@ -741,9 +3717,17 @@ auto frost_get_array_element(frost_value* val, size_t index) -> frost_value* {
     return &val->u.a.e[index];
 }
 
+auto frost_mutable_array_element(frost_value* val, size_t index) -> frost_value* {
+    assert(val != nullptr && val->type == FROST_ARRAY);
+    assert(index < val->u.a.size);
+    FROST_ACCESS(val);
+    return &val->u.a.e[index];
+}
+
 /*添加*/
 auto frost_pushback_array_element(frost_value* val) -> frost_value* {
     assert(val != nullptr && val->type == FROST_ARRAY);
+    FROST_MUTATE(val);
     if (val->u.a.size == val->u.a.capacity)
         frost_reserve_array(val, val->u.a.capacity == 0 ? 1 : val->u.a.capacity * 2);
     frost_init(&val->u.a.e[val->u.a.size]);
@@ -753,14 +3737,16 @@ auto frost_pushback_array_element(frost_value* val) -> frost_value* {
 /*弹出*/
 void frost_popback_array_element(frost_value* val) {
     assert(val != nullptr && val->type == FROST_ARRAY && val->u.a.size > 0);
+    FROST_MUTATE(val);
     frost_free(&val->u.a.e[--val->u.a.size]);
 }
 
 /*插入*/
 auto frost_insert_array_element(frost_value* val, size_t index) -> frost_value* {
     assert(val != nullptr && val->type == FROST_ARRAY && index <= val->u.a.size);
+    FROST_MUTATE(val);
     if(val->u.a.size == val->u.a.capacity) frost_reserve_array(val, val->u.a.capacity == 0 ? 1 : (val->u.a.size << 1)); //扩容为原来一倍
-    memcpy(&val->u.a.e[index + 1], &val->u.a.e[index], (val->u.a.size - index) * sizeof(frost_value));
+    memmove(&val->u.a.e[index + 1], &val->u.a.e[index], (val->u.a.size - index) * sizeof(frost_value));
     frost_init(&val->u.a.e[index]);
     val->u.a.size++;
     return &val->u.a.e[index];
@@ -770,10 +3756,11 @@ auto frost_insert_array_element(frost_value* val, size_t index) -> frost_value*
 void frost_erase_array_element(frost_value* val, size_t index, size_t count) {
     assert(val != nullptr && val->type == FROST_ARRAY && index + count <= val->u.a.size);
     size_t i;
+    FROST_MUTATE(val);
     for(i = index; i < index + count; i++){
         frost_free(&val->u.a.e[i]);
     }
-    memcpy(val->u.a.e + index, val->u.a.e + index + count, (val->u.a.size - index - count) * sizeof(frost_value));
+    memmove(val->u.a.e + index, val->u.a.e + index + count, (val->u.a.size - index - count) * sizeof(frost_value));
     for(i = val->u.a.size - count; i < val->u.a.size; i++)
         frost_init(&val->u.a.e[i]);
     val->u.a.size -= count;
@@ -782,6 +3769,7 @@ void frost_erase_array_element(frost_value* val, size_t index, size_t count) {
 
 void frost_set_object(frost_value* val, size_t capacity) {
     assert(val != nullptr);
+    FROST_ASSERT_WRITABLE(val);
     frost_free(val);
     val->type = FROST_OBJECT;
     val->u.o.size = 0;
@@ -802,7 +3790,9 @@ auto frost_get_object_capacity(const frost_value* val) -> size_t {
 
 void frost_reserve_object(frost_value* val, size_t capacity) {
     assert(val != nullptr && val->type == FROST_OBJECT);
+    FROST_ASSERT_WRITABLE(val);
     if (val->u.o.capacity < capacity) {
+        frost_unshare(val);
         val->u.o.capacity = capacity;
         val->u.o.m = (frost_member*)realloc(val->u.o.m, capacity * sizeof(frost_member));
     }
@@ -810,7 +3800,9 @@ void frost_reserve_object(frost_value* val, size_t capacity) {
 
 void frost_shrink_object(frost_value* val) {
     assert(val != nullptr && val->type == FROST_OBJECT);
+    FROST_ASSERT_WRITABLE(val);
     if (val->u.o.capacity > val->u.o.size) {
+        frost_unshare(val);
         val->u.o.capacity = val->u.o.size;
         val->u.o.m = (frost_member*)realloc(val->u.o.m, val->u.o.capacity * sizeof(frost_member));
     }
@@ -819,6 +3811,7 @@ void frost_shrink_object(frost_value* val) {
 void frost_clear_object(frost_value* val) {
     assert(val != nullptr && val->type == FROST_OBJECT);
     size_t i = 0;
+    FROST_MUTATE(val);
     for(i = 0; i < val->u.o.size; i++){
         free(val->u.o.m[i].k);
         val->u.o.m[i].k = nullptr;
@@ -849,9 +3842,48 @@ auto frost_get_object_value(const frost_value* val, size_t index) -> frost_value
     return &val->u.o.m[index].v;
 }
 
+auto frost_mutable_object_value(frost_value* val, size_t index) -> frost_value*
+{
+    assert(val != nullptr && val->type == FROST_OBJECT);
+    assert(index < val->u.o.size);
+    FROST_ACCESS(val);
+    return &val->u.o.m[index].v;
+}
+
+/* 按字节序比较键, 较短的前缀在前; 键通常很短, 逐字节比较比调用 memcmp 快 */
+static inline auto frost_key_compare(const char* lkey, size_t llen, const char* rkey, size_t rlen) -> int
+{
+    size_t i, n = llen < rlen ? llen : rlen;
+    for (i = 0; i < n; i++)
+        if (lkey[i] != rkey[i])
+            return (unsigned char)lkey[i] < (unsigned char)rkey[i] ? -1 : 1;
+    return (llen > rlen) - (llen < rlen);
+}
+
+/* 有序成员中第一个不小于 key 的下标; 每步只按比较结果选择下一段的起点, 没有难以预测的分支 */
+static auto frost_sorted_lower_bound(const frost_value* val, const char* key, size_t klen) -> size_t
+{
+    const frost_member* base = val->u.o.m;
+    size_t n = val->u.o.size;
+    if (n == 0)
+        return 0;
+    while (n > 1) {
+        size_t half = n >> 1;
+        base = frost_key_compare(base[half].k, base[half].klen, key, klen) < 0 ? base + half : base;
+        n -= half;
+    }
+    return (size_t)(base - val->u.o.m) + (frost_key_compare(base->k, base->klen, key, klen) < 0);
+}
+
 auto frost_find_object_index(const frost_value* val, const char* key, size_t klen) -> size_t {
     size_t i = 0;
     assert(val != nullptr && val->type == FROST_OBJECT && key != nullptr);
+    if ((val->flags & FROST_FLAG_SORTED) != 0 && val->u.o.size >= FROST_SORTED_SEARCH_MIN) {
+        i = frost_sorted_lower_bound(val, key, klen);
+        if (i < val->u.o.size && val->u.o.m[i].klen == klen && memcmp(val->u.o.m[i].k, key, klen) == 0)
+            return i;
+        return FROST_KEY_NOT_EXIST;
+    }
     for (i = 0; i < val->u.o.size; i++)
         if (val->u.o.m[i].klen == klen && memcmp(val->u.o.m[i].k, key, klen) == 0)
             return i;
@@ -860,19 +3892,31 @@ auto frost_find_object_index(const frost_value* val, const char* key, size_t kle
 
 auto frost_find_object_value(frost_value* val, const char* key, size_t klen) -> frost_value* {
     size_t index = frost_find_object_index(val, key, klen);
-    return index != FROST_KEY_NOT_EXIST ? &val->u.o.m[index].v : nullptr;
+    if (index == FROST_KEY_NOT_EXIST)
+        return nullptr;
+    return &val->u.o.m[index].v;
 }
 
 auto frost_set_object_value(frost_value* val, const char* key, size_t klen) -> frost_value* {
     assert(val != nullptr && val->type == FROST_OBJECT && key != nullptr);
     size_t i, index;
+    FROST_ASSERT_WRITABLE(val);
+    /* 已有的键只需取出值的可写指针, 不改变成员数组 */
     index = frost_find_object_index(val, key, klen);
-    if(index != FROST_KEY_NOT_EXIST)
+    if(index != FROST_KEY_NOT_EXIST) {
+        FROST_ACCESS(val);
         return &val->u.o.m[index].v;
+    }
+    FROST_MUTATE(val);
     if(val->u.o.size == val->u.o.capacity){
         frost_reserve_object(val, val->u.o.capacity == 0 ? 1 : (val->u.o.capacity << 1));
     }
     i = val->u.o.size;
+    /* 有序对象把新键插入到有序位置 */
+    if ((val->flags & FROST_FLAG_SORTED) != 0) {
+        i = frost_sorted_lower_bound(val, key, klen);
+        memmove(val->u.o.m + i + 1, val->u.o.m + i, (val->u.o.size - i) * sizeof(frost_member));
+    }
     val->u.o.m[i].k = (char *)malloc((klen + 1));
     memcpy(val->u.o.m[i].k, key, klen);
     val->u.o.m[i].k[klen] = '\0';
@@ -884,10 +3928,55 @@ auto frost_set_object_value(frost_value* val, const char* key, size_t klen) -> f
 
 void frost_remove_object_value(frost_value* val, size_t index) {
     assert(val != nullptr && val->type == FROST_OBJECT && index < val->u.o.size);
+    FROST_MUTATE(val);
     free(val->u.o.m[index].k);
     frost_free(&val->u.o.m[index].v);
-    memcpy(val->u.o.m + index, val->u.o.m + index + 1, (val->u.o.size - index - 1) * sizeof(frost_member));
+    memmove(val->u.o.m + index, val->u.o.m + index + 1, (val->u.o.size - index - 1) * sizeof(frost_member));
     val->u.o.m[--val->u.o.size].k = nullptr;
     val->u.o.m[val->u.o.size].klen = 0;
     frost_init(&val->u.o.m[val->u.o.size].v);
+}
+
+/* 子树中是否还有未排序的对象 */
+static auto frost_sort_pending(const frost_value* val) -> int
+{
+    size_t i;
+    if (val->type == FROST_ARRAY) {
+        for (i = 0; i < val->u.a.size; i++)
+            if (frost_sort_pending(&val->u.a.e[i]) != 0)
+                return 1;
+    } else if (val->type == FROST_OBJECT) {
+        if ((val->flags & FROST_FLAG_SORTED) == 0)
+            return 1;
+        for (i = 0; i < val->u.o.size; i++)
+            if (frost_sort_pending(&val->u.o.m[i].v) != 0)
+                return 1;
+    }
+    return 0;
+}
+
+/*
+ * 稳定排序保证重复的键中原先靠前的仍排在前面, 二分查找找到的与顺序查找相同.
+ * 已经有序的子树不会被写时复制.
+ */
+void frost_sort_object(frost_value* val)
+{
+    size_t i;
+    assert(val != nullptr);
+    if (frost_sort_pending(val) == 0)
+        return;
+    FROST_MUTATE(val);
+    if (val->type == FROST_ARRAY) {
+        for (i = 0; i < val->u.a.size; i++)
+            frost_sort_object(&val->u.a.e[i]);
+    } else {
+        auto less = [](const frost_member& l, const frost_member& r) {
+            return frost_key_compare(l.k, l.klen, r.k, r.klen) < 0;
+        };
+        for (i = 0; i < val->u.o.size; i++)
+            frost_sort_object(&val->u.o.m[i].v);
+        if (!std::is_sorted(val->u.o.m, val->u.o.m + val->u.o.size, less))
+            std::stable_sort(val->u.o.m, val->u.o.m + val->u.o.size, less);
+        val->flags |= FROST_FLAG_SORTED;
+    }
 }
\ No newline at end of file
@@ -2,8 +2,9 @@
 #define FROSTJSON_H__
 
 #include <cstddef>
+#include <cstdint>
 
-using frost_type = enum{ FROST_NULL, FROST_TRUE, FROST_FALSE, FROST_NUMBER, FROST_STRING, FROST_ARRAY, FROST_OBJECT };
+enum frost_type { FROST_NULL, FROST_TRUE, FROST_FALSE, FROST_NUMBER, FROST_STRING, FROST_ARRAY, FROST_OBJECT };
 
 #define FROST_KEY_NOT_EXIST ((size_t)-1)
 
@@ -16,10 +17,37 @@ struct frost_value{
         struct { frost_value* e; size_t size, capacity; }a;   /* array:  elements, element count */
         struct { char* s; size_t len; }s;           /* string: null-terminated string, string length */
         double n;                                   /* number */
+        int64_t i64;                                /* number: FROST_FLAG_INT64 */
+        uint64_t u64;                               /* number: FROST_FLAG_UINT64 */
+        struct { uint64_t value; char* s; size_t len; }rh;              /* number (FROST_FLAG_RAW_HEAP): 源文本在堆上 */
+        struct { uint64_t value; char s[15]; unsigned char len; }ri;    /* number (FROST_FLAG_RAW_NUMBER): 源文本内联 */
     }u; 
     frost_type type;
+    unsigned flags;                                 /* FROST_FLAG_* */
 };
 
+/* 缓冲区位于引用计数的共享块中, 内容不可变 (其中的子值也都是共享的); 修改类 API 以及返回
+ * 子值可写指针的 frost_mutable_array_element / frost_mutable_object_value 先写时复制,
+ * frost_copy 只增加引用计数. 只读的查找不复制, 经它们取得的共享子值不能直接写入 */
+#define FROST_FLAG_SHARED 0x2u
+/* 整数精确保存在 u.i64 (可放入 int64) 或 u.u64 (大于 INT64_MAX), 否则数字为 u.n 中的 double */
+#define FROST_FLAG_INT64 0x4u
+#define FROST_FLAG_UINT64 0x8u
+#define FROST_FLAG_INTEGER (FROST_FLAG_INT64 | FROST_FLAG_UINT64)
+/* 延迟数字 (FROST_PARSE_RAW_NUMBERS): 保留源文本, 输出时原样复制; 首次读取数值时才转换,
+ * 结果缓存在与 u.n / u.i64 / u.u64 重叠的 value 中并设置 FROST_FLAG_NUMBER_CACHED */
+#define FROST_FLAG_RAW_NUMBER 0x10u
+#define FROST_FLAG_RAW_HEAP 0x20u       /* 文本超过 15 字节, 存放在堆上 (与 RAW_NUMBER 同时设置) */
+#define FROST_FLAG_NUMBER_CACHED 0x40u
+/* frost_freeze 标记的只读值: 缓存均已计算, 读取不再写入任何字段, 可被多个线程同时读取;
+ * 修改类 API 在调试构建中断言失败. frost_copy 得到的副本不带此标记 */
+#define FROST_FLAG_FROZEN 0x80u
+/* 对象的成员按键的字节序升序排列 (frost_sort_object), 查找用二分; 新增的键插入到有序位置 */
+#define FROST_FLAG_SORTED 0x100u
+/* 缓冲区 (对象连同键) 位于 frost_compact 的紧凑块中, 与是否共享无关: 独占的紧凑节点照常原地修改元素,
+ * 只有改变大小或释放键的操作才把这一层复制回单独的分配 */
+#define FROST_FLAG_ARENA 0x200u
+
 struct frost_member{
     char* k;
     size_t klen;
@@ -41,30 +69,193 @@ enum{
     FROST_PARSE_MISS_KEY,
     FROST_PARSE_MISS_COLON,
     FROST_PARSE_MISS_COMMA_OR_CURLY_BRACKET,    
+    FROST_PARSE_INVALID_UTF8,
+    FROST_PARSE_TYPE_MISMATCH,      /* 绑定 (frostjson.hpp): JSON 类型与字段类型不符; 流式读取: 顶层不是数组 */
+    FROST_PARSE_MISS_FIELD,         /* 绑定 (frostjson.hpp): 缺少非 optional 字段 */
+    FROST_PARSE_MEMORY_EXCEEDED,    /* 超出 frost_parse_options 的资源上限, 见下 */
+    FROST_PARSE_DEPTH_EXCEEDED,
+    FROST_PARSE_STRING_TOO_LONG,
+    FROST_PARSE_TOO_MANY_ELEMENTS,
+    FROST_PARSE_NUMBER_TOO_LONG,
+    FROST_PARSE_READ_FAILED,        /* 流式读取: 读取回调返回出错 */
+};
+
+/* 解析选项 */
+#define FROST_PARSE_VALIDATE_UTF8 0x1u  /* 校验字符串中的原始字节是否为合法 UTF-8 */
+#define FROST_PARSE_DEDUP         0x2u  /* 解析完成后调用 frost_dedup 合并相同的子树 */
+#define FROST_PARSE_RAW_NUMBERS   0x4u  /* 数字保留源文本, 延迟到首次读取时才转换 (读取器忽略此选项) */
+
+/*
+ * 资源上限, 0 表示不限制. 在解析过程中逐步检查, 超出时立即失败并释放已构造的部分, 不会先分配再检查.
+ * max_bytes 计入解析栈与为结果分配的堆内存 (不计 frost_value 本身与 FROST_PARSE_DEDUP 的开销);
+ * 读取器对它取出的字符串、数字与嵌套层数同样生效
+ */
+struct frost_parse_options{
+    unsigned flags;         /* FROST_PARSE_* 选项位 */
+    size_t max_bytes;       /* 分配的堆内存总量           FROST_PARSE_MEMORY_EXCEEDED */
+    size_t max_depth;       /* 容器的嵌套层数             FROST_PARSE_DEPTH_EXCEEDED */
+    size_t max_string;      /* 字符串与键解码后的字节数   FROST_PARSE_STRING_TOO_LONG */
+    size_t max_elements;    /* 单个容器的元素/成员数      FROST_PARSE_TOO_MANY_ELEMENTS */
+    size_t max_digits;      /* 数字文本的长度             FROST_PARSE_NUMBER_TOO_LONG */
 };
 
 
-#define frost_init(v) do { (v)->type = FROST_NULL; } while(0)
+#define frost_init(v) do { (v)->type = FROST_NULL; (v)->flags = 0; } while(0)
 
 auto frost_parse(frost_value* val, const char* json) -> int; //解析json
+auto frost_parse_with_options(frost_value* val, const char* json, const frost_parse_options* opt) -> int;
 auto frost_stringify(const frost_value* val, size_t* length) -> char*;
+/* 与 frost_stringify 输出相同, 大容器分块由 threads 个线程 (0 为硬件线程数) 并行输出 */
+auto frost_stringify_parallel(const frost_value* val, size_t* length, unsigned threads) -> char*;
+
+/*
+ * 只校验不构造: 检查完整的语法 (含 UTF-8 与数字溢出, 相当于以 FROST_PARSE_VALIDATE_UTF8 解析), 不解码字符串、
+ * 不转换数字, 不分配内存. 嵌套超过 FROST_SKIP_MAX_DEPTH (默认 10000) 层返回 FROST_PARSE_DEPTH_EXCEEDED.
+ * 返回 FROST_PARSE_*; 出错时 *err_offset 为出错处距 json 开头的字节数. json[len] 必须为 '\0'
+ */
+auto frost_validate(const char* json, size_t len, size_t* err_offset) -> int;
+/* 跳过 json 开头的一个值 (及其前面的空白), *end 指向值之后或出错处; opt 只使用 FROST_PARSE_VALIDATE_UTF8 与 max_depth */
+auto frost_skip(const char* json, const char** end, const frost_parse_options* opt) -> int;
+
+/*
+ * 解析时投影: 只构造一组 JSON Pointer 选中的部分, 其余部分只做语法检查后跳过.
+ * 选中值的祖先容器总会保留; 数组中选中下标之前未选中的元素以 null 占位, 使下标不变.
+ * 路径要向下进入的位置是标量时, 该成员/元素被丢弃 (根为标量时结果为 null).
+ * json 的长度为 len, 且 json[len] 必须为 '\0'. 路径非法时 frost_projection_create 返回 nullptr
+ */
+using frost_projection = struct frost_projection;
+
+auto frost_projection_create(const char* const* paths, size_t count) -> frost_projection*;
+void frost_projection_free(frost_projection* proj);
+auto frost_parse_projected(frost_value* val, const char* json, size_t len, const frost_projection* proj) -> int;
+/* 与 frost_parse_with_options 相同的选项; 被跳过的部分同样受 max_depth 限制 */
+auto frost_parse_projected_with_options(frost_value* val, const char* json, size_t len, const frost_projection* proj,
+    const frost_parse_options* opt) -> int;
+
+/* 拉取式读取器: 逐个返回记号而不构造 frost_value, 出错后返回 FROST_TOKEN_ERROR */
+enum frost_token {
+    FROST_TOKEN_NULL, FROST_TOKEN_TRUE, FROST_TOKEN_FALSE, FROST_TOKEN_NUMBER, FROST_TOKEN_STRING,
+    FROST_TOKEN_KEY, FROST_TOKEN_BEGIN_ARRAY, FROST_TOKEN_END_ARRAY, FROST_TOKEN_BEGIN_OBJECT,
+    FROST_TOKEN_END_OBJECT, FROST_TOKEN_END, FROST_TOKEN_ERROR
+};
+using frost_reader = struct frost_reader;
+
+auto frost_reader_open(const char* json, const frost_parse_options* opt) -> frost_reader*;
+void frost_reader_close(frost_reader* rdr);
+auto frost_reader_next(frost_reader* rdr) -> frost_token;
+auto frost_reader_skip(frost_reader* rdr, frost_token token) -> int;  /* 跳过以 token 开头的整个值, 返回 FROST_PARSE_* */
+auto frost_reader_get_number(const frost_reader* rdr) -> double;
+auto frost_reader_get_number_value(const frost_reader* rdr) -> const frost_value*; /* NUMBER 记号的值, 可用 frost_get_int64 等读取 */
+auto frost_reader_get_string(const frost_reader* rdr) -> const char*; /* STRING / KEY 的内容, 不以 '\0' 结尾, 下次 next 前有效 */
+auto frost_reader_get_string_length(const frost_reader* rdr) -> size_t;
+auto frost_reader_get_error(const frost_reader* rdr) -> int;
+
+/*
+ * 顶层数组的流式读取: 每次 next 解析并交出一个元素 (out 原有的内容不会释放), 内存只与最大的元素成正比.
+ * 数据来自 read 回调, 或者长度为 len 且 json[len] 为 '\0' 的缓冲区, 或者文件描述符 (读到文件结束).
+ * next 在数组结束或出错时返回 0, 由 frost_array_stream_get_error 区分; 资源上限对每个元素分别生效
+ */
+using frost_array_stream = struct frost_array_stream;
+using frost_read_callback = ptrdiff_t (*)(void* user, char* data, size_t size);   /* 返回读到的字节数, 0 表示结束, 负数表示出错 */
+
+auto frost_array_stream_open(frost_read_callback read, void* user, const frost_parse_options* opt) -> frost_array_stream*;
+auto frost_array_stream_open_buffer(const char* json, size_t len, const frost_parse_options* opt) -> frost_array_stream*;
+auto frost_array_stream_open_fd(int fd, const frost_parse_options* opt) -> frost_array_stream*;
+void frost_array_stream_close(frost_array_stream* stm);
+auto frost_array_stream_next(frost_array_stream* stm, frost_value* out) -> int;
+auto frost_array_stream_get_error(const frost_array_stream* stm) -> int;
+
+/*
+ * 流式写出: 不构造 frost_value, 按事件直接输出 JSON, 转义与数字格式与 frost_stringify 相同, 每个节点不做任何分配.
+ * write 为 nullptr 时输出累积在内部缓冲区, 由 frost_writer_get_output 取得, frost_writer_reset 后复用同一缓冲区;
+ * 否则缓冲的内容达到 FROST_WRITER_FLUSH_SIZE 时交给 write. 对象中每个值之前先写 key; 根层的多个值以换行分隔.
+ * 事件顺序由调试构建中的断言检查
+ */
+using frost_writer = struct frost_writer;
+using frost_write_callback = int (*)(void* user, const char* data, size_t len);    /* 返回 0 表示写出失败 */
+
+auto frost_writer_open(frost_write_callback write, void* user) -> frost_writer*;
+void frost_writer_close(frost_writer* wtr);     /* 先交出剩余的输出 */
+void frost_writer_begin_object(frost_writer* wtr);
+void frost_writer_begin_array(frost_writer* wtr);
+void frost_writer_end(frost_writer* wtr);       /* 结束最内层的对象或数组 */
+void frost_writer_key(frost_writer* wtr, const char* key, size_t len);
+void frost_writer_string(frost_writer* wtr, const char* str, size_t len);
+void frost_writer_number(frost_writer* wtr, double n);
+void frost_writer_int64(frost_writer* wtr, int64_t n);
+void frost_writer_uint64(frost_writer* wtr, uint64_t n);
+void frost_writer_bool(frost_writer* wtr, int b);
+void frost_writer_null(frost_writer* wtr);
+void frost_writer_value(frost_writer* wtr, const frost_value* val);    /* 写出一整棵已有的树 */
+auto frost_writer_flush(frost_writer* wtr) -> int;     /* 把缓冲的输出交给 write; 返回 0 表示 write 曾经失败 */
+auto frost_writer_get_output(frost_writer* wtr, size_t* length) -> const char*;   /* 以 '\0' 结尾, 下次写入前有效 */
+void frost_writer_reset(frost_writer* wtr);     /* 丢弃输出与嵌套状态, 保留缓冲区 */
+
+/*
+ * 二进制编码 (MessagePack / CBOR), 返回的缓冲区由调用者 free; 解码返回 FROST_PARSE_*
+ * MessagePack 无法表示超过 32 位的长度, 此时编码返回 nullptr
+ */
+auto frost_encode_msgpack(const frost_value* val, size_t* length) -> char*;
+auto frost_decode_msgpack(frost_value* val, const char* data, size_t length) -> int;
+auto frost_encode_cbor(const frost_value* val, size_t* length) -> char*;
+auto frost_decode_cbor(frost_value* val, const char* data, size_t length) -> int;
 
 void frost_copy(frost_value* dst, const frost_value* src);
 void frost_move(frost_value* dst, frost_value* src);
 void frost_swap(frost_value* lhs, frost_value* rhs);
 
+/* 共享与去重 */
+void frost_share(frost_value* val);             /* 把 val 及其子树转为共享节点 */
+void frost_unshare(frost_value* val);           /* 写时复制: 若 val 是共享节点或位于紧凑块中, 复制出单独分配的一层 */
+auto frost_dedup(frost_value* val) -> size_t;   /* 合并相同的子树, 返回节省的堆内存字节数 */
+auto frost_shared_block_size(size_t size) -> size_t;   /* 存放 size 字节内容的共享块连同引用计数头的大小 */
+/* 把独占部分按深度优先顺序搬进一块连续内存并收缩容量 (结果带 FROST_FLAG_ARENA), 返回节省的堆内存字节数 */
+auto frost_compact(frost_value* val) -> size_t;
+
+/* 冻结与发布: frost_snapshot_ptr 以 RCU 方式原子地替换冻结的文档, 读者无需加锁 */
+void frost_freeze(frost_value* val);            /* 计算全部延迟缓存并把整棵树标记为只读 */
+
+using frost_snapshot_ptr = struct frost_snapshot_ptr;
+
+auto frost_snapshot_ptr_create(frost_value* val) -> frost_snapshot_ptr*;    /* 移入并冻结初始版本 */
+void frost_snapshot_ptr_destroy(frost_snapshot_ptr* ptr);                  /* 此时不能再有读者 */
+auto frost_snapshot_ptr_acquire(frost_snapshot_ptr* ptr, unsigned* ticket) -> frost_value*; /* 当前版本, 只读 */
+void frost_snapshot_ptr_release(frost_snapshot_ptr* ptr, unsigned ticket);
+void frost_snapshot_ptr_publish(frost_snapshot_ptr* ptr, frost_value* val); /* 移入新版本, 等读者离开旧版本后释放它 */
+
 void frost_free(frost_value* val);  // 释放
 
+/* 延迟释放: 在 O(1) 内移出 val 的内容 (val 变为 null), 交给后台回收线程释放 */
+void frost_free_deferred(frost_value* val);
+void frost_reclaim_threads(unsigned threads);   /* 回收线程数, 默认 1, 只增不减; 多线程时大容器分段并行释放 */
+void frost_reclaim_drain();                     /* 等待已提交的值全部释放 */
+auto frost_reclaim_pending_bytes() -> size_t;   /* 已提交但尚未释放的堆内存字节数 (下限) */
+
 #define frost_set_null(v) frost_free(v)
 
 auto frost_get_type(const frost_value* val) -> frost_type;
 auto frost_is_equal(const frost_value* lhs, const frost_value* rhs) -> int;
+auto frost_hash(const frost_value* val) -> uint64_t;  /* 结构哈希, 与 frost_is_equal 一致; 每次重新计算, 不缓存 */
+
+/*
+ * 并行版本: 结果与 frost_copy / frost_is_equal / frost_hash 相同, 由 threads 个线程 (0 为硬件线程数)
+ * 通过工作窃取分担子树; 比较发现不相等后其余任务尽快结束. 调用期间不能有其他线程修改参与的值
+ */
+void frost_copy_parallel(frost_value* dst, const frost_value* src, unsigned threads);
+auto frost_is_equal_parallel(const frost_value* lhs, const frost_value* rhs, unsigned threads) -> int;
+auto frost_hash_parallel(const frost_value* val, unsigned threads) -> uint64_t;
 
 auto frost_get_boolean(const frost_value* val) -> int; 
 void frost_set_boolean(frost_value* val, int bol);
 
 auto frost_get_number(const frost_value* val) -> double;  
 void frost_set_number(frost_value* val, double n);
+auto frost_get_int64(const frost_value* val) -> int64_t;    /* double 截断取整; 超出范围时饱和, NaN 得 0 */
+void frost_set_int64(frost_value* val, int64_t num);
+auto frost_get_uint64(const frost_value* val) -> uint64_t;  /* 同上, 负数得 0 */
+void frost_set_uint64(frost_value* val, uint64_t num);
+auto frost_get_number_kind(const frost_value* val) -> unsigned;    /* FROST_FLAG_INT64 / FROST_FLAG_UINT64, double 为 0 */
+auto frost_get_number_text(const frost_value* val, size_t* len) -> const char*; /* 延迟数字的源文本 (不以 '\0' 结尾), 否则 nullptr */
 
 auto frost_get_string(const frost_value* val) -> const char*;
 auto frost_get_string_length(const frost_value* val) -> size_t;
@@ -77,6 +268,7 @@ void frost_reserve_array(frost_value* val, size_t capacity);
 void frost_shrink_array(frost_value* val);
 void frost_clear_array(frost_value* val);
 auto frost_get_array_element(frost_value* val, size_t index) -> frost_value*;
+auto frost_mutable_array_element(frost_value* val, size_t index) -> frost_value*;   /* 共享时先写时复制 */
 auto frost_pushback_array_element(frost_value* val) -> frost_value*;
 void frost_popback_array_element(frost_value* val);
 auto frost_insert_array_element(frost_value* val, size_t index) -> frost_value*;
@@ -91,9 +283,62 @@ void frost_clear_object(frost_value* val);
 auto frost_get_object_key(const frost_value* val, size_t index) -> const char*;
 auto frost_get_object_key_length(const frost_value* val, size_t index) -> size_t;
 auto frost_get_object_value(const frost_value* val, size_t index) -> frost_value*;
+auto frost_mutable_object_value(frost_value* val, size_t index) -> frost_value*;    /* 共享时先写时复制 */
 auto frost_find_object_index(const frost_value* val, const char* key, size_t klen) -> size_t;
 auto frost_find_object_value(frost_value* val, const char* key, size_t klen) -> frost_value*;
 auto frost_set_object_value(frost_value* val, const char* key, size_t klen) -> frost_value*;
 void frost_remove_object_value(frost_value* val, size_t index);
+void frost_sort_object(frost_value* val);   /* 把 val 及其子树中的对象按键排序, 重复的键保持原有先后 */
+
+/* JSON Pointer (RFC 6901), 找不到或指针非法时返回 nullptr */
+auto frost_find_pointer_value(frost_value* val, const char* pointer, size_t len) -> frost_value*;
+
+/*
+ * JSONPath 查询 (RFC 9535 的子集: 子成员、通配、下标与切片、递归下降、单个比较的过滤).
+ * 编译一次后可在任意多个文档上运行; 运行时只读遍历, 按文档顺序对每个匹配调用 cb,
+ * cb 返回非 0 时停止. 返回匹配 (调用 cb) 的次数; cb 可为 nullptr, 此时只计数. 语法错误时编译返回 nullptr
+ */
+using frost_query = struct frost_query;
+using frost_query_callback = int (*)(const frost_value* val, void* user);
+
+auto frost_query_compile(const char* path) -> frost_query*;
+void frost_query_free(frost_query* q);
+auto frost_query_run(const frost_query* q, const frost_value* doc, frost_query_callback cb, void* user) -> size_t;
+
+/* JSON Patch (RFC 6902) 与 Merge Patch (RFC 7396), 原地修改 doc; 任一操作失败则整体回滚 */
+enum {
+    FROST_PATCH_OK = 0,
+    FROST_PATCH_INVALID,        /* 补丁格式错误: 不是数组、缺少成员、未知 op 或非法的 JSON Pointer */
+    FROST_PATCH_PATH_NOT_FOUND, /* 路径不存在或数组下标越界 */
+    FROST_PATCH_TEST_FAILED     /* test 操作比较不相等 */
+};
+
+auto frost_apply_patch(frost_value* doc, const frost_value* patch) -> int;
+auto frost_apply_merge_patch(frost_value* doc, const frost_value* patch) -> int; /* 总是返回 FROST_PATCH_OK */
+void frost_diff(frost_value* patch, const frost_value* from, const frost_value* to); /* 生成把 from 变为 to 的 RFC 6902 补丁 */
+
+/* 只读快照: frost_snapshot_write 写出不含指针的映像, frost_snapshot_open 以 mmap 打开, 无需解析 */
+using frost_snapshot = struct frost_snapshot;
+using frost_snapshot_value = struct frost_snapshot_value;
+
+auto frost_snapshot_write(const frost_value* val, const char* path) -> int; /* 成功返回 0 */
+auto frost_snapshot_open(const char* path) -> frost_snapshot*;            /* 失败返回 nullptr */
+void frost_snapshot_close(frost_snapshot* snap);
+auto frost_snapshot_root(const frost_snapshot* snap) -> const frost_snapshot_value*;
+void frost_snapshot_copy(frost_value* dst, const frost_snapshot* snap, const frost_snapshot_value* src);
+
+auto frost_snapshot_get_type(const frost_snapshot_value* val) -> frost_type;
+auto frost_snapshot_get_boolean(const frost_snapshot_value* val) -> int;
+auto frost_snapshot_get_number(const frost_snapshot_value* val) -> double;
+auto frost_snapshot_get_string(const frost_snapshot* snap, const frost_snapshot_value* val) -> const char*;
+auto frost_snapshot_get_string_length(const frost_snapshot_value* val) -> size_t;
+auto frost_snapshot_get_array_size(const frost_snapshot_value* val) -> size_t;
+auto frost_snapshot_get_array_element(const frost_snapshot* snap, const frost_snapshot_value* val, size_t index) -> const frost_snapshot_value*;
+auto frost_snapshot_get_object_size(const frost_snapshot_value* val) -> size_t;
+auto frost_snapshot_get_object_key(const frost_snapshot* snap, const frost_snapshot_value* val, size_t index) -> const char*;
+auto frost_snapshot_get_object_key_length(const frost_snapshot* snap, const frost_snapshot_value* val, size_t index) -> size_t;
+auto frost_snapshot_get_object_value(const frost_snapshot* snap, const frost_snapshot_value* val, size_t index) -> const frost_snapshot_value*;
+auto frost_snapshot_find_object_index(const frost_snapshot* snap, const frost_snapshot_value* val, const char* key, size_t klen) -> size_t;
+auto frost_snapshot_find_object_value(const frost_snapshot* snap, const frost_snapshot_value* val, const char* key, size_t klen) -> const frost_snapshot_value*;
 
 #endif /* FROSTJSON_H__ */
\ No newline at end of file
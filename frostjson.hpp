@@ -0,0 +1,933 @@
+#ifndef FROSTJSON_HPP__
+#define FROSTJSON_HPP__
+
+/*
+ * 类型绑定: 在 frost_reader 上直接把 JSON 读入 C++ 结构体, 不构造 frost_value;
+ * frost::stringify 则反向把结构体写成 JSON.
+ *
+ *     struct point { double x, y; std::optional<std::string> tag; };
+ *     FROST_BIND(point, FROST_FIELD(point, x), FROST_FIELD(point, y), FROST_FIELD(point, tag));
+ *
+ *     point p;
+ *     int ret = frost::bind(&p, "{\"x\":1,\"y\":2}");
+ *     std::string json = frost::stringify(p);
+ *
+ * 支持 bool、算术类型、std::string、std::vector<T>、std::optional<T> 以及用 FROST_BIND
+ * 描述过的结构体 (可嵌套). 未描述的键被跳过; 非 optional 字段缺失返回 FROST_PARSE_MISS_FIELD,
+ * 类型不符 (含整数字段读到小数或越界) 返回 FROST_PARSE_TYPE_MISMATCH.
+ */
+
+#include "frostjson.h"
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace frost {
+
+template <class T, class M>
+struct field_info {
+    const char* name;
+    size_t len;
+    M T::*member;
+};
+
+template <class T, class M, size_t N>
+constexpr auto field(const char (&name)[N], M T::*member) -> field_info<T, M>
+{
+    return field_info<T, M> { name, N - 1, member };
+}
+
+namespace detail {
+
+    constexpr auto key_hash(const char* key, size_t len) -> uint64_t
+    {
+        /* FNV-1a, 再以 murmur3 的 fmix64 打散, 高低 32 位都可直接使用 */
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < len; i++) {
+            h ^= (unsigned char)key[i];
+            h *= 0x100000001b3ull;
+        }
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    constexpr auto ceil_pow2(size_t n) -> size_t
+    {
+        size_t p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+    constexpr auto log2_pow2(size_t n) -> unsigned
+    {
+        unsigned b = 0;
+        while (((size_t)1 << b) < n)
+            b++;
+        return b;
+    }
+
+    /* 非 constexpr: 在常量求值中被调用即成为编译错误 */
+    [[noreturn]] inline void key_table_duplicate_key() { abort(); }
+    [[noreturn]] inline void key_table_no_perfect_hash() { abort(); }
+
+} // namespace detail
+
+/*
+ * 编译期完美哈希: 对一组已知键, 在编译期为每个桶选出位移量 (hash-and-displace),
+ * 使所有键落在互不相同的槽中. 查找只对键计算一次哈希, 再比较一次槽中的键即可,
+ * 返回键在构造时的下标, 未知键返回 npos, 调用者可回退到 frost_find_object_index.
+ * 表只存在于编译期已知键的 C++ 代码中: frost::bind 读对象时经它分派字段, find_object_values
+ * 经它取已知字段; C 接口的 frost_parse 与 frost_find_object_* 不接收键表, 仍逐个比较成员.
+ *
+ *     constexpr auto keys = frost::make_key_table("id", "name", "tags");
+ *     static_assert(keys.index_of("name") == 1);
+ */
+template <size_t N>
+class key_table {
+public:
+    static constexpr size_t npos = (size_t)-1;
+    static constexpr size_t slot_count = detail::ceil_pow2(N < 1 ? 2 : N * 2);
+    static constexpr size_t bucket_count = (N + 1) / 2 < 1 ? 1 : (N + 1) / 2;
+    static constexpr unsigned slot_bits = detail::log2_pow2(slot_count);
+
+    constexpr key_table(const std::array<const char*, N>& keys, const std::array<size_t, N>& lens)
+        : keys_(keys)
+        , lens_(lens)
+        , disp_ {}
+        , slots_ {}
+    {
+        build();
+    }
+
+    constexpr auto size() const -> size_t { return N; }
+    constexpr auto key(size_t index) const -> const char* { return keys_[index]; }
+    constexpr auto key_length(size_t index) const -> size_t { return lens_[index]; }
+
+    constexpr auto index_of(const char* key, size_t len) const -> size_t
+    {
+        uint64_t h = detail::key_hash(key, len);
+        size_t i = slots_[slot(h, disp_[bucket(h)])];
+        return i < N && lens_[i] == len && std::char_traits<char>::compare(keys_[i], key, len) == 0 ? i : npos;
+    }
+
+    template <size_t L>
+    constexpr auto index_of(const char (&key)[L]) const -> size_t
+    {
+        return index_of(key, L - 1);
+    }
+
+private:
+    static constexpr auto bucket(uint64_t h) -> size_t
+    {
+        return (size_t)(((h >> 32) * bucket_count) >> 32);
+    }
+
+    /* 位移量与键的哈希混合后取高位, 不同位移量给出近似独立的槽位 */
+    static constexpr auto slot(uint64_t h, uint32_t d) -> size_t
+    {
+        return (size_t)(((h ^ (d * 0x9e3779b97f4a7c15ull)) * 0xff51afd7ed558ccdull) >> (64 - slot_bits));
+    }
+
+    constexpr void build()
+    {
+        std::array<uint64_t, N> hash {};
+        std::array<size_t, bucket_count> count {};
+        std::array<size_t, bucket_count> order {};
+        for (size_t i = 0; i < N; i++)
+            for (size_t j = 0; j < i; j++)
+                if (lens_[i] == lens_[j] && std::char_traits<char>::compare(keys_[i], keys_[j], lens_[i]) == 0)
+                    detail::key_table_duplicate_key();
+        for (size_t i = 0; i < slot_count; i++)
+            slots_[i] = N;
+        for (size_t i = 0; i < N; i++) {
+            hash[i] = detail::key_hash(keys_[i], lens_[i]);
+            count[bucket(hash[i])]++;
+        }
+        /* 大桶先放, 此时空槽最多 */
+        for (size_t b = 0; b < bucket_count; b++)
+            order[b] = b;
+        for (size_t b = 0; b < bucket_count; b++)
+            for (size_t c = b + 1; c < bucket_count; c++)
+                if (count[order[c]] > count[order[b]]) {
+                    size_t t = order[b];
+                    order[b] = order[c];
+                    order[c] = t;
+                }
+        for (size_t b = 0; b < bucket_count && count[order[b]] > 0; b++) {
+            for (uint32_t d = 0;; d++) {
+                bool ok = true;
+                if (d > (1u << 16))
+                    detail::key_table_no_perfect_hash();
+                for (size_t i = 0; i < N && ok; i++) {
+                    if (bucket(hash[i]) != order[b])
+                        continue;
+                    if (slots_[slot(hash[i], d)] != N)
+                        ok = false;
+                    else
+                        slots_[slot(hash[i], d)] = (uint32_t)i;
+                }
+                if (ok) {
+                    disp_[order[b]] = d;
+                    break;
+                }
+                for (size_t i = 0; i < N; i++)
+                    if (bucket(hash[i]) == order[b] && slots_[slot(hash[i], d)] == i)
+                        slots_[slot(hash[i], d)] = N;
+            }
+        }
+    }
+
+    std::array<const char*, N> keys_;
+    std::array<size_t, N> lens_;
+    std::array<uint32_t, bucket_count> disp_;
+    std::array<uint32_t, slot_count> slots_;
+};
+
+template <size_t... L>
+constexpr auto make_key_table(const char (&... keys)[L]) -> key_table<sizeof...(L)>
+{
+    return key_table<sizeof...(L)>({ keys... }, { (L - 1)... });
+}
+
+/*
+ * 一次遍历 obj 的成员, 把已知键的值填入 out[table.index_of(key)], 其余置 nullptr;
+ * 重复的键取第一个, 与 frost_find_object_value 一致. 返回找到的键数.
+ */
+template <size_t N>
+auto find_object_values(const key_table<N>& table, frost_value* obj, frost_value** out) -> size_t
+{
+    size_t found = 0;
+    for (size_t i = 0; i < N; i++)
+        out[i] = nullptr;
+    for (size_t i = 0, n = frost_get_object_size(obj); i < n && found < N; i++) {
+        size_t index = table.index_of(frost_get_object_key(obj, i), frost_get_object_key_length(obj, i));
+        if (index != table.npos && out[index] == nullptr) {
+            out[index] = frost_get_object_value(obj, i);
+            found++;
+        }
+    }
+    return found;
+}
+
+namespace detail {
+
+    /* FROST_BIND 定义的 frost_bind_fields 经 ADL 找到, 结构体可以位于任意命名空间 */
+    template <class T, class = void>
+    struct is_bound : std::false_type { };
+    template <class T>
+    struct is_bound<T, std::void_t<decltype(frost_bind_fields((const T*)nullptr))>> : std::true_type { };
+
+    template <class T>
+    struct is_vector : std::false_type { };
+    template <class T, class A>
+    struct is_vector<std::vector<T, A>> : std::true_type { };
+
+    template <class T>
+    struct is_optional : std::false_type { };
+    template <class T>
+    struct is_optional<std::optional<T>> : std::true_type { };
+
+    template <class T>
+    auto read(frost_reader* rdr, frost_token token, T& out) -> int;
+
+    template <class T>
+    auto read_number(frost_reader* rdr, frost_token token, T& out) -> int
+    {
+        if (token != FROST_TOKEN_NUMBER)
+            return FROST_PARSE_TYPE_MISMATCH;
+        double n = frost_reader_get_number(rdr);
+        if constexpr (std::is_integral_v<T>) {
+            const frost_value* num = frost_reader_get_number_value(rdr);
+            if ((num->flags & FROST_FLAG_UINT64) != 0) {
+                if (num->u.u64 > (uint64_t)std::numeric_limits<T>::max())
+                    return FROST_PARSE_TYPE_MISMATCH;
+                out = (T)num->u.u64;
+                return FROST_PARSE_OK;
+            }
+            if ((num->flags & FROST_FLAG_INT64) != 0) {
+                /* 整数字面量精确保存, 直接按 T 的范围检查 */
+                int64_t i = num->u.i64;
+                if constexpr (std::is_signed_v<T>) {
+                    if (i < (int64_t)std::numeric_limits<T>::min() || i > (int64_t)std::numeric_limits<T>::max())
+                        return FROST_PARSE_TYPE_MISMATCH;
+                } else if (i < 0 || (uint64_t)i > (uint64_t)std::numeric_limits<T>::max())
+                    return FROST_PARSE_TYPE_MISMATCH;
+                out = (T)i;
+                return FROST_PARSE_OK;
+            }
+            /* 2^63 等边界值在 double 中精确可表示, 用半开区间判断 */
+            constexpr double lo = std::is_signed_v<T> ? -(double)((unsigned long long)1 << (sizeof(T) * 8 - 1)) : 0.0;
+            constexpr double hi = std::is_signed_v<T> ? (double)((unsigned long long)1 << (sizeof(T) * 8 - 1)) : 2.0 * (double)((unsigned long long)1 << (sizeof(T) * 8 - 1));
+            if (!(n >= lo && n < hi) || (double)(T)n != n)
+                return FROST_PARSE_TYPE_MISMATCH;
+        }
+        out = (T)n;
+        return FROST_PARSE_OK;
+    }
+
+    template <class T>
+    auto read_array(frost_reader* rdr, frost_token token, T& out) -> int
+    {
+        if (token != FROST_TOKEN_BEGIN_ARRAY)
+            return FROST_PARSE_TYPE_MISMATCH;
+        out.clear();
+        while ((token = frost_reader_next(rdr)) != FROST_TOKEN_END_ARRAY) {
+            if (token == FROST_TOKEN_ERROR)
+                return frost_reader_get_error(rdr);
+            out.emplace_back();
+            int ret = read(rdr, token, out.back());
+            if (ret != FROST_PARSE_OK)
+                return ret;
+        }
+        return FROST_PARSE_OK;
+    }
+
+    template <class T, size_t I>
+    auto read_field(frost_reader* rdr, T& out) -> int
+    {
+        constexpr auto fields = frost_bind_fields((const T*)nullptr);
+        return read(rdr, frost_reader_next(rdr), out.*(std::get<I>(fields).member));
+    }
+
+    /* 字段键名的完美哈希表及与之对应的读取函数表, 键经一次哈希即跳到所属字段 */
+    template <class T>
+    struct binding {
+        static constexpr auto fields = frost_bind_fields((const T*)nullptr);
+        static constexpr size_t count = std::tuple_size_v<std::decay_t<decltype(fields)>>;
+
+        template <size_t... I>
+        static constexpr auto make_table(std::index_sequence<I...>) -> key_table<count>
+        {
+            return key_table<count>({ std::get<I>(fields).name... }, { std::get<I>(fields).len... });
+        }
+
+        template <size_t... I>
+        static constexpr auto make_readers(std::index_sequence<I...>) -> std::array<int (*)(frost_reader*, T&), count>
+        {
+            return { &read_field<T, I>... };
+        }
+
+        static constexpr key_table<count> table = make_table(std::make_index_sequence<count>());
+        static constexpr std::array<int (*)(frost_reader*, T&), count> readers = make_readers(std::make_index_sequence<count>());
+    };
+
+    template <class T, class Fields, size_t... I>
+    auto finish_object(T& out, const Fields& fields, const bool* seen, std::index_sequence<I...>) -> int
+    {
+        int ret = FROST_PARSE_OK;
+        auto member = [&](const auto& f, bool found) {
+            auto& v = out.*(f.member);
+            if (found)
+                return;
+            if constexpr (is_optional<std::decay_t<decltype(v)>>::value)
+                v.reset();
+            else
+                ret = FROST_PARSE_MISS_FIELD;
+        };
+        (member(std::get<I>(fields), seen[I]), ...);
+        return ret;
+    }
+
+    template <class T>
+    auto read_object(frost_reader* rdr, frost_token token, T& out) -> int
+    {
+        using bind = binding<T>;
+        bool seen[bind::count + 1] = {};
+        if (token != FROST_TOKEN_BEGIN_OBJECT)
+            return FROST_PARSE_TYPE_MISMATCH;
+        while ((token = frost_reader_next(rdr)) != FROST_TOKEN_END_OBJECT) {
+            int ret = 0;
+            size_t index = 0;
+            if (token == FROST_TOKEN_ERROR)
+                return frost_reader_get_error(rdr);
+            index = bind::table.index_of(frost_reader_get_string(rdr), frost_reader_get_string_length(rdr));
+            if (index == bind::table.npos)
+                ret = frost_reader_skip(rdr, frost_reader_next(rdr));
+            else {
+                seen[index] = true;
+                ret = bind::readers[index](rdr, out);
+            }
+            if (ret != FROST_PARSE_OK)
+                return ret;
+        }
+        return finish_object(out, bind::fields, seen, std::make_index_sequence<bind::count>());
+    }
+
+    template <class T>
+    auto read(frost_reader* rdr, frost_token token, T& out) -> int
+    {
+        if (token == FROST_TOKEN_ERROR)
+            return frost_reader_get_error(rdr);
+        if constexpr (is_optional<T>::value) {
+            if (token == FROST_TOKEN_NULL) {
+                out.reset();
+                return FROST_PARSE_OK;
+            }
+            return read(rdr, token, out.emplace());
+        } else if constexpr (std::is_same_v<T, bool>) {
+            if (token != FROST_TOKEN_TRUE && token != FROST_TOKEN_FALSE)
+                return FROST_PARSE_TYPE_MISMATCH;
+            out = token == FROST_TOKEN_TRUE;
+            return FROST_PARSE_OK;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            return read_number(rdr, token, out);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            if (token != FROST_TOKEN_STRING)
+                return FROST_PARSE_TYPE_MISMATCH;
+            out.assign(frost_reader_get_string(rdr), frost_reader_get_string_length(rdr));
+            return FROST_PARSE_OK;
+        } else if constexpr (is_vector<T>::value) {
+            return read_array(rdr, token, out);
+        } else {
+            static_assert(is_bound<T>::value, "type is not bound, describe it with FROST_BIND");
+            return read_object(rdr, token, out);
+        }
+    }
+
+    inline void write_string(std::string& out, const char* str, size_t len)
+    {
+        static const char hex_digits[] = "0123456789ABCDEF";
+        out.push_back('"');
+        for (size_t i = 0; i < len; i++) {
+            auto ch = (unsigned char)str[i];
+            switch (ch) {
+            case '\"': out.append("\\\"", 2); break;
+            case '\\': out.append("\\\\", 2); break;
+            case '\b': out.append("\\b", 2); break;
+            case '\f': out.append("\\f", 2); break;
+            case '\n': out.append("\\n", 2); break;
+            case '\r': out.append("\\r", 2); break;
+            case '\t': out.append("\\t", 2); break;
+            default:
+                if (ch < 0x20) {
+                    char esc[6] = { '\\', 'u', '0', '0', hex_digits[ch >> 4], hex_digits[ch & 15] };
+                    out.append(esc, 6);
+                } else
+                    out.push_back((char)ch);
+            }
+        }
+        out.push_back('"');
+    }
+
+    template <class T>
+    void write(std::string& out, const T& in);
+
+    template <class T, class Fields, size_t... I>
+    void write_object(std::string& out, const T& in, const Fields& fields, std::index_sequence<I...>)
+    {
+        bool first = true;
+        auto member = [&](const auto& f) {
+            const auto& v = in.*(f.member);
+            if constexpr (is_optional<std::decay_t<decltype(v)>>::value) {
+                if (!v.has_value())
+                    return;
+            }
+            if (!first)
+                out.push_back(',');
+            first = false;
+            write_string(out, f.name, f.len);
+            out.push_back(':');
+            write(out, v);
+        };
+        out.push_back('{');
+        (member(std::get<I>(fields)), ...);
+        out.push_back('}');
+    }
+
+    template <class T>
+    void write(std::string& out, const T& in)
+    {
+        if constexpr (is_optional<T>::value) {
+            if (in.has_value())
+                write(out, *in);
+            else
+                out.append("null", 4);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            if (in)
+                out.append("true", 4);
+            else
+                out.append("false", 5);
+        } else if constexpr (std::is_integral_v<T>) {
+            char buf[24];
+            int n = std::is_signed_v<T> ? snprintf(buf, sizeof(buf), "%lld", (long long)in) : snprintf(buf, sizeof(buf), "%llu", (unsigned long long)in);
+            out.append(buf, (size_t)n);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            char buf[32];
+            out.append(buf, (size_t)snprintf(buf, sizeof(buf), "%.17g", (double)in));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            write_string(out, in.data(), in.size());
+        } else if constexpr (is_vector<T>::value) {
+            out.push_back('[');
+            for (size_t i = 0; i < in.size(); i++) {
+                if (i > 0)
+                    out.push_back(',');
+                write(out, in[i]);
+            }
+            out.push_back(']');
+        } else {
+            static_assert(is_bound<T>::value, "type is not bound, describe it with FROST_BIND");
+            constexpr auto fields = frost_bind_fields((const T*)nullptr);
+            write_object(out, in, fields, std::make_index_sequence<std::tuple_size_v<std::decay_t<decltype(fields)>>>());
+        }
+    }
+
+} // namespace detail
+
+/* 把 json 直接读入 *out, 返回 FROST_PARSE_*; 失败时 *out 可能已被部分写入 */
+template <class T>
+auto bind(T* out, const char* json, const frost_parse_options* opt = nullptr) -> int
+{
+    frost_reader* rdr = frost_reader_open(json, opt);
+    int ret = detail::read(rdr, frost_reader_next(rdr), *out);
+    if (ret == FROST_PARSE_OK && frost_reader_next(rdr) != FROST_TOKEN_END)
+        ret = frost_reader_get_error(rdr);
+    frost_reader_close(rdr);
+    return ret;
+}
+
+template <class T>
+auto stringify(const T& in) -> std::string
+{
+    std::string out;
+    detail::write(out, in);
+    return out;
+}
+
+/*
+ * RAII 封装: frost::value 独占一棵 frost_value 树, 析构时释放; 只能移动, 深复制需显式调用 clone().
+ * frost::view / frost::ref 是不持有所有权的只读 / 可写引用, 由元素访问与遍历返回,
+ * 生命周期不超过所属的树, 对容器的增删会使其中已取得的引用失效.
+ *
+ *     frost::value doc;
+ *     if (doc.parse(json) == FROST_PARSE_OK)
+ *         for (auto [key, v] : doc.members())
+ *             if (v.is_string())
+ *                 use(key, v.get_string());   // 均为 std::string_view, 不复制
+ *
+ * 查找接受 std::string_view, 以 std::string、字符串字面量或 string_view 查找都不构造临时字符串.
+ */
+class value;
+class view;
+class ref;
+
+template <class R>
+struct basic_member {
+    std::string_view key;
+    R value;
+};
+
+using member_view = basic_member<view>;
+using member_ref = basic_member<ref>;
+
+namespace detail {
+
+    template <class R, class V>
+    class element_iterator {
+    public:
+        explicit element_iterator(V* p) : p_(p) { }
+        auto operator*() const -> R { return R(p_); }
+        auto operator++() -> element_iterator& { ++p_; return *this; }
+        auto operator==(const element_iterator& rhs) const -> bool { return p_ == rhs.p_; }
+        auto operator!=(const element_iterator& rhs) const -> bool { return p_ != rhs.p_; }
+    private:
+        V* p_;
+    };
+
+    template <class R, class M>
+    class member_iterator {
+    public:
+        explicit member_iterator(M* p) : p_(p) { }
+        auto operator*() const -> basic_member<R> { return { std::string_view(p_->k, p_->klen), R(&p_->v) }; }
+        auto operator++() -> member_iterator& { ++p_; return *this; }
+        auto operator==(const member_iterator& rhs) const -> bool { return p_ == rhs.p_; }
+        auto operator!=(const member_iterator& rhs) const -> bool { return p_ != rhs.p_; }
+    private:
+        M* p_;
+    };
+
+    template <class I>
+    struct range {
+        I first, last;
+        auto begin() const -> I { return first; }
+        auto end() const -> I { return last; }
+    };
+
+    /* 只读访问, D 提供 raw() 返回底层的 frost_value */
+    template <class D>
+    class const_access {
+    public:
+        auto type() const -> frost_type { return frost_get_type(get()); }
+        auto is_null() const -> bool { return type() == FROST_NULL; }
+        auto is_bool() const -> bool { return type() == FROST_TRUE || type() == FROST_FALSE; }
+        auto is_number() const -> bool { return type() == FROST_NUMBER; }
+        auto is_string() const -> bool { return type() == FROST_STRING; }
+        auto is_array() const -> bool { return type() == FROST_ARRAY; }
+        auto is_object() const -> bool { return type() == FROST_OBJECT; }
+
+        auto get_bool() const -> bool { return frost_get_boolean(get()) != 0; }
+        auto get_number() const -> double { return frost_get_number(get()); }
+        auto get_int64() const -> int64_t { return frost_get_int64(get()); }
+        auto get_uint64() const -> uint64_t { return frost_get_uint64(get()); }
+        auto get_string() const -> std::string_view { return std::string_view(frost_get_string(get()), frost_get_string_length(get())); }
+
+        /* 数组的元素数或对象的成员数 */
+        auto size() const -> size_t { return is_array() ? frost_get_array_size(get()) : frost_get_object_size(get()); }
+        auto empty() const -> bool { return size() == 0; }
+
+        auto at(size_t index) const -> view;
+        auto find(std::string_view key) const -> view;   /* 键不存在时返回空引用 */
+        auto contains(std::string_view key) const -> bool { return frost_find_object_index(get(), key.data(), key.size()) != FROST_KEY_NOT_EXIST; }
+
+        auto elements() const -> range<element_iterator<view, const frost_value>>;
+        auto members() const -> range<member_iterator<view, const frost_member>>;
+
+        auto stringify() const -> std::string
+        {
+            size_t len = 0;
+            char* json = frost_stringify(get(), &len);
+            std::string out(json, len);
+            free(json);
+            return out;
+        }
+
+        operator view() const;
+
+    private:
+        auto get() const -> const frost_value* { return static_cast<const D*>(this)->raw(); }
+    };
+
+    /* 可写访问; 取出子值的可写引用经 frost_mutable_* 先写时复制 (冻结的值除外) */
+    template <class D>
+    class mutable_access : public const_access<D> {
+    public:
+        using const_access<D>::at;
+        using const_access<D>::find;
+        using const_access<D>::elements;
+        using const_access<D>::members;
+
+        auto at(size_t index) -> ref;
+        auto find(std::string_view key) -> ref;
+        auto elements() -> range<element_iterator<ref, frost_value>>;
+        auto members() -> range<member_iterator<ref, frost_member>>;
+        auto operator[](size_t index) -> ref;
+        auto operator[](std::string_view key) -> ref;    /* 键不存在时插入 null 成员 */
+
+        void assign(std::nullptr_t) { frost_set_null(get()); }
+        void assign(bool b) { frost_set_boolean(get(), b ? 1 : 0); }
+        void assign(double n) { frost_set_number(get(), n); }
+        void assign(const char* str) { assign(std::string_view(str)); }
+        void assign(std::string_view str) { frost_set_string(get(), str.data(), str.size()); }
+        void assign(value&& v);
+        template <class T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+        void assign(T n)
+        {
+            if constexpr (std::is_signed_v<T>)
+                frost_set_int64(get(), n);
+            else
+                frost_set_uint64(get(), n);
+        }
+        void set_array(size_t capacity = 0) { frost_set_array(get(), capacity); }
+        void set_object(size_t capacity = 0) { frost_set_object(get(), capacity); }
+
+        auto push_back(value&& v) -> ref;
+        auto insert(std::string_view key, value&& v) -> ref;   /* 键已存在时替换其值 */
+        auto erase(std::string_view key) -> bool
+        {
+            size_t index = frost_find_object_index(get(), key.data(), key.size());
+            if (index == FROST_KEY_NOT_EXIST)
+                return false;
+            frost_remove_object_value(get(), index);
+            return true;
+        }
+
+    private:
+        auto get() -> frost_value* { return static_cast<D*>(this)->raw(); }
+    };
+
+} // namespace detail
+
+class view : public detail::const_access<view> {
+public:
+    view() noexcept : p_(nullptr) { }
+    explicit view(const frost_value* p) noexcept : p_(p) { }
+    auto raw() const -> const frost_value* { return p_; }
+    explicit operator bool() const { return p_ != nullptr; }
+private:
+    const frost_value* p_;
+};
+
+class ref : public detail::mutable_access<ref> {
+public:
+    ref() noexcept : p_(nullptr) { }
+    explicit ref(frost_value* p) noexcept : p_(p) { }
+    auto raw() const -> frost_value* { return p_; }
+    explicit operator bool() const { return p_ != nullptr; }
+private:
+    frost_value* p_;
+};
+
+class value : public detail::mutable_access<value> {
+public:
+    value() noexcept { frost_init(&v_); }
+    value(std::nullptr_t) noexcept { frost_init(&v_); }
+    value(bool b) noexcept { frost_init(&v_); assign(b); }
+    value(double n) noexcept { frost_init(&v_); assign(n); }
+    value(const char* str) { frost_init(&v_); assign(str); }
+    value(std::string_view str) { frost_init(&v_); assign(str); }
+    template <class T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    value(T n) noexcept { frost_init(&v_); assign(n); }
+
+    value(const value&) = delete;
+    auto operator=(const value&) -> value& = delete;
+    value(value&& rhs) noexcept
+    {
+        frost_init(&v_);
+        frost_move(&v_, &rhs.v_);
+    }
+    auto operator=(value&& rhs) noexcept -> value&
+    {
+        if (this != &rhs)
+            frost_move(&v_, &rhs.v_);
+        return *this;
+    }
+    ~value() { frost_free(&v_); }
+
+    static auto array(size_t capacity = 0) -> value
+    {
+        value v;
+        v.set_array(capacity);
+        return v;
+    }
+    static auto object(size_t capacity = 0) -> value
+    {
+        value v;
+        v.set_object(capacity);
+        return v;
+    }
+
+    /* 接管 C API 构造的树, raw 随后为 null */
+    static auto adopt(frost_value* raw) noexcept -> value
+    {
+        value v;
+        frost_move(&v.v_, raw);
+        return v;
+    }
+
+    /* 解析失败时为 null, 返回 FROST_PARSE_* */
+    auto parse(const char* json, const frost_parse_options* opt = nullptr) -> int
+    {
+        return opt == nullptr ? frost_parse(&v_, json) : frost_parse_with_options(&v_, json, opt);
+    }
+
+    auto clone() const -> value
+    {
+        value v;
+        frost_copy(&v.v_, &v_);
+        return v;
+    }
+
+    void swap(value& rhs) noexcept { frost_swap(&v_, &rhs.v_); }
+    friend void swap(value& lhs, value& rhs) noexcept { lhs.swap(rhs); }
+
+    auto raw() -> frost_value* { return &v_; }
+    auto raw() const -> const frost_value* { return &v_; }
+
+private:
+    frost_value v_;
+};
+
+inline auto operator==(view lhs, view rhs) -> bool { return frost_is_equal(lhs.raw(), rhs.raw()) != 0; }
+inline auto operator!=(view lhs, view rhs) -> bool { return !(lhs == rhs); }
+
+namespace detail {
+
+    template <class D>
+    auto const_access<D>::at(size_t index) const -> view
+    {
+        assert(index < frost_get_array_size(get()));
+        return view(&get()->u.a.e[index]);
+    }
+
+    template <class D>
+    auto const_access<D>::find(std::string_view key) const -> view
+    {
+        size_t index = frost_find_object_index(get(), key.data(), key.size());
+        return index == FROST_KEY_NOT_EXIST ? view() : view(&get()->u.o.m[index].v);
+    }
+
+    template <class D>
+    auto const_access<D>::elements() const -> range<element_iterator<view, const frost_value>>
+    {
+        const frost_value* e = frost_get_array_size(get()) > 0 ? get()->u.a.e : nullptr;
+        return { element_iterator<view, const frost_value>(e), element_iterator<view, const frost_value>(e + frost_get_array_size(get())) };
+    }
+
+    template <class D>
+    auto const_access<D>::members() const -> range<member_iterator<view, const frost_member>>
+    {
+        const frost_member* m = frost_get_object_size(get()) > 0 ? get()->u.o.m : nullptr;
+        return { member_iterator<view, const frost_member>(m), member_iterator<view, const frost_member>(m + frost_get_object_size(get())) };
+    }
+
+    template <class D>
+    const_access<D>::operator view() const
+    {
+        return view(get());
+    }
+
+    template <class D>
+    auto mutable_access<D>::at(size_t index) -> ref
+    {
+        return ref(frost_mutable_array_element(get(), index));
+    }
+
+    template <class D>
+    auto mutable_access<D>::find(std::string_view key) -> ref
+    {
+        size_t index = frost_find_object_index(get(), key.data(), key.size());
+        return index == FROST_KEY_NOT_EXIST ? ref() : ref(frost_mutable_object_value(get(), index));
+    }
+
+    /* 经第一个元素的可写访问触发写时复制, 此后直接遍历缓冲区 */
+    template <class D>
+    auto mutable_access<D>::elements() -> range<element_iterator<ref, frost_value>>
+    {
+        size_t n = frost_get_array_size(get());
+        frost_value* e = n > 0 ? frost_mutable_array_element(get(), 0) : nullptr;
+        return { element_iterator<ref, frost_value>(e), element_iterator<ref, frost_value>(e + n) };
+    }
+
+    template <class D>
+    auto mutable_access<D>::members() -> range<member_iterator<ref, frost_member>>
+    {
+        size_t n = frost_get_object_size(get());
+        if (n > 0)
+            frost_mutable_object_value(get(), 0);
+        frost_member* m = n > 0 ? get()->u.o.m : nullptr;
+        return { member_iterator<ref, frost_member>(m), member_iterator<ref, frost_member>(m + n) };
+    }
+
+    template <class D>
+    auto mutable_access<D>::operator[](size_t index) -> ref
+    {
+        return at(index);
+    }
+
+    template <class D>
+    auto mutable_access<D>::operator[](std::string_view key) -> ref
+    {
+        return ref(frost_set_object_value(get(), key.data(), key.size()));
+    }
+
+    template <class D>
+    void mutable_access<D>::assign(value&& v)
+    {
+        if (v.raw() != get())
+            frost_move(get(), v.raw());
+    }
+
+    template <class D>
+    auto mutable_access<D>::push_back(value&& v) -> ref
+    {
+        frost_value* e = frost_pushback_array_element(get());
+        frost_move(e, v.raw());
+        return ref(e);
+    }
+
+    template <class D>
+    auto mutable_access<D>::insert(std::string_view key, value&& v) -> ref
+    {
+        frost_value* m = frost_set_object_value(get(), key.data(), key.size());
+        frost_move(m, v.raw());
+        return ref(m);
+    }
+
+} // namespace detail
+
+/*
+ * 顶层数组的流式读取 (frost_array_stream_*): 以 range-for 逐个取出元素, 同一时刻只持有当前元素.
+ * 只能遍历一次; 循环结束后 error() 区分数组正常结束与出错.
+ *
+ *     frost::array_stream records(fd);    // 或 (json, len)、(read, user)
+ *     for (frost::value& rec : records)
+ *         use(rec);
+ *     if (records.error() != FROST_PARSE_OK)
+ *         ...
+ */
+class array_stream {
+public:
+    class iterator {
+    public:
+        explicit iterator(array_stream* s) : s_(s) { }
+        auto operator*() const -> value& { return s_->current_; }
+        auto operator->() const -> value* { return &s_->current_; }
+        auto operator++() -> iterator&
+        {
+            if (!s_->next(s_->current_))
+                s_ = nullptr;
+            return *this;
+        }
+        auto operator==(const iterator& rhs) const -> bool { return s_ == rhs.s_; }
+        auto operator!=(const iterator& rhs) const -> bool { return s_ != rhs.s_; }
+    private:
+        array_stream* s_;
+    };
+
+    array_stream(const char* json, size_t len, const frost_parse_options* opt = nullptr)
+        : s_(frost_array_stream_open_buffer(json, len, opt)) { }
+    explicit array_stream(int fd, const frost_parse_options* opt = nullptr)
+        : s_(frost_array_stream_open_fd(fd, opt)) { }
+    array_stream(frost_read_callback read, void* user, const frost_parse_options* opt = nullptr)
+        : s_(frost_array_stream_open(read, user, opt)) { }
+    array_stream(const array_stream&) = delete;
+    auto operator=(const array_stream&) -> array_stream& = delete;
+    ~array_stream() { frost_array_stream_close(s_); }
+
+    /* 取出下一个元素, 数组结束或出错时返回 false */
+    auto next(value& out) -> bool
+    {
+        frost_value v;
+        if (frost_array_stream_next(s_, &v) == 0)
+            return false;
+        out = value::adopt(&v);
+        return true;
+    }
+
+    auto begin() -> iterator { return ++iterator(this); }
+    auto end() -> iterator { return iterator(nullptr); }
+    auto error() const -> int { return frost_array_stream_get_error(s_); }
+
+private:
+    frost_array_stream* s_;
+    value current_;
+};
+
+} // namespace frost
+
+#define FROST_FIELD(type, name) ::frost::field(#name, &type::name)
+
+/* 在结构体所在的命名空间中描述其字段, 参数为若干 FROST_FIELD 或 frost::field("key", &type::member) */
+#define FROST_BIND(type, ...)                                        \
+    constexpr auto frost_bind_fields(const type*)                    \
+    {                                                                \
+        return std::make_tuple(__VA_ARGS__);                         \
+    }                                                                \
+    static_assert(true, "")
+
+#endif /* FROSTJSON_HPP__ */
@@ -0,0 +1,679 @@
+#include "frostjson.h"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * MessagePack / CBOR 与 frost_value 之间的直接转换.
+ *
+ * 两种格式的字符串都带长度前缀, 解码时无需处理转义; 数组与对象同样带元素个数,
+ * 解码时按精确大小一次分配. 整数值的 double 编码为整数, 其余按 float32 (无损时) 或 float64.
+ * 解码错误沿用 FROST_PARSE_* 错误码:
+ *   截断或不支持的类型  FROST_PARSE_INVALID_VALUE
+ *   对象键不是字符串    FROST_PARSE_MISS_KEY
+ *   末尾有多余字节      FORST_PARSE_ROOT_NOT_SINGULAR
+ *   嵌套超过上限        FROST_PARSE_DEPTH_EXCEEDED
+ * 解码按嵌套递归, 层数受 FROST_BINARY_MAX_DEPTH 限制, 以免恶意输入耗尽栈; CBOR 标签不占层数, 循环跳过.
+ */
+
+#ifndef FROST_BINARY_INIT_SIZE
+#define FROST_BINARY_INIT_SIZE 256
+#endif
+
+#ifndef FROST_BINARY_MAX_DEPTH
+#define FROST_BINARY_MAX_DEPTH 1024
+#endif
+
+using frost_buffer = struct {
+    unsigned char* data;
+    size_t size, top;
+    int overflow;   /* 有长度超出格式上限, 编码失败 */
+};
+
+static auto frost_buffer_push(frost_buffer* buf, size_t size) -> unsigned char*
+{
+    unsigned char* ret = nullptr;
+    if (buf->top + size > buf->size) {
+        if (buf->size == 0)
+            buf->size = FROST_BINARY_INIT_SIZE;
+        while (buf->top + size > buf->size)
+            buf->size += buf->size >> 1;
+        buf->data = (unsigned char*)realloc(buf->data, buf->size);
+    }
+    ret = buf->data + buf->top;
+    buf->top += size;
+    return ret;
+}
+
+static void frost_buffer_putc(frost_buffer* buf, unsigned ch)
+{
+    *frost_buffer_push(buf, 1) = (unsigned char)ch;
+}
+
+/* 大端写入 n 字节 */
+static void frost_buffer_put_be(frost_buffer* buf, uint64_t num, size_t n)
+{
+    unsigned char* out = frost_buffer_push(buf, n);
+    for (size_t i = 0; i < n; i++)
+        out[i] = (unsigned char)(num >> (8 * (n - 1 - i)));
+}
+
+static auto frost_buffer_finish(frost_buffer* buf, size_t* length) -> char*
+{
+    if (buf->overflow) {
+        free(buf->data);
+        if (length != nullptr)
+            *length = 0;
+        return nullptr;
+    }
+    if (length != nullptr)
+        *length = buf->top;
+    if (buf->data == nullptr)
+        frost_buffer_push(buf, 1);
+    return (char*)buf->data;
+}
+
+static auto frost_double_bits(double num) -> uint64_t
+{
+    uint64_t bits = 0;
+    memcpy(&bits, &num, sizeof(bits));
+    return bits;
+}
+
+static auto frost_float_bits(float num) -> uint32_t
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &num, sizeof(bits));
+    return bits;
+}
+
+/* 能否无损表示为 int64 (排除 -0.0, 以保留符号) */
+static auto frost_double_is_int64(double num) -> int
+{
+    return num >= -9223372036854775808.0 && num < 9223372036854775808.0 && (double)(int64_t)num == num
+        && !(num == 0.0 && std::signbit(num));
+}
+
+static auto frost_double_is_float(double num) -> int
+{
+    return (double)(float)num == num;
+}
+
+/* 解码游标 */
+using frost_reader_cursor = struct {
+    const unsigned char* cur;
+    const unsigned char* end;
+    size_t depth;
+};
+
+static auto frost_cursor_need(const frost_reader_cursor* cur, size_t n) -> int
+{
+    return (size_t)(cur->end - cur->cur) >= n;
+}
+
+static auto frost_cursor_get_be(frost_reader_cursor* cur, size_t n) -> uint64_t
+{
+    uint64_t num = 0;
+    for (size_t i = 0; i < n; i++)
+        num = (num << 8) | cur->cur[i];
+    cur->cur += n;
+    return num;
+}
+
+/* JSON 无法表示 NaN/Inf, 解码时拒绝 */
+static auto frost_binary_set_double(frost_value* val, double num) -> int
+{
+    if (!std::isfinite(num))
+        return FROST_PARSE_INVALID_VALUE;
+    frost_set_number(val, num);
+    return FROST_PARSE_OK;
+}
+
+static auto frost_bits_double(uint64_t bits) -> double
+{
+    double num = 0;
+    memcpy(&num, &bits, sizeof(num));
+    return num;
+}
+
+static auto frost_bits_float(uint32_t bits) -> double
+{
+    float num = 0;
+    memcpy(&num, &bits, sizeof(num));
+    return num;
+}
+
+/*
+ * 分配恰好 size 个成员的对象/数组并进入一层嵌套, 成员解码完后由调用者 depth--;
+ * 元素先初始化再计入 size, 出错时 frost_free 只释放已解码部分
+ */
+static auto frost_binary_set_array(frost_reader_cursor* cur, frost_value* val, uint64_t size) -> int
+{
+    if (cur->depth >= FROST_BINARY_MAX_DEPTH)
+        return FROST_PARSE_DEPTH_EXCEEDED;
+    /* 每个元素至少占 1 字节, 据此拒绝伪造的超大长度 */
+    if (size > (uint64_t)(cur->end - cur->cur))
+        return FROST_PARSE_INVALID_VALUE;
+    frost_set_array(val, (size_t)size);
+    cur->depth++;
+    return FROST_PARSE_OK;
+}
+
+static auto frost_binary_set_object(frost_reader_cursor* cur, frost_value* val, uint64_t size) -> int
+{
+    if (cur->depth >= FROST_BINARY_MAX_DEPTH)
+        return FROST_PARSE_DEPTH_EXCEEDED;
+    if (size > (uint64_t)(cur->end - cur->cur) / 2)
+        return FROST_PARSE_INVALID_VALUE;
+    frost_set_object(val, (size_t)size);
+    cur->depth++;
+    return FROST_PARSE_OK;
+}
+
+/* ---------------- MessagePack ---------------- */
+
+static void frost_msgpack_put_length(frost_buffer* buf, size_t len, unsigned fix, unsigned fixmax, unsigned op8, unsigned op16, unsigned op32)
+{
+    if (len <= fixmax)
+        frost_buffer_putc(buf, fix | (unsigned)len);
+    else if (op8 != 0 && len <= 0xFF) {
+        frost_buffer_putc(buf, op8);
+        frost_buffer_put_be(buf, len, 1);
+    } else if (len <= 0xFFFF) {
+        frost_buffer_putc(buf, op16);
+        frost_buffer_put_be(buf, len, 2);
+    } else if (len <= 0xFFFFFFFFu) {
+        frost_buffer_putc(buf, op32);
+        frost_buffer_put_be(buf, len, 4);
+    } else
+        buf->overflow = 1;  /* MessagePack 的长度最多 32 位 */
+}
+
+static void frost_msgpack_put_string(frost_buffer* buf, const char* str, size_t len)
+{
+    frost_msgpack_put_length(buf, len, 0xA0, 31, 0xD9, 0xDA, 0xDB);
+    if (len > 0 && !buf->overflow)
+        memcpy(frost_buffer_push(buf, len), str, len);
+}
+
+static void frost_msgpack_put_int(frost_buffer* buf, int64_t num)
+{
+    if (num >= 0) {
+        uint64_t uns = (uint64_t)num;
+        if (uns <= 0x7F)
+            frost_buffer_putc(buf, (unsigned)uns);
+        else if (uns <= 0xFF) {
+            frost_buffer_putc(buf, 0xCC);
+            frost_buffer_put_be(buf, uns, 1);
+        } else if (uns <= 0xFFFF) {
+            frost_buffer_putc(buf, 0xCD);
+            frost_buffer_put_be(buf, uns, 2);
+        } else if (uns <= 0xFFFFFFFFu) {
+            frost_buffer_putc(buf, 0xCE);
+            frost_buffer_put_be(buf, uns, 4);
+        } else {
+            frost_buffer_putc(buf, 0xCF);
+            frost_buffer_put_be(buf, uns, 8);
+        }
+    } else if (num >= -32)
+        frost_buffer_putc(buf, (unsigned)(num & 0xFF));
+    else if (num >= INT8_MIN) {
+        frost_buffer_putc(buf, 0xD0);
+        frost_buffer_put_be(buf, (uint64_t)num, 1);
+    } else if (num >= INT16_MIN) {
+        frost_buffer_putc(buf, 0xD1);
+        frost_buffer_put_be(buf, (uint64_t)num, 2);
+    } else if (num >= INT32_MIN) {
+        frost_buffer_putc(buf, 0xD2);
+        frost_buffer_put_be(buf, (uint64_t)num, 4);
+    } else {
+        frost_buffer_putc(buf, 0xD3);
+        frost_buffer_put_be(buf, (uint64_t)num, 8);
+    }
+}
+
+static void frost_msgpack_put_number(frost_buffer* buf, double num)
+{
+    if (frost_double_is_int64(num))
+        frost_msgpack_put_int(buf, (int64_t)num);
+    else if (frost_double_is_float(num)) {
+        frost_buffer_putc(buf, 0xCA);
+        frost_buffer_put_be(buf, frost_float_bits((float)num), 4);
+    } else {
+        frost_buffer_putc(buf, 0xCB);
+        frost_buffer_put_be(buf, frost_double_bits(num), 8);
+    }
+}
+
+static void frost_msgpack_encode_value(frost_buffer* buf, const frost_value* val)
+{
+    size_t i = 0;
+    unsigned kind = 0;
+    if (buf->overflow)
+        return;
+    switch (val->type) {
+    case FROST_NULL:
+        frost_buffer_putc(buf, 0xC0);
+        break;
+    case FROST_FALSE:
+        frost_buffer_putc(buf, 0xC2);
+        break;
+    case FROST_TRUE:
+        frost_buffer_putc(buf, 0xC3);
+        break;
+    case FROST_NUMBER:
+        kind = frost_get_number_kind(val);
+        if (kind == FROST_FLAG_INT64)
+            frost_msgpack_put_int(buf, val->u.i64);
+        else if (kind == FROST_FLAG_UINT64) {
+            frost_buffer_putc(buf, 0xCF);
+            frost_buffer_put_be(buf, val->u.u64, 8);
+        } else
+            frost_msgpack_put_number(buf, val->u.n);
+        break;
+    case FROST_STRING:
+        frost_msgpack_put_string(buf, val->u.s.s, val->u.s.len);
+        break;
+    case FROST_ARRAY:
+        frost_msgpack_put_length(buf, val->u.a.size, 0x90, 15, 0, 0xDC, 0xDD);
+        for (i = 0; i < val->u.a.size; i++)
+            frost_msgpack_encode_value(buf, &val->u.a.e[i]);
+        break;
+    case FROST_OBJECT:
+        frost_msgpack_put_length(buf, val->u.o.size, 0x80, 15, 0, 0xDE, 0xDF);
+        for (i = 0; i < val->u.o.size; i++) {
+            frost_msgpack_put_string(buf, val->u.o.m[i].k, val->u.o.m[i].klen);
+            frost_msgpack_encode_value(buf, &val->u.o.m[i].v);
+        }
+        break;
+    default:
+        assert(0 && "invalid type");
+    }
+}
+
+auto frost_encode_msgpack(const frost_value* val, size_t* length) -> char*
+{
+    frost_buffer buf = { nullptr, 0, 0, 0 };
+    assert(val != nullptr);
+    frost_msgpack_encode_value(&buf, val);
+    return frost_buffer_finish(&buf, length);
+}
+
+/* 读取 str/bin 的长度; 不是字符串时返回 0 */
+static auto frost_msgpack_string_length(frost_reader_cursor* cur, unsigned op, uint64_t* len) -> int
+{
+    size_t n = 0;
+    if ((op & 0xE0) == 0xA0) {
+        *len = op & 0x1F;
+        return 1;
+    }
+    switch (op) {
+    case 0xC4: case 0xD9: n = 1; break;
+    case 0xC5: case 0xDA: n = 2; break;
+    case 0xC6: case 0xDB: n = 4; break;
+    default:
+        return 0;
+    }
+    if (!frost_cursor_need(cur, n))
+        return 0;
+    *len = frost_cursor_get_be(cur, n);
+    return 1;
+}
+
+static auto frost_msgpack_decode_value(frost_reader_cursor* cur, frost_value* val) -> int;
+
+static auto frost_msgpack_decode_array(frost_reader_cursor* cur, frost_value* val, uint64_t size) -> int
+{
+    int ret = frost_binary_set_array(cur, val, size);
+    if (ret != FROST_PARSE_OK)
+        return ret;
+    for (uint64_t i = 0; i < size; i++) {
+        frost_value* elem = &val->u.a.e[val->u.a.size++];
+        frost_init(elem);
+        if ((ret = frost_msgpack_decode_value(cur, elem)) != FROST_PARSE_OK)
+            return ret;
+    }
+    cur->depth--;
+    return FROST_PARSE_OK;
+}
+
+static auto frost_msgpack_decode_object(frost_reader_cursor* cur, frost_value* val, uint64_t size) -> int
+{
+    uint64_t klen = 0;
+    int ret = frost_binary_set_object(cur, val, size);
+    if (ret != FROST_PARSE_OK)
+        return ret;
+    for (uint64_t i = 0; i < size; i++) {
+        frost_member* mem = &val->u.o.m[val->u.o.size];
+        if (!frost_cursor_need(cur, 1))
+            return FROST_PARSE_INVALID_VALUE;
+        if (!frost_msgpack_string_length(cur, *cur->cur++, &klen))
+            return FROST_PARSE_MISS_KEY;
+        if (!frost_cursor_need(cur, klen))
+            return FROST_PARSE_INVALID_VALUE;
+        mem->klen = (size_t)klen;
+        mem->k = (char*)malloc(mem->klen + 1);
+        memcpy(mem->k, cur->cur, mem->klen);
+        mem->k[mem->klen] = '\0';
+        cur->cur += klen;
+        frost_init(&mem->v);
+        ret = frost_msgpack_decode_value(cur, &mem->v);
+        val->u.o.size++;
+        if (ret != FROST_PARSE_OK)
+            return ret;
+    }
+    cur->depth--;
+    return FROST_PARSE_OK;
+}
+
+static auto frost_msgpack_decode_value(frost_reader_cursor* cur, frost_value* val) -> int
+{
+    unsigned op = 0;
+    uint64_t len = 0;
+    size_t n = 0;
+    if (!frost_cursor_need(cur, 1))
+        return FROST_PARSE_INVALID_VALUE;
+    op = *cur->cur++;
+    if (op <= 0x7F) {
+        frost_set_int64(val, op);
+        return FROST_PARSE_OK;
+    }
+    if (op >= 0xE0) {
+        frost_set_int64(val, (int)op - 0x100);
+        return FROST_PARSE_OK;
+    }
+    if ((op & 0xF0) == 0x80)
+        return frost_msgpack_decode_object(cur, val, op & 0x0F);
+    if ((op & 0xF0) == 0x90)
+        return frost_msgpack_decode_array(cur, val, op & 0x0F);
+    if (frost_msgpack_string_length(cur, op, &len)) {
+        if (!frost_cursor_need(cur, len))
+            return FROST_PARSE_INVALID_VALUE;
+        frost_set_string(val, (const char*)cur->cur, (size_t)len);
+        cur->cur += len;
+        return FROST_PARSE_OK;
+    }
+    switch (op) {
+    case 0xC0: val->type = FROST_NULL; return FROST_PARSE_OK;
+    case 0xC2: val->type = FROST_FALSE; return FROST_PARSE_OK;
+    case 0xC3: val->type = FROST_TRUE; return FROST_PARSE_OK;
+    case 0xCC: case 0xD0: n = 1; break;
+    case 0xCD: case 0xD1: case 0xDC: case 0xDE: n = 2; break;
+    case 0xCE: case 0xD2: case 0xCA: case 0xDD: case 0xDF: n = 4; break;
+    case 0xCF: case 0xD3: case 0xCB: n = 8; break;
+    default:
+        return FROST_PARSE_INVALID_VALUE; /* ext 等不支持的类型 */
+    }
+    if (!frost_cursor_need(cur, n))
+        return FROST_PARSE_INVALID_VALUE;
+    len = frost_cursor_get_be(cur, n);
+    switch (op) {
+    case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+        frost_set_uint64(val, len);
+        return FROST_PARSE_OK;
+    case 0xD0: frost_set_int64(val, (int8_t)len); return FROST_PARSE_OK;
+    case 0xD1: frost_set_int64(val, (int16_t)len); return FROST_PARSE_OK;
+    case 0xD2: frost_set_int64(val, (int32_t)len); return FROST_PARSE_OK;
+    case 0xD3: frost_set_int64(val, (int64_t)len); return FROST_PARSE_OK;
+    case 0xCA: return frost_binary_set_double(val, frost_bits_float((uint32_t)len));
+    case 0xCB: return frost_binary_set_double(val, frost_bits_double(len));
+    case 0xDC: case 0xDD:
+        return frost_msgpack_decode_array(cur, val, len);
+    default:
+        return frost_msgpack_decode_object(cur, val, len);
+    }
+}
+
+static auto frost_binary_decode(frost_value* val, const char* data, size_t length, int (*decode)(frost_reader_cursor*, frost_value*)) -> int
+{
+    frost_reader_cursor cur;
+    int ret = 0;
+    assert(val != nullptr && (data != nullptr || length == 0));
+    cur.cur = (const unsigned char*)data;
+    cur.end = cur.cur + length;
+    cur.depth = 0;
+    frost_init(val);
+    ret = decode(&cur, val);
+    if (ret == FROST_PARSE_OK && cur.cur != cur.end)
+        ret = FORST_PARSE_ROOT_NOT_SINGULAR;
+    if (ret != FROST_PARSE_OK)
+        frost_free(val);
+    return ret;
+}
+
+auto frost_decode_msgpack(frost_value* val, const char* data, size_t length) -> int
+{
+    return frost_binary_decode(val, data, length, frost_msgpack_decode_value);
+}
+
+/* ---------------- CBOR (RFC 8949) ---------------- */
+
+static void frost_cbor_put_head(frost_buffer* buf, unsigned major, uint64_t arg)
+{
+    major <<= 5;
+    if (arg < 24)
+        frost_buffer_putc(buf, major | (unsigned)arg);
+    else if (arg <= 0xFF) {
+        frost_buffer_putc(buf, major | 24);
+        frost_buffer_put_be(buf, arg, 1);
+    } else if (arg <= 0xFFFF) {
+        frost_buffer_putc(buf, major | 25);
+        frost_buffer_put_be(buf, arg, 2);
+    } else if (arg <= 0xFFFFFFFFu) {
+        frost_buffer_putc(buf, major | 26);
+        frost_buffer_put_be(buf, arg, 4);
+    } else {
+        frost_buffer_putc(buf, major | 27);
+        frost_buffer_put_be(buf, arg, 8);
+    }
+}
+
+static void frost_cbor_put_string(frost_buffer* buf, const char* str, size_t len)
+{
+    frost_cbor_put_head(buf, 3, len);
+    if (len > 0)
+        memcpy(frost_buffer_push(buf, len), str, len);
+}
+
+static void frost_cbor_put_number(frost_buffer* buf, double num)
+{
+    if (frost_double_is_int64(num)) {
+        auto inum = (int64_t)num;
+        if (inum >= 0)
+            frost_cbor_put_head(buf, 0, (uint64_t)inum);
+        else
+            frost_cbor_put_head(buf, 1, (uint64_t)(-1 - inum));
+    } else if (frost_double_is_float(num)) {
+        frost_buffer_putc(buf, 0xFA);
+        frost_buffer_put_be(buf, frost_float_bits((float)num), 4);
+    } else {
+        frost_buffer_putc(buf, 0xFB);
+        frost_buffer_put_be(buf, frost_double_bits(num), 8);
+    }
+}
+
+static void frost_cbor_encode_value(frost_buffer* buf, const frost_value* val)
+{
+    size_t i = 0;
+    unsigned kind = 0;
+    switch (val->type) {
+    case FROST_NULL:
+        frost_buffer_putc(buf, 0xF6);
+        break;
+    case FROST_FALSE:
+        frost_buffer_putc(buf, 0xF4);
+        break;
+    case FROST_TRUE:
+        frost_buffer_putc(buf, 0xF5);
+        break;
+    case FROST_NUMBER:
+        kind = frost_get_number_kind(val);
+        if (kind == FROST_FLAG_INT64 && val->u.i64 >= 0)
+            frost_cbor_put_head(buf, 0, (uint64_t)val->u.i64);
+        else if (kind == FROST_FLAG_INT64)
+            frost_cbor_put_head(buf, 1, (uint64_t)(-1 - val->u.i64));
+        else if (kind == FROST_FLAG_UINT64)
+            frost_cbor_put_head(buf, 0, val->u.u64);
+        else
+            frost_cbor_put_number(buf, val->u.n);
+        break;
+    case FROST_STRING:
+        frost_cbor_put_string(buf, val->u.s.s, val->u.s.len);
+        break;
+    case FROST_ARRAY:
+        frost_cbor_put_head(buf, 4, val->u.a.size);
+        for (i = 0; i < val->u.a.size; i++)
+            frost_cbor_encode_value(buf, &val->u.a.e[i]);
+        break;
+    case FROST_OBJECT:
+        frost_cbor_put_head(buf, 5, val->u.o.size);
+        for (i = 0; i < val->u.o.size; i++) {
+            frost_cbor_put_string(buf, val->u.o.m[i].k, val->u.o.m[i].klen);
+            frost_cbor_encode_value(buf, &val->u.o.m[i].v);
+        }
+        break;
+    default:
+        assert(0 && "invalid type");
+    }
+}
+
+auto frost_encode_cbor(const frost_value* val, size_t* length) -> char*
+{
+    frost_buffer buf = { nullptr, 0, 0, 0 };
+    assert(val != nullptr);
+    frost_cbor_encode_value(&buf, val);
+    return frost_buffer_finish(&buf, length);
+}
+
+static auto frost_half_to_double(unsigned half) -> double
+{
+    unsigned exp = (half >> 10) & 0x1F;
+    unsigned mant = half & 0x3FF;
+    double num = 0.0;
+    if (exp == 0)
+        num = ldexp(mant, -24);
+    else if (exp != 31)
+        num = ldexp(mant + 1024, (int)exp - 25);
+    else
+        num = mant == 0 ? HUGE_VAL : NAN;
+    return (half & 0x8000) != 0 ? -num : num;
+}
+
+/* 读取数据项头部; 不定长 (additional info 31) 不支持 */
+static auto frost_cbor_get_head(frost_reader_cursor* cur, unsigned* major, uint64_t* arg) -> int
+{
+    unsigned info = 0;
+    size_t n = 0;
+    if (!frost_cursor_need(cur, 1))
+        return 0;
+    *major = *cur->cur >> 5;
+    info = *cur->cur++ & 0x1F;
+    if (info < 24) {
+        *arg = info;
+        return 1;
+    }
+    switch (info) {
+    case 24: n = 1; break;
+    case 25: n = 2; break;
+    case 26: n = 4; break;
+    case 27: n = 8; break;
+    default:
+        return 0;
+    }
+    if (!frost_cursor_need(cur, n))
+        return 0;
+    *arg = frost_cursor_get_be(cur, n);
+    /* major 7 需要区分 half/float/double, 借用 info 传回宽度 */
+    if (*major == 7)
+        *major = 7 | (info << 3);
+    return 1;
+}
+
+static auto frost_cbor_decode_value(frost_reader_cursor* cur, frost_value* val) -> int
+{
+    unsigned major = 0;
+    uint64_t arg = 0;
+    int ret = 0;
+    /* tag (major 6): 忽略标签, 解码其内容; 连续的标签循环跳过, 不消耗栈 */
+    do {
+        if (!frost_cbor_get_head(cur, &major, &arg))
+            return FROST_PARSE_INVALID_VALUE;
+    } while (major == 6);
+    switch (major) {
+    case 0:
+        frost_set_uint64(val, arg);
+        return FROST_PARSE_OK;
+    case 1:
+        /* -1 - arg; 小于 INT64_MIN 时只能近似为 double */
+        if (arg <= (uint64_t)INT64_MAX)
+            frost_set_int64(val, -1 - (int64_t)arg);
+        else
+            frost_set_number(val, -1.0 - (double)arg);
+        return FROST_PARSE_OK;
+    case 2:
+    case 3:
+        if (!frost_cursor_need(cur, arg))
+            return FROST_PARSE_INVALID_VALUE;
+        frost_set_string(val, (const char*)cur->cur, (size_t)arg);
+        cur->cur += arg;
+        return FROST_PARSE_OK;
+    case 4:
+        if ((ret = frost_binary_set_array(cur, val, arg)) != FROST_PARSE_OK)
+            return ret;
+        for (uint64_t i = 0; i < arg; i++) {
+            frost_value* elem = &val->u.a.e[val->u.a.size++];
+            frost_init(elem);
+            if ((ret = frost_cbor_decode_value(cur, elem)) != FROST_PARSE_OK)
+                return ret;
+        }
+        cur->depth--;
+        return FROST_PARSE_OK;
+    case 5:
+        if ((ret = frost_binary_set_object(cur, val, arg)) != FROST_PARSE_OK)
+            return ret;
+        for (uint64_t i = 0; i < arg; i++) {
+            frost_member* mem = &val->u.o.m[val->u.o.size];
+            uint64_t klen = 0;
+            if (!frost_cbor_get_head(cur, &major, &klen))
+                return FROST_PARSE_INVALID_VALUE;
+            if (major != 3)
+                return FROST_PARSE_MISS_KEY;
+            if (!frost_cursor_need(cur, klen))
+                return FROST_PARSE_INVALID_VALUE;
+            mem->klen = (size_t)klen;
+            mem->k = (char*)malloc(mem->klen + 1);
+            memcpy(mem->k, cur->cur, mem->klen);
+            mem->k[mem->klen] = '\0';
+            cur->cur += klen;
+            frost_init(&mem->v);
+            ret = frost_cbor_decode_value(cur, &mem->v);
+            val->u.o.size++;
+            if (ret != FROST_PARSE_OK)
+                return ret;
+        }
+        cur->depth--;
+        return FROST_PARSE_OK;
+    case 7:
+        switch (arg) {
+        case 20: val->type = FROST_FALSE; return FROST_PARSE_OK;
+        case 21: val->type = FROST_TRUE; return FROST_PARSE_OK;
+        case 22: case 23: val->type = FROST_NULL; return FROST_PARSE_OK;
+        default: return FROST_PARSE_INVALID_VALUE;
+        }
+    case 7 | (25 << 3):
+        return frost_binary_set_double(val, frost_half_to_double((unsigned)arg));
+    case 7 | (26 << 3):
+        return frost_binary_set_double(val, frost_bits_float((uint32_t)arg));
+    case 7 | (27 << 3):
+        return frost_binary_set_double(val, frost_bits_double(arg));
+    default:
+        return FROST_PARSE_INVALID_VALUE;
+    }
+}
+
+auto frost_decode_cbor(frost_value* val, const char* data, size_t length) -> int
+{
+    return frost_binary_decode(val, data, length, frost_cbor_decode_value);
+}
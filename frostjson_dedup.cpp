@@ -0,0 +1,322 @@
+#include "frostjson.h"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * 相同子树去重 (hash-consing)
+ *
+ * 第一遍自底向上算出每棵子树的结构哈希 (按后序记下), 统计每种子树 (字符串与非空容器)
+ * 出现的次数; 节点中不存放哈希, 按后序记下后整棵树只需走一遍. 第二遍同样后序遍历, 依次取用哈希,
+ * 出现不止一次的子树在表中查找与之逐项相同 (对象成员顺序也相同) 的代表: 找到则释放
+ * 自身, 改为引用代表的共享块; 否则用 frost_share 把自身转为共享节点, 作为代表登记.
+ * 子值先于父节点处理, 比较父节点时相同的子值已经引用同一共享块, 通常只需比较指针.
+ *
+ * 哈希只用来分组, 是否合并总是由逐项比较决定, 因此哈希碰撞不会合并不同的值.
+ */
+
+using frost_dedup_entry = struct {
+    uint64_t hash;
+    size_t count;           /* 第一遍统计的出现次数; 只登记代表的附加项为 0 */
+    frost_value canon;      /* 代表, 持有一个引用; FROST_NULL 表示尚无 */
+    int used;
+};
+
+using frost_dedup_context = struct {
+    frost_dedup_entry* e;
+    size_t mask;
+    uint64_t* hash;         /* 候选节点的哈希, 按后序排列 */
+    size_t top, next;
+    size_t saved;           /* 释放的重复内容 */
+    size_t overhead;        /* 转为共享节点多占用的内存 */
+};
+
+static auto frost_dedup_candidate(const frost_value* val) -> int
+{
+    switch (val->type) {
+    case FROST_STRING: return 1;
+    case FROST_ARRAY:  return val->u.a.size > 0;
+    case FROST_OBJECT: return val->u.o.size > 0;
+    default:           return 0;
+    }
+}
+
+static auto frost_dedup_count_nodes(const frost_value* val) -> size_t
+{
+    size_t i, n = 0;
+    if ((val->flags & FROST_FLAG_SHARED) == 0) {
+        if (val->type == FROST_ARRAY)
+            for (i = 0; i < val->u.a.size; i++)
+                n += frost_dedup_count_nodes(&val->u.a.e[i]);
+        else if (val->type == FROST_OBJECT)
+            for (i = 0; i < val->u.o.size; i++)
+                n += frost_dedup_count_nodes(&val->u.o.m[i].v);
+    }
+    return n + frost_dedup_candidate(val);
+}
+
+/* 第一个哈希相同的项, 没有则返回空位 */
+static auto frost_dedup_slot(const frost_dedup_context* ctx, uint64_t hash) -> frost_dedup_entry*
+{
+    size_t i = (size_t)(hash ^ (hash >> 32)) & ctx->mask;
+    while (ctx->e[i].used != 0 && ctx->e[i].hash != hash)
+        i = (i + 1) & ctx->mask;
+    return &ctx->e[i];
+}
+
+static inline auto frost_dedup_mix(uint64_t h, uint64_t k) -> uint64_t
+{
+    h = (h ^ k) * 0xff51afd7ed558ccdull;
+    return h ^ (h >> 32);
+}
+
+static auto frost_dedup_key_hash(const char* key, size_t klen) -> uint64_t
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < klen; i++)
+        h = (h ^ (unsigned char)key[i]) * 0x100000001b3ull;
+    return h;
+}
+
+/*
+ * 返回子树的结构哈希: 数组与对象都按成员顺序组合, 与 frost_dedup_same 的判定一致, 标量沿用 frost_hash.
+ * record 非 0 时把候选节点的哈希按后序记入 ctx->hash 并计数; 已有的共享节点只记录自身
+ */
+static auto frost_dedup_count(frost_dedup_context* ctx, const frost_value* val, int record) -> uint64_t
+{
+    size_t i;
+    uint64_t hash;
+    int inner = record != 0 && (val->flags & FROST_FLAG_SHARED) == 0;
+    frost_dedup_entry* ent = nullptr;
+    switch (val->type) {
+    case FROST_ARRAY:
+        hash = 0x2127599bf4325c37ull;
+        for (i = 0; i < val->u.a.size; i++)
+            hash = frost_dedup_mix(hash, frost_dedup_count(ctx, &val->u.a.e[i], inner));
+        hash = frost_dedup_mix(hash, val->u.a.size);
+        break;
+    case FROST_OBJECT:
+        hash = 0x6c8e9cf570932bd5ull;
+        for (i = 0; i < val->u.o.size; i++) {
+            hash = frost_dedup_mix(hash, frost_dedup_key_hash(val->u.o.m[i].k, val->u.o.m[i].klen));
+            hash = frost_dedup_mix(hash, frost_dedup_count(ctx, &val->u.o.m[i].v, inner));
+        }
+        hash = frost_dedup_mix(hash, val->u.o.size);
+        break;
+    default:
+        hash = frost_hash(val);
+        break;
+    }
+    if (record == 0 || frost_dedup_candidate(val) == 0)
+        return hash;
+    ctx->hash[ctx->top++] = hash;
+    ent = frost_dedup_slot(ctx, hash);
+    if (ent->used == 0) {
+        ent->used = 1;
+        ent->hash = hash;
+    }
+    ent->count++;
+    return hash;
+}
+
+/* 延迟数字按源文本比较, 合并后输出不变; 其余按表示与位模式比较, 以免 0.0 与 -0.0 合并 */
+static auto frost_dedup_same_number(const frost_value* lhs, const frost_value* rhs) -> int
+{
+    size_t llen = 0;
+    size_t rlen = 0;
+    const char* l = frost_get_number_text(lhs, &llen);
+    const char* r = frost_get_number_text(rhs, &rlen);
+    if (l != nullptr || r != nullptr)
+        return l != nullptr && r != nullptr && llen == rlen && memcmp(l, r, llen) == 0;
+    return (lhs->flags & FROST_FLAG_INTEGER) == (rhs->flags & FROST_FLAG_INTEGER)
+        && memcmp(&lhs->u.n, &rhs->u.n, sizeof(double)) == 0;
+}
+
+/* 逐项比较; 子值引用同一共享块时直接判定相同 */
+static auto frost_dedup_same(const frost_value* lhs, const frost_value* rhs) -> int
+{
+    size_t i;
+    if (lhs->type != rhs->type)
+        return 0;
+    switch (lhs->type) {
+    case FROST_NUMBER:
+        return frost_dedup_same_number(lhs, rhs);
+    case FROST_STRING:
+        if ((lhs->flags & rhs->flags & FROST_FLAG_SHARED) != 0 && lhs->u.s.s == rhs->u.s.s)
+            return 1;
+        return lhs->u.s.len == rhs->u.s.len && memcmp(lhs->u.s.s, rhs->u.s.s, lhs->u.s.len) == 0;
+    case FROST_ARRAY:
+        if ((lhs->flags & rhs->flags & FROST_FLAG_SHARED) != 0 && lhs->u.a.e == rhs->u.a.e)
+            return 1;
+        if (lhs->u.a.size != rhs->u.a.size)
+            return 0;
+        for (i = 0; i < lhs->u.a.size; i++)
+            if (frost_dedup_same(&lhs->u.a.e[i], &rhs->u.a.e[i]) == 0)
+                return 0;
+        return 1;
+    case FROST_OBJECT:
+        if ((lhs->flags & rhs->flags & FROST_FLAG_SHARED) != 0 && lhs->u.o.m == rhs->u.o.m)
+            return 1;
+        if (lhs->u.o.size != rhs->u.o.size)
+            return 0;
+        for (i = 0; i < lhs->u.o.size; i++) {
+            const frost_member* l = &lhs->u.o.m[i];
+            const frost_member* r = &rhs->u.o.m[i];
+            if (l->klen != r->klen || memcmp(l->k, r->k, l->klen) != 0 || frost_dedup_same(&l->v, &r->v) == 0)
+                return 0;
+        }
+        return 1;
+    default:
+        return 1;
+    }
+}
+
+/* 独占 (非共享) 部分占用的堆内存 */
+static auto frost_dedup_owned(const frost_value* val) -> size_t
+{
+    size_t i, n = 0;
+    if ((val->flags & FROST_FLAG_SHARED) != 0)
+        return 0;
+    switch (val->type) {
+    case FROST_STRING:
+        return val->u.s.len + 1;
+    case FROST_ARRAY:
+        n = val->u.a.capacity * sizeof(frost_value);
+        for (i = 0; i < val->u.a.size; i++)
+            n += frost_dedup_owned(&val->u.a.e[i]);
+        return n;
+    case FROST_OBJECT:
+        n = val->u.o.capacity * sizeof(frost_member);
+        for (i = 0; i < val->u.o.size; i++)
+            n += val->u.o.m[i].klen + 1 + frost_dedup_owned(&val->u.o.m[i].v);
+        return n;
+    default:
+        return 0;
+    }
+}
+
+/* 独占部分经 frost_share 转为共享节点后占用的堆内存 */
+static auto frost_dedup_shared_size(const frost_value* val) -> size_t
+{
+    size_t i, n = 0;
+    if ((val->flags & FROST_FLAG_SHARED) != 0)
+        return 0;
+    switch (val->type) {
+    case FROST_STRING:
+        return frost_shared_block_size(val->u.s.len + 1);
+    case FROST_ARRAY:
+        if (val->u.a.size == 0)
+            return val->u.a.capacity * sizeof(frost_value);
+        n = frost_shared_block_size(val->u.a.size * sizeof(frost_value));
+        for (i = 0; i < val->u.a.size; i++)
+            n += frost_dedup_shared_size(&val->u.a.e[i]);
+        return n;
+    case FROST_OBJECT:
+        if (val->u.o.size == 0)
+            return val->u.o.capacity * sizeof(frost_member);
+        n = frost_shared_block_size(val->u.o.size * sizeof(frost_member));
+        for (i = 0; i < val->u.o.size; i++)
+            n += val->u.o.m[i].klen + 1 + frost_dedup_shared_size(&val->u.o.m[i].v);
+        return n;
+    default:
+        return 0;
+    }
+}
+
+/* 查找与 val 相同的代表; 没有则把 val 登记为代表 (此时 val 必须已是共享节点) */
+static auto frost_dedup_lookup(frost_dedup_context* ctx, const frost_value* val, uint64_t hash, int insert) -> const frost_value*
+{
+    size_t i = (size_t)(hash ^ (hash >> 32)) & ctx->mask;
+    frost_dedup_entry* slot = nullptr;
+    for (; ctx->e[i].used != 0; i = (i + 1) & ctx->mask) {
+        frost_dedup_entry* ent = &ctx->e[i];
+        if (ent->hash != hash)
+            continue;
+        if (ent->canon.type == FROST_NULL) {
+            if (slot == nullptr)
+                slot = ent;
+        } else if (frost_dedup_same(val, &ent->canon) != 0)
+            return &ent->canon;
+    }
+    if (insert != 0) {
+        assert((val->flags & FROST_FLAG_SHARED) != 0);
+        if (slot == nullptr) {
+            slot = &ctx->e[i];
+            slot->used = 1;
+            slot->hash = hash;
+        }
+        frost_copy(&slot->canon, val);
+    }
+    return nullptr;
+}
+
+static void frost_dedup_value(frost_dedup_context* ctx, frost_value* val)
+{
+    size_t i, owned, shared;
+    uint64_t hash;
+    const frost_value* canon = nullptr;
+    if (frost_dedup_candidate(val) == 0)
+        return;
+    /* 已有的共享节点不再展开, 只作为代表供后面的重复值引用 */
+    if ((val->flags & FROST_FLAG_SHARED) != 0) {
+        hash = ctx->hash[ctx->next++];
+        if (frost_dedup_slot(ctx, hash)->count > 1)
+            frost_dedup_lookup(ctx, val, hash, 1);
+        return;
+    }
+    if (val->type == FROST_ARRAY)
+        for (i = 0; i < val->u.a.size; i++)
+            frost_dedup_value(ctx, &val->u.a.e[i]);
+    else if (val->type == FROST_OBJECT)
+        for (i = 0; i < val->u.o.size; i++)
+            frost_dedup_value(ctx, &val->u.o.m[i].v);
+    /* 子值的哈希都已取用, 下一个就是自身的 */
+    hash = ctx->hash[ctx->next++];
+    if (frost_dedup_slot(ctx, hash)->count < 2)
+        return;
+    if ((canon = frost_dedup_lookup(ctx, val, hash, 0)) != nullptr) {
+        ctx->saved += frost_dedup_owned(val);
+        frost_copy(val, canon);
+        return;
+    }
+    /* 共享块头的开销超过可能节省的内存时 (例如很短的字符串) 不共享 */
+    owned = frost_dedup_owned(val);
+    shared = frost_dedup_shared_size(val);
+    if (frost_dedup_slot(ctx, hash)->count * owned <= shared)
+        return;
+    if (shared > owned)
+        ctx->overhead += shared - owned;
+    else
+        ctx->saved += owned - shared;
+    frost_share(val);
+    frost_dedup_lookup(ctx, val, hash, 1);
+}
+
+auto frost_dedup(frost_value* val) -> size_t
+{
+    frost_dedup_context ctx;
+    size_t i, n, size = 16;
+    assert(val != nullptr && (val->flags & FROST_FLAG_FROZEN) == 0);
+    n = frost_dedup_count_nodes(val);
+    if (n < 2)
+        return 0;
+    /* 每个节点最多占一项, 另有同一哈希下成员顺序不同的代表 */
+    while (size < 4 * n)
+        size <<= 1;
+    ctx.e = (frost_dedup_entry*)calloc(size, sizeof(frost_dedup_entry));
+    ctx.mask = size - 1;
+    ctx.hash = (uint64_t*)malloc(n * sizeof(uint64_t));
+    ctx.top = ctx.next = 0;
+    ctx.saved = ctx.overhead = 0;
+    for (i = 0; i < size; i++)
+        frost_init(&ctx.e[i].canon);
+    frost_dedup_count(&ctx, val, 1);
+    assert(ctx.top == n);
+    frost_dedup_value(&ctx, val);
+    assert(ctx.next == n);
+    for (i = 0; i < size; i++)
+        frost_free(&ctx.e[i].canon);
+    free(ctx.hash);
+    free(ctx.e);
+    return ctx.saved > ctx.overhead ? ctx.saved - ctx.overhead : 0;
+}
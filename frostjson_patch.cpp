@@ -0,0 +1,662 @@
+#include "frostjson.h"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * JSON Pointer (RFC 6901), JSON Patch (RFC 6902) 与 JSON Merge Patch (RFC 7396).
+ *
+ * 补丁直接在文档上原地执行. 每个操作对文档的改动都记入撤销日志: 被替换或删除的值
+ * (连同对象成员的键) 以 frost_move 的方式移入日志而不是复制, 因此执行与回滚的代价
+ * 只与补丁本身 (以及 copy 复制的子树) 有关, 与文档大小无关. 任一操作失败时按逆序
+ * 撤销已执行的操作, 文档恢复原状.
+ *
+ * 容器在执行过程中可能扩容搬迁, 日志因此不保存节点指针, 而保存父节点的 JSON Pointer
+ * (指向补丁中的字符串), 撤销时重新定位.
+ *
+ * frost_diff 反向生成补丁: 两侧引用同一共享块的子树直接跳过; 数组两端相同的元素用
+ * frost_is_equal 剥去, 其余部分逐层展开, 只有发生变化的路径才会产生操作.
+ */
+
+#ifndef FROST_PATCH_LOG_INIT_SIZE
+#define FROST_PATCH_LOG_INIT_SIZE 16
+#endif
+
+enum {
+    FROST_UNDO_RESTORE,         /* 原位置的值被替换: 放回旧值 */
+    FROST_UNDO_REMOVE_MEMBER,   /* 新增了对象成员: 删除 */
+    FROST_UNDO_INSERT_MEMBER,   /* 删除了对象成员: 插回原下标 */
+    FROST_UNDO_ERASE_ELEMENT,   /* 插入了数组元素: 删除 */
+    FROST_UNDO_INSERT_ELEMENT   /* 删除了数组元素: 插回原下标 */
+};
+
+using frost_patch_undo = struct {
+    int kind;
+    int carry;          /* move 操作: 撤销时值在目的地与源之间转交, 不释放也不取日志中的值 */
+    const char* path;   /* RESTORE 为目标路径, 其余为父节点路径 */
+    size_t plen;
+    size_t index;
+    frost_member mem;   /* 被移出的值; 对象成员同时保存键 */
+};
+
+using frost_patch_context = struct {
+    frost_value* doc;
+    frost_patch_undo* log;
+    size_t size, top;
+    char* key;          /* 解码后的引用标记 */
+    size_t ksize;
+    frost_value carry;
+    int read_only;      /* frost_find_pointer_value: 只读定位, 沿途不取得独占 */
+};
+
+/* 取出 ptr[*pos..] 处的下一个引用标记 (*pos 指向 '/' 之后), 解码 ~0 ~1 */
+static auto frost_pointer_token(frost_patch_context* ctx, const char* ptr, size_t len, size_t* pos, size_t* klen) -> int
+{
+    size_t i = *pos;
+    size_t n = 0;
+    if (ctx->key == nullptr) {
+        ctx->ksize = 32;
+        ctx->key = (char*)malloc(ctx->ksize);
+    }
+    while (i < len && ptr[i] != '/') {
+        if (n + 1 > ctx->ksize) {
+            ctx->ksize *= 2;
+            ctx->key = (char*)realloc(ctx->key, ctx->ksize);
+        }
+        if (ptr[i] == '~') {
+            if (i + 1 >= len || (ptr[i + 1] != '0' && ptr[i + 1] != '1'))
+                return FROST_PATCH_INVALID;
+            ctx->key[n++] = ptr[i + 1] == '0' ? '~' : '/';
+            i += 2;
+        } else
+            ctx->key[n++] = ptr[i++];
+    }
+    *pos = i;
+    *klen = n;
+    return FROST_PATCH_OK;
+}
+
+/* 数组下标: 不允许前导 0; "-" 表示末尾之后, 仅 add 可用 */
+static auto frost_pointer_index(const char* key, size_t klen, size_t size, int append, size_t* index) -> int
+{
+    size_t n = 0;
+    if (klen == 1 && key[0] == '-') {
+        if (append == 0)
+            return FROST_PATCH_PATH_NOT_FOUND;
+        *index = size;
+        return FROST_PATCH_OK;
+    }
+    if (klen == 0 || (klen > 1 && key[0] == '0'))
+        return FROST_PATCH_INVALID;
+    for (size_t i = 0; i < klen; i++) {
+        if (key[i] < '0' || key[i] > '9')
+            return FROST_PATCH_INVALID;
+        if (n > (size_t)-1 / 10)
+            return FROST_PATCH_PATH_NOT_FOUND;
+        n = n * 10 + (size_t)(key[i] - '0');
+    }
+    if (n > size || (n == size && append == 0))
+        return FROST_PATCH_PATH_NOT_FOUND;
+    *index = n;
+    return FROST_PATCH_OK;
+}
+
+/*
+ * 返回的节点可能被修改: 沿途的共享容器先取得独占. 与 frost_mutable_object_value 等相同,
+ * 紧凑块中的节点留在原处, 冻结的值只供读取, 保持不变
+ */
+static void frost_pointer_touch(frost_value* val)
+{
+    if (val->type == FROST_OBJECT && val->u.o.size > 0)
+        frost_mutable_object_value(val, 0);
+    else if (val->type == FROST_ARRAY && val->u.a.size > 0)
+        frost_mutable_array_element(val, 0);
+}
+
+/* 逐个标记向下定位, 结果存入 *out */
+static auto frost_pointer_resolve(frost_patch_context* ctx, frost_value* val, const char* ptr, size_t len, frost_value** out) -> int
+{
+    size_t pos = 0;
+    if (len > 0 && ptr[0] != '/')
+        return FROST_PATCH_INVALID;
+    while (pos < len) {
+        size_t klen = 0;
+        size_t index = 0;
+        int ret = 0;
+        pos++;
+        if ((ret = frost_pointer_token(ctx, ptr, len, &pos, &klen)) != FROST_PATCH_OK)
+            return ret;
+        if (ctx->read_only == 0)
+            frost_pointer_touch(val);
+        if (val->type == FROST_OBJECT) {
+            if ((index = frost_find_object_index(val, ctx->key, klen)) == FROST_KEY_NOT_EXIST)
+                return FROST_PATCH_PATH_NOT_FOUND;
+            val = &val->u.o.m[index].v;
+        } else if (val->type == FROST_ARRAY) {
+            if ((ret = frost_pointer_index(ctx->key, klen, val->u.a.size, 0, &index)) != FROST_PATCH_OK)
+                return ret;
+            val = &val->u.a.e[index];
+        } else
+            return FROST_PATCH_PATH_NOT_FOUND;
+    }
+    if (ctx->read_only == 0)
+        frost_pointer_touch(val);
+    *out = val;
+    return FROST_PATCH_OK;
+}
+
+/* 定位父节点, 并把最后一个标记解码到 ctx->key; *plen 为父节点路径长度 */
+static auto frost_pointer_resolve_parent(frost_patch_context* ctx, const char* ptr, size_t len, frost_value** parent, size_t* plen, size_t* klen) -> int
+{
+    size_t pos = len;
+    int ret = 0;
+    assert(len > 0);
+    while (ptr[pos - 1] != '/')
+        if (--pos == 0)
+            return FROST_PATCH_INVALID;
+    *plen = pos - 1;
+    if ((ret = frost_pointer_resolve(ctx, ctx->doc, ptr, *plen, parent)) != FROST_PATCH_OK)
+        return ret;
+    return frost_pointer_token(ctx, ptr, len, &pos, klen);
+}
+
+auto frost_find_pointer_value(frost_value* val, const char* pointer, size_t len) -> frost_value*
+{
+    frost_patch_context ctx;
+    frost_value* ret = nullptr;
+    assert(val != nullptr && (pointer != nullptr || len == 0));
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.read_only = 1;
+    if (frost_pointer_resolve(&ctx, val, pointer, len, &ret) != FROST_PATCH_OK)
+        ret = nullptr;
+    free(ctx.key);
+    return ret;
+}
+
+static auto frost_patch_log(frost_patch_context* ctx, int kind, const char* path, size_t plen, size_t index) -> frost_patch_undo*
+{
+    frost_patch_undo* undo = nullptr;
+    if (ctx->top == ctx->size) {
+        ctx->size = ctx->size == 0 ? FROST_PATCH_LOG_INIT_SIZE : ctx->size * 2;
+        ctx->log = (frost_patch_undo*)realloc(ctx->log, ctx->size * sizeof(frost_patch_undo));
+    }
+    undo = &ctx->log[ctx->top++];
+    undo->kind = kind;
+    undo->carry = 0;
+    undo->path = path;
+    undo->plen = plen;
+    undo->index = index;
+    undo->mem.k = nullptr;
+    undo->mem.klen = 0;
+    frost_init(&undo->mem.v);
+    return undo;
+}
+
+/* 取下对象成员 (键与值一并移出), 后面的成员前移; 紧凑块中的键不能单独取下, 先把这一层复制出来 */
+static void frost_patch_detach_member(frost_value* obj, size_t index, frost_member* mem)
+{
+    frost_unshare(obj);
+    memcpy(mem, &obj->u.o.m[index], sizeof(frost_member));
+    memmove(obj->u.o.m + index, obj->u.o.m + index + 1, (obj->u.o.size - index - 1) * sizeof(frost_member));
+    obj->u.o.size--;
+}
+
+static void frost_patch_attach_member(frost_value* obj, size_t index, frost_member* mem)
+{
+    assert(index <= obj->u.o.size);
+    frost_unshare(obj);
+    if (obj->u.o.size == obj->u.o.capacity)
+        frost_reserve_object(obj, obj->u.o.capacity == 0 ? 1 : obj->u.o.capacity * 2);
+    memmove(obj->u.o.m + index + 1, obj->u.o.m + index, (obj->u.o.size - index) * sizeof(frost_member));
+    memcpy(&obj->u.o.m[index], mem, sizeof(frost_member));
+    obj->u.o.size++;
+    mem->k = nullptr;
+    frost_init(&mem->v);
+}
+
+/* 把 *val 移入 path 处 (add 语义: 对象成员已存在则替换, 数组则插入) */
+static auto frost_patch_add(frost_patch_context* ctx, const char* path, size_t len, frost_value* val, int carry) -> int
+{
+    frost_value* parent = nullptr;
+    frost_patch_undo* undo = nullptr;
+    size_t plen = 0;
+    size_t klen = 0;
+    size_t index = 0;
+    int ret = 0;
+    if (len == 0) {
+        undo = frost_patch_log(ctx, FROST_UNDO_RESTORE, path, 0, 0);
+        frost_move(&undo->mem.v, ctx->doc);
+        frost_move(ctx->doc, val);
+        undo->carry = carry;
+        return FROST_PATCH_OK;
+    }
+    if ((ret = frost_pointer_resolve_parent(ctx, path, len, &parent, &plen, &klen)) != FROST_PATCH_OK)
+        return ret;
+    if (parent->type == FROST_OBJECT) {
+        if ((index = frost_find_object_index(parent, ctx->key, klen)) != FROST_KEY_NOT_EXIST) {
+            undo = frost_patch_log(ctx, FROST_UNDO_RESTORE, path, len, 0);
+            frost_move(&undo->mem.v, &parent->u.o.m[index].v);
+            frost_move(&parent->u.o.m[index].v, val);
+        } else {
+            /* 有序对象把新键插入到有序位置, 撤销时按实际下标删除 */
+            frost_move(frost_set_object_value(parent, ctx->key, klen), val);
+            index = frost_find_object_index(parent, ctx->key, klen);
+            undo = frost_patch_log(ctx, FROST_UNDO_REMOVE_MEMBER, path, plen, index);
+        }
+    } else if (parent->type == FROST_ARRAY) {
+        if ((ret = frost_pointer_index(ctx->key, klen, parent->u.a.size, 1, &index)) != FROST_PATCH_OK)
+            return ret;
+        frost_move(frost_insert_array_element(parent, index), val);
+        undo = frost_patch_log(ctx, FROST_UNDO_ERASE_ELEMENT, path, plen, index);
+    } else
+        return FROST_PATCH_PATH_NOT_FOUND;
+    undo->carry = carry;
+    return FROST_PATCH_OK;
+}
+
+/* 从 path 处移除值; out 非空时把值交给调用者 (move), 否则留在日志中以便撤销 */
+static auto frost_patch_remove(frost_patch_context* ctx, const char* path, size_t len, frost_value* out) -> int
+{
+    frost_value* parent = nullptr;
+    frost_patch_undo* undo = nullptr;
+    size_t plen = 0;
+    size_t klen = 0;
+    size_t index = 0;
+    int ret = 0;
+    if (len == 0)
+        return FROST_PATCH_INVALID;
+    if ((ret = frost_pointer_resolve_parent(ctx, path, len, &parent, &plen, &klen)) != FROST_PATCH_OK)
+        return ret;
+    if (parent->type == FROST_OBJECT) {
+        if ((index = frost_find_object_index(parent, ctx->key, klen)) == FROST_KEY_NOT_EXIST)
+            return FROST_PATCH_PATH_NOT_FOUND;
+        undo = frost_patch_log(ctx, FROST_UNDO_INSERT_MEMBER, path, plen, index);
+        frost_patch_detach_member(parent, index, &undo->mem);
+    } else if (parent->type == FROST_ARRAY) {
+        if ((ret = frost_pointer_index(ctx->key, klen, parent->u.a.size, 0, &index)) != FROST_PATCH_OK)
+            return ret;
+        undo = frost_patch_log(ctx, FROST_UNDO_INSERT_ELEMENT, path, plen, index);
+        frost_move(&undo->mem.v, &parent->u.a.e[index]);
+        frost_erase_array_element(parent, index, 1);
+    } else
+        return FROST_PATCH_PATH_NOT_FOUND;
+    if (out != nullptr) {
+        frost_move(out, &undo->mem.v);
+        undo->carry = 1;
+    }
+    return FROST_PATCH_OK;
+}
+
+static auto frost_patch_replace(frost_patch_context* ctx, const char* path, size_t len, frost_value* val) -> int
+{
+    frost_value* target = nullptr;
+    frost_patch_undo* undo = nullptr;
+    int ret = 0;
+    if ((ret = frost_pointer_resolve(ctx, ctx->doc, path, len, &target)) != FROST_PATCH_OK)
+        return ret;
+    undo = frost_patch_log(ctx, FROST_UNDO_RESTORE, path, len, 0);
+    frost_move(&undo->mem.v, target);
+    frost_move(target, val);
+    return FROST_PATCH_OK;
+}
+
+/* 撤销一条日志; 解析必然成功, 因为此后的改动都已撤销 */
+static void frost_patch_undo_one(frost_patch_context* ctx, frost_patch_undo* undo)
+{
+    frost_value* node = nullptr;
+    frost_member mem;
+    int ret = frost_pointer_resolve(ctx, ctx->doc, undo->path, undo->plen, &node);
+    assert(ret == FROST_PATCH_OK);
+    (void)ret;
+    switch (undo->kind) {
+    case FROST_UNDO_RESTORE:
+        if (undo->carry != 0)
+            frost_move(&ctx->carry, node);
+        frost_move(node, &undo->mem.v);
+        break;
+    case FROST_UNDO_REMOVE_MEMBER:
+        if (undo->carry != 0) {
+            frost_patch_detach_member(node, undo->index, &mem);
+            free(mem.k);
+            frost_move(&ctx->carry, &mem.v);
+        } else
+            frost_remove_object_value(node, undo->index);
+        break;
+    case FROST_UNDO_ERASE_ELEMENT:
+        if (undo->carry != 0)
+            frost_move(&ctx->carry, &node->u.a.e[undo->index]);
+        frost_erase_array_element(node, undo->index, 1);
+        break;
+    case FROST_UNDO_INSERT_MEMBER:
+        if (undo->carry != 0)
+            frost_move(&undo->mem.v, &ctx->carry);
+        frost_patch_attach_member(node, undo->index, &undo->mem);
+        break;
+    case FROST_UNDO_INSERT_ELEMENT:
+        if (undo->carry != 0)
+            frost_move(&undo->mem.v, &ctx->carry);
+        frost_move(frost_insert_array_element(node, undo->index), &undo->mem.v);
+        break;
+    default:
+        assert(0);
+    }
+}
+
+static auto frost_patch_string(const frost_value* op, const char* key, size_t klen, const char** str, size_t* len) -> int
+{
+    size_t index = frost_find_object_index(op, key, klen);
+    if (index == FROST_KEY_NOT_EXIST || op->u.o.m[index].v.type != FROST_STRING)
+        return FROST_PATCH_INVALID;
+    *str = op->u.o.m[index].v.u.s.s;
+    *len = op->u.o.m[index].v.u.s.len;
+    return FROST_PATCH_OK;
+}
+
+#define FROST_PATCH_OP_IS(op, olen, name) ((olen) == sizeof(name) - 1 && memcmp(op, name, olen) == 0)
+
+static auto frost_patch_apply_op(frost_patch_context* ctx, const frost_value* op) -> int
+{
+    const char* name = nullptr;
+    const char* path = nullptr;
+    const char* from = nullptr;
+    const frost_value* value = nullptr;
+    frost_value* node = nullptr;
+    frost_value tmp;
+    size_t nlen = 0;
+    size_t len = 0;
+    size_t flen = 0;
+    size_t index = 0;
+    int ret = 0;
+    if (op->type != FROST_OBJECT)
+        return FROST_PATCH_INVALID;
+    if (frost_patch_string(op, "op", 2, &name, &nlen) != FROST_PATCH_OK || frost_patch_string(op, "path", 4, &path, &len) != FROST_PATCH_OK)
+        return FROST_PATCH_INVALID;
+    if (len > 0 && path[0] != '/')
+        return FROST_PATCH_INVALID;
+    if ((index = frost_find_object_index(op, "value", 5)) != FROST_KEY_NOT_EXIST)
+        value = &op->u.o.m[index].v;
+    frost_init(&tmp);
+    if (FROST_PATCH_OP_IS(name, nlen, "add") || FROST_PATCH_OP_IS(name, nlen, "replace")) {
+        if (value == nullptr)
+            return FROST_PATCH_INVALID;
+        frost_copy(&tmp, value);
+        ret = name[0] == 'a' ? frost_patch_add(ctx, path, len, &tmp, 0) : frost_patch_replace(ctx, path, len, &tmp);
+    } else if (FROST_PATCH_OP_IS(name, nlen, "remove")) {
+        ret = frost_patch_remove(ctx, path, len, nullptr);
+    } else if (FROST_PATCH_OP_IS(name, nlen, "test")) {
+        if (value == nullptr)
+            return FROST_PATCH_INVALID;
+        if ((ret = frost_pointer_resolve(ctx, ctx->doc, path, len, &node)) == FROST_PATCH_OK && frost_is_equal(node, value) == 0)
+            ret = FROST_PATCH_TEST_FAILED;
+    } else if (FROST_PATCH_OP_IS(name, nlen, "move") || FROST_PATCH_OP_IS(name, nlen, "copy")) {
+        if (frost_patch_string(op, "from", 4, &from, &flen) != FROST_PATCH_OK)
+            return FROST_PATCH_INVALID;
+        if ((ret = frost_pointer_resolve(ctx, ctx->doc, from, flen, &node)) != FROST_PATCH_OK)
+            return ret;
+        if (name[0] == 'c') {
+            frost_copy(&tmp, node);
+            ret = frost_patch_add(ctx, path, len, &tmp, 0);
+        } else if (flen != len || memcmp(from, path, len) != 0) {
+            /* 不能移入自身的子节点 */
+            if (len > flen && memcmp(from, path, flen) == 0 && path[flen] == '/')
+                return FROST_PATCH_INVALID;
+            if ((ret = frost_patch_remove(ctx, from, flen, &tmp)) == FROST_PATCH_OK && (ret = frost_patch_add(ctx, path, len, &tmp, 1)) != FROST_PATCH_OK) {
+                /* 目的地无效: 值先交还给 remove 的日志, 随后由整体回滚放回原处 */
+                frost_move(&ctx->log[ctx->top - 1].mem.v, &tmp);
+                ctx->log[ctx->top - 1].carry = 0;
+            }
+        }
+    } else
+        return FROST_PATCH_INVALID;
+    frost_free(&tmp);
+    return ret;
+}
+
+auto frost_apply_patch(frost_value* doc, const frost_value* patch) -> int
+{
+    frost_patch_context ctx;
+    int ret = FROST_PATCH_OK;
+    assert(doc != nullptr && patch != nullptr && (doc->flags & FROST_FLAG_FROZEN) == 0);
+    if (patch->type != FROST_ARRAY)
+        return FROST_PATCH_INVALID;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.doc = doc;
+    frost_init(&ctx.carry);
+    for (size_t i = 0; i < patch->u.a.size && ret == FROST_PATCH_OK; i++)
+        ret = frost_patch_apply_op(&ctx, &patch->u.a.e[i]);
+    if (ret != FROST_PATCH_OK) {
+        while (ctx.top > 0)
+            frost_patch_undo_one(&ctx, &ctx.log[--ctx.top]);
+        assert(ctx.carry.type == FROST_NULL);
+    }
+    for (size_t i = 0; i < ctx.top; i++) {
+        free(ctx.log[i].mem.k);
+        frost_free(&ctx.log[i].mem.v);
+    }
+    free(ctx.log);
+    free(ctx.key);
+    return ret;
+}
+
+static void frost_merge_patch(frost_value* doc, const frost_value* patch)
+{
+    if (patch->type != FROST_OBJECT) {
+        frost_copy(doc, patch);
+        return;
+    }
+    if (doc->type != FROST_OBJECT)
+        frost_set_object(doc, patch->u.o.size);
+    frost_pointer_touch(doc);
+    for (size_t i = 0; i < patch->u.o.size; i++) {
+        const frost_member* mem = &patch->u.o.m[i];
+        size_t index = frost_find_object_index(doc, mem->k, mem->klen);
+        if (mem->v.type == FROST_NULL) {
+            if (index != FROST_KEY_NOT_EXIST)
+                frost_remove_object_value(doc, index);
+        } else if (index != FROST_KEY_NOT_EXIST)
+            frost_merge_patch(&doc->u.o.m[index].v, &mem->v);
+        else
+            frost_merge_patch(frost_set_object_value(doc, mem->k, mem->klen), &mem->v);
+    }
+}
+
+auto frost_apply_merge_patch(frost_value* doc, const frost_value* patch) -> int
+{
+    assert(doc != nullptr && patch != nullptr && (doc->flags & FROST_FLAG_FROZEN) == 0);
+    frost_merge_patch(doc, patch);
+    return FROST_PATCH_OK;
+}
+
+using frost_diff_context = struct {
+    frost_value* patch;
+    char* path;         /* 当前节点的 JSON Pointer */
+    size_t size, top;
+};
+
+static void frost_diff_path_putc(frost_diff_context* ctx, char ch)
+{
+    if (ctx->top == ctx->size) {
+        ctx->size = ctx->size == 0 ? 64 : ctx->size * 2;
+        ctx->path = (char*)realloc(ctx->path, ctx->size);
+    }
+    ctx->path[ctx->top++] = ch;
+}
+
+static void frost_diff_path_key(frost_diff_context* ctx, const char* key, size_t klen)
+{
+    frost_diff_path_putc(ctx, '/');
+    for (size_t i = 0; i < klen; i++) {
+        if (key[i] == '~') {
+            frost_diff_path_putc(ctx, '~');
+            frost_diff_path_putc(ctx, '0');
+        } else if (key[i] == '/') {
+            frost_diff_path_putc(ctx, '~');
+            frost_diff_path_putc(ctx, '1');
+        } else
+            frost_diff_path_putc(ctx, key[i]);
+    }
+}
+
+static void frost_diff_path_index(frost_diff_context* ctx, size_t index)
+{
+    char buf[24];
+    size_t n = 0;
+    do {
+        buf[n++] = (char)('0' + index % 10);
+        index /= 10;
+    } while (index > 0);
+    frost_diff_path_putc(ctx, '/');
+    while (n > 0)
+        frost_diff_path_putc(ctx, buf[--n]);
+}
+
+static void frost_diff_emit(frost_diff_context* ctx, const char* op, const frost_value* value)
+{
+    frost_value* elem = frost_pushback_array_element(ctx->patch);
+    frost_set_object(elem, value != nullptr ? 3 : 2);
+    frost_set_string(frost_set_object_value(elem, "op", 2), op, strlen(op));
+    frost_set_string(frost_set_object_value(elem, "path", 4), ctx->path, ctx->top);
+    if (value != nullptr)
+        frost_copy(frost_set_object_value(elem, "value", 5), value);
+}
+
+/* 对象键的临时散列索引, 成员较多且顺序不同时避免逐个线性查找 */
+using frost_diff_index = struct {
+    size_t* slot;       /* 成员下标 + 1, 0 为空 */
+    size_t mask;
+};
+
+static auto frost_diff_key_hash(const char* key, size_t klen) -> size_t
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < klen; i++)
+        h = (h ^ (unsigned char)key[i]) * 0x100000001b3ull;
+    return (size_t)(h ^ (h >> 29));
+}
+
+#define FROST_DIFF_INDEX_MIN 16
+
+static void frost_diff_index_build(frost_diff_index* idx, const frost_value* obj)
+{
+    size_t n = 4;
+    idx->slot = nullptr;
+    idx->mask = 0;
+    if (obj->u.o.size < FROST_DIFF_INDEX_MIN)
+        return;
+    while (n < obj->u.o.size * 2)
+        n <<= 1;
+    idx->slot = (size_t*)calloc(n, sizeof(size_t));
+    idx->mask = n - 1;
+    for (size_t i = 0; i < obj->u.o.size; i++) {
+        size_t h = frost_diff_key_hash(obj->u.o.m[i].k, obj->u.o.m[i].klen) & idx->mask;
+        while (idx->slot[h] != 0)
+            h = (h + 1) & idx->mask;
+        idx->slot[h] = i + 1;
+    }
+}
+
+/* 查找键; hint 为期望的下标 (两侧键顺序相同时一次命中) */
+static auto frost_diff_index_find(const frost_diff_index* idx, const frost_value* obj, const char* key, size_t klen, size_t hint) -> size_t
+{
+    if (hint < obj->u.o.size && obj->u.o.m[hint].klen == klen && memcmp(obj->u.o.m[hint].k, key, klen) == 0)
+        return hint;
+    if (idx->slot == nullptr)
+        return frost_find_object_index(obj, key, klen);
+    for (size_t h = frost_diff_key_hash(key, klen) & idx->mask; idx->slot[h] != 0; h = (h + 1) & idx->mask) {
+        const frost_member* mem = &obj->u.o.m[idx->slot[h] - 1];
+        if (mem->klen == klen && memcmp(mem->k, key, klen) == 0)
+            return idx->slot[h] - 1;
+    }
+    return FROST_KEY_NOT_EXIST;
+}
+
+static void frost_diff_value(frost_diff_context* ctx, const frost_value* from, const frost_value* to);
+
+static void frost_diff_object(frost_diff_context* ctx, const frost_value* from, const frost_value* to)
+{
+    frost_diff_index fidx;
+    frost_diff_index tidx;
+    size_t top = ctx->top;
+    frost_diff_index_build(&fidx, from);
+    frost_diff_index_build(&tidx, to);
+    for (size_t i = 0; i < from->u.o.size; i++) {
+        const frost_member* mem = &from->u.o.m[i];
+        if (frost_diff_index_find(&tidx, to, mem->k, mem->klen, i) == FROST_KEY_NOT_EXIST) {
+            frost_diff_path_key(ctx, mem->k, mem->klen);
+            frost_diff_emit(ctx, "remove", nullptr);
+            ctx->top = top;
+        }
+    }
+    for (size_t i = 0; i < to->u.o.size; i++) {
+        const frost_member* mem = &to->u.o.m[i];
+        size_t index = frost_diff_index_find(&fidx, from, mem->k, mem->klen, i);
+        frost_diff_path_key(ctx, mem->k, mem->klen);
+        if (index == FROST_KEY_NOT_EXIST)
+            frost_diff_emit(ctx, "add", &mem->v);
+        else
+            frost_diff_value(ctx, &from->u.o.m[index].v, &mem->v);
+        ctx->top = top;
+    }
+    free(fidx.slot);
+    free(tidx.slot);
+}
+
+/* 去掉相同的公共前后缀, 中间部分按下标逐个比较, 多出的元素从尾部删除或依次插入 */
+static void frost_diff_array(frost_diff_context* ctx, const frost_value* from, const frost_value* to)
+{
+    size_t n = from->u.a.size;
+    size_t m = to->u.a.size;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t common = 0;
+    size_t top = ctx->top;
+    while (head < n && head < m && frost_is_equal(&from->u.a.e[head], &to->u.a.e[head]) != 0)
+        head++;
+    while (tail < n - head && tail < m - head && frost_is_equal(&from->u.a.e[n - 1 - tail], &to->u.a.e[m - 1 - tail]) != 0)
+        tail++;
+    common = (n < m ? n : m) - head - tail;
+    for (size_t i = head; i < head + common; i++) {
+        frost_diff_path_index(ctx, i);
+        frost_diff_value(ctx, &from->u.a.e[i], &to->u.a.e[i]);
+        ctx->top = top;
+    }
+    for (size_t i = n - tail; i > head + common; i--) {
+        frost_diff_path_index(ctx, i - 1);
+        frost_diff_emit(ctx, "remove", nullptr);
+        ctx->top = top;
+    }
+    for (size_t i = head + common; i < m - tail; i++) {
+        frost_diff_path_index(ctx, i);
+        frost_diff_emit(ctx, "add", &to->u.a.e[i]);
+        ctx->top = top;
+    }
+}
+
+static void frost_diff_value(frost_diff_context* ctx, const frost_value* from, const frost_value* to)
+{
+    if (from->type != to->type || (from->type != FROST_ARRAY && from->type != FROST_OBJECT)) {
+        if (frost_is_equal(from, to) == 0)
+            frost_diff_emit(ctx, "replace", to);
+        return;
+    }
+    /* 引用同一共享块 (frost_copy / frost_dedup 的结果) 的子树必然相同 */
+    if ((from->flags & to->flags & FROST_FLAG_SHARED) != 0
+        && (from->type == FROST_ARRAY ? from->u.a.e == to->u.a.e : from->u.o.m == to->u.o.m))
+        return;
+    if (from->type == FROST_OBJECT)
+        frost_diff_object(ctx, from, to);
+    else
+        frost_diff_array(ctx, from, to);
+}
+
+void frost_diff(frost_value* patch, const frost_value* from, const frost_value* to)
+{
+    frost_diff_context ctx;
+    assert(patch != nullptr && from != nullptr && to != nullptr && patch != from && patch != to);
+    frost_set_array(patch, 0);
+    ctx.patch = patch;
+    ctx.path = nullptr;
+    ctx.size = ctx.top = 0;
+    frost_diff_value(&ctx, from, to);
+    free(ctx.path);
+}
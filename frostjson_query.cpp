@@ -0,0 +1,562 @@
+#include "frostjson.h"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * JSONPath 查询 (RFC 9535 的常用子集)
+ *
+ *   $.a / $['a']         子成员              $.* / $[*]      全部子值
+ *   $[0] / $[-1]         数组下标 (负数从尾部计)
+ *   $[1:5:2] / $[::-1]   切片, 语义同 RFC 9535
+ *   $['a','b'] / $[0,2]  同一段中的多个选择器, 结果按选择器顺序排列
+ *   $..a / $..[0]        递归下降: 对当前节点及其全部后代应用选择器
+ *   $[?@.price < 10]     过滤: 对每个子值求值, 也可写作 [?(@.price < 10)];
+ *                        只有 @ 开头的相对路径时表示存在性测试
+ *
+ * 编译时把路径拆成段, 键解码并记下长度, 过滤条件中的字面量解析为 frost_value,
+ * 运行时不再分析路径文本, 也不分配内存. 查询只读遍历文档: 不写时复制, 不清除缓存,
+ * 因此可以在冻结的文档上并发运行.
+ */
+
+enum {
+    FROST_QUERY_NAME,       /* 子成员 */
+    FROST_QUERY_WILDCARD,   /* 全部子值 */
+    FROST_QUERY_INDEX,      /* 数组下标 */
+    FROST_QUERY_SLICE,      /* 数组切片 */
+    FROST_QUERY_FILTER      /* 过滤 */
+};
+
+enum {
+    FROST_QUERY_EXISTS,     /* 无比较: 相对路径存在即为真 */
+    FROST_QUERY_EQ, FROST_QUERY_NE, FROST_QUERY_LT, FROST_QUERY_LE, FROST_QUERY_GT, FROST_QUERY_GE
+};
+
+/* 过滤条件中相对路径的一步: 键或下标 */
+using frost_query_token = struct {
+    char* key;              /* nullptr 表示下标 */
+    size_t klen;
+    long long index;
+};
+
+using frost_query_selector = struct {
+    int kind;
+    char* key;              /* NAME: 解码后的键 */
+    size_t klen;
+    long long start, end, step;
+    int has_start, has_end; /* SLICE: 省略的起止取决于步长的正负 */
+    frost_query_token* rel; /* FILTER: @ 之后的相对路径 */
+    size_t rlen;
+    int op;
+    frost_value literal;
+};
+
+using frost_query_segment = struct {
+    int descent;            /* .. */
+    int simple;             /* 只有一个 NAME 选择器且不递归下降: 求值时直接向下查找 */
+    frost_query_selector* sel;
+    size_t size;
+};
+
+struct frost_query {
+    frost_query_segment* seg;
+    size_t size;
+};
+
+using frost_query_context = struct {
+    const frost_query* q;
+    frost_query_callback cb;
+    void* user;
+    size_t count;
+    int stop;
+};
+
+/*
+ * 编译
+ */
+
+static auto frost_query_push(void** buf, size_t* size, size_t elem) -> void*
+{
+    /* 段与选择器通常只有几个, 每次按 2 的幂扩容 */
+    if ((*size & (*size - 1)) == 0)
+        *buf = realloc(*buf, (*size == 0 ? 1 : *size * 2) * elem);
+    return (char*)*buf + (*size)++ * elem;
+}
+
+static void frost_query_space(const char** p)
+{
+    while (**p == ' ' || **p == '\t' || **p == '\n' || **p == '\r')
+        (*p)++;
+}
+
+/* 点号后的成员名: 字母、数字、'_' 与非 ASCII 字节, 不以数字开头 */
+static auto frost_query_name_char(char ch, int first) -> int
+{
+    auto c = (unsigned char)ch;
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_' || c >= 0x80 || (first == 0 && c >= '0' && c <= '9');
+}
+
+static auto frost_query_name(const char** p, char** key, size_t* klen) -> int
+{
+    const char* s = *p;
+    while (frost_query_name_char(**p, *p == s))
+        (*p)++;
+    if (*p == s)
+        return 0;
+    *klen = (size_t)(*p - s);
+    *key = (char*)malloc(*klen + 1);
+    memcpy(*key, s, *klen);
+    (*key)[*klen] = '\0';
+    return 1;
+}
+
+/*
+ * 字面量: 单引号字符串先改写为等价的 JSON 字符串 (\' 变为 ', " 变为 \"),
+ * 其余按 JSON 语法用 frost_skip 确定范围后交给 frost_parse
+ */
+static auto frost_query_literal(const char** p, frost_value* val) -> int
+{
+    const char* s = *p;
+    const char* end = nullptr;
+    char* buf = nullptr;
+    size_t n = 0;
+    int ret = 0;
+    if (*s == '\'') {
+        buf = (char*)malloc(2 * strlen(s) + 2);
+        buf[n++] = '"';
+        for (s++; *s != '\'' && *s != '\0'; s++) {
+            if (*s == '"')
+                buf[n++] = '\\';
+            else if (*s == '\\' && s[1] == '\'')
+                s++;
+            else if (*s == '\\' && s[1] != '\0')
+                buf[n++] = *s++;
+            buf[n++] = *s;
+        }
+        if (*s == '\0') {
+            free(buf);
+            return 0;
+        }
+        end = s + 1;
+        buf[n++] = '"';
+    } else {
+        if (frost_skip(s, &end, nullptr) != FROST_PARSE_OK)
+            return 0;
+        n = (size_t)(end - s);
+        buf = (char*)malloc(n + 1);
+        memcpy(buf, s, n);
+    }
+    buf[n] = '\0';
+    ret = frost_parse(val, buf) == FROST_PARSE_OK;
+    free(buf);
+    *p = end;
+    return ret;
+}
+
+/* 带引号的键, 取出解码后的字符串 */
+static auto frost_query_quoted(const char** p, char** key, size_t* klen) -> int
+{
+    frost_value val;
+    frost_init(&val);
+    if (frost_query_literal(p, &val) == 0 || val.type != FROST_STRING) {
+        frost_free(&val);
+        return 0;
+    }
+    *klen = val.u.s.len;
+    *key = (char*)malloc(*klen + 1);
+    memcpy(*key, val.u.s.s, *klen + 1);
+    frost_free(&val);
+    return 1;
+}
+
+static auto frost_query_integer(const char** p, long long* n) -> int
+{
+    int neg = **p == '-';
+    const char* s = *p + neg;
+    unsigned long long mag = 0;
+    if (*s < '0' || *s > '9' || (*s == '0' && s[1] >= '0' && s[1] <= '9'))
+        return 0;
+    for (; *s >= '0' && *s <= '9'; s++) {
+        if (mag > 922337203685477580ULL)
+            return 0;
+        mag = mag * 10 + (unsigned long long)(*s - '0');
+    }
+    if (mag > 9223372036854775807ULL)
+        return 0;
+    *n = neg != 0 ? -(long long)mag : (long long)mag;
+    *p = s;
+    return 1;
+}
+
+static auto frost_query_relative(const char** p, frost_query_selector* sel) -> int
+{
+    frost_query_token* tok = nullptr;
+    if (**p != '@')
+        return 0;
+    (*p)++;
+    for (;;) {
+        if (**p == '.' && (*p)[1] != '.') {
+            (*p)++;
+            tok = (frost_query_token*)frost_query_push((void**)&sel->rel, &sel->rlen, sizeof(frost_query_token));
+            tok->key = nullptr;
+            if (frost_query_name(p, &tok->key, &tok->klen) == 0)
+                return 0;
+        } else if (**p == '[') {
+            (*p)++;
+            frost_query_space(p);
+            tok = (frost_query_token*)frost_query_push((void**)&sel->rel, &sel->rlen, sizeof(frost_query_token));
+            tok->key = nullptr;
+            if (**p == '\'' || **p == '"') {
+                if (frost_query_quoted(p, &tok->key, &tok->klen) == 0)
+                    return 0;
+            } else if (frost_query_integer(p, &tok->index) == 0)
+                return 0;
+            frost_query_space(p);
+            if (*(*p)++ != ']')
+                return 0;
+        } else
+            return 1;
+    }
+}
+
+static auto frost_query_filter(const char** p, frost_query_selector* sel) -> int
+{
+    static const struct { const char* text; int op; } ops[] = {
+        { "==", FROST_QUERY_EQ }, { "!=", FROST_QUERY_NE }, { "<=", FROST_QUERY_LE },
+        { ">=", FROST_QUERY_GE }, { "<", FROST_QUERY_LT }, { ">", FROST_QUERY_GT }
+    };
+    int paren = **p == '(';
+    size_t i;
+    *p += paren;
+    frost_query_space(p);
+    if (frost_query_relative(p, sel) == 0)
+        return 0;
+    frost_query_space(p);
+    sel->op = FROST_QUERY_EXISTS;
+    for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+        if (strncmp(*p, ops[i].text, strlen(ops[i].text)) == 0) {
+            sel->op = ops[i].op;
+            *p += strlen(ops[i].text);
+            frost_query_space(p);
+            if (frost_query_literal(p, &sel->literal) == 0)
+                return 0;
+            frost_query_space(p);
+            break;
+        }
+    if (paren != 0 && *(*p)++ != ')')
+        return 0;
+    return 1;
+}
+
+static auto frost_query_selector_parse(const char** p, frost_query_selector* sel) -> int
+{
+    long long n = 0;
+    if (**p == '\'' || **p == '"') {
+        sel->kind = FROST_QUERY_NAME;
+        return frost_query_quoted(p, &sel->key, &sel->klen);
+    }
+    if (**p == '*') {
+        (*p)++;
+        sel->kind = FROST_QUERY_WILDCARD;
+        return 1;
+    }
+    if (**p == '?') {
+        (*p)++;
+        sel->kind = FROST_QUERY_FILTER;
+        return frost_query_filter(p, sel);
+    }
+    /* 下标或切片 start:end:step, 三者都可省略 */
+    sel->has_start = frost_query_integer(p, &n);
+    sel->start = n;
+    frost_query_space(p);
+    if (**p != ':') {
+        sel->kind = FROST_QUERY_INDEX;
+        return sel->has_start;
+    }
+    sel->kind = FROST_QUERY_SLICE;
+    sel->step = 1;
+    (*p)++;
+    frost_query_space(p);
+    sel->has_end = frost_query_integer(p, &sel->end);
+    frost_query_space(p);
+    if (**p == ':') {
+        (*p)++;
+        frost_query_space(p);
+        frost_query_integer(p, &sel->step);
+    }
+    return 1;
+}
+
+static auto frost_query_add_selector(frost_query_segment* seg) -> frost_query_selector*
+{
+    auto* sel = (frost_query_selector*)frost_query_push((void**)&seg->sel, &seg->size, sizeof(frost_query_selector));
+    memset(sel, 0, sizeof(frost_query_selector));
+    frost_init(&sel->literal);
+    return sel;
+}
+
+static auto frost_query_segment_parse(const char** p, frost_query_segment* seg) -> int
+{
+    frost_query_selector* sel = nullptr;
+    if (**p == '.') {
+        (*p)++;
+        if (**p == '.') {
+            (*p)++;
+            seg->descent = 1;
+            if (**p == '[')
+                return frost_query_segment_parse(p, seg);
+        }
+        sel = frost_query_add_selector(seg);
+        if (**p == '*') {
+            (*p)++;
+            sel->kind = FROST_QUERY_WILDCARD;
+            return 1;
+        }
+        sel->kind = FROST_QUERY_NAME;
+        return frost_query_name(p, &sel->key, &sel->klen);
+    }
+    if (**p != '[')
+        return 0;
+    (*p)++;
+    for (;;) {
+        frost_query_space(p);
+        if (frost_query_selector_parse(p, frost_query_add_selector(seg)) == 0)
+            return 0;
+        frost_query_space(p);
+        if (**p == ']') {
+            (*p)++;
+            return 1;
+        }
+        if (*(*p)++ != ',')
+            return 0;
+    }
+}
+
+auto frost_query_compile(const char* path) -> frost_query*
+{
+    auto* q = (frost_query*)calloc(1, sizeof(frost_query));
+    const char* p = path;
+    assert(path != nullptr);
+    frost_query_space(&p);
+    if (*p++ != '$') {
+        frost_query_free(q);
+        return nullptr;
+    }
+    for (;;) {
+        frost_query_segment* seg = nullptr;
+        frost_query_space(&p);
+        if (*p == '\0') {
+            for (size_t i = 0; i < q->size; i++)
+                q->seg[i].simple = q->seg[i].descent == 0 && q->seg[i].size == 1 && q->seg[i].sel[0].kind == FROST_QUERY_NAME;
+            return q;
+        }
+        seg = (frost_query_segment*)frost_query_push((void**)&q->seg, &q->size, sizeof(frost_query_segment));
+        memset(seg, 0, sizeof(frost_query_segment));
+        if (frost_query_segment_parse(&p, seg) == 0) {
+            frost_query_free(q);
+            return nullptr;
+        }
+    }
+}
+
+void frost_query_free(frost_query* q)
+{
+    size_t i, j, k;
+    if (q == nullptr)
+        return;
+    for (i = 0; i < q->size; i++) {
+        for (j = 0; j < q->seg[i].size; j++) {
+            frost_query_selector* sel = &q->seg[i].sel[j];
+            for (k = 0; k < sel->rlen; k++)
+                free(sel->rel[k].key);
+            free(sel->rel);
+            free(sel->key);
+            frost_free(&sel->literal);
+        }
+        free(q->seg[i].sel);
+    }
+    free(q->seg);
+    free(q);
+}
+
+/*
+ * 求值
+ */
+
+/* 负下标从尾部计; 不存在时返回 nullptr */
+static auto frost_query_element(const frost_value* val, long long index) -> const frost_value*
+{
+    auto size = (long long)val->u.a.size;
+    if (index < 0)
+        index += size;
+    return index >= 0 && index < size ? &val->u.a.e[index] : nullptr;
+}
+
+static auto frost_query_resolve(const frost_query_selector* sel, const frost_value* val) -> const frost_value*
+{
+    size_t i, index;
+    for (i = 0; i < sel->rlen && val != nullptr; i++) {
+        const frost_query_token* tok = &sel->rel[i];
+        if (tok->key != nullptr && val->type == FROST_OBJECT)
+            val = (index = frost_find_object_index(val, tok->key, tok->klen)) != FROST_KEY_NOT_EXIST ? &val->u.o.m[index].v : nullptr;
+        else if (tok->key == nullptr && val->type == FROST_ARRAY)
+            val = frost_query_element(val, tok->index);
+        else
+            val = nullptr;
+    }
+    return val;
+}
+
+/* 大小比较只对数字与数字、字符串与字符串有意义, 其余一律为假 */
+static auto frost_query_compare(const frost_value* lhs, const frost_value* rhs, int* order) -> int
+{
+    double l, r;
+    size_t n;
+    int c;
+    if (lhs->type == FROST_NUMBER && rhs->type == FROST_NUMBER) {
+        l = frost_get_number(lhs);
+        r = frost_get_number(rhs);
+        *order = l < r ? -1 : l > r ? 1 : 0;
+        return l == l && r == r;
+    }
+    if (lhs->type == FROST_STRING && rhs->type == FROST_STRING) {
+        n = lhs->u.s.len < rhs->u.s.len ? lhs->u.s.len : rhs->u.s.len;
+        c = memcmp(lhs->u.s.s, rhs->u.s.s, n);
+        *order = c != 0 ? c : lhs->u.s.len < rhs->u.s.len ? -1 : lhs->u.s.len > rhs->u.s.len ? 1 : 0;
+        return 1;
+    }
+    return 0;
+}
+
+/* 路径不存在时: == 为假, != 为真, 大小比较为假 */
+static auto frost_query_test(const frost_query_selector* sel, const frost_value* val) -> int
+{
+    const frost_value* lhs = frost_query_resolve(sel, val);
+    int order = 0;
+    switch (sel->op) {
+    case FROST_QUERY_EXISTS:
+        return lhs != nullptr;
+    case FROST_QUERY_EQ:
+        return lhs != nullptr && frost_is_equal(lhs, &sel->literal);
+    case FROST_QUERY_NE:
+        return lhs == nullptr || frost_is_equal(lhs, &sel->literal) == 0;
+    default:
+        if (lhs == nullptr)
+            return 0;
+        if ((sel->op == FROST_QUERY_LE || sel->op == FROST_QUERY_GE) && frost_is_equal(lhs, &sel->literal) != 0)
+            return 1;
+        if (frost_query_compare(lhs, &sel->literal, &order) == 0)
+            return 0;
+        return sel->op == FROST_QUERY_LT || sel->op == FROST_QUERY_LE ? order < 0 : order > 0;
+    }
+}
+
+static void frost_query_segment_eval(frost_query_context* ctx, size_t depth, const frost_value* val);
+
+static void frost_query_emit(frost_query_context* ctx, size_t depth, const frost_value* val)
+{
+    size_t index;
+    if (ctx->stop != 0)
+        return;
+    for (; depth < ctx->q->size && ctx->q->seg[depth].simple != 0; depth++) {
+        const frost_query_selector* sel = &ctx->q->seg[depth].sel[0];
+        if (val->type != FROST_OBJECT || (index = frost_find_object_index(val, sel->key, sel->klen)) == FROST_KEY_NOT_EXIST)
+            return;
+        val = &val->u.o.m[index].v;
+    }
+    if (depth < ctx->q->size) {
+        frost_query_segment_eval(ctx, depth, val);
+        return;
+    }
+    ctx->count++;
+    if (ctx->cb != nullptr && ctx->cb(val, ctx->user) != 0)
+        ctx->stop = 1;
+}
+
+/* 对 val 应用一个选择器, 选中的值交给下一段 */
+static void frost_query_select(frost_query_context* ctx, size_t depth, const frost_query_selector* sel, const frost_value* val)
+{
+    size_t i, index;
+    long long n, lower, upper, k;
+    switch (sel->kind) {
+    case FROST_QUERY_NAME:
+        if (val->type == FROST_OBJECT && (index = frost_find_object_index(val, sel->key, sel->klen)) != FROST_KEY_NOT_EXIST)
+            frost_query_emit(ctx, depth + 1, &val->u.o.m[index].v);
+        break;
+    case FROST_QUERY_WILDCARD:
+    case FROST_QUERY_FILTER:
+        if (val->type == FROST_ARRAY) {
+            for (i = 0; i < val->u.a.size && ctx->stop == 0; i++)
+                if (sel->kind == FROST_QUERY_WILDCARD || frost_query_test(sel, &val->u.a.e[i]) != 0)
+                    frost_query_emit(ctx, depth + 1, &val->u.a.e[i]);
+        } else if (val->type == FROST_OBJECT) {
+            for (i = 0; i < val->u.o.size && ctx->stop == 0; i++)
+                if (sel->kind == FROST_QUERY_WILDCARD || frost_query_test(sel, &val->u.o.m[i].v) != 0)
+                    frost_query_emit(ctx, depth + 1, &val->u.o.m[i].v);
+        }
+        break;
+    case FROST_QUERY_INDEX:
+        if (val->type == FROST_ARRAY && frost_query_element(val, sel->start) != nullptr)
+            frost_query_emit(ctx, depth + 1, frost_query_element(val, sel->start));
+        break;
+    case FROST_QUERY_SLICE:
+        if (val->type != FROST_ARRAY || sel->step == 0)
+            break;
+        n = (long long)val->u.a.size;
+        if (sel->step > 0) {
+            lower = sel->has_start != 0 ? (sel->start < 0 ? sel->start + n : sel->start) : 0;
+            upper = sel->has_end != 0 ? (sel->end < 0 ? sel->end + n : sel->end) : n;
+            lower = lower < 0 ? 0 : lower > n ? n : lower;
+            upper = upper < 0 ? 0 : upper > n ? n : upper;
+            /* 下一步越过边界时先停下, k += step 不会溢出 */
+            for (k = lower; k < upper && ctx->stop == 0; k += sel->step) {
+                frost_query_emit(ctx, depth + 1, &val->u.a.e[k]);
+                if (sel->step >= upper - k)
+                    break;
+            }
+        } else {
+            upper = sel->has_start != 0 ? (sel->start < 0 ? sel->start + n : sel->start) : n - 1;
+            lower = sel->has_end != 0 ? (sel->end < 0 ? sel->end + n : sel->end) : -1;
+            upper = upper < -1 ? -1 : upper > n - 1 ? n - 1 : upper;
+            lower = lower < -1 ? -1 : lower > n - 1 ? n - 1 : lower;
+            for (k = upper; k > lower && ctx->stop == 0; k += sel->step) {
+                frost_query_emit(ctx, depth + 1, &val->u.a.e[k]);
+                if (sel->step <= lower - k)
+                    break;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* 递归下降按先序访问 val 及其后代, 每个节点上依次应用本段的全部选择器 */
+static void frost_query_segment_eval(frost_query_context* ctx, size_t depth, const frost_value* val)
+{
+    const frost_query_segment* seg = &ctx->q->seg[depth];
+    size_t i;
+    for (i = 0; i < seg->size && ctx->stop == 0; i++)
+        frost_query_select(ctx, depth, &seg->sel[i], val);
+    if (seg->descent == 0)
+        return;
+    if (val->type == FROST_ARRAY)
+        for (i = 0; i < val->u.a.size && ctx->stop == 0; i++)
+            frost_query_segment_eval(ctx, depth, &val->u.a.e[i]);
+    else if (val->type == FROST_OBJECT)
+        for (i = 0; i < val->u.o.size && ctx->stop == 0; i++)
+            frost_query_segment_eval(ctx, depth, &val->u.o.m[i].v);
+}
+
+auto frost_query_run(const frost_query* q, const frost_value* doc, frost_query_callback cb, void* user) -> size_t
+{
+    frost_query_context ctx;
+    assert(q != nullptr && doc != nullptr);
+    ctx.q = q;
+    ctx.cb = cb;
+    ctx.user = user;
+    ctx.count = 0;
+    ctx.stop = 0;
+    frost_query_emit(&ctx, 0, doc);
+    return ctx.count;
+}
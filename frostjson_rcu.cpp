@@ -0,0 +1,114 @@
+#include "frostjson.h"
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+/*
+ * 以 RCU 方式发布冻结的文档
+ *
+ * 读者进入时在当前纪元 (epoch) 奇偶性对应的计数器上加一, 然后读取当前版本; 发布者替换
+ * 版本指针后翻转纪元, 此后进入的读者计入另一组计数器且只能看到新版本, 因此等旧一组计数
+ * 归零后, 再没有读者持有旧版本, 可以释放. 读者读到纪元后、加一之前纪元可能已被翻转,
+ * 加一后重新检查纪元, 不一致则撤销重试, 保证发布者看到的零不会被迟到的读者打破.
+ *
+ * 计数器按线程分散到多个缓存行, 避免大量读者争用同一行. 发布者之间以互斥锁串行,
+ * 且等待期间一直持有锁; 持有读取凭据的线程不能发布, 否则会等待自己.
+ */
+
+#define FROST_RCU_STRIPES 16
+
+struct alignas(64) frost_rcu_counter {
+    std::atomic<size_t> n;
+};
+
+struct frost_snapshot_ptr {
+    std::atomic<frost_value*> current;
+    std::atomic<size_t> epoch;
+    frost_rcu_counter readers[2 * FROST_RCU_STRIPES];    /* [奇偶性 * FROST_RCU_STRIPES + 分组] */
+    std::mutex writer;
+};
+
+/* 当前线程使用的计数器分组, 首次使用时轮流分配 */
+static auto frost_rcu_stripe() -> unsigned
+{
+    static std::atomic<unsigned> next(0);
+    static thread_local unsigned stripe = next.fetch_add(1, std::memory_order_relaxed) % FROST_RCU_STRIPES;
+    return stripe;
+}
+
+static auto frost_rcu_take(frost_value* val) -> frost_value*
+{
+    auto* doc = (frost_value*)malloc(sizeof(frost_value));
+    frost_init(doc);
+    frost_move(doc, val);
+    frost_freeze(doc);
+    return doc;
+}
+
+static void frost_rcu_drop(frost_value* doc)
+{
+    frost_free(doc);
+    free(doc);
+}
+
+auto frost_snapshot_ptr_create(frost_value* val) -> frost_snapshot_ptr*
+{
+    assert(val != nullptr);
+    auto* ptr = new frost_snapshot_ptr;
+    ptr->current.store(frost_rcu_take(val), std::memory_order_relaxed);
+    ptr->epoch.store(0, std::memory_order_relaxed);
+    for (auto& c : ptr->readers)
+        c.n.store(0, std::memory_order_relaxed);
+    return ptr;
+}
+
+void frost_snapshot_ptr_destroy(frost_snapshot_ptr* ptr)
+{
+    assert(ptr != nullptr);
+    for (auto& c : ptr->readers)
+        assert(c.n.load(std::memory_order_relaxed) == 0);
+    frost_rcu_drop(ptr->current.load(std::memory_order_relaxed));
+    delete ptr;
+}
+
+auto frost_snapshot_ptr_acquire(frost_snapshot_ptr* ptr, unsigned* ticket) -> frost_value*
+{
+    size_t epoch = 0;
+    unsigned slot = 0;
+    assert(ptr != nullptr && ticket != nullptr);
+    for (;;) {
+        epoch = ptr->epoch.load();
+        slot = (unsigned)(epoch & 1) * FROST_RCU_STRIPES + frost_rcu_stripe();
+        ptr->readers[slot].n.fetch_add(1);
+        if (ptr->epoch.load() == epoch)
+            break;
+        ptr->readers[slot].n.fetch_sub(1, std::memory_order_release);
+    }
+    *ticket = slot;
+    return ptr->current.load();
+}
+
+void frost_snapshot_ptr_release(frost_snapshot_ptr* ptr, unsigned ticket)
+{
+    assert(ptr != nullptr && ticket < 2 * FROST_RCU_STRIPES);
+    ptr->readers[ticket].n.fetch_sub(1, std::memory_order_release);
+}
+
+void frost_snapshot_ptr_publish(frost_snapshot_ptr* ptr, frost_value* val)
+{
+    frost_value* doc = nullptr;
+    frost_value* old = nullptr;
+    size_t parity = 0;
+    unsigned i = 0;
+    assert(ptr != nullptr && val != nullptr);
+    doc = frost_rcu_take(val);
+    std::lock_guard<std::mutex> lock(ptr->writer);
+    old = ptr->current.exchange(doc);
+    parity = ptr->epoch.fetch_add(1) & 1;
+    for (i = 0; i < FROST_RCU_STRIPES; i++)
+        while (ptr->readers[parity * FROST_RCU_STRIPES + i].n.load() != 0)
+            std::this_thread::yield();
+    frost_rcu_drop(old);
+}
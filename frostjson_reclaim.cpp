@@ -0,0 +1,261 @@
+#include "frostjson.h"
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+/*
+ * 后台延迟释放
+ *
+ * frost_free_deferred 像 frost_move 一样把值的内容移入一个堆上的节点 (O(1)), 排入队列后
+ * 立即返回, 由回收线程调用 frost_free. 有多个回收线程时, 子值足够多的独占容器被切成
+ * 若干区间分别释放, 最后一个完成的区间释放容器本身.
+ *
+ * 待释放字节数在回收线程处理到某个区间时才计入其中子树的全部大小, 此前只计最外层的
+ * 缓冲区, 因此它反映的是下限; frost_reclaim_drain 返回后为 0.
+ *
+ * 回收线程在首次提交时启动, 进程退出时 (静态对象析构) 先释放完队列中的值再结束.
+ */
+
+#ifndef FROST_RECLAIM_SPLIT_MIN
+#define FROST_RECLAIM_SPLIT_MIN 4096    /* 容器的子值数达到此值才切分 */
+#endif
+
+using frost_reclaim_node = struct {
+    frost_value val;
+    std::atomic<size_t> remaining;      /* 尚未完成的区间数 */
+    size_t bytes;                       /* 以此节点整体计入待释放字节数的部分 */
+};
+
+using frost_reclaim_job = struct frost_reclaim_job;
+
+struct frost_reclaim_job {
+    frost_reclaim_job* next;
+    frost_reclaim_node* node;
+    size_t begin, end;                  /* 子值区间; 整个值时 end 为 0 */
+};
+
+struct frost_reclaimer {
+    std::mutex lock;
+    std::condition_variable work;       /* 队列非空或退出 */
+    std::condition_variable idle;       /* 队列为空且没有正在处理的任务 */
+    frost_reclaim_job* head = nullptr;
+    frost_reclaim_job* tail = nullptr;
+    size_t running = 0;
+    unsigned wanted = 1;
+    bool stop = false;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> started{0};     /* 已启动的线程数, 供回收线程不加锁读取 */
+    std::atomic<size_t> pending{0};
+
+    ~frost_reclaimer();
+};
+
+static frost_reclaimer frost_reclaim;
+
+/* 独占部分占用的堆内存; 共享块可能仍被其他值引用, 不计入 */
+static auto frost_reclaim_size(const frost_value* val) -> size_t
+{
+    size_t i, n = 0;
+    if ((val->flags & FROST_FLAG_SHARED) != 0)
+        return 0;
+    switch (val->type) {
+    case FROST_NUMBER:
+        return (val->flags & FROST_FLAG_RAW_HEAP) != 0 ? val->u.rh.len + 1 : 0;
+    case FROST_STRING:
+        return val->u.s.len + 1;
+    case FROST_ARRAY:
+        n = val->u.a.capacity * sizeof(frost_value);
+        for (i = 0; i < val->u.a.size; i++)
+            n += frost_reclaim_size(&val->u.a.e[i]);
+        return n;
+    case FROST_OBJECT:
+        n = val->u.o.capacity * sizeof(frost_member);
+        for (i = 0; i < val->u.o.size; i++)
+            n += val->u.o.m[i].klen + 1 + frost_reclaim_size(&val->u.o.m[i].v);
+        return n;
+    default:
+        return 0;
+    }
+}
+
+static auto frost_reclaim_shallow(const frost_value* val) -> size_t
+{
+    if ((val->flags & FROST_FLAG_SHARED) != 0)
+        return 0;
+    switch (val->type) {
+    case FROST_STRING: return val->u.s.len + 1;
+    case FROST_ARRAY:  return val->u.a.capacity * sizeof(frost_value);
+    case FROST_OBJECT: return val->u.o.capacity * sizeof(frost_member);
+    default:           return 0;
+    }
+}
+
+/* 可切分的子值数; 紧凑块中的对象的键不能单独释放, 与共享节点一样整体交给 frost_free */
+static auto frost_reclaim_children(const frost_value* val) -> size_t
+{
+    if ((val->flags & (FROST_FLAG_SHARED | FROST_FLAG_ARENA)) != 0)
+        return 0;
+    return val->type == FROST_ARRAY ? val->u.a.size : val->type == FROST_OBJECT ? val->u.o.size : 0;
+}
+
+/* 调用者持有 lock */
+static void frost_reclaim_push(frost_reclaim_node* node, size_t begin, size_t end)
+{
+    auto* job = (frost_reclaim_job*)malloc(sizeof(frost_reclaim_job));
+    job->next = nullptr;
+    job->node = node;
+    job->begin = begin;
+    job->end = end;
+    if (frost_reclaim.tail != nullptr)
+        frost_reclaim.tail->next = job;
+    else
+        frost_reclaim.head = job;
+    frost_reclaim.tail = job;
+}
+
+static void frost_reclaim_finish(frost_reclaim_node* node)
+{
+    frost_free(&node->val);
+    frost_reclaim.pending.fetch_sub(node->bytes, std::memory_order_relaxed);
+    free(node);
+}
+
+/* 释放区间内的子值 (对象连同键), 子值变为 null; 最后一个区间释放容器本身 */
+static void frost_reclaim_range(frost_reclaim_node* node, size_t begin, size_t end)
+{
+    frost_value* val = &node->val;
+    size_t i, bytes = 0;
+    for (i = begin; i < end; i++)
+        bytes += val->type == FROST_ARRAY ? frost_reclaim_size(&val->u.a.e[i])
+                                          : val->u.o.m[i].klen + 1 + frost_reclaim_size(&val->u.o.m[i].v);
+    frost_reclaim.pending.fetch_add(bytes, std::memory_order_relaxed);
+    for (i = begin; i < end; i++) {
+        if (val->type == FROST_ARRAY)
+            frost_free(&val->u.a.e[i]);
+        else {
+            free(val->u.o.m[i].k);
+            val->u.o.m[i].k = nullptr;
+            frost_free(&val->u.o.m[i].v);
+        }
+    }
+    frost_reclaim.pending.fetch_sub(bytes, std::memory_order_relaxed);
+    if (node->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        frost_reclaim_finish(node);
+}
+
+static void frost_reclaim_run(frost_reclaim_job* job)
+{
+    frost_reclaim_node* node = job->node;
+    size_t i, step, count, bytes;
+    size_t chunks = 4 * frost_reclaim.started.load(std::memory_order_relaxed);
+    if (job->end != 0) {
+        frost_reclaim_range(node, job->begin, job->end);
+        return;
+    }
+    count = frost_reclaim_children(&node->val);
+    if (count < FROST_RECLAIM_SPLIT_MIN || chunks < 8) {
+        /* 不切分: 先计入整棵树的大小 */
+        bytes = frost_reclaim_size(&node->val);
+        frost_reclaim.pending.fetch_add(bytes - node->bytes, std::memory_order_relaxed);
+        node->bytes = bytes;
+        frost_reclaim_finish(node);
+        return;
+    }
+    step = (count + chunks - 1) / chunks;
+    node->remaining.store((count + step - 1) / step, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(frost_reclaim.lock);
+    for (i = 0; i < count; i += step)
+        frost_reclaim_push(node, i, i + step < count ? i + step : count);
+    frost_reclaim.work.notify_all();
+}
+
+static void frost_reclaim_worker()
+{
+    std::unique_lock<std::mutex> guard(frost_reclaim.lock);
+    for (;;) {
+        frost_reclaim_job* job = nullptr;
+        frost_reclaim.work.wait(guard, [] { return frost_reclaim.head != nullptr || frost_reclaim.stop; });
+        if (frost_reclaim.head == nullptr)
+            return;
+        job = frost_reclaim.head;
+        frost_reclaim.head = job->next;
+        if (frost_reclaim.head == nullptr)
+            frost_reclaim.tail = nullptr;
+        frost_reclaim.running++;
+        guard.unlock();
+        frost_reclaim_run(job);
+        free(job);
+        guard.lock();
+        if (--frost_reclaim.running == 0 && frost_reclaim.head == nullptr)
+            frost_reclaim.idle.notify_all();
+    }
+}
+
+/* 调用者持有 lock */
+static void frost_reclaim_spawn()
+{
+    while (frost_reclaim.threads.size() < frost_reclaim.wanted) {
+        frost_reclaim.threads.emplace_back(frost_reclaim_worker);
+        frost_reclaim.started.store(frost_reclaim.threads.size(), std::memory_order_relaxed);
+    }
+}
+
+frost_reclaimer::~frost_reclaimer()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    work.notify_all();
+    for (auto& t : threads)
+        t.join();
+}
+
+void frost_free_deferred(frost_value* val)
+{
+    frost_reclaim_node* node = nullptr;
+    assert(val != nullptr);
+    /* 没有堆内存的值直接释放 */
+    if (val->type == FROST_NULL || val->type == FROST_TRUE || val->type == FROST_FALSE
+        || (val->type == FROST_NUMBER && (val->flags & FROST_FLAG_RAW_HEAP) == 0)) {
+        frost_free(val);
+        return;
+    }
+    node = (frost_reclaim_node*)malloc(sizeof(frost_reclaim_node));
+    new (&node->remaining) std::atomic<size_t>(0);
+    memcpy(&node->val, val, sizeof(frost_value));
+    frost_init(val);
+    node->bytes = frost_reclaim_shallow(&node->val);
+    frost_reclaim.pending.fetch_add(node->bytes, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(frost_reclaim.lock);
+    frost_reclaim_spawn();
+    frost_reclaim_push(node, 0, 0);
+    frost_reclaim.work.notify_one();
+}
+
+void frost_reclaim_threads(unsigned threads)
+{
+    assert(threads > 0);
+    std::lock_guard<std::mutex> guard(frost_reclaim.lock);
+    if (threads > frost_reclaim.wanted)
+        frost_reclaim.wanted = threads;
+    if (!frost_reclaim.threads.empty())
+        frost_reclaim_spawn();
+}
+
+void frost_reclaim_drain()
+{
+    std::unique_lock<std::mutex> guard(frost_reclaim.lock);
+    frost_reclaim.idle.wait(guard, [] { return frost_reclaim.head == nullptr && frost_reclaim.running == 0; });
+}
+
+auto frost_reclaim_pending_bytes() -> size_t
+{
+    return frost_reclaim.pending.load(std::memory_order_relaxed);
+}
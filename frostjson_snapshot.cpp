@@ -0,0 +1,397 @@
+#include "frostjson.h"
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#define FROST_SNAPSHOT_MMAP 0
+#else
+#define FROST_SNAPSHOT_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * 可重定位的二进制快照: 整棵树以偏移量 (相对映像起始) 表示, 不含指针,
+ * 可直接 mmap 只读访问, 无需解析; 多个进程映射同一文件时共享页缓存.
+ *
+ * 映像布局 (本机字节序, 所有节点按 8 字节对齐):
+ *   frost_snapshot_header
+ *   根节点 frost_snapshot_value
+ *   数组: 连续的 frost_snapshot_value 表
+ *   对象: 连续的 frost_snapshot_member 表
+ *   字符串与键: 以 '\0' 结尾的字节序列
+ *
+ * 快照文件视为可信输入 (由 frost_snapshot_write 生成), 打开时只校验头部.
+ */
+
+#define FROST_SNAPSHOT_MAGIC "FROSTSN1"
+#define FROST_SNAPSHOT_VERSION 1u
+#define FROST_SNAPSHOT_ENDIAN 0x01020304u
+
+struct frost_snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;        /* 写入 FROST_SNAPSHOT_ENDIAN, 用于识别字节序不同的映像 */
+    uint64_t size;          /* 映像总字节数 */
+    uint64_t root;          /* 根节点偏移 */
+};
+
+struct frost_snapshot_value {
+    uint32_t type;          /* frost_type */
+    uint32_t flags;         /* number: FROST_FLAG_INT64 / FROST_FLAG_UINT64, 其余为 0 */
+    uint64_t size;          /* string: 长度; array/object: 元素个数 */
+    uint64_t offset;        /* string/array/object: 数据偏移; number: double 或整数的位模式 */
+};
+
+struct frost_snapshot_member {
+    uint64_t k;             /* 键偏移 */
+    uint64_t klen;
+    frost_snapshot_value v;
+};
+
+struct frost_snapshot {
+    const char* base;
+    size_t size;
+};
+
+/* ---------------- write ---------------- */
+
+using frost_snapshot_buffer = struct {
+    char* data;
+    size_t size, top;
+};
+
+/* 追加 size 字节 (8 字节对齐, 清零), 返回其偏移; 缓冲区可能被 realloc, 调用方只保存偏移 */
+static auto frost_snapshot_alloc(frost_snapshot_buffer* buf, size_t size) -> uint64_t
+{
+    size_t off = (buf->top + 7) & ~(size_t)7;
+    if (off + size > buf->size) {
+        if (buf->size == 0)
+            buf->size = 4096;
+        while (off + size > buf->size)
+            buf->size += buf->size >> 1;
+        buf->data = (char*)realloc(buf->data, buf->size);
+    }
+    memset(buf->data + buf->top, 0, off + size - buf->top);
+    buf->top = off + size;
+    return off;
+}
+
+static auto frost_snapshot_put_string(frost_snapshot_buffer* buf, const char* str, size_t len) -> uint64_t
+{
+    uint64_t off = frost_snapshot_alloc(buf, len + 1);
+    memcpy(buf->data + off, str, len);
+    return off;
+}
+
+#define SNAPSHOT_VALUE(buf, off) ((frost_snapshot_value*)((buf)->data + (off)))
+#define SNAPSHOT_MEMBER(buf, off) ((frost_snapshot_member*)((buf)->data + (off)))
+
+static void frost_snapshot_put_value(frost_snapshot_buffer* buf, uint64_t slot, const frost_value* val)
+{
+    uint64_t table = 0;
+    uint64_t str = 0;
+    size_t i = 0;
+    switch (val->type) {
+    case FROST_NUMBER:
+        SNAPSHOT_VALUE(buf, slot)->type = FROST_NUMBER;
+        SNAPSHOT_VALUE(buf, slot)->flags = frost_get_number_kind(val);
+        memcpy(&SNAPSHOT_VALUE(buf, slot)->offset, &val->u, sizeof(uint64_t));
+        break;
+    case FROST_STRING:
+        str = frost_snapshot_put_string(buf, val->u.s.s, val->u.s.len);
+        SNAPSHOT_VALUE(buf, slot)->type = FROST_STRING;
+        SNAPSHOT_VALUE(buf, slot)->size = val->u.s.len;
+        SNAPSHOT_VALUE(buf, slot)->offset = str;
+        break;
+    case FROST_ARRAY:
+        table = frost_snapshot_alloc(buf, val->u.a.size * sizeof(frost_snapshot_value));
+        SNAPSHOT_VALUE(buf, slot)->type = FROST_ARRAY;
+        SNAPSHOT_VALUE(buf, slot)->size = val->u.a.size;
+        SNAPSHOT_VALUE(buf, slot)->offset = table;
+        for (i = 0; i < val->u.a.size; i++)
+            frost_snapshot_put_value(buf, table + i * sizeof(frost_snapshot_value), &val->u.a.e[i]);
+        break;
+    case FROST_OBJECT:
+        table = frost_snapshot_alloc(buf, val->u.o.size * sizeof(frost_snapshot_member));
+        SNAPSHOT_VALUE(buf, slot)->type = FROST_OBJECT;
+        SNAPSHOT_VALUE(buf, slot)->size = val->u.o.size;
+        SNAPSHOT_VALUE(buf, slot)->offset = table;
+        for (i = 0; i < val->u.o.size; i++) {
+            uint64_t mem = table + i * sizeof(frost_snapshot_member);
+            str = frost_snapshot_put_string(buf, val->u.o.m[i].k, val->u.o.m[i].klen);
+            SNAPSHOT_MEMBER(buf, mem)->k = str;
+            SNAPSHOT_MEMBER(buf, mem)->klen = val->u.o.m[i].klen;
+            frost_snapshot_put_value(buf, mem + offsetof(frost_snapshot_member, v), &val->u.o.m[i].v);
+        }
+        break;
+    default:
+        SNAPSHOT_VALUE(buf, slot)->type = val->type;
+        break;
+    }
+}
+
+/* 先写入 path.tmp 再 rename, 正在映射旧文件的读者不受影响 */
+auto frost_snapshot_write(const frost_value* val, const char* path) -> int
+{
+    frost_snapshot_buffer buf = { nullptr, 0, 0 };
+    frost_snapshot_header* header = nullptr;
+    uint64_t root = 0;
+    size_t plen = 0;
+    char* tmp = nullptr;
+    FILE* fp = nullptr;
+    int ret = -1;
+    assert(val != nullptr && path != nullptr);
+
+    frost_snapshot_alloc(&buf, sizeof(frost_snapshot_header));
+    root = frost_snapshot_alloc(&buf, sizeof(frost_snapshot_value));
+    frost_snapshot_put_value(&buf, root, val);
+    header = (frost_snapshot_header*)buf.data;
+    memcpy(header->magic, FROST_SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = FROST_SNAPSHOT_VERSION;
+    header->endian = FROST_SNAPSHOT_ENDIAN;
+    header->size = buf.top;
+    header->root = root;
+
+    plen = strlen(path);
+    tmp = (char*)malloc(plen + 5);
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", 5);
+    fp = fopen(tmp, "wb");
+    if (fp != nullptr) {
+        size_t written = fwrite(buf.data, 1, buf.top, fp);
+        if (fclose(fp) == 0 && written == buf.top && rename(tmp, path) == 0)
+            ret = 0;
+        else
+            remove(tmp);
+    }
+    free(tmp);
+    free(buf.data);
+    return ret;
+}
+
+/* ---------------- open ---------------- */
+
+static auto frost_snapshot_check(const char* base, size_t size) -> int
+{
+    const auto* header = (const frost_snapshot_header*)base;
+    if (size < sizeof(frost_snapshot_header) + sizeof(frost_snapshot_value))
+        return 0;
+    return memcmp(header->magic, FROST_SNAPSHOT_MAGIC, sizeof(header->magic)) == 0
+        && header->version == FROST_SNAPSHOT_VERSION
+        && header->endian == FROST_SNAPSHOT_ENDIAN
+        && header->size == size
+        && header->root % 8 == 0
+        && header->root <= size - sizeof(frost_snapshot_value);
+}
+
+auto frost_snapshot_open(const char* path) -> frost_snapshot*
+{
+    frost_snapshot* snap = nullptr;
+    char* base = nullptr;
+    size_t size = 0;
+    assert(path != nullptr);
+#if FROST_SNAPSHOT_MMAP
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    size = (size_t)st.st_size;
+    base = (char*)mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == (char*)MAP_FAILED)
+        return nullptr;
+    if (frost_snapshot_check(base, size) == 0) {
+        munmap(base, size);
+        return nullptr;
+    }
+#else
+    FILE* fp = fopen(path, "rb");
+    if (fp == nullptr)
+        return nullptr;
+    fseek(fp, 0, SEEK_END);
+    size = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    base = (char*)malloc(size > 0 ? size : 1);
+    if (fread(base, 1, size, fp) != size || frost_snapshot_check(base, size) == 0) {
+        fclose(fp);
+        free(base);
+        return nullptr;
+    }
+    fclose(fp);
+#endif
+    snap = (frost_snapshot*)malloc(sizeof(frost_snapshot));
+    snap->base = base;
+    snap->size = size;
+    return snap;
+}
+
+void frost_snapshot_close(frost_snapshot* snap)
+{
+    if (snap == nullptr)
+        return;
+#if FROST_SNAPSHOT_MMAP
+    munmap((void*)snap->base, snap->size);
+#else
+    free((void*)snap->base);
+#endif
+    free(snap);
+}
+
+/* ---------------- read ---------------- */
+
+/* 节点只保存偏移, 定位数据需要映像起始地址, 因此读取接口都带 snap 参数 */
+#define SNAPSHOT_AT(snap, off) ((snap)->base + (off))
+
+auto frost_snapshot_root(const frost_snapshot* snap) -> const frost_snapshot_value*
+{
+    assert(snap != nullptr);
+    return (const frost_snapshot_value*)SNAPSHOT_AT(snap, ((const frost_snapshot_header*)snap->base)->root);
+}
+
+auto frost_snapshot_get_type(const frost_snapshot_value* val) -> frost_type
+{
+    assert(val != nullptr);
+    return (frost_type)val->type;
+}
+
+auto frost_snapshot_get_boolean(const frost_snapshot_value* val) -> int
+{
+    assert(val != nullptr && (val->type == FROST_TRUE || val->type == FROST_FALSE));
+    return val->type == FROST_TRUE;
+}
+
+auto frost_snapshot_get_number(const frost_snapshot_value* val) -> double
+{
+    double num = 0.0;
+    assert(val != nullptr && val->type == FROST_NUMBER);
+    if ((val->flags & FROST_FLAG_INT64) != 0)
+        return (double)(int64_t)val->offset;
+    if ((val->flags & FROST_FLAG_UINT64) != 0)
+        return (double)val->offset;
+    memcpy(&num, &val->offset, sizeof(num));
+    return num;
+}
+
+auto frost_snapshot_get_string(const frost_snapshot* snap, const frost_snapshot_value* val) -> const char*
+{
+    assert(snap != nullptr && val != nullptr && val->type == FROST_STRING);
+    return SNAPSHOT_AT(snap, val->offset);
+}
+
+auto frost_snapshot_get_string_length(const frost_snapshot_value* val) -> size_t
+{
+    assert(val != nullptr && val->type == FROST_STRING);
+    return (size_t)val->size;
+}
+
+auto frost_snapshot_get_array_size(const frost_snapshot_value* val) -> size_t
+{
+    assert(val != nullptr && val->type == FROST_ARRAY);
+    return (size_t)val->size;
+}
+
+auto frost_snapshot_get_array_element(const frost_snapshot* snap, const frost_snapshot_value* val, size_t index) -> const frost_snapshot_value*
+{
+    assert(snap != nullptr && val != nullptr && val->type == FROST_ARRAY);
+    assert(index < val->size);
+    return (const frost_snapshot_value*)SNAPSHOT_AT(snap, val->offset) + index;
+}
+
+auto frost_snapshot_get_object_size(const frost_snapshot_value* val) -> size_t
+{
+    assert(val != nullptr && val->type == FROST_OBJECT);
+    return (size_t)val->size;
+}
+
+static auto frost_snapshot_member_at(const frost_snapshot* snap, const frost_snapshot_value* val, size_t index) -> const frost_snapshot_member*
+{
+    assert(snap != nullptr && val != nullptr && val->type == FROST_OBJECT);
+    assert(index < val->size);
+    return (const frost_snapshot_member*)SNAPSHOT_AT(snap, val->offset) + index;
+}
+
+auto frost_snapshot_get_object_key(const frost_snapshot* snap, const frost_snapshot_value* val, size_t index) -> const char*
+{
+    return SNAPSHOT_AT(snap, frost_snapshot_member_at(snap, val, index)->k);
+}
+
+auto frost_snapshot_get_object_key_length(const frost_snapshot* snap, const frost_snapshot_value* val, size_t index) -> size_t
+{
+    return (size_t)frost_snapshot_member_at(snap, val, index)->klen;
+}
+
+auto frost_snapshot_get_object_value(const frost_snapshot* snap, const frost_snapshot_value* val, size_t index) -> const frost_snapshot_value*
+{
+    return &frost_snapshot_member_at(snap, val, index)->v;
+}
+
+auto frost_snapshot_find_object_index(const frost_snapshot* snap, const frost_snapshot_value* val, const char* key, size_t klen) -> size_t
+{
+    size_t i = 0;
+    const frost_snapshot_member* mem = nullptr;
+    assert(snap != nullptr && val != nullptr && val->type == FROST_OBJECT && key != nullptr);
+    mem = (const frost_snapshot_member*)SNAPSHOT_AT(snap, val->offset);
+    for (i = 0; i < val->size; i++)
+        if (mem[i].klen == klen && memcmp(SNAPSHOT_AT(snap, mem[i].k), key, klen) == 0)
+            return i;
+    return FROST_KEY_NOT_EXIST;
+}
+
+auto frost_snapshot_find_object_value(const frost_snapshot* snap, const frost_snapshot_value* val, const char* key, size_t klen) -> const frost_snapshot_value*
+{
+    size_t index = frost_snapshot_find_object_index(snap, val, key, klen);
+    return index != FROST_KEY_NOT_EXIST ? frost_snapshot_get_object_value(snap, val, index) : nullptr;
+}
+
+void frost_snapshot_copy(frost_value* dst, const frost_snapshot* snap, const frost_snapshot_value* src)
+{
+    size_t i = 0;
+    assert(dst != nullptr && snap != nullptr && src != nullptr);
+    switch (src->type) {
+    case FROST_NUMBER:
+        if ((src->flags & FROST_FLAG_INT64) != 0)
+            frost_set_int64(dst, (int64_t)src->offset);
+        else if ((src->flags & FROST_FLAG_UINT64) != 0)
+            frost_set_uint64(dst, src->offset);
+        else
+            frost_set_number(dst, frost_snapshot_get_number(src));
+        break;
+    case FROST_STRING:
+        frost_set_string(dst, SNAPSHOT_AT(snap, src->offset), (size_t)src->size);
+        break;
+    case FROST_ARRAY:
+        frost_set_array(dst, (size_t)src->size);
+        for (i = 0; i < src->size; i++) {
+            frost_value* elem = &dst->u.a.e[dst->u.a.size++];
+            frost_init(elem);
+            frost_snapshot_copy(elem, snap, frost_snapshot_get_array_element(snap, src, i));
+        }
+        break;
+    case FROST_OBJECT:
+        frost_set_object(dst, (size_t)src->size);
+        for (i = 0; i < src->size; i++) {
+            const frost_snapshot_member* smem = frost_snapshot_member_at(snap, src, i);
+            frost_member* mem = &dst->u.o.m[dst->u.o.size++];
+            mem->klen = (size_t)smem->klen;
+            mem->k = (char*)malloc(mem->klen + 1);
+            memcpy(mem->k, SNAPSHOT_AT(snap, smem->k), mem->klen + 1);
+            frost_init(&mem->v);
+            frost_snapshot_copy(&mem->v, snap, &smem->v);
+        }
+        break;
+    default:
+        frost_free(dst);
+        dst->type = (frost_type)src->type;
+        break;
+    }
+}
@@ -0,0 +1,839 @@
+#include "frostjson.h"
+#include "frostjson.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * frostjson_microbench: 容器与访问 API 的逐函数微基准 (Google Benchmark)
+ *
+ * 每个基准在 1 ~ 1M 的规模上运行并拟合复杂度曲线 (_BigO / _RMS 行).
+ * allocs/iter 与 bytes/iter 只统计计时区间内的 malloc/realloc/calloc,
+ * 用于观察扩容策略等对分配次数的影响.
+ *
+ * 会改变规模的操作 (insert/erase/remove/...) 在暂停计时后恢复原规模,
+ * 因此每次迭代都作用在大小为 N 的容器上.
+ */
+
+/* 分配计数: 在 glibc 上替换 malloc 系列函数, 仅在计时区间内计数 */
+static bool micro_counting = false;
+static size_t micro_allocs = 0;
+static size_t micro_bytes = 0;
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size)
+{
+    if (micro_counting) {
+        micro_allocs++;
+        micro_bytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    if (micro_counting) {
+        micro_allocs++;
+        micro_bytes += size;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    if (micro_counting) {
+        micro_allocs++;
+        micro_bytes += count * size;
+    }
+    return __libc_calloc(count, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+}
+#endif
+
+/* 在计时开关处同步打开/关闭分配计数 */
+static void micro_begin(benchmark::State&)
+{
+    micro_allocs = micro_bytes = 0;
+    micro_counting = true;
+}
+
+static void micro_pause(benchmark::State& st)
+{
+    micro_counting = false;
+    st.PauseTiming();
+}
+
+static void micro_resume(benchmark::State& st)
+{
+    st.ResumeTiming();
+    micro_counting = true;
+}
+
+static void micro_end(benchmark::State& st)
+{
+    micro_counting = false;
+    st.counters["allocs/iter"] = benchmark::Counter((double)micro_allocs, benchmark::Counter::kAvgIterations);
+    st.counters["bytes/iter"] = benchmark::Counter((double)micro_bytes, benchmark::Counter::kAvgIterations);
+    st.SetComplexityN(st.range(0));
+}
+
+static void micro_make_array(frost_value* arr, size_t size, size_t capacity)
+{
+    frost_init(arr);
+    frost_set_array(arr, capacity);
+    for (size_t i = 0; i < size; i++)
+        frost_set_number(frost_pushback_array_element(arr), (double)i);
+}
+
+static auto micro_keys(size_t count) -> std::vector<std::string>
+{
+    std::vector<std::string> keys(count);
+    for (size_t i = 0; i < count; i++)
+        keys[i] = "key" + std::to_string(i);
+    return keys;
+}
+
+/* 直接填充成员以 O(N) 构造大对象; frost_set_object_value 逐个插入是 O(N^2) */
+static void micro_make_object(frost_value* obj, const std::vector<std::string>& keys, size_t capacity)
+{
+    frost_init(obj);
+    frost_set_object(obj, capacity);
+    for (size_t i = 0; i < keys.size(); i++) {
+        frost_member* mem = &obj->u.o.m[i];
+        mem->klen = keys[i].size();
+        mem->k = (char*)malloc(mem->klen + 1);
+        memcpy(mem->k, keys[i].c_str(), mem->klen + 1);
+        frost_init(&mem->v);
+        frost_set_number(&mem->v, (double)i);
+    }
+    obj->u.o.size = keys.size();
+}
+
+#define MICRO_RANGE(fn) BENCHMARK(fn)->RangeMultiplier(8)->Range(1, 1 << 20)->Complexity()
+/* 当前实现为 O(N^2) 的操作限制规模, 避免单个基准运行数分钟 */
+#define MICRO_RANGE_SMALL(fn) BENCHMARK(fn)->RangeMultiplier(8)->Range(1, 1 << 15)->Complexity()
+
+/* ---------------- array ---------------- */
+
+static void BM_set_array(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    frost_init(&arr);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_set_array(&arr, n);
+        benchmark::DoNotOptimize(arr.u.a.e);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_set_array);
+
+static void BM_pushback_array_element_build(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    frost_init(&arr);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_set_array(&arr, 0);
+        for (size_t i = 0; i < n; i++)
+            frost_set_number(frost_pushback_array_element(&arr), (double)i);
+        micro_pause(st);
+        frost_free(&arr);
+        micro_resume(st);
+    }
+    micro_end(st);
+}
+MICRO_RANGE(BM_pushback_array_element_build);
+
+static void BM_pushback_array_element(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    micro_make_array(&arr, n, n + 1);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_set_number(frost_pushback_array_element(&arr), 1.0);
+        micro_pause(st);
+        frost_popback_array_element(&arr);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_pushback_array_element);
+
+static void BM_popback_array_element(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    micro_make_array(&arr, n, n);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_popback_array_element(&arr);
+        micro_pause(st);
+        frost_set_number(frost_pushback_array_element(&arr), 1.0);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_popback_array_element);
+
+static void BM_insert_array_element_front(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    micro_make_array(&arr, n, n + 1);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_set_number(frost_insert_array_element(&arr, 0), 1.0);
+        micro_pause(st);
+        frost_popback_array_element(&arr);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_insert_array_element_front);
+
+static void BM_insert_array_element_middle(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    micro_make_array(&arr, n, n + 1);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_set_number(frost_insert_array_element(&arr, n / 2), 1.0);
+        micro_pause(st);
+        frost_popback_array_element(&arr);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_insert_array_element_middle);
+
+static void BM_erase_array_element_front(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    micro_make_array(&arr, n, n);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_erase_array_element(&arr, 0, 1);
+        micro_pause(st);
+        frost_set_number(frost_pushback_array_element(&arr), 1.0);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_erase_array_element_front);
+
+static void BM_erase_array_element_back(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    micro_make_array(&arr, n, n);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_erase_array_element(&arr, n - 1, 1);
+        micro_pause(st);
+        frost_set_number(frost_pushback_array_element(&arr), 1.0);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_erase_array_element_back);
+
+static void BM_get_array_element(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    size_t i = 0;
+    frost_value arr;
+    micro_make_array(&arr, n, n);
+    micro_begin(st);
+    for (auto _ : st) {
+        benchmark::DoNotOptimize(frost_get_number(frost_get_array_element(&arr, i)));
+        if (++i == n)
+            i = 0;
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_get_array_element);
+
+static void BM_shrink_array(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    micro_make_array(&arr, n, n * 2);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_shrink_array(&arr);
+        micro_pause(st);
+        frost_reserve_array(&arr, n * 2);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_shrink_array);
+
+static void BM_clear_array(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    micro_make_array(&arr, n, n);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_clear_array(&arr);
+        micro_pause(st);
+        for (size_t i = 0; i < n; i++)
+            frost_set_number(frost_pushback_array_element(&arr), (double)i);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_clear_array);
+
+static void BM_copy_array(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr, dst;
+    micro_make_array(&arr, n, n);
+    frost_init(&dst);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_copy(&dst, &arr);
+        micro_pause(st);
+        frost_free(&dst);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&arr);
+}
+MICRO_RANGE(BM_copy_array);
+
+static void BM_free_array(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value arr;
+    frost_init(&arr);
+    micro_begin(st);
+    for (auto _ : st) {
+        micro_pause(st);
+        micro_make_array(&arr, n, n);
+        micro_resume(st);
+        frost_free(&arr);
+    }
+    micro_end(st);
+}
+MICRO_RANGE(BM_free_array);
+
+/* ---------------- object ---------------- */
+
+static void BM_set_object(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value obj;
+    frost_init(&obj);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_set_object(&obj, n);
+        benchmark::DoNotOptimize(obj.u.o.m);
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_set_object);
+
+static void BM_set_object_value_new(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value obj;
+    micro_make_object(&obj, micro_keys(n), n + 1);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_set_number(frost_set_object_value(&obj, "new", 3), 1.0);
+        micro_pause(st);
+        frost_remove_object_value(&obj, n);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_set_object_value_new);
+
+static void BM_set_object_value_existing(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    const std::string& last = keys[n - 1];
+    frost_value obj;
+    micro_make_object(&obj, keys, n);
+    micro_begin(st);
+    for (auto _ : st)
+        benchmark::DoNotOptimize(frost_set_object_value(&obj, last.c_str(), last.size()));
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_set_object_value_existing);
+
+static void BM_find_object_index_first(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    frost_value obj;
+    micro_make_object(&obj, keys, n);
+    micro_begin(st);
+    for (auto _ : st)
+        benchmark::DoNotOptimize(frost_find_object_index(&obj, keys[0].c_str(), keys[0].size()));
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_find_object_index_first);
+
+static void BM_find_object_index_last(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    const std::string& last = keys[n - 1];
+    frost_value obj;
+    micro_make_object(&obj, keys, n);
+    micro_begin(st);
+    for (auto _ : st)
+        benchmark::DoNotOptimize(frost_find_object_index(&obj, last.c_str(), last.size()));
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_find_object_index_last);
+
+static void BM_find_object_index_miss(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value obj;
+    micro_make_object(&obj, micro_keys(n), n);
+    micro_begin(st);
+    for (auto _ : st)
+        benchmark::DoNotOptimize(frost_find_object_index(&obj, "missing", 7));
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_find_object_index_miss);
+
+static void BM_find_object_value(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    size_t i = 0;
+    frost_value obj;
+    micro_make_object(&obj, keys, n);
+    micro_begin(st);
+    for (auto _ : st) {
+        benchmark::DoNotOptimize(frost_find_object_value(&obj, keys[i].c_str(), keys[i].size()));
+        if (++i == n)
+            i = 0;
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_find_object_value);
+
+/* 同上, 对象先经 frost_sort_object 排序, 查找为二分 */
+static void BM_find_object_value_sorted(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    size_t i = 0;
+    frost_value obj;
+    micro_make_object(&obj, keys, n);
+    frost_sort_object(&obj);
+    micro_begin(st);
+    for (auto _ : st) {
+        benchmark::DoNotOptimize(frost_find_object_value(&obj, keys[i].c_str(), keys[i].size()));
+        if (++i == n)
+            i = 0;
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_find_object_value_sorted);
+
+/* 固定 16 个字段的消息: 逐键 frost_find_object_value 与编译期完美哈希一次遍历取全部字段 */
+static constexpr auto micro_schema = frost::make_key_table(
+    "key0", "key1", "key2", "key3", "key4", "key5", "key6", "key7",
+    "key8", "key9", "key10", "key11", "key12", "key13", "key14", "key15");
+
+static void BM_find_object_value_schema(benchmark::State& st)
+{
+    frost_value obj;
+    micro_make_object(&obj, micro_keys(micro_schema.size()), micro_schema.size());
+    micro_begin(st);
+    for (auto _ : st) {
+        for (size_t i = 0; i < micro_schema.size(); i++)
+            benchmark::DoNotOptimize(frost_find_object_value(&obj, micro_schema.key(i), micro_schema.key_length(i)));
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+BENCHMARK(BM_find_object_value_schema)->Arg(micro_schema.size());
+
+static void BM_find_object_values_key_table(benchmark::State& st)
+{
+    frost_value obj;
+    frost_value* out[micro_schema.size()];
+    micro_make_object(&obj, micro_keys(micro_schema.size()), micro_schema.size());
+    micro_begin(st);
+    for (auto _ : st) {
+        benchmark::DoNotOptimize(frost::find_object_values(micro_schema, &obj, out));
+        benchmark::DoNotOptimize(out);
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+BENCHMARK(BM_find_object_values_key_table)->Arg(micro_schema.size());
+
+static void BM_get_object_value(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    size_t i = 0;
+    frost_value obj;
+    micro_make_object(&obj, micro_keys(n), n);
+    micro_begin(st);
+    for (auto _ : st) {
+        benchmark::DoNotOptimize(frost_get_object_key(&obj, i));
+        benchmark::DoNotOptimize(frost_get_object_value(&obj, i));
+        if (++i == n)
+            i = 0;
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_get_object_value);
+
+static void BM_remove_object_value_front(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value obj;
+    micro_make_object(&obj, micro_keys(n), n);
+    micro_begin(st);
+    for (auto _ : st) {
+        micro_pause(st);
+        std::string key(frost_get_object_key(&obj, 0), frost_get_object_key_length(&obj, 0));
+        micro_resume(st);
+        frost_remove_object_value(&obj, 0);
+        micro_pause(st);
+        frost_set_number(frost_set_object_value(&obj, key.c_str(), key.size()), 1.0);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_remove_object_value_front);
+
+static void BM_remove_object_value_back(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    const std::string& last = keys[n - 1];
+    frost_value obj;
+    micro_make_object(&obj, keys, n);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_remove_object_value(&obj, n - 1);
+        micro_pause(st);
+        frost_set_number(frost_set_object_value(&obj, last.c_str(), last.size()), 1.0);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_remove_object_value_back);
+
+static void BM_shrink_object(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value obj;
+    micro_make_object(&obj, micro_keys(n), n * 2);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_shrink_object(&obj);
+        micro_pause(st);
+        frost_reserve_object(&obj, n * 2);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE(BM_shrink_object);
+
+static void BM_clear_object(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    frost_value obj;
+    frost_init(&obj);
+    micro_begin(st);
+    for (auto _ : st) {
+        micro_pause(st);
+        micro_make_object(&obj, keys, n);
+        micro_resume(st);
+        frost_clear_object(&obj);
+        micro_pause(st);
+        frost_free(&obj);
+        micro_resume(st);
+    }
+    micro_end(st);
+}
+MICRO_RANGE(BM_clear_object);
+
+static void BM_copy_object(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    frost_value obj, dst;
+    micro_make_object(&obj, micro_keys(n), n);
+    frost_init(&dst);
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_copy(&dst, &obj);
+        micro_pause(st);
+        frost_free(&dst);
+        micro_resume(st);
+    }
+    micro_end(st);
+    frost_free(&obj);
+}
+MICRO_RANGE_SMALL(BM_copy_object);
+
+static void BM_is_equal_object(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    frost_value lhs, rhs;
+    micro_make_object(&lhs, keys, n);
+    micro_make_object(&rhs, keys, n);
+    micro_begin(st);
+    for (auto _ : st)
+        benchmark::DoNotOptimize(frost_is_equal(&lhs, &rhs));
+    micro_end(st);
+    frost_free(&lhs);
+    frost_free(&rhs);
+}
+MICRO_RANGE_SMALL(BM_is_equal_object);
+
+/* 两侧成员顺序相反; 排序后逐个对齐比较 */
+static void BM_is_equal_object_sorted(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    frost_value lhs, rhs;
+    micro_make_object(&lhs, keys, n);
+    micro_make_object(&rhs, keys, n);
+    std::reverse(rhs.u.o.m, rhs.u.o.m + n);
+    frost_sort_object(&lhs);
+    frost_sort_object(&rhs);
+    micro_begin(st);
+    for (auto _ : st)
+        benchmark::DoNotOptimize(frost_is_equal(&lhs, &rhs));
+    micro_end(st);
+    frost_free(&lhs);
+    frost_free(&rhs);
+}
+MICRO_RANGE(BM_is_equal_object_sorted);
+
+static void BM_free_object(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    auto keys = micro_keys(n);
+    frost_value obj;
+    frost_init(&obj);
+    micro_begin(st);
+    for (auto _ : st) {
+        micro_pause(st);
+        micro_make_object(&obj, keys, n);
+        micro_resume(st);
+        frost_free(&obj);
+    }
+    micro_end(st);
+}
+MICRO_RANGE(BM_free_object);
+
+/* ---------------- query ---------------- */
+
+/* {"items":[{"id":i,"name":"item","price":i}, ...]}, 取出全部 price 求和 */
+static void micro_make_items(frost_value* doc, size_t size)
+{
+    frost_value* items = nullptr;
+    frost_init(doc);
+    frost_set_object(doc, 1);
+    items = frost_set_object_value(doc, "items", 5);
+    frost_set_array(items, size);
+    for (size_t i = 0; i < size; i++) {
+        frost_value* item = frost_pushback_array_element(items);
+        frost_set_object(item, 3);
+        frost_set_number(frost_set_object_value(item, "id", 2), (double)i);
+        frost_set_string(frost_set_object_value(item, "name", 4), "item", 4);
+        frost_set_number(frost_set_object_value(item, "price", 5), (double)i);
+    }
+}
+
+static auto micro_sum_price(const frost_value* val, void* user) -> int
+{
+    *(double*)user += frost_get_number(val);
+    return 0;
+}
+
+static void BM_query_run(benchmark::State& st)
+{
+    frost_value doc;
+    frost_query* q = frost_query_compile("$.items[*].price");
+    double sum = 0.0;
+    micro_make_items(&doc, (size_t)st.range(0));
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_query_run(q, &doc, micro_sum_price, &sum);
+        benchmark::DoNotOptimize(sum);
+    }
+    micro_end(st);
+    frost_query_free(q);
+    frost_free(&doc);
+}
+MICRO_RANGE(BM_query_run);
+
+/* 同上, 以 frost_find_object_value / frost_get_array_element 手写 */
+static void BM_query_manual(benchmark::State& st)
+{
+    frost_value doc;
+    double sum = 0.0;
+    micro_make_items(&doc, (size_t)st.range(0));
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_value* items = frost_find_object_value(&doc, "items", 5);
+        for (size_t i = 0; i < frost_get_array_size(items); i++)
+            sum += frost_get_number(frost_find_object_value(frost_get_array_element(items, i), "price", 5));
+        benchmark::DoNotOptimize(sum);
+    }
+    micro_end(st);
+    frost_free(&doc);
+}
+MICRO_RANGE(BM_query_manual);
+
+/* ---------------- compact ---------------- */
+
+/* 同 micro_make_items, 但每个节点之间穿插其他分配后再释放, 使节点在堆上分散 */
+static void micro_make_scattered(frost_value* doc, size_t size)
+{
+    std::vector<void*> junk;
+    frost_value* items = nullptr;
+    frost_init(doc);
+    frost_set_object(doc, 1);
+    items = frost_set_object_value(doc, "items", 5);
+    frost_set_array(items, size);
+    for (size_t i = 0; i < size; i++) {
+        frost_value* item = frost_pushback_array_element(items);
+        frost_set_object(item, 3);
+        junk.push_back(malloc(64 + i % 7 * 48));
+        frost_set_number(frost_set_object_value(item, "id", 2), (double)i);
+        frost_set_string(frost_set_object_value(item, "name", 4), "item", 4);
+        junk.push_back(malloc(64 + i % 5 * 48));
+        frost_set_number(frost_set_object_value(item, "price", 5), (double)i);
+    }
+    for (void* p : junk)
+        free(p);
+}
+
+/* 以 frost_stringify 走遍整棵树, 比较紧凑化前后的遍历速度 */
+static void micro_walk(benchmark::State& st, int compact)
+{
+    frost_value doc;
+    micro_make_scattered(&doc, (size_t)st.range(0));
+    if (compact != 0)
+        frost_compact(&doc);
+    micro_begin(st);
+    for (auto _ : st) {
+        size_t len = 0;
+        char* json = frost_stringify(&doc, &len);
+        benchmark::DoNotOptimize(json);
+        free(json);
+    }
+    micro_end(st);
+    frost_free(&doc);
+}
+
+static void BM_walk_scattered(benchmark::State& st) { micro_walk(st, 0); }
+MICRO_RANGE(BM_walk_scattered);
+
+static void BM_walk_compact(benchmark::State& st) { micro_walk(st, 1); }
+MICRO_RANGE(BM_walk_compact);
+
+/* ---------------- writer ---------------- */
+
+/* 输出 {"items":[{"id":i,"name":"item","price":i}, ...]}: 先建树再 frost_stringify */
+static void BM_build_stringify(benchmark::State& st)
+{
+    micro_begin(st);
+    for (auto _ : st) {
+        frost_value doc;
+        size_t len = 0;
+        micro_make_items(&doc, (size_t)st.range(0));
+        char* json = frost_stringify(&doc, &len);
+        benchmark::DoNotOptimize(json);
+        free(json);
+        frost_free(&doc);
+    }
+    micro_end(st);
+}
+MICRO_RANGE(BM_build_stringify);
+
+/* 同上, 以 frost_writer 直接输出, 复用缓冲区 */
+static void BM_writer(benchmark::State& st)
+{
+    frost_writer* wtr = frost_writer_open(nullptr, nullptr);
+    micro_begin(st);
+    for (auto _ : st) {
+        size_t len = 0;
+        frost_writer_reset(wtr);
+        frost_writer_begin_object(wtr);
+        frost_writer_key(wtr, "items", 5);
+        frost_writer_begin_array(wtr);
+        for (size_t i = 0; i < (size_t)st.range(0); i++) {
+            frost_writer_begin_object(wtr);
+            frost_writer_key(wtr, "id", 2);
+            frost_writer_number(wtr, (double)i);
+            frost_writer_key(wtr, "name", 4);
+            frost_writer_string(wtr, "item", 4);
+            frost_writer_key(wtr, "price", 5);
+            frost_writer_number(wtr, (double)i);
+            frost_writer_end(wtr);
+        }
+        frost_writer_end(wtr);
+        frost_writer_end(wtr);
+        benchmark::DoNotOptimize(frost_writer_get_output(wtr, &len));
+    }
+    micro_end(st);
+    frost_writer_close(wtr);
+}
+MICRO_RANGE(BM_writer);
+
+BENCHMARK_MAIN();
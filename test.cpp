@@ -1,7 +1,11 @@
 #include "frostjson.h"
+#include "frostjson.hpp"
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <atomic>
+#include <thread>
 
 static int main_ret = 0;
 static int test_count = 0;
@@ -35,6 +39,7 @@ static int test_pass = 0;
 
 static void test_parse_null() {
     frost_value val;
+    frost_init(&val);
     val.type = FROST_FALSE;
     frost_set_boolean(&val, 0);
     EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&val, "null"));
@@ -44,6 +49,7 @@ static void test_parse_null() {
 
 static void test_parse_true() {
     frost_value val;
+    frost_init(&val);
     val.type = FROST_FALSE;
     frost_set_boolean(&val, 0);
     EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&val, "true"));
@@ -53,6 +59,7 @@ static void test_parse_true() {
 
 static void test_parse_false() {
     frost_value val;
+    frost_init(&val);
     val.type = FROST_TRUE;
     frost_set_boolean(&val, 1);
     EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&val, "false"));
@@ -103,6 +110,51 @@ static void test_parse_number(){
     TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
 }
 
+#define TEST_INT64(expect, json)\
+    do {\
+        frost_value v;\
+        frost_init(&v);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, json));\
+        EXPECT_EQ_INT(FROST_NUMBER, frost_get_type(&v));\
+        EXPECT_TRUE(v.flags & FROST_FLAG_INT64);\
+        EXPECT_TRUE(frost_get_int64(&v) == (expect));\
+        frost_free(&v);\
+    } while(0)
+
+static void test_parse_integer() {
+    frost_value v;
+    TEST_INT64(0, "0");
+    TEST_INT64(1, "1");
+    TEST_INT64(-1, "-1");
+    TEST_INT64(9007199254740993LL, "9007199254740993"); /* 2^53 + 1, double 无法表示 */
+    TEST_INT64(INT64_MAX, "9223372036854775807");
+    TEST_INT64(INT64_MIN, "-9223372036854775808");
+
+    frost_init(&v);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "18446744073709551615"));
+    EXPECT_TRUE(v.flags & FROST_FLAG_UINT64);
+    EXPECT_TRUE(frost_get_uint64(&v) == UINT64_MAX);
+    EXPECT_TRUE(frost_get_int64(&v) == INT64_MAX);
+    EXPECT_EQ_DOUBLE(18446744073709551615.0, frost_get_number(&v));
+
+    /* 超出 64 位范围, 或带小数/指数, 或 "-0": 仍为 double */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "18446744073709551616"));
+    EXPECT_FALSE(v.flags & FROST_FLAG_INTEGER);
+    EXPECT_EQ_DOUBLE(18446744073709551616.0, frost_get_number(&v));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "-9223372036854775809"));
+    EXPECT_FALSE(v.flags & FROST_FLAG_INTEGER);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "123456789012345678901234"));
+    EXPECT_FALSE(v.flags & FROST_FLAG_INTEGER);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "-0"));
+    EXPECT_FALSE(v.flags & FROST_FLAG_INTEGER);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "1.0"));
+    EXPECT_FALSE(v.flags & FROST_FLAG_INTEGER);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "1e2"));
+    EXPECT_FALSE(v.flags & FROST_FLAG_INTEGER);
+    EXPECT_TRUE(frost_get_int64(&v) == 100);
+    frost_free(&v);
+}
+
 #define TEST_STRING(expect, json)\
     do {\
         frost_value v;\
@@ -344,11 +396,179 @@ static void test_parse_miss_comma_or_curly_bracket() {
     TEST_PARSE_ERROR(FROST_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{}");
 }
 
+#define TEST_UTF8(error, json)\
+    do {\
+        frost_value v;\
+        frost_parse_options opt = {};\
+        opt.flags = FROST_PARSE_VALIDATE_UTF8;\
+        frost_init(&v);\
+        EXPECT_EQ_INT(error, frost_parse_with_options(&v, json, &opt));\
+        EXPECT_EQ_INT(error == FROST_PARSE_OK ? FROST_STRING : FROST_NULL, frost_get_type(&v));\
+        frost_free(&v);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, json));\
+        frost_free(&v);\
+    } while(0)
+
+/* 在不同长度的 ASCII 前后缀之间放入 seq, 覆盖 16 字节块边界上的各种位置 */
+static void test_utf8_padded(int error, const char* seq) {
+    char json[256];
+    size_t n = strlen(seq);
+    for (size_t pre = 0; pre < 40; pre++)
+        for (size_t post = 0; post < 20; post += 3) {
+            size_t k = 0;
+            json[k++] = '"';
+            memset(json + k, 'a', pre);
+            k += pre;
+            memcpy(json + k, seq, n);
+            k += n;
+            memset(json + k, 'b', post);
+            k += post;
+            json[k++] = '"';
+            json[k] = '\0';
+            TEST_UTF8(error, json);
+        }
+}
+
+static void test_parse_invalid_utf8() {
+    TEST_UTF8(FROST_PARSE_OK, "\"\xC2\xA2\xE2\x82\xAC\xF0\x9D\x84\x9E\"");
+    TEST_UTF8(FROST_PARSE_OK, "\"\xED\x9F\xBF\xEE\x80\x80\xF4\x8F\xBF\xBF\"");  /* U+D7FF U+E000 U+10FFFF */
+    TEST_UTF8(FROST_PARSE_OK, "\"\\uD834\\uDD1E \xE4\xBD\xA0\xE5\xA5\xBD\\n\"");
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\x80\"");                 /* 孤立的续字节 */
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xC0\xAF\"");             /* 过长编码 */
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xE0\x80\xAF\"");
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xF0\x80\x80\xAF\"");
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"");         /* 代理项 U+D800 */
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xF4\x90\x80\x80\"");     /* 超过 U+10FFFF */
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xF5\x80\x80\x80\"");
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xFF\"");
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xE2\x82\"");             /* 截断 */
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xE2\x82\\n\xAC\"");      /* 被转义打断 */
+    TEST_UTF8(FROST_PARSE_INVALID_UTF8, "\"\xC2\xA2\xC2\"");
+
+    test_utf8_padded(FROST_PARSE_OK, "\xC2\xA2");
+    test_utf8_padded(FROST_PARSE_OK, "\xE2\x82\xAC\xF0\x9D\x84\x9E\xF4\x8F\xBF\xBF");
+    test_utf8_padded(FROST_PARSE_INVALID_UTF8, "\x80");
+    test_utf8_padded(FROST_PARSE_INVALID_UTF8, "\xC0\xAF");
+    test_utf8_padded(FROST_PARSE_INVALID_UTF8, "\xED\xA0\x80");
+    test_utf8_padded(FROST_PARSE_INVALID_UTF8, "\xF4\x90\x80\x80");
+    test_utf8_padded(FROST_PARSE_INVALID_UTF8, "\xE2\x82");
+    test_utf8_padded(FROST_PARSE_INVALID_UTF8, "\xF0\x9D\x84");
+    test_utf8_padded(FROST_PARSE_INVALID_UTF8, "\xC2\xA2\xA2");
+}
+
+#define TEST_LIMIT(error, json, field, limit)\
+    do {\
+        frost_value v;\
+        frost_parse_options opt = {};\
+        opt.field = limit;\
+        frost_init(&v);\
+        EXPECT_EQ_INT(error, frost_parse_with_options(&v, json, &opt));\
+        if (error != FROST_PARSE_OK)\
+            EXPECT_EQ_INT(FROST_NULL, frost_get_type(&v));\
+        frost_free(&v);\
+    } while(0)
+
+static void test_parse_limits() {
+    frost_parse_options opt = {};
+    frost_reader* rdr;
+    frost_value v;
+    std::string big;
+
+    TEST_LIMIT(FROST_PARSE_OK, "[[[]]]", max_depth, 3);
+    TEST_LIMIT(FROST_PARSE_DEPTH_EXCEEDED, "[[[[]]]]", max_depth, 3);
+    TEST_LIMIT(FROST_PARSE_DEPTH_EXCEEDED, "{\"a\":[{\"b\":1}]}", max_depth, 2);
+    TEST_LIMIT(FROST_PARSE_OK, "\"abcd\"", max_string, 4);
+    TEST_LIMIT(FROST_PARSE_STRING_TOO_LONG, "\"abcde\"", max_string, 4);
+    TEST_LIMIT(FROST_PARSE_STRING_TOO_LONG, "\"abc\\n\\t\"", max_string, 4);
+    TEST_LIMIT(FROST_PARSE_OK, "\"ab\\u00e9\"", max_string, 4);
+    TEST_LIMIT(FROST_PARSE_STRING_TOO_LONG, "\"abc\\u00e9\"", max_string, 4);
+    TEST_LIMIT(FROST_PARSE_STRING_TOO_LONG, "{\"abcde\":1}", max_string, 4);
+    TEST_LIMIT(FROST_PARSE_OK, "[1,2,3]", max_elements, 3);
+    TEST_LIMIT(FROST_PARSE_TOO_MANY_ELEMENTS, "[1,2,3,4]", max_elements, 3);
+    TEST_LIMIT(FROST_PARSE_TOO_MANY_ELEMENTS, "[[1],{\"a\":1,\"b\":2,\"c\":3,\"d\":4}]", max_elements, 3);
+    TEST_LIMIT(FROST_PARSE_OK, "-1.5e10", max_digits, 7);
+    TEST_LIMIT(FROST_PARSE_NUMBER_TOO_LONG, "-1.5e100", max_digits, 7);
+    TEST_LIMIT(FROST_PARSE_NUMBER_TOO_LONG, "[1,12345678]", max_digits, 7);
+    TEST_LIMIT(FROST_PARSE_OK, "[\"a\",{\"k\":\"v\"}]", max_bytes, 4096);
+    TEST_LIMIT(FROST_PARSE_MEMORY_EXCEEDED, "[\"a\",{\"k\":\"v\"}]", max_bytes, 64);
+
+    /* 在累计到上限时就失败, 不会先把整个大字符串或大数组放进解析栈 */
+    big = "[" + std::string(1 << 20, '1') + "]";
+    TEST_LIMIT(FROST_PARSE_NUMBER_TOO_LONG, big.c_str(), max_digits, 64);
+    big = "\"" + std::string(1 << 20, 'x') + "\"";
+    TEST_LIMIT(FROST_PARSE_MEMORY_EXCEEDED, big.c_str(), max_bytes, 1 << 16);
+    TEST_LIMIT(FROST_PARSE_OK, big.c_str(), max_bytes, 4 << 20);
+    big = "\"" + std::string(1 << 16, 'x');
+    for (size_t i = 0; i < 100000; i++)
+        big += "\\n";
+    big += "\"";
+    TEST_LIMIT(FROST_PARSE_MEMORY_EXCEEDED, big.c_str(), max_bytes, 1 << 17);
+    big = "[";
+    for (size_t i = 0; i < 100000; i++)
+        big += i > 0 ? ",0" : "0";
+    big += "]";
+    TEST_LIMIT(FROST_PARSE_MEMORY_EXCEEDED, big.c_str(), max_bytes, 1 << 16);
+    TEST_LIMIT(FROST_PARSE_TOO_MANY_ELEMENTS, big.c_str(), max_elements, 1000);
+    big = std::string(100000, '[') + std::string(100000, ']');
+    TEST_LIMIT(FROST_PARSE_DEPTH_EXCEEDED, big.c_str(), max_depth, 64);
+
+    /* 上限同样作用于延迟数字 (20 位的文本在堆上占 21 字节) 与读取器 */
+    opt.flags = FROST_PARSE_RAW_NUMBERS;
+    opt.max_bytes = 21;
+    frost_init(&v);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, "12345678901234567890", &opt));
+    frost_free(&v);
+    opt.max_bytes = 20;
+    EXPECT_EQ_INT(FROST_PARSE_MEMORY_EXCEEDED, frost_parse_with_options(&v, "12345678901234567890", &opt));
+    opt.flags = 0;
+    opt.max_bytes = 0;
+    opt.max_depth = 2;
+    opt.max_string = 3;
+    rdr = frost_reader_open("[[\"abc\",[\"abcd\"]]]", &opt);
+    EXPECT_EQ_INT(FROST_TOKEN_BEGIN_ARRAY, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_BEGIN_ARRAY, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_STRING, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_ERROR, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED, frost_reader_get_error(rdr));
+    frost_reader_close(rdr);
+    rdr = frost_reader_open("[\"abcd\"]", &opt);
+    EXPECT_EQ_INT(FROST_TOKEN_BEGIN_ARRAY, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_ERROR, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_PARSE_STRING_TOO_LONG, frost_reader_get_error(rdr));
+    frost_reader_close(rdr);
+
+    /* 跳过的部分同样受 max_depth 限制: frost_skip, frost_reader_skip 与投影解析 */
+    opt.max_string = 0;
+    {
+        const char* path = "/a";
+        const char* end = nullptr;
+        frost_projection* proj = frost_projection_create(&path, 1);
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_skip("[[1]]", &end, &opt));
+        EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED, frost_skip("[[[1]]]", &end, &opt));
+        rdr = frost_reader_open("[[1]]", &opt);
+        EXPECT_EQ_INT(FROST_TOKEN_BEGIN_ARRAY, frost_reader_next(rdr));
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_reader_skip(rdr, FROST_TOKEN_BEGIN_ARRAY));
+        frost_reader_close(rdr);
+        rdr = frost_reader_open("[[[1]]]", &opt);
+        EXPECT_EQ_INT(FROST_TOKEN_BEGIN_ARRAY, frost_reader_next(rdr));
+        EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED, frost_reader_skip(rdr, FROST_TOKEN_BEGIN_ARRAY));
+        frost_reader_close(rdr);
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_projected_with_options(&v, "{\"a\":1,\"b\":[1]}", 15, proj, &opt));
+        frost_free(&v);
+        EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED,
+            frost_parse_projected_with_options(&v, "{\"a\":1,\"b\":[[1]]}", 17, proj, &opt));
+        EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED,
+            frost_parse_projected_with_options(&v, "{\"a\":[[1]],\"b\":1}", 17, proj, &opt));
+        frost_projection_free(proj);
+    }
+}
+
 static void test_parse() {
     test_parse_null();
     test_parse_true();
     test_parse_false();
     test_parse_number();
+    test_parse_integer();
     test_parse_string();
     test_parse_array(); 
     test_parse_object();
@@ -366,6 +586,8 @@ static void test_parse() {
     test_parse_miss_key();
     test_parse_miss_colon();
     test_parse_miss_comma_or_curly_bracket();
+    test_parse_invalid_utf8();
+    test_parse_limits();
 }
 
 #define TEST_ROUNDTRIP(json)\
@@ -402,6 +624,87 @@ static void test_stringify_number() {
     TEST_ROUNDTRIP("-2.2250738585072014e-308");
     TEST_ROUNDTRIP("1.7976931348623157e+308");  /* 最大浮点数 */
     TEST_ROUNDTRIP("-1.7976931348623157e+308");
+
+    TEST_ROUNDTRIP("10");
+    TEST_ROUNDTRIP("99");
+    TEST_ROUNDTRIP("100");
+    TEST_ROUNDTRIP("-123456789");
+    TEST_ROUNDTRIP("9007199254740993");
+    TEST_ROUNDTRIP("9223372036854775807");
+    TEST_ROUNDTRIP("-9223372036854775808");
+    TEST_ROUNDTRIP("18446744073709551615");
+    TEST_ROUNDTRIP("[1234567890123456789,-1,0]");
+}
+
+#define TEST_RAW_ROUNDTRIP(json)\
+    do {\
+        frost_value v, expect;\
+        frost_parse_options opt = {};\
+        opt.flags = FROST_PARSE_RAW_NUMBERS;\
+        char* json2;\
+        size_t length;\
+        frost_init(&v);\
+        frost_init(&expect);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, json, &opt));\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&expect, json));\
+        json2 = frost_stringify(&v, &length);\
+        EXPECT_EQ_STRING(json, json2, length);\
+        EXPECT_TRUE(frost_is_equal(&v, &expect));\
+        EXPECT_TRUE(frost_hash(&v) == frost_hash(&expect));\
+        frost_free(&v);\
+        frost_free(&expect);\
+        free(json2);\
+    } while(0)
+
+static void test_stringify_raw_number() {
+    frost_value v, c;
+    frost_parse_options opt = {};
+    opt.flags = FROST_PARSE_RAW_NUMBERS;
+    const char* text;
+    size_t len = 0;
+    TEST_RAW_ROUNDTRIP("0");
+    TEST_RAW_ROUNDTRIP("-0.0");
+    TEST_RAW_ROUNDTRIP("1.50");
+    TEST_RAW_ROUNDTRIP("1E10");
+    TEST_RAW_ROUNDTRIP("1e-0010");
+    TEST_RAW_ROUNDTRIP("18446744073709551615");
+    TEST_RAW_ROUNDTRIP("123456789012345678901234567890");
+    TEST_RAW_ROUNDTRIP("0.1000000000000000055511151231257827");
+    TEST_RAW_ROUNDTRIP("[1.0,2.00,{\"a\":3e0,\"b\":[-0,1E+2]}]");
+
+    frost_init(&v);
+    frost_init(&c);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, "[1.0, 9007199254740993, 3.14159265358979323846]", &opt));
+    EXPECT_TRUE(v.u.a.e[0].flags & FROST_FLAG_RAW_NUMBER);
+    EXPECT_FALSE(v.u.a.e[0].flags & (FROST_FLAG_RAW_HEAP | FROST_FLAG_NUMBER_CACHED));
+    EXPECT_TRUE(v.u.a.e[2].flags & FROST_FLAG_RAW_HEAP);
+    text = frost_get_number_text(&v.u.a.e[2], &len);
+    EXPECT_EQ_STRING("3.14159265358979323846", text, len);
+
+    /* 首次读取时转换并缓存, 文本保持不变 */
+    EXPECT_EQ_DOUBLE(1.0, frost_get_number(&v.u.a.e[0]));
+    EXPECT_TRUE(v.u.a.e[0].flags & FROST_FLAG_NUMBER_CACHED);
+    EXPECT_EQ_INT(FROST_FLAG_INT64, (int)frost_get_number_kind(&v.u.a.e[1]));
+    EXPECT_TRUE(frost_get_int64(&v.u.a.e[1]) == 9007199254740993LL);
+    EXPECT_EQ_DOUBLE(3.14159265358979323846, frost_get_number(&v.u.a.e[2]));
+    text = frost_get_number_text(&v.u.a.e[0], &len);
+    EXPECT_EQ_STRING("1.0", text, len);
+
+    frost_copy(&c, &v);
+    EXPECT_TRUE(c.u.a.e[2].u.rh.s != v.u.a.e[2].u.rh.s);
+    frost_free(&v);
+    frost_set_number(frost_get_array_element(&c, 0), 2.0);
+    text = frost_get_number_text(&c.u.a.e[2], &len);
+    EXPECT_EQ_STRING("3.14159265358979323846", text, len);
+    EXPECT_TRUE(frost_get_number_text(&c.u.a.e[0], &len) == NULL);
+    frost_free(&c);
+
+    EXPECT_EQ_INT(FROST_PARSE_NUMBER_TOO_BIG, frost_parse_with_options(&v, "1e309", &opt));
+    EXPECT_EQ_INT(FROST_PARSE_NUMBER_TOO_BIG, frost_parse_with_options(&v, "-17976931348623159e292", &opt));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, "0.00001e310", &opt));
+    EXPECT_EQ_DOUBLE(1e305, frost_get_number(&v));
+    frost_free(&v);
+    EXPECT_EQ_INT(FROST_PARSE_INVALID_VALUE, frost_parse_with_options(&v, "[1.]", &opt));
 }
 
 static void test_stringify_string() {
@@ -422,14 +725,75 @@ static void test_stringify_object() {
     TEST_ROUNDTRIP("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
 }
 
+/* 与 frost_stringify 逐字节相同 */
+static void test_stringify_parallel_same(const char* json, const frost_parse_options* opt) {
+    static const unsigned threads[] = { 1, 2, 3, 8, 0 };
+    frost_value v;
+    char* expect;
+    char* actual;
+    size_t elen, alen;
+    frost_init(&v);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, json, opt));
+    expect = frost_stringify(&v, &elen);
+    for (unsigned t : threads) {
+        actual = frost_stringify_parallel(&v, &alen, t);
+        EXPECT_EQ_SIZE_T(elen, alen);
+        EXPECT_TRUE(elen == alen && memcmp(expect, actual, elen + 1) == 0);
+        free(actual);
+    }
+    free(expect);
+    frost_free(&v);
+}
+
+static void test_stringify_parallel() {
+    frost_parse_options raw = {};
+    raw.flags = FROST_PARSE_RAW_NUMBERS;
+    std::string big = "[";
+    std::string json;
+    char buf[64];
+    for (size_t i = 0; i < 10000; i++) {
+        if (i > 0)
+            big += ',';
+        switch (i % 6) {
+        case 0: big += "\"s\\\"\\\\\\n\\u0001\\u00e9x\""; break;
+        case 1: snprintf(buf, sizeof(buf), "%.17g", (double)i / 7.0 - 1e300 * (double)(i % 5 == 0)); big += buf; break;
+        case 2: snprintf(buf, sizeof(buf), "%zu", i * 1000003); big += buf; break;
+        case 3: big += "[null,true,false,{}]"; break;
+        case 4: big += "{\"k\\t\":[1,\"\\u0000\"]}"; break;
+        default: big += "-9223372036854775808"; break;
+        }
+    }
+    big += "]";
+    test_stringify_parallel_same(big.c_str(), nullptr);
+    test_stringify_parallel_same(big.c_str(), &raw);
+
+    /* 大容器在较小的外层容器中; 大对象 */
+    json = "{\"meta\":{\"n\":1,\"s\":\"x\"},\"data\":" + big + ",\"tail\":[" + big + "," + big + "]}";
+    test_stringify_parallel_same(json.c_str(), nullptr);
+    json = "{";
+    for (size_t i = 0; i < 5000; i++) {
+        snprintf(buf, sizeof(buf), "%s\"key\\n%zu\":[%zu,\"v\"]", i > 0 ? "," : "", i, i);
+        json += buf;
+    }
+    json += "}";
+    test_stringify_parallel_same(json.c_str(), nullptr);
+
+    /* 较小的文档退回顺序输出 */
+    test_stringify_parallel_same("[1,2,{\"a\":\"b\"}]", nullptr);
+    test_stringify_parallel_same("\"text\"", nullptr);
+    test_stringify_parallel_same("[]", nullptr);
+}
+
 static void test_stringify() {
     TEST_ROUNDTRIP("null");
     TEST_ROUNDTRIP("false");
     TEST_ROUNDTRIP("true");
     test_stringify_number();
+    test_stringify_raw_number();
     test_stringify_string();
     test_stringify_array();
     test_stringify_object();
+    test_stringify_parallel();
 }
 
 #define TEST_EQUAL(json1, json2, equality) \
@@ -440,6 +804,8 @@ static void test_stringify() {
         EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v1, json1));\
         EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v2, json2));\
         EXPECT_EQ_INT(equality, frost_is_equal(&v1, &v2));\
+        if (equality)\
+            EXPECT_TRUE(frost_hash(&v1) == frost_hash(&v2));\
         frost_free(&v1);\
         frost_free(&v2);\
     } while(0)
@@ -468,6 +834,15 @@ static void test_equal() {
     TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2,\"c\":3}", 0);
     TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":{}}}}", 1);
     TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":[]}}}", 0);
+    TEST_EQUAL("1", "1.0", 1);
+    TEST_EQUAL("-0", "0", 1);
+    TEST_EQUAL("9007199254740992", "9007199254740992.0", 1);
+    TEST_EQUAL("9007199254740993", "9007199254740992", 0);
+    TEST_EQUAL("9007199254740993", "9007199254740992.0", 0);
+    TEST_EQUAL("9223372036854775807", "9223372036854775808", 0);
+    TEST_EQUAL("18446744073709551615", "18446744073709551615", 1);
+    TEST_EQUAL("18446744073709551615", "1.8446744073709552e19", 0);
+    TEST_EQUAL("9223372036854775808", "9.223372036854775808e18", 1);
 }
 
 static void test_copy() {
@@ -481,6 +856,93 @@ static void test_copy() {
     frost_free(&v2);
 }
 
+static void test_parallel_same(const std::string& json, const frost_parse_options* opt, int dedup) {
+    static const unsigned threads[] = { 1, 2, 3, 8, 0 };
+    frost_value v, c, d;
+    frost_init(&v);
+    frost_init(&c);
+    frost_init(&d);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, json.c_str(), opt));
+    if (dedup)
+        frost_dedup(&v);
+    for (unsigned t : threads) {
+        frost_copy_parallel(&c, &v, t);
+        EXPECT_TRUE(frost_is_equal_parallel(&v, &c, t));
+        frost_copy(&d, &c);
+        EXPECT_EQ_INT(1, frost_is_equal(&d, &v));
+        EXPECT_TRUE(frost_hash_parallel(&c, t) == frost_hash(&d));
+        EXPECT_TRUE(frost_hash_parallel(&c, t) == frost_hash(&v));
+        frost_free(&v);
+        frost_move(&v, &d);
+    }
+    frost_free(&v);
+    frost_free(&c);
+}
+
+static void test_parallel() {
+    frost_parse_options raw = {};
+    raw.flags = FROST_PARSE_RAW_NUMBERS;
+    frost_value v1, v2;
+    std::string big = "[";
+    std::string json;
+    std::string other;
+    char buf[96];
+    for (size_t i = 0; i < 20000; i++) {
+        snprintf(buf, sizeof(buf), "%s{\"id\":%zu,\"x\":%.17g,\"tags\":[\"t%zu\",null,true],\"k\":{\"a\":\"b\"}}",
+            i > 0 ? "," : "", i, (double)i / 3.0, i % 7);
+        big += buf;
+    }
+    big += "]";
+    test_parallel_same(big, nullptr, 0);
+    test_parallel_same(big, &raw, 0);
+    test_parallel_same(big, nullptr, 1);
+    json = "{\"meta\":{\"n\":1},\"data\":[" + big + "," + big + "],\"s\":\"x\"}";
+    test_parallel_same(json, nullptr, 0);
+    test_parallel_same("[1,{\"a\":[]},\"s\"]", nullptr, 0);
+    test_parallel_same("\"text\"", nullptr, 0);
+
+    /* 不同之处在开头、末尾或深处; 对象的键顺序不同仍相等 */
+    frost_init(&v1);
+    frost_init(&v2);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v1, json.c_str()));
+    other = json;
+    other.replace(other.rfind("\"t6\""), 4, "\"t7\"");
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v2, other.c_str()));
+    EXPECT_EQ_INT(0, frost_is_equal_parallel(&v1, &v2, 4));
+    other = json;
+    other.replace(other.find("\"id\":0,"), 7, "\"id\":1,");
+    frost_free(&v2);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v2, other.c_str()));
+    EXPECT_EQ_INT(0, frost_is_equal_parallel(&v1, &v2, 4));
+    frost_free(&v1);
+    frost_free(&v2);
+    json = "{";
+    other = "{";
+    for (size_t i = 0; i < 10000; i++) {
+        snprintf(buf, sizeof(buf), "%s\"key%zu\":[%zu,\"v\"]", i > 0 ? "," : "", i, i);
+        json += buf;
+        snprintf(buf, sizeof(buf), "%s\"key%zu\":[%zu.0,\"v\"]", i > 0 ? "," : "", 9999 - i, 9999 - i);
+        other += buf;
+    }
+    json += "}";
+    other += "}";
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v1, json.c_str(), &raw));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v2, other.c_str()));
+    EXPECT_EQ_INT(1, frost_is_equal_parallel(&v1, &v2, 4));
+    EXPECT_TRUE(frost_hash_parallel(&v1, 4) == frost_hash_parallel(&v2, 3));
+    frost_sort_object(&v1);
+    frost_sort_object(&v2);
+    EXPECT_EQ_INT(1, frost_is_equal_parallel(&v1, &v2, 4));
+    frost_set_string(frost_find_object_value(&v2, "key5000", 7), "changed", 7);
+    EXPECT_EQ_INT(0, frost_is_equal_parallel(&v1, &v2, 4));
+    /* 冻结的树同样逐项比较 */
+    frost_freeze(&v1);
+    frost_freeze(&v2);
+    EXPECT_EQ_INT(0, frost_is_equal_parallel(&v1, &v2, 4));
+    frost_free(&v1);
+    frost_free(&v2);
+}
+
 static void test_move() {
     frost_value v1, v2, v3;
     frost_init(&v1);
@@ -535,6 +997,23 @@ static void test_access_number() {
     frost_set_string(&val, "a", 1);
     frost_set_number(&val, 1234.5);
     EXPECT_EQ_DOUBLE(1234.5, frost_get_number(&val));
+    EXPECT_TRUE(frost_get_int64(&val) == 1234);
+    frost_set_number(&val, -1e300);
+    EXPECT_TRUE(frost_get_int64(&val) == INT64_MIN);
+    EXPECT_TRUE(frost_get_uint64(&val) == 0);
+    frost_set_number(&val, NAN);
+    EXPECT_TRUE(frost_get_int64(&val) == 0);
+    EXPECT_TRUE(frost_get_uint64(&val) == 0);
+    frost_set_int64(&val, -5);
+    EXPECT_EQ_DOUBLE(-5.0, frost_get_number(&val));
+    EXPECT_TRUE(frost_get_uint64(&val) == 0);
+    frost_set_uint64(&val, 7);
+    EXPECT_TRUE(val.flags & FROST_FLAG_INT64);
+    frost_set_uint64(&val, UINT64_MAX - 1);
+    EXPECT_TRUE(val.flags & FROST_FLAG_UINT64);
+    EXPECT_TRUE(frost_get_uint64(&val) == UINT64_MAX - 1);
+    frost_set_number(&val, 1.0);
+    EXPECT_FALSE(val.flags & FROST_FLAG_INTEGER);
     frost_free(&val);
 }
 
@@ -704,15 +1183,1945 @@ static void test_access() {
     test_access_object();
 }
 
+#define TEST_BINARY_ROUNDTRIP(encode, decode, json)\
+    do {\
+        frost_value v1, v2;\
+        char* bin;\
+        char* json2;\
+        size_t blen, length;\
+        frost_init(&v1);\
+        frost_init(&v2);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v1, json));\
+        bin = encode(&v1, &blen);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, decode(&v2, bin, blen));\
+        json2 = frost_stringify(&v2, &length);\
+        EXPECT_EQ_STRING(json, json2, length);\
+        frost_free(&v1);\
+        frost_free(&v2);\
+        free(bin);\
+        free(json2);\
+    } while(0)
+
+#define TEST_BINARY_ENCODE(encode, expect, json)\
+    do {\
+        frost_value v;\
+        char* bin;\
+        size_t blen;\
+        frost_init(&v);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, json));\
+        bin = encode(&v, &blen);\
+        EXPECT_EQ_STRING(expect, bin, blen);\
+        frost_free(&v);\
+        free(bin);\
+    } while(0)
+
+#define TEST_BINARY_ERROR(decode, error, data)\
+    do {\
+        frost_value v;\
+        frost_init(&v);\
+        EXPECT_EQ_INT(error, decode(&v, data, sizeof(data) - 1));\
+        EXPECT_EQ_INT(FROST_NULL, frost_get_type(&v));\
+        frost_free(&v);\
+    } while(0)
+
+#define TEST_BINARY_ROUNDTRIP_BOTH(json)\
+    do {\
+        TEST_BINARY_ROUNDTRIP(frost_encode_msgpack, frost_decode_msgpack, json);\
+        TEST_BINARY_ROUNDTRIP(frost_encode_cbor, frost_decode_cbor, json);\
+    } while(0)
+
+static void test_binary_roundtrip() {
+    TEST_BINARY_ROUNDTRIP_BOTH("null");
+    TEST_BINARY_ROUNDTRIP_BOTH("false");
+    TEST_BINARY_ROUNDTRIP_BOTH("true");
+    TEST_BINARY_ROUNDTRIP_BOTH("0");
+    TEST_BINARY_ROUNDTRIP_BOTH("-0");
+    TEST_BINARY_ROUNDTRIP_BOTH("1");
+    TEST_BINARY_ROUNDTRIP_BOTH("-1");
+    TEST_BINARY_ROUNDTRIP_BOTH("127");
+    TEST_BINARY_ROUNDTRIP_BOTH("128");
+    TEST_BINARY_ROUNDTRIP_BOTH("-32");
+    TEST_BINARY_ROUNDTRIP_BOTH("-33");
+    TEST_BINARY_ROUNDTRIP_BOTH("255");
+    TEST_BINARY_ROUNDTRIP_BOTH("256");
+    TEST_BINARY_ROUNDTRIP_BOTH("65535");
+    TEST_BINARY_ROUNDTRIP_BOTH("65536");
+    TEST_BINARY_ROUNDTRIP_BOTH("-129");
+    TEST_BINARY_ROUNDTRIP_BOTH("-32769");
+    TEST_BINARY_ROUNDTRIP_BOTH("4294967296");
+    TEST_BINARY_ROUNDTRIP_BOTH("-2147483649");
+    TEST_BINARY_ROUNDTRIP_BOTH("9007199254740993");
+    TEST_BINARY_ROUNDTRIP_BOTH("-9223372036854775808");
+    TEST_BINARY_ROUNDTRIP_BOTH("18446744073709551615");
+    TEST_BINARY_ROUNDTRIP_BOTH("1.5");
+    TEST_BINARY_ROUNDTRIP_BOTH("3.25");
+    TEST_BINARY_ROUNDTRIP_BOTH("1e+20");
+    TEST_BINARY_ROUNDTRIP_BOTH("1.7976931348623157e+308");
+    TEST_BINARY_ROUNDTRIP_BOTH("4.9406564584124654e-324");
+    TEST_BINARY_ROUNDTRIP_BOTH("\"\"");
+    TEST_BINARY_ROUNDTRIP_BOTH("\"Hello\\u0000World\"");
+    TEST_BINARY_ROUNDTRIP_BOTH("\"\\n\\t\"");
+    TEST_BINARY_ROUNDTRIP_BOTH("[]");
+    TEST_BINARY_ROUNDTRIP_BOTH("[null,false,true,123,\"abc\",[1,2,3]]");
+    TEST_BINARY_ROUNDTRIP_BOTH("{}");
+    TEST_BINARY_ROUNDTRIP_BOTH("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
+}
+
+static void test_binary_large() {
+    /* 超过 fix/短长度编码的字符串、数组与对象 */
+    frost_value v1, v2;
+    char* bin;
+    size_t blen, i;
+    char key[16];
+    frost_init(&v1);
+    frost_set_object(&v1, 0);
+    for (i = 0; i < 70000; i++) {
+        sprintf(key, "k%u", (unsigned)i);
+        frost_set_number(frost_set_object_value(&v1, key, strlen(key)), (double)i * 0.5);
+        if (i == 300)
+            break;
+    }
+    frost_set_array(frost_set_object_value(&v1, "arr", 3), 0);
+    for (i = 0; i < 70000; i++)
+        frost_set_number(frost_pushback_array_element(frost_find_object_value(&v1, "arr", 3)), (double)i);
+    {
+        char* big = (char*)malloc(70000);
+        memset(big, 'x', 70000);
+        frost_set_string(frost_set_object_value(&v1, "big", 3), big, 70000);
+        free(big);
+    }
+
+    frost_init(&v2);
+    bin = frost_encode_msgpack(&v1, &blen);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_decode_msgpack(&v2, bin, blen));
+    EXPECT_TRUE(frost_is_equal(&v1, &v2));
+    EXPECT_EQ_SIZE_T(70000, frost_get_array_capacity(frost_find_object_value(&v2, "arr", 3)));
+    frost_free(&v2);
+    free(bin);
+
+    bin = frost_encode_cbor(&v1, &blen);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_decode_cbor(&v2, bin, blen));
+    EXPECT_TRUE(frost_is_equal(&v1, &v2));
+    frost_free(&v2);
+    free(bin);
+    frost_free(&v1);
+}
+
+static void test_binary_encode() {
+    TEST_BINARY_ENCODE(frost_encode_msgpack, "\x81\xA1" "a" "\x01", "{\"a\":1}");
+    TEST_BINARY_ENCODE(frost_encode_msgpack, "\x93\xC0\xC2\xC3", "[null,false,true]");
+    TEST_BINARY_ENCODE(frost_encode_msgpack, "\xFF", "-1");
+    TEST_BINARY_ENCODE(frost_encode_msgpack, "\xCC\xC8", "200");
+    TEST_BINARY_ENCODE(frost_encode_msgpack, "\xCA\x3F\xC0\x00\x00", "1.5");
+    TEST_BINARY_ENCODE(frost_encode_msgpack, "\xCB\x3F\xB9\x99\x99\x99\x99\x99\x9A", "0.1");
+
+    /* RFC 8949 附录 A 中的示例 */
+    TEST_BINARY_ENCODE(frost_encode_cbor, "\x00", "0");
+    TEST_BINARY_ENCODE(frost_encode_cbor, "\x18\x64", "100");
+    TEST_BINARY_ENCODE(frost_encode_cbor, "\x38\x63", "-100");
+    TEST_BINARY_ENCODE(frost_encode_cbor, "\x1B\x00\x00\x00\xE8\xD4\xA5\x10\x00", "1000000000000");
+    TEST_BINARY_ENCODE(frost_encode_cbor, "\xFB\x3F\xF1\x99\x99\x99\x99\x99\x9A", "1.1");
+    TEST_BINARY_ENCODE(frost_encode_cbor, "\xA2\x61" "a" "\x01\x61" "b" "\x82\x02\x03", "{\"a\":1,\"b\":[2,3]}");
+}
+
+static void test_binary_decode() {
+    frost_value v;
+    frost_init(&v);
+    /* CBOR half float 与标签 */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_decode_cbor(&v, "\xF9\x3E\x00", 3));
+    EXPECT_EQ_DOUBLE(1.5, frost_get_number(&v));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_decode_cbor(&v, "\xC1\x1A\x51\x4B\x67\xB0", 6));
+    EXPECT_EQ_DOUBLE(1363896240.0, frost_get_number(&v));
+    /* MessagePack bin 按字符串解码 */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_decode_msgpack(&v, "\xC4\x02hi", 4));
+    EXPECT_EQ_STRING("hi", frost_get_string(&v), frost_get_string_length(&v));
+    frost_free(&v);
+}
+
+static void test_binary_error() {
+    TEST_BINARY_ERROR(frost_decode_msgpack, FROST_PARSE_INVALID_VALUE, "");
+    TEST_BINARY_ERROR(frost_decode_msgpack, FROST_PARSE_INVALID_VALUE, "\xA3" "ab");
+    TEST_BINARY_ERROR(frost_decode_msgpack, FROST_PARSE_INVALID_VALUE, "\x93\x01\x02");
+    TEST_BINARY_ERROR(frost_decode_msgpack, FROST_PARSE_INVALID_VALUE, "\xDD\xFF\xFF\xFF\xFF\x01");
+    TEST_BINARY_ERROR(frost_decode_msgpack, FROST_PARSE_INVALID_VALUE, "\xD4\x01\x01");
+    TEST_BINARY_ERROR(frost_decode_msgpack, FROST_PARSE_INVALID_VALUE, "\x92\xA1" "a" "\xCB\x7F\xF0\x00\x00\x00\x00\x00\x00");
+    TEST_BINARY_ERROR(frost_decode_msgpack, FROST_PARSE_MISS_KEY, "\x81\x01\x01");
+    TEST_BINARY_ERROR(frost_decode_msgpack, FORST_PARSE_ROOT_NOT_SINGULAR, "\xC0\xC0");
+    TEST_BINARY_ERROR(frost_decode_msgpack, FROST_PARSE_INVALID_VALUE, "\x82\xA1" "a" "\x91\xA1" "x" "\xA1" "b");
+
+    TEST_BINARY_ERROR(frost_decode_cbor, FROST_PARSE_INVALID_VALUE, "");
+    TEST_BINARY_ERROR(frost_decode_cbor, FROST_PARSE_INVALID_VALUE, "\x63" "ab");
+    TEST_BINARY_ERROR(frost_decode_cbor, FROST_PARSE_INVALID_VALUE, "\x9F\x01\xFF");
+    TEST_BINARY_ERROR(frost_decode_cbor, FROST_PARSE_INVALID_VALUE, "\xF9\x7E\x00");
+    TEST_BINARY_ERROR(frost_decode_cbor, FROST_PARSE_MISS_KEY, "\xA1\x01\x01");
+    TEST_BINARY_ERROR(frost_decode_cbor, FORST_PARSE_ROOT_NOT_SINGULAR, "\xF6\xF6");
+}
+
+static void test_binary_limit() {
+    frost_value v;
+    std::string bin;
+    size_t blen = 0;
+    char str[4] = "abc";
+    /* 深层嵌套返回错误而不是耗尽栈 */
+    frost_init(&v);
+    bin.assign(1 << 20, '\x91');
+    EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED, frost_decode_msgpack(&v, bin.data(), bin.size()));
+    EXPECT_EQ_INT(FROST_NULL, frost_get_type(&v));
+    bin.assign(1 << 20, '\x81');
+    EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED, frost_decode_cbor(&v, bin.data(), bin.size()));
+    bin.clear();
+    for (int i = 0; i < 100000; i++)
+        bin += "\xA1\x61" "a";
+    EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED, frost_decode_cbor(&v, bin.data(), bin.size()));
+    /* 任意长的标签链 */
+    bin.assign(1 << 20, '\xC1');
+    bin += '\x01';
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_decode_cbor(&v, bin.data(), bin.size()));
+    EXPECT_EQ_DOUBLE(1.0, frost_get_number(&v));
+    frost_free(&v);
+
+    /* MessagePack 长度超过 32 位时编码失败; 伪造的长度不会被读取 */
+    v.type = FROST_STRING;
+    v.flags = 0;
+    v.u.s.s = str;
+    if (sizeof(size_t) > 4) {
+        v.u.s.len = (size_t)UINT32_MAX + 1;
+        blen = 1;
+        EXPECT_TRUE(frost_encode_msgpack(&v, &blen) == nullptr);
+        EXPECT_EQ_SIZE_T(0, blen);
+    }
+}
+
+static void test_binary() {
+    test_binary_roundtrip();
+    test_binary_large();
+    test_binary_encode();
+    test_binary_decode();
+    test_binary_error();
+    test_binary_limit();
+}
+
+static void test_snapshot() {
+    const char* path = "frostjson_test_snapshot.bin";
+    frost_value v1, v2;
+    frost_snapshot* snap;
+    const frost_snapshot_value *root, *sv;
+    size_t i;
+
+    frost_init(&v1);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v1,
+        "{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"d\":-1.5,\"s\":\"abc\",\"z\":\"a\\u0000b\","
+        "\"a\":[1,2,3],\"e\":[],\"o\":{\"1\":1,\"2\":{\"x\":[\"y\"]}}}"));
+    EXPECT_EQ_INT(0, frost_snapshot_write(&v1, path));
+    snap = frost_snapshot_open(path);
+    EXPECT_TRUE(snap != NULL);
+    if (snap != NULL) {
+        root = frost_snapshot_root(snap);
+        EXPECT_EQ_INT(FROST_OBJECT, frost_snapshot_get_type(root));
+        EXPECT_EQ_SIZE_T(10, frost_snapshot_get_object_size(root));
+        EXPECT_EQ_STRING("n", frost_snapshot_get_object_key(snap, root, 0), frost_snapshot_get_object_key_length(snap, root, 0));
+        EXPECT_EQ_INT(FROST_NULL, frost_snapshot_get_type(frost_snapshot_get_object_value(snap, root, 0)));
+        EXPECT_FALSE(frost_snapshot_get_boolean(frost_snapshot_find_object_value(snap, root, "f", 1)));
+        EXPECT_TRUE(frost_snapshot_get_boolean(frost_snapshot_find_object_value(snap, root, "t", 1)));
+        EXPECT_EQ_DOUBLE(123.0, frost_snapshot_get_number(frost_snapshot_find_object_value(snap, root, "i", 1)));
+        EXPECT_EQ_DOUBLE(-1.5, frost_snapshot_get_number(frost_snapshot_find_object_value(snap, root, "d", 1)));
+        sv = frost_snapshot_find_object_value(snap, root, "s", 1);
+        EXPECT_EQ_STRING("abc", frost_snapshot_get_string(snap, sv), frost_snapshot_get_string_length(sv));
+        sv = frost_snapshot_find_object_value(snap, root, "z", 1);
+        EXPECT_EQ_STRING("a\0b", frost_snapshot_get_string(snap, sv), frost_snapshot_get_string_length(sv));
+        sv = frost_snapshot_find_object_value(snap, root, "a", 1);
+        EXPECT_EQ_SIZE_T(3, frost_snapshot_get_array_size(sv));
+        for (i = 0; i < 3; i++)
+            EXPECT_EQ_DOUBLE(i + 1.0, frost_snapshot_get_number(frost_snapshot_get_array_element(snap, sv, i)));
+        EXPECT_EQ_SIZE_T(0, frost_snapshot_get_array_size(frost_snapshot_find_object_value(snap, root, "e", 1)));
+        EXPECT_TRUE(frost_snapshot_find_object_value(snap, root, "missing", 7) == NULL);
+        EXPECT_EQ_SIZE_T(FROST_KEY_NOT_EXIST, frost_snapshot_find_object_index(snap, root, "missing", 7));
+        sv = frost_snapshot_find_object_value(snap, frost_snapshot_find_object_value(snap, root, "o", 1), "2", 1);
+        sv = frost_snapshot_find_object_value(snap, sv, "x", 1);
+        EXPECT_EQ_STRING("y", frost_snapshot_get_string(snap, frost_snapshot_get_array_element(snap, sv, 0)), 1);
+
+        frost_init(&v2);
+        frost_snapshot_copy(&v2, snap, root);
+        EXPECT_TRUE(frost_is_equal(&v1, &v2));
+        frost_free(&v2);
+        frost_snapshot_close(snap);
+    }
+
+    /* 标量根与无效文件 */
+    frost_set_string(&v1, "Hello", 5);
+    EXPECT_EQ_INT(0, frost_snapshot_write(&v1, path));
+    snap = frost_snapshot_open(path);
+    EXPECT_TRUE(snap != NULL);
+    if (snap != NULL) {
+        root = frost_snapshot_root(snap);
+        EXPECT_EQ_STRING("Hello", frost_snapshot_get_string(snap, root), frost_snapshot_get_string_length(root));
+        frost_snapshot_close(snap);
+    }
+    frost_free(&v1);
+    {
+        FILE* fp = fopen(path, "wb");
+        fputs("not a snapshot file at all, just text", fp);
+        fclose(fp);
+    }
+    EXPECT_TRUE(frost_snapshot_open(path) == NULL);
+    EXPECT_TRUE(frost_snapshot_open("frostjson_test_missing.bin") == NULL);
+    remove(path);
+}
+
+static void test_reader() {
+    static const frost_token expect[] = {
+        FROST_TOKEN_BEGIN_OBJECT, FROST_TOKEN_KEY, FROST_TOKEN_BEGIN_ARRAY, FROST_TOKEN_NULL, FROST_TOKEN_TRUE,
+        FROST_TOKEN_FALSE, FROST_TOKEN_NUMBER, FROST_TOKEN_STRING, FROST_TOKEN_BEGIN_OBJECT, FROST_TOKEN_END_OBJECT,
+        FROST_TOKEN_BEGIN_ARRAY, FROST_TOKEN_END_ARRAY, FROST_TOKEN_END_ARRAY, FROST_TOKEN_KEY, FROST_TOKEN_NUMBER,
+        FROST_TOKEN_END_OBJECT, FROST_TOKEN_END, FROST_TOKEN_END
+    };
+    frost_reader* rdr = frost_reader_open(" { \"a\\n\" : [ null , true , false , 1.5 , \"x\\u00A2\" , { } , [ ] ] , \"b\" : -2 } ", NULL);
+    for (size_t i = 0; i < sizeof(expect) / sizeof(expect[0]); i++) {
+        frost_token token = frost_reader_next(rdr);
+        EXPECT_EQ_INT(expect[i], token);
+        if (i == 1)
+            EXPECT_EQ_STRING("a\n", frost_reader_get_string(rdr), frost_reader_get_string_length(rdr));
+        if (i == 6)
+            EXPECT_EQ_DOUBLE(1.5, frost_reader_get_number(rdr));
+        if (i == 7)
+            EXPECT_EQ_STRING("x\xC2\xA2", frost_reader_get_string(rdr), frost_reader_get_string_length(rdr));
+    }
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_reader_get_error(rdr));
+    frost_reader_close(rdr);
+
+    rdr = frost_reader_open("[[1,{\"k\":[2]}],3]", NULL);
+    EXPECT_EQ_INT(FROST_TOKEN_BEGIN_ARRAY, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_reader_skip(rdr, frost_reader_next(rdr)));
+    EXPECT_EQ_INT(FROST_TOKEN_NUMBER, frost_reader_next(rdr));
+    EXPECT_EQ_DOUBLE(3.0, frost_reader_get_number(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_END_ARRAY, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_END, frost_reader_next(rdr));
+    frost_reader_close(rdr);
+
+    rdr = frost_reader_open("[[1,x],3]", NULL);
+    EXPECT_EQ_INT(FROST_TOKEN_BEGIN_ARRAY, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_PARSE_INVALID_VALUE, frost_reader_skip(rdr, frost_reader_next(rdr)));
+    EXPECT_EQ_INT(FROST_TOKEN_ERROR, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_PARSE_INVALID_VALUE, frost_reader_get_error(rdr));
+    frost_reader_close(rdr);
+
+    rdr = frost_reader_open("[1 2]", NULL);
+    EXPECT_EQ_INT(FROST_TOKEN_BEGIN_ARRAY, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_NUMBER, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_ERROR, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, frost_reader_get_error(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_ERROR, frost_reader_next(rdr));
+    frost_reader_close(rdr);
+
+    rdr = frost_reader_open("{\"a\" 1}", NULL);
+    EXPECT_EQ_INT(FROST_TOKEN_BEGIN_OBJECT, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_ERROR, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_PARSE_MISS_COLON, frost_reader_get_error(rdr));
+    frost_reader_close(rdr);
+
+    rdr = frost_reader_open("1 2", NULL);
+    EXPECT_EQ_INT(FROST_TOKEN_NUMBER, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FROST_TOKEN_ERROR, frost_reader_next(rdr));
+    EXPECT_EQ_INT(FORST_PARSE_ROOT_NOT_SINGULAR, frost_reader_get_error(rdr));
+    frost_reader_close(rdr);
+}
+
+static auto test_writer_append(void* user, const char* data, size_t len) -> int {
+    ((std::string*)user)->append(data, len);
+    return 1;
+}
+
+static auto test_writer_fail(void* user, const char* data, size_t len) -> int {
+    (void)data;
+    (void)len;
+    ++*(int*)user;
+    return 0;
+}
+
+static void test_writer() {
+    static const char json[] = "{\"n\":null,\"f\":false,\"t\":true,\"i\":-123,\"s\":\"a\\\"\\\\\\n\\u0001\",\"a\":[1.5,{},[]],\"o\":{\"k\":\"v\"}}";
+    frost_writer* wtr = frost_writer_open(nullptr, nullptr);
+    frost_value v;
+    std::string out;
+    char* expect;
+    const char* actual;
+    size_t elen, alen;
+    int calls = 0;
+
+    frost_writer_begin_object(wtr);
+    frost_writer_key(wtr, "n", 1);
+    frost_writer_null(wtr);
+    frost_writer_key(wtr, "f", 1);
+    frost_writer_bool(wtr, 0);
+    frost_writer_key(wtr, "t", 1);
+    frost_writer_bool(wtr, 1);
+    frost_writer_key(wtr, "i", 1);
+    frost_writer_int64(wtr, -123);
+    frost_writer_key(wtr, "s", 1);
+    frost_writer_string(wtr, "a\"\\\n\x01", 5);
+    frost_writer_key(wtr, "a", 1);
+    frost_writer_begin_array(wtr);
+    frost_writer_number(wtr, 1.5);
+    frost_writer_begin_object(wtr);
+    frost_writer_end(wtr);
+    frost_writer_begin_array(wtr);
+    frost_writer_end(wtr);
+    frost_writer_end(wtr);
+    frost_writer_key(wtr, "o", 1);
+    frost_writer_begin_object(wtr);
+    frost_writer_key(wtr, "k", 1);
+    frost_writer_string(wtr, "v", 1);
+    frost_writer_end(wtr);
+    frost_writer_end(wtr);
+    actual = frost_writer_get_output(wtr, &alen);
+    EXPECT_EQ_STRING(json, actual, alen);
+    EXPECT_EQ_SIZE_T(strlen(json), alen);
+
+    /* 复用缓冲区; 根层的多个值以换行分隔; 与 frost_stringify 输出相同 */
+    frost_writer_reset(wtr);
+    frost_writer_uint64(wtr, 18446744073709551615ull);
+    frost_writer_string(wtr, "", 0);
+    actual = frost_writer_get_output(wtr, &alen);
+    EXPECT_EQ_STRING("18446744073709551615\n\"\"", actual, alen);
+    frost_writer_reset(wtr);
+    frost_init(&v);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, json));
+    frost_writer_begin_array(wtr);
+    frost_writer_value(wtr, &v);
+    frost_writer_number(wtr, 0.1);
+    frost_writer_end(wtr);
+    expect = frost_stringify(&v, &elen);
+    out = std::string("[") + expect + ",0.10000000000000001]";
+    actual = frost_writer_get_output(wtr, &alen);
+    EXPECT_EQ_SIZE_T(out.size(), alen);
+    EXPECT_TRUE(out.size() == alen && memcmp(out.c_str(), actual, alen + 1) == 0);
+    free(expect);
+    frost_writer_close(wtr);
+
+    /* 流式: 分多次交给回调, 拼起来与整体输出相同 */
+    out.clear();
+    wtr = frost_writer_open(test_writer_append, &out);
+    frost_writer_begin_array(wtr);
+    for (size_t i = 0; i < 20000; i++)
+        frost_writer_value(wtr, &v);
+    frost_writer_end(wtr);
+    EXPECT_TRUE(out.size() > 0 && out.size() < 20000 * (strlen(json) + 1) + 1);
+    EXPECT_EQ_INT(1, frost_writer_flush(wtr));
+    frost_writer_close(wtr);
+    EXPECT_EQ_SIZE_T(20000 * (strlen(json) + 1) + 1, out.size());
+    frost_free(&v);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, out.c_str()));
+    EXPECT_EQ_SIZE_T(20000, frost_get_array_size(&v));
+    frost_free(&v);
+
+    /* 写出失败后不再调用回调 */
+    wtr = frost_writer_open(test_writer_fail, &calls);
+    frost_writer_string(wtr, "x", 1);
+    EXPECT_EQ_INT(0, frost_writer_flush(wtr));
+    frost_writer_string(wtr, "y", 1);
+    EXPECT_EQ_INT(0, frost_writer_flush(wtr));
+    frost_writer_close(wtr);
+    EXPECT_EQ_INT(1, calls);
+}
+
+using test_source = struct {
+    const char* data;
+    size_t len, pos, step;  /* 每次最多交出 step 字节; 读到 len 后返回 0, fail 时返回 -1 */
+    int fail;
+};
+
+static auto test_source_read(void* user, char* data, size_t size) -> ptrdiff_t {
+    auto* src = (test_source*)user;
+    size_t n = src->len - src->pos;
+    if (n == 0)
+        return src->fail ? -1 : 0;
+    n = n < src->step ? n : src->step;
+    n = n < size ? n : size;
+    memcpy(data, src->data + src->pos, n);
+    src->pos += n;
+    return (ptrdiff_t)n;
+}
+
+/* 逐个取出元素并与整体解析的结果比较, 返回取出的元素数; 不相等时返回 (size_t)-1 */
+static auto test_array_stream_check(frost_array_stream* stm, const frost_value* expect) -> size_t {
+    frost_value v;
+    size_t count = 0;
+    while (frost_array_stream_next(stm, &v) != 0) {
+        int same = count < frost_get_array_size(expect) && frost_is_equal(&v, &expect->u.a.e[count]);
+        frost_free(&v);
+        if (!same)
+            return (size_t)-1;
+        count++;
+    }
+    return count;
+}
+
+#define TEST_ARRAY_STREAM_ERROR(error, count, json)\
+    do {\
+        frost_array_stream* stm = frost_array_stream_open_buffer(json, sizeof(json) - 1, nullptr);\
+        frost_value v;\
+        size_t n = 0;\
+        while (frost_array_stream_next(stm, &v) != 0) {\
+            frost_free(&v);\
+            n++;\
+        }\
+        EXPECT_EQ_INT(error, frost_array_stream_get_error(stm));\
+        EXPECT_EQ_SIZE_T(count, n);\
+        EXPECT_EQ_INT(0, frost_array_stream_next(stm, &v));\
+        frost_array_stream_close(stm);\
+    } while(0)
+
+static void test_array_stream() {
+    static const char record[] = "{\"id\":12345,\"f\":-1.25e-3,\"s\":\"a\\u00e9\\uD834\\uDD1E\\n\",\"t\":true,\"n\":null,\"a\":[1,false]}";
+    frost_parse_options opt = {};
+    opt.flags = FROST_PARSE_VALIDATE_UTF8;
+    frost_array_stream* stm = nullptr;
+    frost_value expect, v;
+    test_source src;
+    std::string json = "[";
+    size_t i, shift, records = 0;
+    int mismatched = 0;
+    frost_init(&expect);
+
+    /* 数字、字面量、转义与 UTF-8 序列跨越读入的边界; 另有一个大于读入块的元素 */
+    while (json.size() < 100000) {
+        json += records % 3 == 0 ? record : records % 3 == 1 ? "123456789.5e-7" : "[\"\xe6\xb5\x81\",false]";
+        json += ",";
+        records++;
+    }
+    json += "\"" + std::string(70000, 'x') + "\"]";
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&expect, json.c_str()));
+    for (shift = 0; shift < 96; shift++) {
+        std::string padded = std::string(shift, ' ') + json + " ";
+        src = { padded.c_str(), padded.size(), 0, shift % 2 == 0 ? padded.size() : 1 + shift, 0 };
+        stm = frost_array_stream_open(test_source_read, &src, &opt);
+        if (test_array_stream_check(stm, &expect) != records + 1 || frost_array_stream_get_error(stm) != FROST_PARSE_OK)
+            mismatched++;
+        frost_array_stream_close(stm);
+    }
+    EXPECT_EQ_INT(0, mismatched);
+
+    stm = frost_array_stream_open_buffer(json.c_str(), json.size(), nullptr);
+    EXPECT_EQ_SIZE_T(records + 1, test_array_stream_check(stm, &expect));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_array_stream_get_error(stm));
+    frost_array_stream_close(stm);
+
+    /* 文件描述符 */
+    {
+        FILE* f = tmpfile();
+        fwrite(json.c_str(), 1, json.size(), f);
+        fflush(f);
+        rewind(f);
+        stm = frost_array_stream_open_fd(fileno(f), nullptr);
+        EXPECT_EQ_SIZE_T(records + 1, test_array_stream_check(stm, &expect));
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_array_stream_get_error(stm));
+        frost_array_stream_close(stm);
+        fclose(f);
+    }
+    frost_free(&expect);
+
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_OK, 0, " [ ] ");
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_OK, 3, "[1,\"2\",[3]]");
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_EXPECT_VALUE, 0, " ");
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_TYPE_MISMATCH, 0, "{\"a\":1}");
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, 2, "[1,2");
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, 1, "[1 2]");
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_EXPECT_VALUE, 1, "[1,");
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_INVALID_VALUE, 1, "[1,]");
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_INVALID_VALUE, 1, "[1,tru]");
+    TEST_ARRAY_STREAM_ERROR(FROST_PARSE_MISS_QUOTATION_MARK, 0, "[\"abc");
+    TEST_ARRAY_STREAM_ERROR(FORST_PARSE_ROOT_NOT_SINGULAR, 1, "[1] 2");
+
+    /* 未闭合的字符串延续到读入的边界时, 无论出错的是哪个字符 (空格之后被截断的 UTF-8 序列) 都先读入更多数据 */
+    {
+        const char* text = "[\"x \xe6\xb5\x81 y\",\"\\u00e9 \xc3\xa9\",\" \xf0\x9d\x84\x9e\\n\"]";
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&expect, text));
+        for (shift = 65500, mismatched = 0; shift < 65540; shift++) {
+            std::string padded = std::string(shift, ' ') + text;
+            src = { padded.c_str(), padded.size(), 0, padded.size(), 0 };
+            stm = frost_array_stream_open(test_source_read, &src, &opt);
+            if (test_array_stream_check(stm, &expect) != 3 || frost_array_stream_get_error(stm) != FROST_PARSE_OK)
+                mismatched++;
+            frost_array_stream_close(stm);
+        }
+        EXPECT_EQ_INT(0, mismatched);
+        frost_free(&expect);
+        src = { "[\"a b\xc3\x28 c\"]", 11, 0, 1, 0 };
+        stm = frost_array_stream_open(test_source_read, &src, &opt);
+        EXPECT_EQ_INT(0, frost_array_stream_next(stm, &v));
+        EXPECT_EQ_INT(FROST_PARSE_INVALID_UTF8, frost_array_stream_get_error(stm));
+        frost_array_stream_close(stm);
+    }
+
+    /* 逐字节读入时的错误与读取失败 */
+    src = { "[1,{\"a\":tru}]", 13, 0, 1, 0 };
+    stm = frost_array_stream_open(test_source_read, &src, nullptr);
+    EXPECT_EQ_INT(1, frost_array_stream_next(stm, &v));
+    EXPECT_EQ_INT(0, frost_array_stream_next(stm, &v));
+    EXPECT_EQ_INT(FROST_PARSE_INVALID_VALUE, frost_array_stream_get_error(stm));
+    EXPECT_EQ_INT(FROST_NULL, frost_get_type(&v));
+    frost_array_stream_close(stm);
+    src = { "[1,[2,3", 7, 0, 1, 1 };
+    stm = frost_array_stream_open(test_source_read, &src, nullptr);
+    EXPECT_EQ_INT(1, frost_array_stream_next(stm, &v));
+    EXPECT_EQ_INT(0, frost_array_stream_next(stm, &v));
+    EXPECT_EQ_INT(FROST_PARSE_READ_FAILED, frost_array_stream_get_error(stm));
+    frost_array_stream_close(stm);
+
+    /* 资源上限对每个元素分别生效, max_elements 也限制顶层数组 */
+    {
+        frost_parse_options limits = {};
+        const char* text = "[[1,2,3],[[4]],[5],[6]]";
+        limits.max_depth = 2;
+        limits.max_elements = 3;
+        stm = frost_array_stream_open_buffer(text, strlen(text), &limits);
+        for (i = 0; frost_array_stream_next(stm, &v) != 0; i++)
+            frost_free(&v);
+        EXPECT_EQ_SIZE_T(1, i);
+        EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED, frost_array_stream_get_error(stm));
+        frost_array_stream_close(stm);
+        text = "[[1,2,3],[4],[5],[6]]";
+        stm = frost_array_stream_open_buffer(text, strlen(text), &limits);
+        for (i = 0; frost_array_stream_next(stm, &v) != 0; i++)
+            frost_free(&v);
+        EXPECT_EQ_SIZE_T(3, i);
+        EXPECT_EQ_INT(FROST_PARSE_TOO_MANY_ELEMENTS, frost_array_stream_get_error(stm));
+        frost_array_stream_close(stm);
+    }
+
+    /* C++ 封装 */
+    {
+        const char* text = "[{\"price\":1.5},{\"price\":2},{\"price\":4}]";
+        double sum = 0.0;
+        src = { text, strlen(text), 0, 5, 0 };
+        frost::array_stream items(test_source_read, &src);
+        for (frost::value& item : items)
+            sum += item["price"].get_number();
+        EXPECT_EQ_DOUBLE(7.5, sum);
+        EXPECT_EQ_INT(FROST_PARSE_OK, items.error());
+        std::string cut(text, 15);
+        frost::array_stream bad(cut.c_str(), cut.size());
+        for (auto& item : bad)
+            EXPECT_TRUE(item.is_object());
+        EXPECT_EQ_INT(FROST_PARSE_EXPECT_VALUE, bad.error());
+    }
+}
+
+namespace bindtest {
+
+struct point {
+    double x;
+    double y;
+};
+FROST_BIND(point, FROST_FIELD(point, x), FROST_FIELD(point, y));
+
+struct shape {
+    std::string name;
+    int id;
+    bool closed;
+    std::vector<point> points;
+    std::optional<std::string> label;
+    std::optional<point> center;
+    std::vector<std::vector<unsigned>> tags;
+};
+FROST_BIND(shape, FROST_FIELD(shape, name), frost::field("ID", &shape::id), FROST_FIELD(shape, closed),
+    FROST_FIELD(shape, points), FROST_FIELD(shape, label), FROST_FIELD(shape, center), FROST_FIELD(shape, tags));
+
+} // namespace bindtest
+
+#define TEST_BIND_ERROR(type, error, json)\
+    do {\
+        type out{};\
+        EXPECT_EQ_INT(error, frost::bind(&out, json));\
+    } while(0)
+
+static void test_bind() {
+    bindtest::shape s{};
+    s.label = "stale";
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost::bind(&s,
+        "{ \"name\" : \"tri\\nangle\", \"ID\" : 7, \"extra\" : { \"deep\" : [1, {\"x\": 2}] },"
+        " \"closed\" : true, \"points\" : [ {\"x\":0,\"y\":0}, {\"y\":1.5,\"x\":1}, {\"x\":-1,\"y\":2,\"z\":3} ],"
+        " \"center\" : null, \"tags\" : [[1,2],[],[3]] }"));
+    EXPECT_EQ_STRING("tri\nangle", s.name.c_str(), s.name.size());
+    EXPECT_EQ_INT(7, s.id);
+    EXPECT_TRUE(s.closed);
+    EXPECT_EQ_SIZE_T(3, s.points.size());
+    EXPECT_EQ_DOUBLE(1.0, s.points[1].x);
+    EXPECT_EQ_DOUBLE(1.5, s.points[1].y);
+    EXPECT_EQ_DOUBLE(2.0, s.points[2].y);
+    EXPECT_FALSE(s.label.has_value());
+    EXPECT_FALSE(s.center.has_value());
+    EXPECT_EQ_SIZE_T(3, s.tags.size());
+    EXPECT_EQ_SIZE_T(0, s.tags[1].size());
+    EXPECT_EQ_INT(3, (int)s.tags[2][0]);
+
+    s.label = "a\"b";
+    s.center = bindtest::point{ 0.5, -0.25 };
+    {
+        std::string json = frost::stringify(s);
+        frost_value v1, v2;
+        static const char expect[] = "{\"name\":\"tri\\nangle\",\"ID\":7,\"closed\":true,\"points\":[{\"x\":0,\"y\":0},{\"x\":1,\"y\":1.5},"
+            "{\"x\":-1,\"y\":2}],\"label\":\"a\\\"b\",\"center\":{\"x\":0.5,\"y\":-0.25},\"tags\":[[1,2],[],[3]]}";
+        EXPECT_EQ_STRING(expect, json.c_str(), json.size());
+        frost_init(&v1);
+        frost_init(&v2);
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v1, json.c_str()));
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v2, expect));
+        EXPECT_TRUE(frost_is_equal(&v1, &v2));
+        frost_free(&v1);
+        frost_free(&v2);
+
+        bindtest::shape t{};
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost::bind(&t, json.c_str()));
+        EXPECT_TRUE(t.label.has_value() && *t.label == "a\"b");
+        EXPECT_TRUE(t.center.has_value() && t.center->y == -0.25);
+        EXPECT_TRUE(frost::stringify(t) == json);
+    }
+
+    {
+        std::vector<std::string> words;
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost::bind(&words, "[\"a\", \"\", \"\\u20AC\"]"));
+        EXPECT_EQ_SIZE_T(3, words.size());
+        EXPECT_EQ_STRING("\xE2\x82\xAC", words[2].c_str(), words[2].size());
+        std::string json = frost::stringify(words);
+        EXPECT_EQ_STRING("[\"a\",\"\",\"\xE2\x82\xAC\"]", json.c_str(), json.size());
+    }
+
+    {
+        std::vector<int64_t> ids;
+        uint64_t big = 0;
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost::bind(&ids, "[9007199254740993, -9223372036854775808, 2.0]"));
+        EXPECT_TRUE(ids[0] == 9007199254740993LL && ids[1] == INT64_MIN && ids[2] == 2);
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost::bind(&big, "18446744073709551615"));
+        EXPECT_TRUE(big == UINT64_MAX);
+    }
+
+    TEST_BIND_ERROR(bindtest::point, FROST_PARSE_MISS_FIELD, "{\"x\":1}");
+    TEST_BIND_ERROR(bindtest::point, FROST_PARSE_TYPE_MISMATCH, "{\"x\":1,\"y\":\"2\"}");
+    TEST_BIND_ERROR(bindtest::point, FROST_PARSE_TYPE_MISMATCH, "[1,2]");
+    TEST_BIND_ERROR(bindtest::point, FROST_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"x\":1 \"y\":2}");
+    TEST_BIND_ERROR(bindtest::point, FORST_PARSE_ROOT_NOT_SINGULAR, "{\"x\":1,\"y\":2} 3");
+    TEST_BIND_ERROR(bindtest::point, FROST_PARSE_INVALID_VALUE, "{\"x\":1,\"y\":2,\"z\":[tru]}");
+    TEST_BIND_ERROR(int, FROST_PARSE_TYPE_MISMATCH, "1.5");
+    TEST_BIND_ERROR(int, FROST_PARSE_TYPE_MISMATCH, "2147483648");
+    TEST_BIND_ERROR(unsigned, FROST_PARSE_TYPE_MISMATCH, "-1");
+    TEST_BIND_ERROR(int64_t, FROST_PARSE_TYPE_MISMATCH, "9223372036854775808");
+    TEST_BIND_ERROR(uint8_t, FROST_PARSE_TYPE_MISMATCH, "256");
+    TEST_BIND_ERROR(bool, FROST_PARSE_TYPE_MISMATCH, "0");
+    TEST_BIND_ERROR(std::vector<int>, FROST_PARSE_INVALID_VALUE, "[1,]");
+    TEST_BIND_ERROR(std::string, FROST_PARSE_EXPECT_VALUE, "");
+}
+
+#define TEST_PATCH(expect_ret, doc_json, patch_json, expect_json)\
+    do {\
+        frost_value doc, patch, expect;\
+        frost_init(&doc);\
+        frost_init(&patch);\
+        frost_init(&expect);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&doc, doc_json));\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&patch, patch_json));\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&expect, expect_json));\
+        EXPECT_EQ_INT(expect_ret, frost_apply_patch(&doc, &patch));\
+        EXPECT_TRUE(frost_is_equal(&doc, &expect));\
+        frost_free(&doc);\
+        frost_free(&patch);\
+        frost_free(&expect);\
+    } while(0)
+
+/* 失败的补丁必须让文档保持原样 */
+#define TEST_PATCH_ERROR(error, doc_json, patch_json) TEST_PATCH(error, doc_json, patch_json, doc_json)
+
+static void test_patch_apply() {
+    /* RFC 6902 附录 A */
+    TEST_PATCH(FROST_PATCH_OK, "{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]", "{\"baz\":\"qux\",\"foo\":\"bar\"}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"foo\":[\"bar\",\"baz\"]}", "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]", "{\"foo\":[\"bar\",\"qux\",\"baz\"]}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"remove\",\"path\":\"/baz\"}]", "{\"foo\":\"bar\"}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]", "{\"foo\":[\"bar\",\"baz\"]}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]", "{\"baz\":\"boo\",\"foo\":\"bar\"}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+        "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]",
+        "{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}", "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]",
+        "{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+        "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]", "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/child\",\"value\":{\"grandchild\":{}}}]", "{\"foo\":\"bar\",\"child\":{\"grandchild\":{}}}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"foo\":[\"bar\"]}", "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\",\"def\"]}]", "{\"foo\":[\"bar\",[\"abc\",\"def\"]]}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"/\":9,\"~1\":10}", "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":10},{\"op\":\"remove\",\"path\":\"/~1\"}]", "{\"~1\":10}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"\":1}", "[{\"op\":\"replace\",\"path\":\"/\",\"value\":2}]", "{\"\":2}");
+
+    TEST_PATCH(FROST_PATCH_OK, "{\"a\":1}", "[{\"op\":\"replace\",\"path\":\"\",\"value\":[1]}]", "[1]");
+    TEST_PATCH(FROST_PATCH_OK, "{\"a\":{\"b\":[1,2]}}", "[{\"op\":\"copy\",\"from\":\"/a/b\",\"path\":\"/c\"},{\"op\":\"add\",\"path\":\"/c/0\",\"value\":0}]",
+        "{\"a\":{\"b\":[1,2]},\"c\":[0,1,2]}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"a\":{\"b\":1}}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a\"}]", "{\"a\":{\"b\":1}}");
+    TEST_PATCH(FROST_PATCH_OK, "{\"a\":{\"b\":1}}", "[{\"op\":\"move\",\"from\":\"/a/b\",\"path\":\"\"}]", "1");
+    TEST_PATCH(FROST_PATCH_OK, "[1,2,3]", "[]", "[1,2,3]");
+}
+
+static void test_patch_rollback() {
+    TEST_PATCH_ERROR(FROST_PATCH_TEST_FAILED, "{\"baz\":\"qux\"}", "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"bar\"}]");
+    TEST_PATCH_ERROR(FROST_PATCH_PATH_NOT_FOUND, "{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]");
+    TEST_PATCH_ERROR(FROST_PATCH_PATH_NOT_FOUND, "{\"foo\":[1]}", "[{\"op\":\"add\",\"path\":\"/foo/2\",\"value\":0}]");
+    TEST_PATCH_ERROR(FROST_PATCH_PATH_NOT_FOUND, "{\"foo\":[1]}", "[{\"op\":\"remove\",\"path\":\"/foo/-\"}]");
+    TEST_PATCH_ERROR(FROST_PATCH_INVALID, "{\"foo\":[1]}", "[{\"op\":\"remove\",\"path\":\"/foo/01\"}]");
+    TEST_PATCH_ERROR(FROST_PATCH_INVALID, "{\"foo\":1}", "[{\"op\":\"remove\",\"path\":\"foo\"}]");
+    TEST_PATCH_ERROR(FROST_PATCH_INVALID, "{\"foo\":1}", "[{\"op\":\"remove\",\"path\":\"/~2\"}]");
+    TEST_PATCH_ERROR(FROST_PATCH_INVALID, "{\"foo\":1}", "[{\"op\":\"frob\",\"path\":\"/foo\"}]");
+    TEST_PATCH_ERROR(FROST_PATCH_INVALID, "{\"foo\":1}", "[{\"op\":\"add\",\"path\":\"/bar\"}]");
+    TEST_PATCH_ERROR(FROST_PATCH_INVALID, "{\"foo\":1}", "{\"op\":\"add\",\"path\":\"/bar\",\"value\":1}");
+    TEST_PATCH_ERROR(FROST_PATCH_INVALID, "{\"a\":{\"b\":1}}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/b\"}]");
+
+    /* 前面的操作都已生效, 最后一个失败: 全部撤销 */
+    TEST_PATCH_ERROR(FROST_PATCH_TEST_FAILED, "{\"a\":{\"x\":[1,2,3],\"y\":\"s\"},\"b\":[{\"k\":1}],\"c\":null}",
+        "[{\"op\":\"add\",\"path\":\"/a/z\",\"value\":{\"deep\":[1]}},"
+        " {\"op\":\"remove\",\"path\":\"/a/x/0\"},"
+        " {\"op\":\"replace\",\"path\":\"/a/y\",\"value\":false},"
+        " {\"op\":\"remove\",\"path\":\"/a/x\"},"
+        " {\"op\":\"move\",\"from\":\"/b/0\",\"path\":\"/a/x\"},"
+        " {\"op\":\"add\",\"path\":\"/b/-\",\"value\":1},"
+        " {\"op\":\"add\",\"path\":\"/b/0\",\"value\":0},"
+        " {\"op\":\"copy\",\"from\":\"/a\",\"path\":\"/b/1\"},"
+        " {\"op\":\"move\",\"from\":\"/a\",\"path\":\"/c\"},"
+        " {\"op\":\"move\",\"from\":\"/c/z\",\"path\":\"\"},"
+        " {\"op\":\"remove\",\"path\":\"/deep/0\"},"
+        " {\"op\":\"test\",\"path\":\"\",\"value\":0}]");
+    TEST_PATCH_ERROR(FROST_PATCH_PATH_NOT_FOUND, "{\"a\":[1,2],\"b\":{}}",
+        "[{\"op\":\"add\",\"path\":\"/a/-\",\"value\":3},{\"op\":\"move\",\"from\":\"/a/1\",\"path\":\"/b/x/y\"}]");
+    TEST_PATCH_ERROR(FROST_PATCH_PATH_NOT_FOUND, "{\"o\":{\"p\":1,\"q\":2,\"r\":3}}",
+        "[{\"op\":\"remove\",\"path\":\"/o/p\"},{\"op\":\"remove\",\"path\":\"/o/q\"},{\"op\":\"add\",\"path\":\"/o/p\",\"value\":4},{\"op\":\"remove\",\"path\":\"/o/p/x\"}]");
+
+    /* 有序对象的新键插在中间, 撤销时删除的是它而不是最后一个成员 */
+    {
+        static const char* patches[] = {
+            "[{\"op\":\"add\",\"path\":\"/a\",\"value\":0},{\"op\":\"test\",\"path\":\"/b\",\"value\":9}]",
+            "[{\"op\":\"add\",\"path\":\"/c\",\"value\":0},{\"op\":\"test\",\"path\":\"/b\",\"value\":9}]",
+            "[{\"op\":\"move\",\"from\":\"/d\",\"path\":\"/a\"},{\"op\":\"test\",\"path\":\"/b\",\"value\":9}]"
+        };
+        frost_value doc, patch;
+        char* json;
+        size_t length;
+        frost_init(&doc);
+        frost_init(&patch);
+        for (size_t i = 0; i < sizeof(patches) / sizeof(patches[0]); i++) {
+            EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&doc, "{\"d\":2,\"b\":1}"));
+            EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&patch, patches[i]));
+            frost_sort_object(&doc);
+            EXPECT_EQ_INT(FROST_PATCH_TEST_FAILED, frost_apply_patch(&doc, &patch));
+            json = frost_stringify(&doc, &length);
+            EXPECT_EQ_STRING("{\"b\":1,\"d\":2}", json, length);
+            free(json);
+            frost_free(&doc);
+            frost_free(&patch);
+        }
+    }
+}
+
+#define TEST_MERGE_PATCH(doc_json, patch_json, expect_json)\
+    do {\
+        frost_value doc, patch, expect;\
+        frost_init(&doc);\
+        frost_init(&patch);\
+        frost_init(&expect);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&doc, doc_json));\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&patch, patch_json));\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&expect, expect_json));\
+        EXPECT_EQ_INT(FROST_PATCH_OK, frost_apply_merge_patch(&doc, &patch));\
+        EXPECT_TRUE(frost_is_equal(&doc, &expect));\
+        frost_free(&doc);\
+        frost_free(&patch);\
+        frost_free(&expect);\
+    } while(0)
+
+static void test_patch_merge() {
+    /* RFC 7396 附录 A */
+    TEST_MERGE_PATCH("{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}");
+    TEST_MERGE_PATCH("{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}");
+    TEST_MERGE_PATCH("{\"a\":\"b\"}", "{\"a\":null}", "{}");
+    TEST_MERGE_PATCH("{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}");
+    TEST_MERGE_PATCH("{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":\"c\"}");
+    TEST_MERGE_PATCH("{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":[\"b\"]}");
+    TEST_MERGE_PATCH("{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}");
+    TEST_MERGE_PATCH("{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}", "{\"a\":[1]}");
+    TEST_MERGE_PATCH("[\"a\",\"b\"]", "[\"c\",\"d\"]", "[\"c\",\"d\"]");
+    TEST_MERGE_PATCH("{\"a\":\"b\"}", "[\"c\"]", "[\"c\"]");
+    TEST_MERGE_PATCH("{\"a\":\"foo\"}", "null", "null");
+    TEST_MERGE_PATCH("{\"a\":\"foo\"}", "\"bar\"", "\"bar\"");
+    TEST_MERGE_PATCH("{\"e\":null}", "{\"a\":1}", "{\"e\":null,\"a\":1}");
+    TEST_MERGE_PATCH("[1,2]", "{\"a\":\"b\",\"c\":null}", "{\"a\":\"b\"}");
+    TEST_MERGE_PATCH("{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}");
+}
+
+static void test_patch_pointer() {
+    frost_value v;
+    frost_init(&v);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"m~n\":8,\" \":7}"));
+    EXPECT_TRUE(frost_find_pointer_value(&v, "", 0) == &v);
+    EXPECT_EQ_STRING("baz", frost_get_string(frost_find_pointer_value(&v, "/foo/1", 6)), 3);
+    EXPECT_EQ_DOUBLE(0.0, frost_get_number(frost_find_pointer_value(&v, "/", 1)));
+    EXPECT_EQ_DOUBLE(1.0, frost_get_number(frost_find_pointer_value(&v, "/a~1b", 5)));
+    EXPECT_EQ_DOUBLE(8.0, frost_get_number(frost_find_pointer_value(&v, "/m~0n", 5)));
+    EXPECT_EQ_DOUBLE(7.0, frost_get_number(frost_find_pointer_value(&v, "/ ", 2)));
+    EXPECT_TRUE(frost_find_pointer_value(&v, "/foo/2", 6) == NULL);
+    EXPECT_TRUE(frost_find_pointer_value(&v, "/foo/-", 6) == NULL);
+    EXPECT_TRUE(frost_find_pointer_value(&v, "/foo/0/x", 8) == NULL);
+    EXPECT_TRUE(frost_find_pointer_value(&v, "foo", 3) == NULL);
+    frost_free(&v);
+}
+
+#define TEST_DIFF(from_json, to_json)\
+    do {\
+        frost_value from, to, patch, doc;\
+        frost_init(&from);\
+        frost_init(&to);\
+        frost_init(&patch);\
+        frost_init(&doc);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&from, from_json));\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&to, to_json));\
+        frost_diff(&patch, &from, &to);\
+        frost_copy(&doc, &from);\
+        EXPECT_EQ_INT(FROST_PATCH_OK, frost_apply_patch(&doc, &patch));\
+        EXPECT_TRUE(frost_is_equal(&doc, &to));\
+        frost_free(&from);\
+        frost_free(&to);\
+        frost_free(&patch);\
+        frost_free(&doc);\
+    } while(0)
+
+#define TEST_DIFF_SIZE(expect, from_json, to_json)\
+    do {\
+        frost_value from, to, patch;\
+        frost_init(&from);\
+        frost_init(&to);\
+        frost_init(&patch);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&from, from_json));\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&to, to_json));\
+        frost_diff(&patch, &from, &to);\
+        EXPECT_EQ_SIZE_T(expect, frost_get_array_size(&patch));\
+        frost_free(&from);\
+        frost_free(&to);\
+        frost_free(&patch);\
+    } while(0)
+
+static void test_patch_diff() {
+    TEST_DIFF("null", "null");
+    TEST_DIFF("1", "\"a\"");
+    TEST_DIFF("{\"a\":1}", "[1]");
+    TEST_DIFF("{\"a\":1,\"b\":[1,2,3],\"c\":{\"d\":\"e\"}}", "{\"a\":1,\"b\":[1,2,3],\"c\":{\"d\":\"e\"}}");
+    TEST_DIFF("{\"a\":1,\"b\":2}", "{\"b\":3,\"c\":4}");
+    TEST_DIFF("{\"a/b\":1,\"m~n\":2}", "{\"a/b\":{\"x\":1},\"m~n\":{}}");
+    TEST_DIFF("[1,2,3,4,5]", "[1,2,9,4,5]");
+    TEST_DIFF("[1,2,3,4,5]", "[1,2,4,5]");
+    TEST_DIFF("[1,2,3,4,5]", "[1,2,7,8,3,4,5]");
+    TEST_DIFF("[1,2,3]", "[]");
+    TEST_DIFF("[]", "[1,[2],{\"3\":3}]");
+    TEST_DIFF("[1,1,1]", "[1,1]");
+    TEST_DIFF("[{\"id\":1,\"v\":[1,2]},{\"id\":2,\"v\":[3]}]", "[{\"id\":1,\"v\":[1,2,3]},{\"id\":2,\"v\":[]},{\"id\":3}]");
+    TEST_DIFF("{\"k0\":0,\"k1\":1,\"k2\":2,\"k3\":3,\"k4\":4,\"k5\":5,\"k6\":6,\"k7\":7,\"k8\":8,\"k9\":9,\"k10\":10,\"k11\":11,\"k12\":12,\"k13\":13,\"k14\":14,\"k15\":15,\"k16\":16}",
+        "{\"k16\":16,\"k15\":15,\"k14\":-14,\"k13\":13,\"k12\":12,\"k11\":11,\"k10\":10,\"k9\":9,\"k8\":8,\"k7\":7,\"k6\":6,\"k5\":5,\"k4\":4,\"k3\":3,\"k2\":2,\"k1\":1,\"new\":0}");
+
+    TEST_DIFF_SIZE(0, "{\"a\":[1,{\"b\":2}],\"c\":{\"d\":[]}}", "{\"c\":{\"d\":[]},\"a\":[1,{\"b\":2}]}");
+    TEST_DIFF_SIZE(1, "{\"a\":[1,{\"b\":2}],\"c\":{\"d\":[]}}", "{\"a\":[1,{\"b\":3}],\"c\":{\"d\":[]}}");
+    TEST_DIFF_SIZE(1, "[0,1,2,3,4,5,6,7,8,9]", "[0,1,2,3,4,42,5,6,7,8,9]");
+    TEST_DIFF_SIZE(1, "[0,1,2,3,4,5,6,7,8,9]", "[0,1,2,3,5,6,7,8,9]");
+    TEST_DIFF_SIZE(1, "1", "2");
+}
+
+static void test_patch_hash() {
+    frost_value a, b, c, patch;
+    frost_value* elem = nullptr;
+    frost_init(&a);
+    frost_init(&b);
+    frost_init(&c);
+    frost_init(&patch);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&a, "{\"x\":[1,-0.0,\"s\"],\"y\":{\"z\":null,\"w\":true}}"));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&b, "{\"y\":{\"w\":true,\"z\":null},\"x\":[1,0,\"s\"]}"));
+    EXPECT_TRUE(frost_hash(&a) == frost_hash(&b));
+    EXPECT_TRUE(frost_is_equal(&a, &b));
+    /* 节点中不存放哈希: 64 位平台上 frost_value 保持 32 字节 */
+    if (sizeof(void*) == 8) {
+        EXPECT_EQ_SIZE_T(32, sizeof(frost_value));
+        EXPECT_EQ_SIZE_T(48, sizeof(frost_member));
+    }
+
+    /* 可写的树不缓存哈希: 经先前取得的元素指针修改深层节点后, 哈希、比较与 diff 都随之更新 */
+    elem = frost_get_array_element(frost_find_object_value(&b, "x", 1), 0);
+    frost_diff(&patch, &a, &b);
+    EXPECT_EQ_SIZE_T(0, frost_get_array_size(&patch));
+    frost_set_number(elem, 2.0);
+    EXPECT_FALSE(frost_is_equal(&a, &b));
+    EXPECT_TRUE(frost_hash(&a) != frost_hash(&b));
+    frost_diff(&patch, &a, &b);
+    EXPECT_EQ_SIZE_T(1, frost_get_array_size(&patch));
+    frost_set_number(elem, 1.0);
+    EXPECT_TRUE(frost_hash(&a) == frost_hash(&b));
+    EXPECT_TRUE(frost_is_equal(&a, &b));
+
+    frost_set_boolean(frost_set_object_value(frost_find_object_value(&b, "y", 1), "v", 1), 0);
+    EXPECT_FALSE(frost_is_equal(&a, &b));
+    EXPECT_TRUE(frost_hash(&a) != frost_hash(&b));
+    frost_remove_object_value(frost_find_object_value(&b, "y", 1), 2);
+    EXPECT_TRUE(frost_hash(&a) == frost_hash(&b));
+
+    frost_popback_array_element(frost_find_object_value(&b, "x", 1));
+    EXPECT_TRUE(frost_hash(&a) != frost_hash(&b));
+
+    /* 冻结不改变哈希与比较的结果; 副本不带只读标记 */
+    frost_copy(&c, &a);
+    frost_freeze(&a);
+    frost_freeze(&b);
+    EXPECT_TRUE(frost_hash(&a) == frost_hash(&c));
+    EXPECT_FALSE(frost_is_equal(&a, &b));
+    EXPECT_TRUE(frost_is_equal(&a, &c));
+    frost_diff(&patch, &a, &b);
+    EXPECT_EQ_SIZE_T(1, frost_get_array_size(&patch));
+    frost_free(&c);
+    frost_copy(&c, &a);
+    EXPECT_FALSE(c.flags & FROST_FLAG_FROZEN);
+    frost_free(&a);
+    frost_free(&b);
+    frost_free(&c);
+    frost_free(&patch);
+
+    frost_set_string(&a, "abcdefghijklmnopq", 17);
+    frost_set_string(&b, "abcdefghijklmnopr", 17);
+    EXPECT_TRUE(frost_hash(&a) != frost_hash(&b));
+    frost_free(&a);
+    frost_free(&b);
+}
+
+static void test_patch() {
+    test_patch_pointer();
+    test_patch_apply();
+    test_patch_rollback();
+    test_patch_merge();
+    test_patch_diff();
+    test_patch_hash();
+}
+
+static constexpr auto test_keys = frost::make_key_table("id", "name", "tags", "", "nam", "names");
+static_assert(test_keys.index_of("id") == 0, "compile-time key lookup");
+static_assert(test_keys.index_of("") == 3, "compile-time key lookup");
+static_assert(test_keys.index_of("names") == 5, "compile-time key lookup");
+static_assert(test_keys.index_of("na") == test_keys.npos, "compile-time key lookup");
+
+static void test_key_table() {
+    static constexpr auto keys = frost::make_key_table(
+        "id", "type", "name", "created_at", "updated_at", "user", "screen_name", "text", "lang", "source",
+        "retweet_count", "favorite_count", "favorited", "retweeted", "entities", "urls", "hashtags", "media",
+        "in_reply_to_status_id", "in_reply_to_user_id", "geo", "coordinates", "place", "contributors",
+        "is_quote_status", "truncated", "possibly_sensitive", "metadata", "result_type", "iso_language_code",
+        "a", "b", "c", "d", "e", "f", "g", "h", "i", "j");
+    frost_value v;
+    frost_value* out[keys.size()];
+    for (size_t i = 0; i < keys.size(); i++)
+        EXPECT_EQ_SIZE_T(i, keys.index_of(keys.key(i), keys.key_length(i)));
+    EXPECT_EQ_SIZE_T(keys.npos, keys.index_of("missing", 7));
+    EXPECT_EQ_SIZE_T(keys.npos, keys.index_of("ids", 3));
+    EXPECT_EQ_SIZE_T(keys.npos, keys.index_of("", 0));
+
+    frost_init(&v);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "{\"text\":\"hi\",\"zzz\":0,\"id\":1,\"j\":true,\"id\":2,\"lang\":null}"));
+    EXPECT_EQ_SIZE_T(4, frost::find_object_values(keys, &v, out));
+    EXPECT_EQ_DOUBLE(1.0, frost_get_number(out[keys.index_of("id")]));
+    EXPECT_EQ_STRING("hi", frost_get_string(out[keys.index_of("text")]), frost_get_string_length(out[keys.index_of("text")]));
+    EXPECT_EQ_INT(FROST_TRUE, frost_get_type(out[keys.index_of("j")]));
+    EXPECT_EQ_INT(FROST_NULL, frost_get_type(out[keys.index_of("lang")]));
+    EXPECT_TRUE(out[keys.index_of("name")] == NULL);
+    EXPECT_TRUE(out[keys.index_of("id")] == frost_find_object_value(&v, "id", 2));
+    frost_free(&v);
+}
+
+static_assert(!std::is_copy_constructible_v<frost::value> && !std::is_copy_assignable_v<frost::value>, "deep copies go through clone()");
+static_assert(std::is_nothrow_move_constructible_v<frost::value> && std::is_nothrow_move_assignable_v<frost::value>, "moves are noexcept");
+static_assert(std::is_nothrow_swappable_v<frost::value>, "swap is noexcept");
+
+static void test_cpp_value() {
+    frost::value doc, moved;
+    frost_value raw;
+    std::string key = "tags";
+    std::string keys;
+    double sum = 0.0;
+
+    EXPECT_EQ_INT(FROST_PARSE_OK, doc.parse("{\"name\":\"a\\u0000b\",\"n\":[1,2,3.5],\"tags\":{\"x\":true,\"y\":null}}"));
+    EXPECT_TRUE(doc.is_object());
+    EXPECT_EQ_SIZE_T(3, doc.size());
+
+    /* string_view 保留长度, 内嵌的 '\0' 不截断 */
+    EXPECT_EQ_SIZE_T(3, doc.find("name").get_string().size());
+    EXPECT_TRUE(doc.find("name").get_string() == std::string_view("a\0b", 3));
+
+    /* 以 std::string / string_view / 字面量查找 */
+    EXPECT_TRUE(doc.contains(key));
+    EXPECT_TRUE(doc.find(std::string_view("n")).is_array());
+    EXPECT_TRUE(!doc.find("missing"));
+    EXPECT_FALSE(doc.contains("missing"));
+
+    for (auto e : doc.find("n").elements())
+        sum += e.get_number();
+    EXPECT_EQ_DOUBLE(6.5, sum);
+    for (auto [k, v] : doc.find(key).members())
+        keys.append(k).append(v.is_null() ? "=null;" : "=set;");
+    EXPECT_EQ_STRING("x=set;y=null;", keys.data(), keys.size());
+
+    /* 可写遍历与修改 */
+    for (auto e : doc["n"].elements())
+        e.assign(e.get_number() * 2);
+    EXPECT_EQ_DOUBLE(7.0, doc["n"][2].get_number());
+    doc["n"].push_back(8);
+    doc["n"].push_back("s");
+    EXPECT_TRUE(doc.find("n").at(3).get_int64() == 8);
+    EXPECT_TRUE(doc.find("n").at(4).get_string() == "s");
+    doc["added"].assign(frost::value::array());
+    doc.insert("name", frost::value(false));
+    EXPECT_FALSE(doc.find("name").get_bool());
+    EXPECT_TRUE(doc.erase("added"));
+    EXPECT_FALSE(doc.erase("added"));
+    std::string json = doc.stringify();
+    EXPECT_EQ_STRING("{\"name\":false,\"n\":[2,4,7,8,\"s\"],\"tags\":{\"x\":true,\"y\":null}}", json.data(), json.size());
+
+    /* clone 是深复制, 移动后原值为 null */
+    frost::value copy = doc.clone();
+    EXPECT_TRUE(copy == doc);
+    copy["tags"]["x"].assign(1.5);
+    EXPECT_TRUE(copy != doc);
+    EXPECT_TRUE(doc.find("tags").find("x").get_bool());
+    moved = std::move(doc);
+    EXPECT_TRUE(doc.is_null());
+    EXPECT_TRUE(moved.is_object());
+    swap(moved, doc);
+    EXPECT_TRUE(moved.is_null());
+    EXPECT_TRUE(doc.is_object());
+
+    /* 可写遍历共享的对象先写时复制, 其他引用者不受影响 */
+    frost_share(copy.raw());
+    moved = copy.clone();
+    for (auto [k, v] : copy.members())
+        v.assign(0);
+    EXPECT_FALSE(copy.raw()->flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(moved.find("name").get_bool() == false && moved.find("n").is_array());
+    moved = frost::value();
+
+    /* 与 C API 交换所有权 */
+    frost_init(&raw);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&raw, "[\"c\"]"));
+    frost::value adopted = frost::value::adopt(&raw);
+    EXPECT_EQ_INT(FROST_NULL, frost_get_type(&raw));
+    EXPECT_TRUE(adopted.at(0).get_string() == "c");
+    EXPECT_EQ_SIZE_T(1, frost_get_array_size(adopted.raw()));
+}
+
+static void test_sort_object() {
+    frost_value v, c, u;
+    frost_value* elem = nullptr;
+    char key[8];
+    char* json;
+    size_t length, i;
+    uint64_t hash;
+    frost_init(&v);
+    frost_init(&c);
+    frost_init(&u);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v,
+        "{\"k07\":7,\"k03\":3,\"k15\":15,\"k00\":0,\"k11\":11,\"k09\":9,\"k01\":1,\"k13\":13,\"k05\":5,\"k10\":10,"
+        "\"k02\":2,\"k14\":14,\"k12\":12,\"k04\":4,\"k08\":8,\"k06\":6,\"k\":-1,\"k03\":33,\"sub\":[{\"b\":1,\"a\":2}]}"));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&u, "{\"k03\":3,\"k\":-1,\"k03\":33}"));
+    hash = frost_hash(&v);
+    frost_sort_object(&v);
+    EXPECT_TRUE(v.flags & FROST_FLAG_SORTED);
+    EXPECT_TRUE(hash == frost_hash(&v));
+    json = frost_stringify(frost_get_array_element(frost_find_object_value(&v, "sub", 3), 0), &length);
+    EXPECT_EQ_STRING("{\"a\":2,\"b\":1}", json, length);
+    free(json);
+
+    /* 二分查找: 命中、缺失 (落在首尾与中间)、重复的键取原先靠前的 */
+    for (i = 0; i < 16; i++) {
+        snprintf(key, sizeof(key), "k%02zu", i);
+        EXPECT_EQ_DOUBLE((double)i, frost_get_number(frost_find_object_value(&v, key, 3)));
+    }
+    EXPECT_EQ_DOUBLE(-1.0, frost_get_number(frost_find_object_value(&v, "k", 1)));
+    EXPECT_EQ_SIZE_T(FROST_KEY_NOT_EXIST, frost_find_object_index(&v, "a", 1));
+    EXPECT_EQ_SIZE_T(FROST_KEY_NOT_EXIST, frost_find_object_index(&v, "z", 1));
+    EXPECT_EQ_SIZE_T(FROST_KEY_NOT_EXIST, frost_find_object_index(&v, "k035", 4));
+    EXPECT_EQ_SIZE_T(FROST_KEY_NOT_EXIST, frost_find_object_index(&v, "", 0));
+    EXPECT_EQ_SIZE_T(4, frost_find_object_index(&v, "k03", 3));
+    EXPECT_EQ_DOUBLE(33.0, frost_get_number(frost_get_object_value(&v, 5)));
+
+    /* 新增的键插入到有序位置, 删除保持有序 */
+    frost_set_number(frost_set_object_value(&v, "k035", 4), 3.5);
+    frost_set_number(frost_set_object_value(&v, "a", 1), 0.5);
+    EXPECT_TRUE(v.flags & FROST_FLAG_SORTED);
+    EXPECT_EQ_SIZE_T(0, frost_find_object_index(&v, "a", 1));
+    EXPECT_EQ_SIZE_T(7, frost_find_object_index(&v, "k035", 4));
+    frost_remove_object_value(&v, 0);
+    for (i = 1; i < frost_get_object_size(&v); i++)
+        EXPECT_TRUE(strcmp(frost_get_object_key(&v, i - 1), frost_get_object_key(&v, i)) <= 0);
+
+    /* 副本保持有序; 两侧都有序时逐个对齐比较 */
+    frost_copy(&c, &v);
+    EXPECT_TRUE(c.flags & FROST_FLAG_SORTED);
+    EXPECT_TRUE(frost_is_equal(&c, &v));
+    frost_set_number(frost_find_object_value(&c, "k15", 3), 0.0);
+    EXPECT_FALSE(frost_is_equal(&c, &v));
+    frost_remove_object_value(&c, frost_find_object_index(&c, "k15", 3));
+    frost_set_number(frost_set_object_value(&c, "k16", 3), 15.0);
+    EXPECT_FALSE(frost_is_equal(&c, &v));
+
+    /* 与未排序的对象按键比较 */
+    frost_sort_object(&u);
+    frost_free(&c);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&c, "{\"k03\":3,\"k\":-1,\"k03\":33}"));
+    EXPECT_TRUE(frost_is_equal(&u, &c));
+    EXPECT_TRUE(frost_is_equal(&c, &u));
+    EXPECT_EQ_DOUBLE(3.0, frost_get_number(frost_find_object_value(&u, "k03", 3)));
+    frost_free(&v);
+    frost_free(&c);
+    frost_free(&u);
+
+    /* 已有序的共享子树不被复制 */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "[{\"b\":{\"c\":1},\"a\":[1,2]},{\"b\":{\"c\":1},\"a\":[1,2]}]"));
+    frost_sort_object(&v);
+    frost_dedup(&v);
+    elem = frost_pushback_array_element(&v);
+    frost_set_object(elem, 0);
+    frost_set_number(frost_set_object_value(elem, "y", 1), 1.0);
+    frost_set_number(frost_set_object_value(elem, "x", 1), 2.0);
+    frost_sort_object(&v);
+    EXPECT_TRUE(v.u.a.e[0].u.o.m == v.u.a.e[1].u.o.m);
+    EXPECT_TRUE(v.u.a.e[0].flags & FROST_FLAG_SHARED);
+    EXPECT_EQ_STRING("x", frost_get_object_key(&v.u.a.e[2], 0), 1);
+    frost_free(&v);
+}
+
+/* 与以 FROST_PARSE_VALIDATE_UTF8 解析的结果一致; 出错时报告出错处的偏移 */
+#define TEST_VALIDATE(expect, offset, json)\
+    do {\
+        frost_parse_options opt = {};\
+        opt.flags = FROST_PARSE_VALIDATE_UTF8;\
+        frost_value v;\
+        size_t off = 12345;\
+        EXPECT_EQ_INT(expect, frost_validate(json, strlen(json), &off));\
+        EXPECT_EQ_INT(expect, frost_parse_with_options(&v, json, &opt));\
+        EXPECT_EQ_SIZE_T(offset, off);\
+        frost_free(&v);\
+    } while(0)
+
+static void test_validate() {
+    const char* json = " [1, {\"a\":\"b\"}] \"s\" x";
+    const char* end = nullptr;
+
+    TEST_VALIDATE(FROST_PARSE_OK, 0, " {\"a\":[1,-2.5e3,true,false,null,\"\\u00A2\\uD834\\uDD1E\"],\"b\":{}} ");
+    TEST_VALIDATE(FROST_PARSE_OK, 0, "18446744073709551616");
+    TEST_VALIDATE(FROST_PARSE_EXPECT_VALUE, 0, "");
+    TEST_VALIDATE(FROST_PARSE_EXPECT_VALUE, 5, "[1,  ");
+    TEST_VALIDATE(FROST_PARSE_INVALID_VALUE, 3, "[1,nul]");
+    TEST_VALIDATE(FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, 2, "[01]");
+    TEST_VALIDATE(FROST_PARSE_INVALID_VALUE, 1, "[1.]");
+    TEST_VALIDATE(FORST_PARSE_ROOT_NOT_SINGULAR, 5, "null x");
+    TEST_VALIDATE(FROST_PARSE_MISS_QUOTATION_MARK, 4, "\"abc");
+    TEST_VALIDATE(FROST_PARSE_INVALID_STRING_ESCAPE, 3, "\"ab\\v\"");
+    TEST_VALIDATE(FROST_PARSE_INVALID_STRING_CHAR, 2, "\"a\x01\"");
+    TEST_VALIDATE(FROST_PARSE_INVALID_UNICODE_HEX, 1, "\"\\u00G0\"");
+    TEST_VALIDATE(FROST_PARSE_INVALID_UNICODE_SURROGATE, 1, "\"\\uD800\\uE000\"");
+    TEST_VALIDATE(FROST_PARSE_INVALID_UTF8, 1, "\"\xC0\xAF\"");
+    TEST_VALIDATE(FROST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, 3, "[1 2]");
+    TEST_VALIDATE(FROST_PARSE_MISS_KEY, 1, "{1:2}");
+    TEST_VALIDATE(FROST_PARSE_MISS_COLON, 5, "{\"a\" 1}");
+    TEST_VALIDATE(FROST_PARSE_MISS_COMMA_OR_CURLY_BRACKET, 7, "{\"a\":1 \"b\":2}");
+    TEST_VALIDATE(FROST_PARSE_NUMBER_TOO_BIG, 1, "[1e999]");
+    TEST_VALIDATE(FROST_PARSE_NUMBER_TOO_BIG, 5, "{\"a\":-1e309}");
+
+    /* 深层嵌套以 FROST_SKIP_MAX_DEPTH (默认 10000) 为上限, 出错处为超出上限的容器 */
+    {
+        size_t n = 10 * 1024 * 1024;
+        size_t off = 0;
+        char* deep = (char*)malloc(n + 1);
+        memset(deep, '[', n);
+        deep[n] = '\0';
+        EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED, frost_validate(deep, n, &off));
+        EXPECT_EQ_SIZE_T(10000, off);
+        EXPECT_EQ_INT(FROST_PARSE_DEPTH_EXCEEDED, frost_skip(deep, &end, nullptr));
+        EXPECT_EQ_SIZE_T(10000, (size_t)(end - deep));
+        free(deep);
+    }
+
+    /* 逐个跳过拼接在一起的值 */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_skip(json, &end, nullptr));
+    EXPECT_EQ_SIZE_T(15, (size_t)(end - json));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_skip(end, &end, nullptr));
+    EXPECT_EQ_SIZE_T(19, (size_t)(end - json));
+    EXPECT_EQ_INT(FROST_PARSE_INVALID_VALUE, frost_skip(end, &end, nullptr));
+    EXPECT_EQ_SIZE_T(20, (size_t)(end - json));
+}
+
+#define TEST_PROJECTED(expect, json, ...)\
+    do {\
+        const char* paths[] = { __VA_ARGS__ };\
+        frost_projection* proj = frost_projection_create(paths, sizeof(paths) / sizeof(paths[0]));\
+        frost_value v;\
+        char* json2;\
+        size_t length;\
+        EXPECT_TRUE(proj != nullptr);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_projected(&v, json, strlen(json), proj));\
+        json2 = frost_stringify(&v, &length);\
+        EXPECT_EQ_STRING(expect, json2, length);\
+        free(json2);\
+        frost_free(&v);\
+        frost_projection_free(proj);\
+    } while(0)
+
+/* 跳过的部分与 frost_parse 报告同样的错误 */
+#define TEST_PROJECTED_ERROR(json, path)\
+    do {\
+        const char* paths[] = { path };\
+        frost_projection* proj = frost_projection_create(paths, 1);\
+        frost_value v, w;\
+        frost_init(&w);\
+        EXPECT_EQ_INT(frost_parse(&w, json), frost_parse_projected(&v, json, strlen(json), proj));\
+        EXPECT_EQ_INT(FROST_NULL, frost_get_type(&v));\
+        frost_free(&w);\
+        frost_projection_free(proj);\
+    } while(0)
+
+static void test_parse_projected() {
+    const char* bad[] = { "a", "/a~2", "/~" };
+    const char* doc = "{\"id\":7,\"name\":\"x\\ty\",\"tags\":[\"a\",{\"k\":1,\"z\":[true]},\"c\"],"
+        "\"meta\":{\"a/b\":1,\"m~n\":2,\"deep\":{\"x\":null}},\"id\":8}";
+    size_t i;
+
+    TEST_PROJECTED("{\"id\":7,\"id\":8}", doc, "/id");
+    TEST_PROJECTED("{\"name\":\"x\\ty\",\"meta\":{\"deep\":{\"x\":null}}}", doc, "/name", "/meta/deep");
+    TEST_PROJECTED("{\"meta\":{\"a/b\":1,\"m~n\":2}}", doc, "/meta/a~1b", "/meta/m~0n");
+    TEST_PROJECTED("{\"tags\":[null,{\"z\":[true]}]}", doc, "/tags/1/z");
+    TEST_PROJECTED("{\"tags\":[\"a\",null,\"c\"]}", doc, "/tags/0", "/tags/2");
+    TEST_PROJECTED("{\"meta\":{}}", doc, "/meta/missing");
+    TEST_PROJECTED("{\"tags\":[]}", doc, "/id/x", "/tags/01", "/tags/-");
+    TEST_PROJECTED("{\"meta\":{\"a/b\":1,\"m~n\":2,\"deep\":{\"x\":null}}}", doc, "/meta/deep/x", "/meta");
+    TEST_PROJECTED("[{\"0\":1},[2]]", "[{\"0\":1,\"1\":0},[2,3]]", "/0/0", "/1/0");
+    TEST_PROJECTED("{\"\":1}", "{\"\":1,\"a\":2}", "/");
+    TEST_PROJECTED("[1,{\"a\":2}]", " [1,{\"a\":2}] ", "");
+    TEST_PROJECTED("null", "\"text\"", "/a");
+    TEST_PROJECTED("{}", "{\"a\":[1e10,-0.5,\"\\uD834\\uDD1E\",{}]}", "/b");
+
+    for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+        EXPECT_TRUE(frost_projection_create(&bad[i], 1) == nullptr);
+
+    TEST_PROJECTED_ERROR("", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":nul}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":01}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":1e999}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":[1,]}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":[1 2]}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":{\"c\" 1}}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":{1:1}}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":{\"c\":1 \"d\":2}}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":\"\\x\"}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":\"\\u12G4\"}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":\"\\uD800\\u0041\"}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":\"\x01\"}", "/a");
+    TEST_PROJECTED_ERROR("{\"b\":\"abc", "/a");
+    TEST_PROJECTED_ERROR("{\"a\":1} x", "/a");
+    TEST_PROJECTED_ERROR("[1,[2,x]]", "/0");
+    TEST_PROJECTED_ERROR("{\"a\":[1,2,x]}", "/a/0");
+}
+
+/* 把匹配依次复制进数组, 与期望的 JSON 数组比较 */
+static auto test_query_collect(const frost_value* val, void* user) -> int {
+    frost_copy(frost_pushback_array_element((frost_value*)user), val);
+    return 0;
+}
+
+#define TEST_QUERY(expect, doc, path)\
+    do {\
+        frost_query* q = frost_query_compile(path);\
+        frost_value out;\
+        char* json;\
+        size_t length;\
+        EXPECT_TRUE(q != nullptr);\
+        if (q != nullptr) {\
+            frost_init(&out);\
+            frost_set_array(&out, 0);\
+            EXPECT_EQ_SIZE_T(frost_query_run(q, doc, test_query_collect, &out), frost_get_array_size(&out));\
+            json = frost_stringify(&out, &length);\
+            EXPECT_EQ_STRING(expect, json, length);\
+            free(json);\
+            frost_free(&out);\
+            frost_query_free(q);\
+        }\
+    } while(0)
+
+static auto test_query_stop(const frost_value*, void* user) -> int {
+    return ++*(int*)user == 2;
+}
+
+static void test_query() {
+    static const char* const bad[] = {
+        "", "a", "$.", "$..", "$[", "$[1", "$[1,]", "$['a]", "$.1a", "$[?@.a ==]", "$[?(@.a > 1]", "$[a]", "$ x", "$[--1]"
+    };
+    frost_value doc;
+    frost_query* q = nullptr;
+    int calls = 0;
+    size_t i;
+    frost_init(&doc);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&doc,
+        "{\"store\":{\"book\":[{\"title\":\"A\",\"price\":8.5,\"tags\":[\"x\"]},{\"title\":\"B\",\"price\":12.75},"
+        "{\"title\":\"C\",\"price\":8,\"isbn\":\"0-553\"},{\"title\":\"D\",\"price\":22.5,\"isbn\":\"0-395\"}],"
+        "\"bicycle\":{\"color\":\"red\",\"price\":19.25}},\"a'b\":1,\"it's\":[0,1,2,3,4,5]}"));
+
+    TEST_QUERY("[{\"color\":\"red\",\"price\":19.25}]", &doc, "$.store.bicycle");
+    TEST_QUERY("[\"red\"]", &doc, "$['store'][\"bicycle\"].color");
+    TEST_QUERY("[\"A\",\"B\",\"C\",\"D\"]", &doc, "$.store.book[*].title");
+    TEST_QUERY("[8.5,12.75,8,22.5,19.25]", &doc, "$..price");
+    TEST_QUERY("[\"A\",\"D\"]", &doc, "$.store.book[0,-1].title");
+    TEST_QUERY("[]", &doc, "$.store.book[4].title");
+    TEST_QUERY("[]", &doc, "$.store.bicycle[0]");
+    TEST_QUERY("[1]", &doc, "$['a\\'b']");
+    TEST_QUERY("[[0,1,2,3,4,5]]", &doc, "$[\"it's\"]");
+    TEST_QUERY("[1,3]", &doc, "$[\"it's\"][1:5:2]");
+    TEST_QUERY("[5,4,3,2,1,0]", &doc, "$[\"it's\"][::-1]");
+    TEST_QUERY("[4,5]", &doc, "$[\"it's\"][-2:]");
+    TEST_QUERY("[3,1]", &doc, "$[\"it's\"][3:0:-2]");
+    TEST_QUERY("[]", &doc, "$[\"it's\"][1:5:0]");
+    TEST_QUERY("[0,1]", &doc, "$[\"it's\"][ : 2 ]");
+    TEST_QUERY("[1]", &doc, "$[\"it's\"][1::9223372036854775807]");
+    TEST_QUERY("[4]", &doc, "$[\"it's\"][4::-9223372036854775807]");
+    TEST_QUERY("[5,0]", &doc, "$[\"it's\"][::-5]");
+    TEST_QUERY("[\"C\",\"D\"]", &doc, "$.store.book[?@.isbn].title");
+    TEST_QUERY("[\"A\",\"C\"]", &doc, "$.store.book[?(@.price < 10)].title");
+    TEST_QUERY("[\"A\",\"C\"]", &doc, "$.store.book[?@.price<=8.5].title");
+    TEST_QUERY("[\"B\",\"D\"]", &doc, "$.store.book[?@.price > 9].title");
+    TEST_QUERY("[\"C\"]", &doc, "$.store.book[?@.price == 8].title");
+    TEST_QUERY("[\"A\",\"B\",\"D\"]", &doc, "$.store.book[?@.isbn != '0-553'].title");
+    TEST_QUERY("[\"D\"]", &doc, "$.store.book[?@['isbn'] <= \"0-395\" ].title");
+    TEST_QUERY("[\"A\"]", &doc, "$.store.book[?@.tags[0] == 'x'].title");
+    TEST_QUERY("[\"A\"]", &doc, "$.store.book[?@.tags == [\"x\"]].title");
+    TEST_QUERY("[\"red\"]", &doc, "$.store.bicycle[?@ == 'red']");
+    TEST_QUERY("[]", &doc, "$.store.book[?@.title > 1]");
+    TEST_QUERY("[19.25,8.5,12.75,8]", &doc, "$..[?@.price < 20].price");
+    TEST_QUERY("[\"A\",\"B\",\"C\",\"D\"]", &doc, "$..book..title");
+    TEST_QUERY("[0,1,2,3,4,5]", &doc, "$..['it\\'s'][*]");
+    TEST_QUERY("[{\"title\":\"C\",\"price\":8,\"isbn\":\"0-553\"}]", &doc, "$..book[2]");
+    TEST_QUERY("[2]", &doc, "$..[\"it's\"][2]");
+
+    for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+        EXPECT_TRUE(frost_query_compile(bad[i]) == nullptr);
+
+    /* 回调返回非 0 时停止; 没有回调时只计数; 同一查询可用于多个文档, 包括冻结的文档 */
+    q = frost_query_compile("$..price");
+    EXPECT_EQ_SIZE_T(2, frost_query_run(q, &doc, test_query_stop, &calls));
+    EXPECT_EQ_INT(2, calls);
+    frost_freeze(&doc);
+    EXPECT_EQ_SIZE_T(5, frost_query_run(q, &doc, nullptr, nullptr));
+    frost_free(&doc);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&doc, "[{\"price\":1},{\"x\":{\"price\":2}}]"));
+    EXPECT_EQ_SIZE_T(2, frost_query_run(q, &doc, nullptr, nullptr));
+    frost_sort_object(&doc);
+    EXPECT_EQ_SIZE_T(2, frost_query_run(q, &doc, nullptr, nullptr));
+    frost_query_free(q);
+    frost_free(&doc);
+}
+
+#define TEST_DEDUP(json)\
+    do {\
+        frost_value v, expect;\
+        char* json2;\
+        size_t length;\
+        frost_init(&v);\
+        frost_init(&expect);\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, json));\
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&expect, json));\
+        frost_dedup(&v);\
+        EXPECT_TRUE(frost_is_equal(&v, &expect));\
+        json2 = frost_stringify(&v, &length);\
+        EXPECT_EQ_STRING(json, json2, length);\
+        frost_free(&v);\
+        frost_free(&expect);\
+        free(json2);\
+    } while(0)
+
+static void test_dedup_shape() {
+    TEST_DEDUP("null");
+    TEST_DEDUP("[]");
+    TEST_DEDUP("[1,1,\"a\",\"a\",[],[],{},{}]");
+    TEST_DEDUP("[0,-0,[0],[-0],[0],[-0]]");
+    TEST_DEDUP("[{\"a\":1,\"b\":2},{\"b\":2,\"a\":1},{\"a\":1,\"b\":2},{\"b\":2,\"a\":1}]");
+    TEST_DEDUP("{\"x\":[\"long enough string\",\"long enough string\"],\"y\":[\"long enough string\",\"long enough string\"]}");
+    TEST_DEDUP("[[[1,[2]],[1,[2]]],[[1,[2]],[1,[2]]],[1,[2]]]");
+}
+
+static void test_dedup_share() {
+    frost_value v, c;
+    size_t saved = 0;
+    frost_init(&v);
+    frost_init(&c);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v,
+        "[{\"name\":\"frostjson\",\"tags\":[\"json\",\"parser\"]},{\"name\":\"frostjson\",\"tags\":[\"json\",\"parser\"]},"
+        "{\"name\":\"frostjson\",\"tags\":[\"json\",\"parser\"]},{\"name\":\"other\",\"tags\":[\"json\",\"parser\"]}]"));
+    saved = frost_dedup(&v);
+    EXPECT_TRUE(saved > 0);
+    EXPECT_EQ_SIZE_T(0, frost_dedup(&v));
+
+    /* 相同的记录引用同一个共享块, 第四条只共享 tags */
+    EXPECT_TRUE(frost_get_array_element(&v, 0)->flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(v.u.a.e[0].u.o.m == v.u.a.e[1].u.o.m);
+    EXPECT_TRUE(v.u.a.e[0].u.o.m == v.u.a.e[2].u.o.m);
+    EXPECT_FALSE(v.u.a.e[3].flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(v.u.a.e[3].u.o.m[1].v.u.a.e == v.u.a.e[0].u.o.m[1].v.u.a.e);
+
+    /* 只读的查找不写时复制: 遍历之后仍然共享, 多个线程可以同时遍历 */
+    for (size_t i = 0; i < frost_get_array_size(&v); i++) {
+        frost_value* e = frost_get_array_element(&v, i);
+        EXPECT_EQ_SIZE_T(2, frost_get_array_size(frost_find_object_value(e, "tags", 4)));
+        EXPECT_EQ_INT(FROST_STRING, frost_get_type(frost_get_object_value(e, 0)));
+        EXPECT_TRUE(frost_find_pointer_value(&v, "/0/tags/1", 9) != nullptr);
+    }
+    {
+        std::thread readers[4];
+        std::atomic<int> failures(0);
+        for (auto& t : readers)
+            t = std::thread([&]() {
+                for (size_t i = 0; i < frost_get_array_size(&v); i++)
+                    if (frost_get_array_size(frost_find_object_value(frost_get_array_element(&v, i), "tags", 4)) != 2)
+                        failures++;
+            });
+        for (auto& t : readers)
+            t.join();
+        EXPECT_EQ_INT(0, failures.load());
+    }
+    EXPECT_TRUE(v.u.a.e[0].flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(v.u.a.e[0].u.o.m == v.u.a.e[1].u.o.m);
+    EXPECT_TRUE(v.u.a.e[3].u.o.m[1].v.flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(v.u.a.e[3].u.o.m[1].v.u.a.e == v.u.a.e[0].u.o.m[1].v.u.a.e);
+
+    /* 共享节点的副本只增加引用计数 */
+    frost_copy(&c, &v.u.a.e[0]);
+    EXPECT_TRUE(c.u.o.m == v.u.a.e[0].u.o.m);
+
+    /* 经 frost_mutable_* 取出的元素先写时复制, 其他引用者不受影响 */
+    frost_set_string(frost_mutable_object_value(&c, frost_find_object_index(&c, "name", 4)), "copy", 4);
+    EXPECT_FALSE(c.flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(c.u.o.m != v.u.a.e[0].u.o.m);
+    frost_set_number(frost_pushback_array_element(frost_mutable_object_value(frost_mutable_array_element(&v, 1), 1)), 1.0);
+    EXPECT_EQ_SIZE_T(3, frost_get_array_size(frost_find_object_value(&v.u.a.e[1], "tags", 4)));
+    EXPECT_EQ_SIZE_T(2, frost_get_array_size(&v.u.a.e[2].u.o.m[1].v));
+    EXPECT_EQ_STRING("frostjson", frost_get_string(&v.u.a.e[0].u.o.m[0].v), 9);
+    EXPECT_EQ_STRING("copy", frost_get_string(frost_get_object_value(&c, 0)), 4);
+    EXPECT_TRUE(v.u.a.e[0].u.o.m == v.u.a.e[2].u.o.m);
+    frost_set_string(frost_mutable_object_value(&v.u.a.e[2], 0), "third", 5);
+    EXPECT_FALSE(v.u.a.e[2].flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(v.u.a.e[0].u.o.m != v.u.a.e[2].u.o.m);
+    EXPECT_EQ_STRING("frostjson", frost_get_string(&v.u.a.e[0].u.o.m[0].v), 9);
+    frost_clear_array(frost_find_object_value(&v.u.a.e[3], "tags", 4));
+    EXPECT_EQ_SIZE_T(2, frost_get_array_size(&v.u.a.e[0].u.o.m[1].v));
+    frost_free(&v);
+    EXPECT_EQ_SIZE_T(2, frost_get_array_size(frost_find_object_value(&c, "tags", 4)));
+    frost_free(&c);
+
+    /* frost_share 与 frost_unshare */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "{\"a\":[1,\"s\",{\"b\":[]}],\"c\":\"d\"}"));
+    frost_share(&v);
+    EXPECT_TRUE(v.flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(v.u.o.m[0].v.flags & FROST_FLAG_SHARED);
+    frost_copy(&c, &v);
+    frost_unshare(&v);
+    EXPECT_FALSE(v.flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(v.u.o.m[0].v.flags & FROST_FLAG_SHARED);
+    EXPECT_TRUE(v.u.o.m[0].v.u.a.e == c.u.o.m[0].v.u.a.e);
+    frost_remove_object_value(&v, 0);
+    EXPECT_TRUE(frost_is_equal(&c.u.o.m[1].v, &v.u.o.m[0].v));
+    frost_free(&c);
+    frost_unshare(&v);
+    frost_free(&v);
+
+    /* 共享块中的延迟数字: 写时复制出的一层另持一份堆上的文本 */
+    {
+        frost_parse_options raw = {};
+        raw.flags = FROST_PARSE_RAW_NUMBERS;
+        char* json;
+        size_t length;
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, "[[1.00000000000000000001,2.0],[1.00000000000000000001,2.0]]", &raw));
+        EXPECT_TRUE(frost_dedup(&v) > 0);
+        EXPECT_TRUE(v.u.a.e[0].u.a.e == v.u.a.e[1].u.a.e);
+        frost_set_number(frost_mutable_array_element(frost_mutable_array_element(&v, 0), 1), 3.0);
+        json = frost_stringify(&v, &length);
+        EXPECT_EQ_STRING("[[1.00000000000000000001,3],[1.00000000000000000001,2.0]]", json, length);
+        free(json);
+        frost_free(&v);
+    }
+}
+
+static void test_dedup_patch() {
+    frost_value v, patch, expect;
+    frost_parse_options opt = {};
+    opt.flags = FROST_PARSE_DEDUP;
+    frost_init(&v);
+    frost_init(&patch);
+    frost_init(&expect);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, "{\"a\":{\"x\":[1,2,3]},\"b\":{\"x\":[1,2,3]}}", &opt));
+    EXPECT_TRUE(v.u.o.m[0].v.u.o.m == v.u.o.m[1].v.u.o.m);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&patch, "[{\"op\":\"replace\",\"path\":\"/a/x/1\",\"value\":9},{\"op\":\"remove\",\"path\":\"/b/x/0\"}]"));
+    EXPECT_EQ_INT(FROST_PATCH_OK, frost_apply_patch(&v, &patch));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&expect, "{\"a\":{\"x\":[1,9,3]},\"b\":{\"x\":[2,3]}}"));
+    EXPECT_TRUE(frost_is_equal(&v, &expect));
+    frost_free(&patch);
+
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&patch, "{\"a\":{\"y\":1}}"));
+    frost_dedup(&expect);
+    frost_apply_merge_patch(&expect, &patch);
+    frost_free(&patch);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&patch, "{\"a\":{\"x\":[1,9,3],\"y\":1},\"b\":{\"x\":[2,3]}}"));
+    EXPECT_TRUE(frost_is_equal(&expect, &patch));
+    frost_free(&v);
+    frost_free(&patch);
+    frost_free(&expect);
+}
+
+static void test_dedup() {
+    test_dedup_shape();
+    test_dedup_share();
+    test_dedup_patch();
+}
+
+/* 节点在紧凑块中按先序排列: 每个共享块都在前一个之后 */
+static auto compact_order(const frost_value* v, const char** last) -> int {
+    size_t i;
+    const char* p = nullptr;
+    if (v->type == FROST_STRING)
+        p = v->u.s.s;
+    else if (v->type == FROST_ARRAY && v->u.a.size > 0)
+        p = (const char*)v->u.a.e;
+    else if (v->type == FROST_OBJECT && v->u.o.size > 0)
+        p = (const char*)v->u.o.m;
+    if (p == nullptr)
+        return 1;
+    if ((v->flags & FROST_FLAG_ARENA) == 0 || p <= *last)
+        return 0;
+    *last = p;
+    for (i = 0; v->type == FROST_ARRAY && i < v->u.a.size; i++)
+        if (compact_order(&v->u.a.e[i], last) == 0)
+            return 0;
+    /* 键紧跟在对象的成员之后 */
+    for (i = 0; v->type == FROST_OBJECT && i < v->u.o.size; i++)
+        if (v->u.o.m[i].k < p + v->u.o.size * sizeof(frost_member))
+            return 0;
+    for (i = 0; v->type == FROST_OBJECT && i < v->u.o.size; i++)
+        if (compact_order(&v->u.o.m[i].v, last) == 0)
+            return 0;
+    return 1;
+}
+
+static void test_compact() {
+    frost_value v, c, expect;
+    const char* last = nullptr;
+    char* json;
+    size_t length;
+    frost_init(&v);
+    frost_init(&c);
+    frost_init(&expect);
+    const char* text = "{\"name\":\"frostjson\",\"tags\":[\"json\",\"parser\",[],{}],\"nested\":{\"a\":[1,2,3],\"b\":\"x\"},\"n\":null}";
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, text));
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&expect, text));
+    EXPECT_TRUE(frost_compact(&v) > 0);
+    EXPECT_TRUE(compact_order(&v, &last));
+    EXPECT_EQ_SIZE_T(v.u.o.size, v.u.o.capacity);
+    EXPECT_EQ_SIZE_T(0, v.u.o.m[1].v.u.a.e[2].u.a.capacity);
+    EXPECT_TRUE(frost_is_equal(&v, &expect));
+    EXPECT_EQ_SIZE_T(0, frost_compact(&v));
+    json = frost_stringify(&v, &length);
+    EXPECT_EQ_STRING("{\"name\":\"frostjson\",\"tags\":[\"json\",\"parser\",[],{}],\"nested\":{\"a\":[1,2,3],\"b\":\"x\"},\"n\":null}", json, length);
+    free(json);
+
+    /* 紧凑化的结果仍是独占的: 查找与元素的原地修改都留在紧凑块中, 改变大小时才复制出那一层 */
+    {
+        const frost_member* m = v.u.o.m;
+        frost_value* tags = frost_find_object_value(&v, "tags", 4);
+        const frost_value* e = tags->u.a.e;
+        EXPECT_TRUE(v.u.o.m == m);
+        EXPECT_TRUE((v.flags & FROST_FLAG_SHARED) == 0 && (v.flags & FROST_FLAG_ARENA) != 0);
+        EXPECT_EQ_STRING("json", frost_get_string(frost_get_array_element(tags, 0)), 4);
+        EXPECT_TRUE(frost_get_object_value(&v, 2) == &m[2].v);
+        EXPECT_TRUE(frost_find_pointer_value(&v, "/nested/a/1", 11) == &m[2].v.u.o.m[0].v.u.a.e[1]);
+        frost_set_number(frost_set_object_value(&v, "n", 1), 0.0);
+        frost_set_null(frost_set_object_value(&v, "n", 1));
+        EXPECT_TRUE(v.u.o.m == m && tags->u.a.e == e);
+        EXPECT_TRUE(compact_order(&v, &(last = nullptr)));
+
+        /* 共享后只读的查找保持共享; 只剩一个引用时, frost_mutable_* 原地转为独占 */
+        frost_share(&v);
+        EXPECT_TRUE(v.u.o.m == m && (v.flags & FROST_FLAG_SHARED) != 0);
+        EXPECT_TRUE(frost_find_object_value(&v, "tags", 4) == tags && (v.flags & FROST_FLAG_SHARED) != 0);
+        EXPECT_TRUE(frost_mutable_object_value(&v, 1) == tags);
+        EXPECT_TRUE(v.u.o.m == m && (v.flags & FROST_FLAG_SHARED) == 0 && (v.flags & FROST_FLAG_ARENA) != 0);
+
+        /* 仍被共享时只复制被访问的一层, 子值留在紧凑块中 */
+        frost_share(&v);
+        frost_copy(&c, &v);
+        EXPECT_TRUE(frost_mutable_object_value(&c, 1)->u.a.e == e);
+        EXPECT_TRUE(c.u.o.m != m && (c.flags & FROST_FLAG_ARENA) == 0);
+        EXPECT_TRUE(v.u.o.m == m);
+        frost_free(&c);
+
+        /* 改变大小时那一层复制回单独的分配 */
+        EXPECT_TRUE(frost_mutable_object_value(&v, 1) == tags && v.u.o.m == m);
+        frost_set_number(frost_pushback_array_element(tags), 1.0);
+        EXPECT_TRUE(tags->u.a.e != e && (tags->flags & FROST_FLAG_ARENA) == 0);
+        frost_popback_array_element(tags);
+        EXPECT_TRUE(frost_is_equal(&v, &expect));
+        EXPECT_TRUE(frost_compact(&v) > 0);
+        EXPECT_TRUE(v.u.o.m == m && (tags->flags & FROST_FLAG_ARENA) != 0);
+
+        /* 补丁取下与放回紧凑块中对象的成员 (键在紧凑块中), 失败时回滚 */
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&c,
+            "[{\"op\":\"remove\",\"path\":\"/nested/b\"},{\"op\":\"test\",\"path\":\"/n\",\"value\":1}]"));
+        EXPECT_EQ_INT(FROST_PATCH_TEST_FAILED, frost_apply_patch(&v, &c));
+        EXPECT_TRUE(frost_is_equal(&v, &expect));
+        EXPECT_TRUE(v.u.o.m == m);
+        frost_free(&c);
+    }
+
+    /* 共享后副本共用紧凑块, 修改时写时复制 (独占时也要复制紧凑块中的键) */
+    frost_share(&v);
+    frost_copy(&c, &v);
+    EXPECT_TRUE(c.u.o.m == v.u.o.m);
+    frost_set_string(frost_mutable_object_value(&c, 0), "copy", 4);
+    EXPECT_EQ_STRING("frostjson", frost_get_string(frost_find_object_value(&v, "name", 4)), 9);
+    frost_set_number(frost_pushback_array_element(frost_mutable_object_value(&v, 1)), 1.0);
+    frost_remove_object_value(frost_mutable_object_value(&v, 2), 0);
+    frost_free(&c);
+    frost_remove_object_value(&v, 3);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&c, "{\"name\":\"frostjson\",\"tags\":[\"json\",\"parser\",[],{},1],\"nested\":{\"b\":\"x\"}}"));
+    EXPECT_TRUE(frost_is_equal(&v, &c));
+    frost_free(&c);
+    frost_free(&v);
+
+    /* 已共享的子树 (包括去重合并的) 保持原样, 紧凑后仍可冻结 */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&c, "[\"shared\",[1]]"));
+    frost_share(&c);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "[[\"long enough string\"],[\"long enough string\"]]"));
+    frost_copy(frost_pushback_array_element(&v), &c);
+    EXPECT_TRUE(frost_dedup(&v) > 0);
+    frost_set_string(frost_pushback_array_element(&v), "own", 3);
+    frost_compact(&v);
+    EXPECT_TRUE(v.u.a.e[2].u.a.e == c.u.a.e);
+    EXPECT_TRUE(v.u.a.e[0].u.a.e == v.u.a.e[1].u.a.e);
+    EXPECT_TRUE(v.u.a.e[3].flags & FROST_FLAG_ARENA);
+    frost_free(&c);
+    frost_freeze(&v);
+    EXPECT_EQ_STRING("shared", frost_get_string(frost_find_pointer_value(&v, "/2/0", 4)), 6);
+    frost_free(&v);
+
+    /* 标量与空容器 */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "1"));
+    EXPECT_EQ_SIZE_T(0, frost_compact(&v));
+    frost_free(&v);
+    frost_set_array(&v, 16);
+    EXPECT_TRUE(frost_compact(&v) >= 16 * sizeof(frost_value));
+    EXPECT_EQ_SIZE_T(0, v.u.a.capacity);
+    frost_set_number(frost_pushback_array_element(&v), 1.0);
+    EXPECT_EQ_SIZE_T(1, frost_get_array_size(&v));
+    frost_free(&v);
+    frost_free(&expect);
+}
+
+/* 整棵树都已冻结, 延迟数字的数值都已缓存 */
+static auto frozen_tree(const frost_value* v) -> int {
+    size_t i;
+    if ((v->flags & FROST_FLAG_FROZEN) == 0)
+        return 0;
+    switch (v->type) {
+    case FROST_NUMBER:
+        return (v->flags & FROST_FLAG_RAW_NUMBER) == 0 || (v->flags & FROST_FLAG_NUMBER_CACHED) != 0;
+    case FROST_ARRAY:
+        for (i = 0; i < v->u.a.size; i++)
+            if (frozen_tree(&v->u.a.e[i]) == 0)
+                return 0;
+        return 1;
+    case FROST_OBJECT:
+        for (i = 0; i < v->u.o.size; i++)
+            if (frozen_tree(&v->u.o.m[i].v) == 0)
+                return 0;
+        return 1;
+    default:
+        return 1;
+    }
+}
+
+static void test_freeze_value() {
+    frost_value v, c;
+    frost_parse_options raw = {};
+    raw.flags = FROST_PARSE_RAW_NUMBERS;
+    frost_init(&v);
+    frost_init(&c);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, "{\"a\":[1,2.5,{\"b\":\"c\"}],\"d\":[],\"e\":123456789012345678901234}", &raw));
+    frost_freeze(&v);
+    EXPECT_TRUE(frozen_tree(&v));
+
+    /* 读取不写入任何字段 */
+    EXPECT_EQ_DOUBLE(2.5, frost_get_number(frost_get_array_element(frost_find_object_value(&v, "a", 1), 1)));
+    EXPECT_EQ_STRING("c", frost_get_string(frost_find_pointer_value(&v, "/a/2/b", 6)), 1);
+    EXPECT_EQ_DOUBLE(1.2345678901234568e23, frost_get_number(frost_get_object_value(&v, 2)));
+    EXPECT_TRUE(frozen_tree(&v));
+
+    /* 副本可以修改, 原值不变 */
+    frost_copy(&c, &v);
+    EXPECT_FALSE(c.flags & FROST_FLAG_FROZEN);
+    EXPECT_TRUE(frost_is_equal(&c, &v));
+    frost_set_number(frost_pushback_array_element(frost_find_object_value(&c, "d", 1)), 1.0);
+    frost_set_string(frost_find_pointer_value(&c, "/a/2/b", 6), "x", 1);
+    EXPECT_FALSE(frost_is_equal(&c, &v));
+    EXPECT_EQ_SIZE_T(0, frost_get_array_size(frost_find_object_value(&v, "d", 1)));
+    EXPECT_TRUE(frozen_tree(&v));
+    frost_free(&c);
+    frost_free(&v);
+
+    /* 与其他文档共用的共享块: 写时复制出的子值不再只读 */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "[{\"k\":[1,2]},{\"k\":[1,2]}]"));
+    frost_dedup(&v);
+    frost_copy(&c, &v.u.a.e[0]);
+    frost_freeze(&v);
+    EXPECT_TRUE(frozen_tree(&v));
+    EXPECT_FALSE(c.flags & FROST_FLAG_FROZEN);
+    frost_set_number(frost_mutable_array_element(frost_mutable_object_value(&c, 0), 0), 3.0);
+    EXPECT_FALSE(frost_find_object_value(&c, "k", 1)->flags & FROST_FLAG_FROZEN);
+    EXPECT_EQ_DOUBLE(1.0, frost_get_number(frost_get_array_element(frost_find_object_value(&v.u.a.e[1], "k", 1), 0)));
+    EXPECT_EQ_DOUBLE(3.0, frost_get_number(frost_get_array_element(frost_find_object_value(&c, "k", 1), 0)));
+    frost_free(&v);
+    frost_free(&c);
+}
+
+static void test_freeze_snapshot_ptr() {
+    frost_value v;
+    frost_value* doc = nullptr;
+    frost_snapshot_ptr* ptr = nullptr;
+    std::atomic<int> done(0);
+    std::atomic<int> failures(0);
+    std::thread readers[4];
+    unsigned ticket = 0;
+    char json[64];
+    int i;
+
+    frost_init(&v);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "{\"n\":0,\"w\":[0,0]}"));
+    ptr = frost_snapshot_ptr_create(&v);
+    EXPECT_EQ_INT(FROST_NULL, frost_get_type(&v));
+    doc = frost_snapshot_ptr_acquire(ptr, &ticket);
+    EXPECT_TRUE(frozen_tree(doc));
+    EXPECT_EQ_DOUBLE(0.0, frost_get_number(frost_find_object_value(doc, "n", 1)));
+    frost_snapshot_ptr_release(ptr, ticket);
+
+    /* 读者不加锁地读取, 版本号不会倒退, 同一版本内各字段一致 */
+    for (auto& t : readers)
+        t = std::thread([&]() {
+            double last = 0.0;
+            while (done.load() == 0) {
+                unsigned tk = 0;
+                frost_value* d = frost_snapshot_ptr_acquire(ptr, &tk);
+                double n = frost_get_number(frost_find_object_value(d, "n", 1));
+                frost_value* w = frost_find_object_value(d, "w", 1);
+                if (n < last || frost_get_number(frost_get_array_element(w, 0)) != n
+                    || frost_get_number(frost_get_array_element(w, 1)) != n * 2)
+                    failures++;
+                last = n;
+                frost_snapshot_ptr_release(ptr, tk);
+            }
+        });
+    for (i = 1; i <= 200; i++) {
+        snprintf(json, sizeof(json), "{\"n\":%d,\"w\":[%d,%d]}", i, i, i * 2);
+        EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, json));
+        frost_snapshot_ptr_publish(ptr, &v);
+    }
+    done = 1;
+    for (auto& t : readers)
+        t.join();
+    EXPECT_EQ_INT(0, failures.load());
+    doc = frost_snapshot_ptr_acquire(ptr, &ticket);
+    EXPECT_EQ_DOUBLE(200.0, frost_get_number(frost_find_object_value(doc, "n", 1)));
+    frost_snapshot_ptr_release(ptr, ticket);
+    frost_snapshot_ptr_destroy(ptr);
+}
+
+static void test_freeze() {
+    test_freeze_value();
+    test_freeze_snapshot_ptr();
+}
+
+static void test_free_deferred() {
+    frost_parse_options raw = {};
+    raw.flags = FROST_PARSE_RAW_NUMBERS;
+    frost_value v, c;
+    std::string json = "[";
+    char buf[64];
+    for (size_t i = 0; i < 20000; i++) {
+        snprintf(buf, sizeof(buf), "%s{\"k%zu\":[\"s%zu\",3.14159265358979323846,{\"a\":null}]}", i > 0 ? "," : "", i, i);
+        json += buf;
+    }
+    json += "]";
+    frost_init(&v);
+    frost_init(&c);
+
+    /* 值被移出, 原处变为 null; 没有堆内存的值直接释放 */
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse_with_options(&v, json.c_str(), &raw));
+    frost_free_deferred(&v);
+    EXPECT_EQ_INT(FROST_NULL, frost_get_type(&v));
+    frost_set_number(&v, 1.0);
+    frost_free_deferred(&v);
+    EXPECT_EQ_INT(FROST_NULL, frost_get_type(&v));
+    frost_reclaim_drain();
+    EXPECT_EQ_SIZE_T(0, frost_reclaim_pending_bytes());
+
+    /* 多个回收线程分段释放大数组与大对象; 共享的子树在其他副本中仍然有效 */
+    frost_reclaim_threads(4);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, json.c_str()));
+    frost_dedup(&v);
+    frost_copy(&c, frost_get_array_element(&v, 7));
+    frost_free_deferred(&v);
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, ("{\"x\":" + json + ",\"s\":\"text\"}").c_str()));
+    frost_free_deferred(&v);
+    frost_set_string(&v, "string", 6);
+    frost_free_deferred(&v);
+    frost_reclaim_drain();
+    EXPECT_EQ_SIZE_T(0, frost_reclaim_pending_bytes());
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, "{\"k7\":[\"s7\",3.14159265358979323846,{\"a\":null}]}"));
+    EXPECT_TRUE(frost_is_equal(&v, &c));
+    frost_free(&v);
+    frost_free(&c);
+
+    json = "{";
+    for (size_t i = 0; i < 10000; i++) {
+        snprintf(buf, sizeof(buf), "%s\"key%zu\":[%zu,\"value\"]", i > 0 ? "," : "", i, i);
+        json += buf;
+    }
+    json += "}";
+    EXPECT_EQ_INT(FROST_PARSE_OK, frost_parse(&v, json.c_str()));
+    frost_free_deferred(&v);
+    frost_reclaim_drain();
+    EXPECT_EQ_SIZE_T(0, frost_reclaim_pending_bytes());
+}
 
 auto main() -> int {
     test_parse();
     test_stringify();
     test_equal();
     test_copy();
+    test_parallel();
     test_move();
     test_swap();
     test_access();  
+    test_binary();
+    test_snapshot();
+    test_reader();
+    test_writer();
+    test_array_stream();
+    test_bind();
+    test_key_table();
+    test_cpp_value();
+    test_sort_object();
+    test_parse_projected();
+    test_validate();
+    test_query();
+    test_patch();
+    test_dedup();
+    test_compact();
+    test_freeze();
+    test_free_deferred();
     printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);
     return main_ret;
 }
\ No newline at end of file